@@ -26,7 +26,34 @@ def draw_bar(height, value=None, legend=None, time=None, speedup=None, color=Non
     print(output)
 
 
+def plot_kvbench(path):
+    # kvbench's CSV has a row per interval per operation; plot each
+    # interval's throughput and tail latency over all operations
+    with open(path, 'r', newline='') as file:
+        data = [row for row in csv.DictReader(file) if row["op"] == "all"]
+
+    if len(data) == 0:
+        print(f"{Colors.FAIL}ERROR: No kvbench results in {path}.{Colors.ENDC}")
+        sys.exit(1)
+
+    print("kvbench Results")
+    print("===============")
+
+    peak = max(float(row["ops_per_sec"]) for row in data)
+    for row in data:
+        height = round(float(row["ops_per_sec"]) / peak * 50)
+        color = Colors.FAIL if int(row["errors"]) > 0 else None
+        draw_bar(height, legend=f"{row['time_s']}s", color=color)
+        print(f"\t{row['ops_per_sec']} ops/second, p99 {row['p99_us']}us, "
+              f"max {row['max_us']}us, {row['errors']} errors")
+
+
 if __name__ == "__main__":
+    # `python3 plot_performance.py kvbench.csv` plots kvbench's results
+    if len(sys.argv) > 1:
+        plot_kvbench(sys.argv[1])
+        sys.exit(0)
+
     path = "performance-runtime.csv"
     with open(path, 'r', newline='') as file:
         # assuming the csv file has columns: test, time
@@ -0,0 +1,278 @@
+#include "client/async_client.hpp"
+
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "common/color.hpp"
+#include "net/network_helpers.hpp"
+
+AsyncConn::~AsyncConn() {
+  if (this->conn) {
+    this->loop.unwatch(this->conn->fd);
+    this->conn->close();
+  }
+  this->loop.cancel(this);
+}
+
+bool AsyncConn::connect() {
+  // A shared memory channel can't be waited on with epoll
+  if (this->server_addr.rfind(SHM_SCHEME, 0) == 0) {
+    cerr_color(RED, "AsyncClient doesn't support ", SHM_SCHEME,
+               " addresses; use ", UNIX_SCHEME, " instead.");
+    return false;
+  }
+  this->conn = connect_to_server(this->server_addr);
+  if (!this->conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return false;
+  }
+
+  int flags = fcntl(this->conn->fd, F_GETFL);
+  if (flags < 0 || fcntl(this->conn->fd, F_SETFL, flags | O_NONBLOCK) < 0 ||
+      !this->loop.watch(this->conn->fd, this, EPOLLIN)) {
+    perror_color(RED, "Failed to set up connection");
+    this->conn->close();
+    this->conn.reset();
+    return false;
+  }
+  this->want_write = false;
+  return true;
+}
+
+bool AsyncConn::start(const Message& msg, std::coroutine_handle<> waiter,
+                      std::optional<Response>* response) {
+  if (!this->conn && !this->connect()) return false;
+
+  uint64_t header = pack_header(msg);
+  auto* header_bytes = reinterpret_cast<const std::byte*>(&header);
+  this->out.insert(this->out.end(), header_bytes,
+                   header_bytes + sizeof(header));
+  this->out.insert(this->out.end(), msg.buf.begin(), msg.buf.end());
+  this->pending.push_back({waiter, response});
+
+  if (!this->flush_deferred) {
+    this->flush_deferred = true;
+    this->loop.defer(this);
+  }
+  return true;
+}
+
+void AsyncConn::on_deferred() {
+  this->flush_deferred = false;
+  if (this->conn) this->flush();
+}
+
+void AsyncConn::on_events(uint32_t events) {
+  if (!this->conn) return;
+  if (events & EPOLLOUT) {
+    this->flush();
+    if (!this->conn) return;
+  }
+  if (events & (EPOLLIN | EPOLLERR | EPOLLHUP)) this->receive();
+}
+
+void AsyncConn::flush() {
+  while (this->out_offset < this->out.size()) {
+    ssize_t n = ::send(this->conn->fd, this->out.data() + this->out_offset,
+                       this->out.size() - this->out_offset, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Wait for room in the socket
+        if (!this->want_write) {
+          this->want_write = true;
+          this->loop.watch(this->conn->fd, this, EPOLLIN | EPOLLOUT);
+        }
+        return;
+      }
+      this->fail();
+      return;
+    }
+    this->out_offset += n;
+  }
+
+  this->out.clear();
+  this->out_offset = 0;
+  if (this->want_write) {
+    this->want_write = false;
+    this->loop.watch(this->conn->fd, this, EPOLLIN);
+  }
+}
+
+void AsyncConn::receive() {
+  // Shared by all connections on the thread, since only one reads at a time
+  static thread_local std::array<std::byte, 64 << 10> buf;
+
+  while (true) {
+    ssize_t n = ::recv(this->conn->fd, buf.data(), buf.size(), 0);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      this->fail();
+      return;
+    }
+    if (n == 0) {
+      this->fail();
+      return;
+    }
+    this->in.insert(this->in.end(), buf.data(), buf.data() + n);
+    // A short read means the socket is (very likely) empty
+    if (size_t(n) < buf.size()) break;
+  }
+
+  while (this->in.size() - this->in_offset >= MESSAGE_HEADER_SIZE) {
+    uint64_t header;
+    memcpy(&header, this->in.data() + this->in_offset, sizeof(header));
+    Message msg;
+    unpack_header(header, &msg);
+    if (msg.sz > this->conn->max_message_size || this->pending.empty()) {
+      this->fail();
+      return;
+    }
+    size_t body = this->in_offset + MESSAGE_HEADER_SIZE;
+    if (this->in.size() - body < msg.sz) break;
+
+    msg.buf.assign(this->in.begin() + body, this->in.begin() + body + msg.sz);
+    this->in_offset = body + msg.sz;
+    std::optional<Response> res = deserialize_response(msg);
+    if (!res) {
+      this->fail();
+      return;
+    }
+
+    // Resumed by the loop rather than here, since it may well send another
+    // request on this connection
+    Pending waiting = this->pending.front();
+    this->pending.pop_front();
+    *waiting.response = std::move(*res);
+    this->loop.schedule(waiting.waiter);
+  }
+
+  if (this->in_offset == this->in.size()) {
+    this->in.clear();
+  } else {
+    this->in.erase(this->in.begin(), this->in.begin() + this->in_offset);
+  }
+  this->in_offset = 0;
+}
+
+void AsyncConn::fail() {
+  if (!this->pending.empty()) {
+    cerr_color(YELLOW, "Lost connection to KvServer at ", this->server_addr,
+               " with ", this->pending.size(), " requests in flight.");
+  }
+  for (const Pending& waiting : this->pending) {
+    this->loop.schedule(waiting.waiter);
+  }
+  this->pending.clear();
+
+  this->loop.unwatch(this->conn->fd);
+  this->conn->close();
+  this->conn.reset();
+  this->out.clear();
+  this->out_offset = 0;
+  this->in.clear();
+  this->in_offset = 0;
+}
+
+AsyncClient::AsyncClient(EventLoop& loop, const std::string& server_addr,
+                         size_t n_connections)
+    : server_addr(server_addr) {
+  for (size_t i = 0; i < std::max<size_t>(n_connections, 1); i++) {
+    this->conns.push_back(std::make_unique<AsyncConn>(loop, server_addr));
+  }
+}
+
+AsyncConn::Awaiter AsyncClient::Send(const Request& request) {
+  AsyncConn* conn = this->conns[this->next_conn].get();
+  this->next_conn = (this->next_conn + 1) % this->conns.size();
+  return conn->send(request);
+}
+
+// The requests below are named rather than passed to Send as temporaries,
+// which g++ 12 mishandles in co_await expressions (see Task).
+Task<std::optional<std::string>> AsyncClient::Get(std::string key) {
+  Request req = GetRequest{std::move(key)};
+  std::optional<Response> res = co_await this->Send(req);
+  if (!res) co_return std::nullopt;
+  if (auto* get_res = std::get_if<GetResponse>(&*res)) {
+    co_return std::move(get_res->value);
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to Get value from server: ", error_res->msg);
+  }
+  co_return std::nullopt;
+}
+
+Task<bool> AsyncClient::Put(std::string key, std::string value,
+                            uint64_t ttl_ms, std::string owner) {
+  Request req =
+      PutRequest{std::move(key), std::move(value), ttl_ms, std::move(owner)};
+  std::optional<Response> res = co_await this->Send(req);
+  if (!res) co_return false;
+  if (std::holds_alternative<PutResponse>(*res)) {
+    co_return true;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to Put value to server: ", error_res->msg);
+  }
+  co_return false;
+}
+
+Task<bool> AsyncClient::Append(std::string key, std::string value) {
+  Request req = AppendRequest{std::move(key), std::move(value)};
+  std::optional<Response> res = co_await this->Send(req);
+  if (!res) co_return false;
+  if (std::holds_alternative<AppendResponse>(*res)) {
+    co_return true;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to Append value to server: ", error_res->msg);
+  }
+  co_return false;
+}
+
+Task<std::optional<std::string>> AsyncClient::Delete(std::string key) {
+  Request req = DeleteRequest{std::move(key)};
+  std::optional<Response> res = co_await this->Send(req);
+  if (!res) co_return std::nullopt;
+  if (auto* delete_res = std::get_if<DeleteResponse>(&*res)) {
+    co_return std::move(delete_res->value);
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to Delete value on server: ", error_res->msg);
+  }
+  co_return std::nullopt;
+}
+
+Task<std::optional<std::vector<std::string>>> AsyncClient::MultiGet(
+    std::vector<std::string> keys) {
+  Request req = MultiGetRequest{std::move(keys)};
+  std::optional<Response> res = co_await this->Send(req);
+  if (!res) co_return std::nullopt;
+  if (auto* multiget_res = std::get_if<MultiGetResponse>(&*res)) {
+    co_return std::move(multiget_res->values);
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to MultiGet values on server: ", error_res->msg);
+  }
+  co_return std::nullopt;
+}
+
+Task<bool> AsyncClient::MultiPut(std::vector<std::string> keys,
+                                 std::vector<std::string> values,
+                                 uint64_t ttl_ms,
+                                 std::vector<std::string> owners) {
+  Request req = MultiPutRequest{std::move(keys), std::move(values), ttl_ms,
+                                std::move(owners)};
+  std::optional<Response> res = co_await this->Send(req);
+  if (!res) co_return false;
+  if (std::holds_alternative<MultiPutResponse>(*res)) {
+    co_return true;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to MultiPut values on server: ", error_res->msg);
+  }
+  co_return false;
+}
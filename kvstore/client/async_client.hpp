@@ -0,0 +1,155 @@
+#ifndef ASYNC_CLIENT_HPP
+#define ASYNC_CLIENT_HPP
+
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "client/event_loop.hpp"
+#include "client/task.hpp"
+#include "net/network_conn.hpp"
+
+/*
+ * A non-blocking connection to a KvServer, driven by an EventLoop. Any number
+ * of requests can be in flight on it at once: requests are sent back to back
+ * (all of those made in one loop iteration with a single send), and since the
+ * server answers a connection's requests in order, each response goes to the
+ * oldest request still waiting.
+ *
+ * The connection is made (blocking) when the first request is sent, and made
+ * again on the next request after it fails.
+ */
+class AsyncConn : public EventLoop::Handler {
+ public:
+  AsyncConn(EventLoop& loop, const std::string& server_addr)
+      : loop(loop), server_addr(server_addr) {
+  }
+  ~AsyncConn();
+
+  // co_await'ing this sends the request, and resumes with the server's
+  // response, or with no value if the connection fails first.
+  class Awaiter {
+   public:
+    // The request is serialized right away, so it needn't outlive this.
+    Awaiter(AsyncConn* conn, const Request& request)
+        : conn(conn), msg(serialize_request(request)) {
+    }
+    bool await_ready() const noexcept {
+      return false;
+    }
+    bool await_suspend(std::coroutine_handle<> waiter) {
+      return this->msg &&
+             this->conn->start(*this->msg, waiter, &this->response);
+    }
+    std::optional<Response> await_resume() {
+      return std::move(this->response);
+    }
+
+   private:
+    AsyncConn* conn;
+    std::optional<Message> msg;
+    std::optional<Response> response;
+  };
+
+  Awaiter send(const Request& request) {
+    return Awaiter(this, request);
+  }
+
+  void on_events(uint32_t events) override;
+  void on_deferred() override;
+
+  AsyncConn(const AsyncConn&) = delete;
+  AsyncConn& operator=(const AsyncConn&) = delete;
+
+ private:
+  // A request waiting for its response, which is stored in `response` before
+  // `waiter` is resumed.
+  struct Pending {
+    std::coroutine_handle<> waiter;
+    std::optional<Response>* response;
+  };
+
+  EventLoop& loop;
+  std::string server_addr;
+  std::shared_ptr<ServerConn> conn;
+  std::deque<Pending> pending;
+
+  // Serialized requests not yet (fully) sent.
+  std::vector<std::byte> out;
+  size_t out_offset = 0;
+  bool flush_deferred = false;
+  bool want_write = false;
+  // Received bytes not yet making up a whole response.
+  std::vector<std::byte> in;
+  size_t in_offset = 0;
+
+  // Queues `msg`, to be sent before the loop next waits. Returns false
+  // (without suspending `waiter`) if it can't be sent.
+  bool start(const Message& msg, std::coroutine_handle<> waiter,
+             std::optional<Response>* response);
+  bool connect();
+  // Sends as much of `out` as the socket takes.
+  void flush();
+  // Reads what's been received, and resumes the requests it answers.
+  void receive();
+  // Closes the connection, and resumes all pending requests with no value.
+  void fail();
+};
+
+/*
+ * A client for one KvServer whose operations are coroutines, so that one
+ * thread can keep many requests in flight, e.g. across many servers with one
+ * AsyncClient each on the same EventLoop:
+ *
+ *   Task<> put_and_get(AsyncClient& client) {
+ *     co_await client.Put("key", "value");
+ *     std::optional<std::string> value = co_await client.Get("key");
+ *   }
+ *
+ *   EventLoop loop;
+ *   AsyncClient client(loop, "localhost:1234");
+ *   loop.spawn(put_and_get(client));
+ *   loop.run();
+ *
+ * (Coroutine lambdas shouldn't capture anything: the captures live in the
+ * lambda, which is usually gone by the time the coroutine runs.)
+ *
+ * Results are as for SimpleClient. Requests are spread over `n_connections`
+ * connections to the server, and the client must outlive them.
+ */
+class AsyncClient {
+ public:
+  AsyncClient(EventLoop& loop, const std::string& server_addr,
+              size_t n_connections = 1);
+
+  Task<std::optional<std::string>> Get(std::string key);
+
+  Task<bool> Put(std::string key, std::string value, uint64_t ttl_ms = 0,
+                 std::string owner = "");
+
+  Task<bool> Append(std::string key, std::string value);
+
+  Task<std::optional<std::string>> Delete(std::string key);
+
+  Task<std::optional<std::vector<std::string>>> MultiGet(
+      std::vector<std::string> keys);
+
+  Task<bool> MultiPut(std::vector<std::string> keys,
+                      std::vector<std::string> values, uint64_t ttl_ms = 0,
+                      std::vector<std::string> owners = {});
+
+  // Sends any request, and resumes with the server's response.
+  AsyncConn::Awaiter Send(const Request& request);
+
+ private:
+  std::string server_addr;
+  std::vector<std::unique_ptr<AsyncConn>> conns;
+  // The connection the next request goes on.
+  size_t next_conn = 0;
+};
+
+#endif /* end of include guard */
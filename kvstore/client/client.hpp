@@ -1,7 +1,9 @@
 #ifndef CLIENT_HPP
 #define CLIENT_HPP
 
+#include <cstdint>
 #include <iostream>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
@@ -14,7 +16,11 @@ class Client {
 
   virtual std::optional<std::string> Get(const std::string& key) = 0;
 
-  virtual bool Put(const std::string& key, const std::string& value) = 0;
+  // A non-zero `ttl_ms` makes the key(s) expire that many milliseconds later.
+  // A non-empty `owner` (or entry of `owners`, which is either empty or has
+  // one per key) is the user the key belongs to (see DeleteByOwner).
+  virtual bool Put(const std::string& key, const std::string& value,
+                   uint64_t ttl_ms = 0, const std::string& owner = "") = 0;
 
   virtual bool Append(const std::string& key, const std::string& value) = 0;
 
@@ -24,8 +30,39 @@ class Client {
       const std::vector<std::string>& keys) = 0;
 
   virtual bool MultiPut(const std::vector<std::string>& keys,
-                        const std::vector<std::string>& values) = 0;
+                        const std::vector<std::string>& values,
+                        uint64_t ttl_ms = 0,
+                        const std::vector<std::string>& owners = {}) = 0;
 
+  // Returns the key-value pairs with start <= key < end (an empty `end` means
+  // no upper bound), at most `limit` of them (0 for no limit).
+  virtual std::optional<std::map<std::string, std::string>> ScanRange(
+      const std::string& start, const std::string& end, size_t limit = 0) = 0;
+
+  // Sets `key` to `value` if its current value is `expected`, and returns
+  // whether it did. If it didn't, `actual` (if given) is set to the current
+  // value, which is empty if the key doesn't exist.
+  virtual std::optional<bool> Cas(const std::string& key,
+                                  const std::string& expected,
+                                  const std::string& value,
+                                  std::string* actual = nullptr) = 0;
+
+  // Adds `delta` to the integer at `key` (0 if it doesn't exist), and returns
+  // the result. Negative deltas decrement.
+  virtual std::optional<int64_t> Incr(const std::string& key,
+                                      int64_t delta = 1) = 0;
+
+  // Puts `value` at `key` if it doesn't exist yet, and returns whether it did.
+  // If it didn't, `actual` (if given) is set to the existing value.
+  virtual std::optional<bool> PutIfAbsent(const std::string& key,
+                                          const std::string& value,
+                                          uint64_t ttl_ms = 0,
+                                          std::string* actual = nullptr) = 0;
+
+  // Deletes all of the keys written with `owner` as their owner in one
+  // request per server, and returns the keys that were deleted.
+  virtual std::optional<std::vector<std::string>> DeleteByOwner(
+      const std::string& owner) = 0;
   virtual bool GDPRDelete(const std::string& user) = 0;
 };
 
@@ -0,0 +1,36 @@
+#include "cascommand.hpp"
+
+void CasCommand::handle(const std::string& s) {
+  std::vector<std::string> tokens = split(s);
+  if (tokens.size() < 3) {
+    cerr_color(RED, "Missing key, expected value and/or value. ", usage());
+    return;
+  } else if (tokens.size() > 3) {
+    cerr_color(RED, "Too many parameters. ", usage());
+    return;
+  }
+
+  std::string actual;
+  auto res = this->client->Cas(tokens[0], tokens[1], tokens[2], &actual);
+  if (!res) {
+    return;
+  }
+
+  if (*res) {
+    std::cout << "Swapped" << '\n';
+  } else {
+    std::cout << "Not swapped, current value: " << actual << '\n';
+  }
+}
+
+std::string CasCommand::name() const {
+  return "cas";
+}
+
+std::string CasCommand::params() const {
+  return "<key> <expected> <value>";
+}
+
+std::string CasCommand::description() const {
+  return "Sets <key> to <value> if its current value is <expected>";
+}
@@ -0,0 +1,33 @@
+#include "deleteownercommand.hpp"
+
+void DeleteOwnerCommand::handle(const std::string& s) {
+  std::vector<std::string> tokens = split(s);
+  if (tokens.size() == 0) {
+    cerr_color(RED, "Missing owner. ", usage());
+    return;
+  } else if (tokens.size() > 1) {
+    cerr_color(RED, "Too many parameters. ", usage());
+    return;
+  }
+
+  auto res = this->client->DeleteByOwner(tokens[0]);
+  if (!res) {
+    return;
+  }
+
+  std::cout << "Deleted " << res->size() << " key(s):\n";
+  for (auto&& key : *res) std::cout << key << '\n';
+}
+
+std::string DeleteOwnerCommand::name() const {
+  return "deleteowner";
+}
+
+std::string DeleteOwnerCommand::params() const {
+  return "<owner>";
+}
+
+std::string DeleteOwnerCommand::description() const {
+  return "Deletes every key that was written with <owner> as its owner, in a "
+         "single request";
+}
@@ -0,0 +1,37 @@
+#include "incrcommand.hpp"
+
+void IncrCommand::handle(const std::string& s) {
+  std::vector<std::string> tokens = split(s);
+  if (tokens.size() == 0) {
+    cerr_color(RED, "Missing key. ", usage());
+    return;
+  } else if (tokens.size() > 2) {
+    cerr_color(RED, "Too many parameters. ", usage());
+    return;
+  }
+
+  std::optional<int64_t> delta = tokens.size() == 2 ? parse_int(tokens[1]) : 1;
+  if (!delta) {
+    cerr_color(RED, "Delta must be an integer. ", usage());
+    return;
+  }
+
+  auto res = this->client->Incr(tokens[0], *delta);
+  if (!res) {
+    return;
+  }
+
+  std::cout << *res << '\n';
+}
+
+std::string IncrCommand::name() const {
+  return "incr";
+}
+
+std::string IncrCommand::params() const {
+  return "<key> [delta]";
+}
+
+std::string IncrCommand::description() const {
+  return "Adds [delta] (default 1, may be negative) to the integer at <key>";
+}
@@ -0,0 +1,38 @@
+#include "putifabsentcommand.hpp"
+
+void PutIfAbsentCommand::handle(const std::string& s) {
+  std::vector<std::string> tokens = split(s);
+  if (tokens.size() < 2) {
+    cerr_color(RED, "Missing key and/or value. ", usage());
+    return;
+  }
+
+  std::string val;
+  for (size_t i = 1; i < tokens.size(); i++) val.append(tokens[i] + " ");
+  // remove trailing whitespace
+  val.pop_back();
+
+  std::string actual;
+  auto res = this->client->PutIfAbsent(tokens[0], val, 0, &actual);
+  if (!res) {
+    return;
+  }
+
+  if (*res) {
+    std::cout << "Inserted" << '\n';
+  } else {
+    std::cout << "Already exists, value: " << actual << '\n';
+  }
+}
+
+std::string PutIfAbsentCommand::name() const {
+  return "putifabsent";
+}
+
+std::string PutIfAbsentCommand::params() const {
+  return "<key> <value>";
+}
+
+std::string PutIfAbsentCommand::description() const {
+  return "Sets <key> to <value> if <key> doesn't exist yet";
+}
@@ -0,0 +1,45 @@
+#include "scancommand.hpp"
+
+void ScanCommand::handle(const std::string& s) {
+  std::vector<std::string> tokens = split(s);
+  if (tokens.size() == 0) {
+    cerr_color(RED, "Missing start key. ", usage());
+    return;
+  } else if (tokens.size() > 3) {
+    cerr_color(RED, "Too many parameters. ", usage());
+    return;
+  } else if (tokens.size() == 3 && !is_number(tokens[2])) {
+    cerr_color(RED, "Limit must be a number. ", usage());
+    return;
+  }
+
+  // A start key ending in '*' scans that prefix
+  std::string start = tokens[0], end;
+  if (start.back() == '*') {
+    start.pop_back();
+    end = prefix_end(start);
+  }
+  if (tokens.size() >= 2 && tokens[1] != "-") end = tokens[1];
+  size_t limit = tokens.size() == 3 ? std::stoul(tokens[2]) : 0;
+
+  auto res = this->client->ScanRange(start, end, limit);
+  if (!res) {
+    return;
+  }
+
+  std::cout << "Got " << res->size() << " pair(s):\n";
+  for (auto&& [key, value] : *res) std::cout << key << ": " << value << '\n';
+}
+
+std::string ScanCommand::name() const {
+  return "scan";
+}
+
+std::string ScanCommand::params() const {
+  return "<start|prefix*> [end|-] [limit]";
+}
+
+std::string ScanCommand::description() const {
+  return "Lists the key-value pairs from <start> up to (but excluding) <end>, "
+         "or those whose keys start with <prefix>, in key order";
+}
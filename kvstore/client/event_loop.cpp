@@ -0,0 +1,160 @@
+#include "client/event_loop.hpp"
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+
+#include "common/color.hpp"
+
+// A coroutine that nobody awaits, which frees itself when it's done.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() {
+      return {};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {
+    }
+    void unhandled_exception() {
+      std::terminate();
+    }
+  };
+};
+
+static Detached run_detached(Task<void> task, size_t* n_running) {
+  co_await task;
+  (*n_running)--;
+}
+
+EventLoop::EventLoop() {
+  this->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (this->epoll_fd < 0) {
+    perror_color(RED, "epoll_create1");
+    exit(EXIT_FAILURE);
+  }
+  // steady_clock is CLOCK_MONOTONIC
+  this->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.ptr = nullptr;
+  if (this->timer_fd < 0 ||
+      epoll_ctl(this->epoll_fd, EPOLL_CTL_ADD, this->timer_fd, &event) < 0) {
+    perror_color(RED, "timerfd");
+    exit(EXIT_FAILURE);
+  }
+}
+
+EventLoop::~EventLoop() {
+  close(this->timer_fd);
+  close(this->epoll_fd);
+}
+
+void EventLoop::spawn(Task<void> task) {
+  this->n_running++;
+  run_detached(std::move(task), &this->n_running);
+}
+
+void EventLoop::run() {
+  std::array<struct epoll_event, 64> events;
+  while (true) {
+    // Resume what's ready, then let handlers act on what it did (e.g. send
+    // the requests it made), which may make more ready, as may sleepers
+    // coming due. The timer is set for the rest before the loop waits.
+    this->fire_timers();
+    while (!this->ready.empty() || !this->deferred.empty()) {
+      while (!this->ready.empty()) {
+        std::coroutine_handle<> handle = this->ready.front();
+        this->ready.pop_front();
+        handle.resume();
+      }
+      std::vector<Handler*> deferred;
+      deferred.swap(this->deferred);
+      for (Handler* handler : deferred) handler->on_deferred();
+      this->fire_timers();
+    }
+    if (this->n_running == 0) return;
+
+    int n = epoll_wait(this->epoll_fd, events.data(), events.size(), -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror_color(RED, "epoll_wait");
+      return;
+    }
+    for (int i = 0; i < n; i++) {
+      // The timer has no handler; fire_timers() takes care of it
+      if (!events[i].data.ptr) continue;
+      static_cast<Handler*>(events[i].data.ptr)->on_events(events[i].events);
+    }
+  }
+}
+
+void EventLoop::fire_timers() {
+  Clock::time_point now = Clock::now();
+  while (!this->timers.empty() && this->timers.top().when <= now) {
+    this->ready.push_back(this->timers.top().waiter);
+    this->timers.pop();
+  }
+
+  // Set (or clear) the timer for the next sleeper, if it changed
+  Clock::time_point next =
+      this->timers.empty() ? Clock::time_point() : this->timers.top().when;
+  if (next == this->timer_set_for) return;
+  this->timer_set_for = next;
+
+  // Drain the last setting's expiry first, so it doesn't wake the loop; if
+  // the new time has already passed, the timer fires right away
+  uint64_t expirations;
+  while (read(this->timer_fd, &expirations, sizeof(expirations)) > 0) {
+  }
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                next.time_since_epoch())
+                .count();
+  struct itimerspec spec = {};
+  spec.it_value.tv_sec = ns / 1'000'000'000;
+  spec.it_value.tv_nsec = ns % 1'000'000'000;
+  if (timerfd_settime(this->timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+    perror_color(RED, "timerfd_settime");
+  }
+}
+
+bool EventLoop::watch(int fd, Handler* handler, uint32_t events) {
+  struct epoll_event event = {};
+  event.events = events;
+  event.data.ptr = handler;
+  bool added = this->watched.count(fd);
+  if (epoll_ctl(this->epoll_fd, added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd,
+                &event) < 0) {
+    perror_color(RED, "epoll_ctl");
+    return false;
+  }
+  this->watched.insert(fd);
+  return true;
+}
+
+void EventLoop::unwatch(int fd) {
+  if (this->watched.erase(fd)) {
+    epoll_ctl(this->epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  }
+}
+
+void EventLoop::schedule(std::coroutine_handle<> handle) {
+  this->ready.push_back(handle);
+}
+
+void EventLoop::defer(Handler* handler) {
+  this->deferred.push_back(handler);
+}
+
+void EventLoop::cancel(Handler* handler) {
+  std::erase(this->deferred, handler);
+}
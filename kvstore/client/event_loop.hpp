@@ -0,0 +1,110 @@
+#ifndef EVENT_LOOP_HPP
+#define EVENT_LOOP_HPP
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <unordered_set>
+#include <vector>
+
+#include "client/task.hpp"
+
+/*
+ * A single-threaded event loop for AsyncClients. It runs coroutines (see
+ * Task), and resumes them as the responses they wait for arrive, so that one
+ * thread can keep many requests in flight. Nothing in it is thread-safe: use
+ * a loop, and the clients on it, from one thread.
+ */
+class EventLoop {
+ public:
+  // Something watching file descriptors on the loop.
+  class Handler {
+   public:
+    virtual ~Handler() = default;
+    // Called with the epoll events that occurred on a watched descriptor.
+    virtual void on_events(uint32_t events) = 0;
+    // Called (once) after defer(), before the loop next waits for events.
+    virtual void on_deferred() {
+    }
+  };
+
+  EventLoop();
+  ~EventLoop();
+
+  // Starts `task`. It runs until it first waits, then on the loop.
+  void spawn(Task<void> task);
+  // Runs the loop until all spawned tasks have finished.
+  void run();
+
+  // Watches `fd` for `events` (EPOLLIN, EPOLLOUT), on behalf of `handler`.
+  // Call again to change the events; returns false on error.
+  bool watch(int fd, Handler* handler, uint32_t events);
+  void unwatch(int fd);
+
+  // Resumes `handle` on the next loop iteration.
+  void schedule(std::coroutine_handle<> handle);
+  // Calls handler->on_deferred() before the loop next waits, e.g. to send
+  // all the requests queued until then at once. `cancel` undoes this.
+  void defer(Handler* handler);
+  void cancel(Handler* handler);
+
+  using Clock = std::chrono::steady_clock;
+
+  // co_await'ing this resumes the coroutine once `when` has passed (to within
+  // the kernel's timer slack, usually ~50us).
+  class SleepAwaiter {
+   public:
+    SleepAwaiter(EventLoop* loop, Clock::time_point when)
+        : loop(loop), when(when) {
+    }
+    bool await_ready() const noexcept {
+      return Clock::now() >= this->when;
+    }
+    void await_suspend(std::coroutine_handle<> waiter) {
+      this->loop->timers.push({this->when, waiter});
+    }
+    void await_resume() const noexcept {
+    }
+
+   private:
+    EventLoop* loop;
+    Clock::time_point when;
+  };
+
+  SleepAwaiter sleep_until(Clock::time_point when) {
+    return SleepAwaiter(this, when);
+  }
+
+  EventLoop(const EventLoop&) = delete;
+  EventLoop& operator=(const EventLoop&) = delete;
+
+ private:
+  int epoll_fd;
+  // The descriptors being watched.
+  std::unordered_set<int> watched;
+  // Spawned tasks that haven't finished.
+  size_t n_running = 0;
+  std::deque<std::coroutine_handle<>> ready;
+  std::vector<Handler*> deferred;
+
+  // Sleeping coroutines, soonest first, and a timerfd (watched like any
+  // other descriptor) set to wake the loop for the soonest.
+  struct Timer {
+    Clock::time_point when;
+    std::coroutine_handle<> waiter;
+    bool operator>(const Timer& other) const {
+      return this->when > other.when;
+    }
+  };
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers;
+  int timer_fd;
+  Clock::time_point timer_set_for;
+
+  // Schedules the timers that are due, and sets timer_fd for the next.
+  void fire_timers();
+};
+
+#endif /* end of include guard */
@@ -1,5 +1,9 @@
 #include "shardkv_client.hpp"
 
+#include <future>
+
+#include "common/utils.hpp"
+
 std::optional<std::string> ShardKvClient::Get(const std::string& key) {
   // Query shardcontroller for config
   auto config = this->Query();
@@ -12,7 +16,8 @@ std::optional<std::string> ShardKvClient::Get(const std::string& key) {
   return SimpleClient{*server}.Get(key);
 }
 
-bool ShardKvClient::Put(const std::string& key, const std::string& value) {
+bool ShardKvClient::Put(const std::string& key, const std::string& value,
+                        uint64_t ttl_ms, const std::string& owner) {
   // Query shardcontroller for config
   auto config = this->Query();
   if (!config) return false;
@@ -20,7 +25,7 @@ bool ShardKvClient::Put(const std::string& key, const std::string& value) {
   // find responsible server in config, then make Put request
   std::optional<std::string> server = config->get_server(key);
   if (!server) return false;
-  return SimpleClient{*server}.Put(key, value);
+  return SimpleClient{*server}.Put(key, value, ttl_ms, owner);
 }
 
 bool ShardKvClient::Append(const std::string& key, const std::string& value) {
@@ -45,6 +50,46 @@ std::optional<std::string> ShardKvClient::Delete(const std::string& key) {
   return SimpleClient{*server}.Delete(key);
 }
 
+std::optional<bool> ShardKvClient::Cas(const std::string& key,
+                                       const std::string& expected,
+                                       const std::string& value,
+                                       std::string* actual) {
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return std::nullopt;
+
+  // find responsible server in config, then make Cas request
+  std::optional<std::string> server = config->get_server(key);
+  if (!server) return std::nullopt;
+  return SimpleClient{*server}.Cas(key, expected, value, actual);
+}
+
+std::optional<int64_t> ShardKvClient::Incr(const std::string& key,
+                                           int64_t delta) {
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return std::nullopt;
+
+  // find responsible server in config, then make Incr request
+  std::optional<std::string> server = config->get_server(key);
+  if (!server) return std::nullopt;
+  return SimpleClient{*server}.Incr(key, delta);
+}
+
+std::optional<bool> ShardKvClient::PutIfAbsent(const std::string& key,
+                                               const std::string& value,
+                                               uint64_t ttl_ms,
+                                               std::string* actual) {
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return std::nullopt;
+
+  // find responsible server in config, then make PutIfAbsent request
+  std::optional<std::string> server = config->get_server(key);
+  if (!server) return std::nullopt;
+  return SimpleClient{*server}.PutIfAbsent(key, value, ttl_ms, actual);
+}
+
 std::optional<std::vector<std::string>> ShardKvClient::MultiGet(
     const std::vector<std::string>& keys) {
   std::vector<std::string> values;
@@ -54,11 +99,153 @@ std::optional<std::vector<std::string>> ShardKvClient::MultiGet(
 }
 
 bool ShardKvClient::MultiPut(const std::vector<std::string>& keys,
-                             const std::vector<std::string>& values) {
+                             const std::vector<std::string>& values,
+                             uint64_t ttl_ms,
+                             const std::vector<std::string>& owners) {
   // TODO (Part B, Step 3): Implement!
   return true;
 }
 
+std::optional<std::map<std::string, std::string>> ShardKvClient::ScanRange(
+    const std::string& start, const std::string& end, size_t limit) {
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return std::nullopt;
+
+  // Scan the servers with a shard that overlaps the range, in parallel
+  std::vector<std::future<std::optional<std::map<std::string, std::string>>>>
+      scans;
+  for (auto&& [server, shards] : config->server_to_shards) {
+    bool overlaps =
+        std::any_of(shards.begin(), shards.end(), [&](const Shard& shard) {
+          return may_overlap(shard, start, end);
+        });
+    if (!overlaps) continue;
+    std::string addr = server;
+    scans.push_back(std::async(std::launch::async, [=] {
+      return SimpleClient{addr}.ScanRange(start, end, limit);
+    }));
+  }
+
+  std::map<std::string, std::string> pairs;
+  bool ok = true;
+  for (auto&& scan : scans) {
+    auto res = scan.get();
+    if (!res) {
+      ok = false;
+      continue;
+    }
+    pairs.merge(*res);
+  }
+  if (!ok) return std::nullopt;
+
+  // Each server returned its first `limit` pairs; keep the first `limit` of
+  // all of them
+  if (limit && pairs.size() > limit) {
+    pairs.erase(std::next(pairs.begin(), limit), pairs.end());
+  }
+  return pairs;
+}
+
+bool ShardKvClient::AtomicMultiPut(const std::vector<std::string>& keys,
+                                   const std::vector<std::string>& values) {
+  if (keys.size() != values.size()) return false;
+
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return false;
+
+  // Group the writes by responsible server
+  std::map<std::string, TxnWrites> writes;
+  for (size_t i = 0; i < keys.size(); i++) {
+    std::optional<std::string> server = config->get_server(keys[i]);
+    if (!server) return false;
+    TxnWrites& w = writes[*server];
+    w.server = *server;
+    w.keys.push_back(keys[i]);
+    w.values.push_back(values[i]);
+  }
+
+  std::vector<TxnWrites> participants;
+  for (auto&& [server, w] : writes) participants.push_back(std::move(w));
+  return two_phase_commit(participants);
+}
+
+std::optional<std::vector<std::string>> ShardKvClient::DeleteByOwner(
+    const std::string& owner) {
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return std::nullopt;
+
+  // The owner's keys can be called anything, so any server may hold some;
+  // ask them all in parallel
+  std::vector<std::future<std::optional<std::vector<std::string>>>> deletes;
+  for (auto&& [server, shards] : config->server_to_shards) {
+    std::string addr = server;
+    deletes.push_back(std::async(std::launch::async, [=] {
+      return SimpleClient{addr}.DeleteByOwner(owner);
+    }));
+  }
+
+  std::vector<std::string> keys;
+  bool ok = true;
+  for (auto&& del : deletes) {
+    auto res = del.get();
+    if (!res) {
+      ok = false;
+      continue;
+    }
+    keys.insert(keys.end(), res->begin(), res->end());
+  }
+  if (!ok) return std::nullopt;
+  return keys;
+}
+
+std::optional<std::vector<BatchResult>> ShardKvClient::Batch(
+    std::vector<BatchOp> ops) {
+  // Query shardcontroller for config
+  auto config = this->Query();
+  if (!config) return std::nullopt;
+
+  // Group the ops by responsible server, remembering where each one came from
+  std::map<std::string, std::pair<std::vector<BatchOp>, std::vector<size_t>>>
+      batches;
+  for (size_t i = 0; i < ops.size(); i++) {
+    const std::string& key =
+        std::visit([](auto&& req) -> const std::string& { return req.key; },
+                   ops[i]);
+    std::optional<std::string> server = config->get_server(key);
+    if (!server) return std::nullopt;
+    auto& [server_ops, indices] = batches[*server];
+    server_ops.push_back(std::move(ops[i]));
+    indices.push_back(i);
+  }
+
+  std::vector<std::future<std::optional<std::vector<BatchResult>>>> sends;
+  for (auto&& [server, batch] : batches) {
+    std::string addr = server;
+    sends.push_back(std::async(std::launch::async, [&, addr] {
+      return SimpleClient{addr}.Batch(std::move(batch.first));
+    }));
+  }
+
+  std::vector<BatchResult> results(ops.size());
+  bool ok = true;
+  size_t i = 0;
+  for (auto&& [server, batch] : batches) {
+    auto res = sends[i++].get();
+    if (!res) {
+      ok = false;
+      continue;
+    }
+    for (size_t j = 0; j < res->size(); j++) {
+      results[batch.second[j]] = std::move((*res)[j]);
+    }
+  }
+  if (!ok) return std::nullopt;
+  return results;
+}
+
 // Shardcontroller functions
 std::optional<ShardControllerConfig> ShardKvClient::Query() {
   QueryRequest req;
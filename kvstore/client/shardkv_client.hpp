@@ -12,6 +12,7 @@
 #include "net/network_conn.hpp"
 #include "net/network_messages.hpp"
 #include "simple_client.hpp"
+#include "transaction.hpp"
 
 class ShardKvClient : public Client {
  public:
@@ -34,7 +35,8 @@ class ShardKvClient : public Client {
   // ShardKvStore functions
   std::optional<std::string> Get(const std::string& key);
 
-  bool Put(const std::string& key, const std::string& value);
+  bool Put(const std::string& key, const std::string& value,
+           uint64_t ttl_ms = 0, const std::string& owner = "");
 
   bool Append(const std::string& key, const std::string& value);
 
@@ -44,7 +46,36 @@ class ShardKvClient : public Client {
       const std::vector<std::string>& keys);
 
   bool MultiPut(const std::vector<std::string>& keys,
-                const std::vector<std::string>& values);
+                const std::vector<std::string>& values, uint64_t ttl_ms = 0,
+                const std::vector<std::string>& owners = {});
+
+  // Only asks the servers whose shards might hold keys in the range.
+  std::optional<std::map<std::string, std::string>> ScanRange(
+      const std::string& start, const std::string& end, size_t limit = 0);
+
+  std::optional<bool> Cas(const std::string& key, const std::string& expected,
+                          const std::string& value,
+                          std::string* actual = nullptr);
+
+  std::optional<int64_t> Incr(const std::string& key, int64_t delta = 1);
+
+  std::optional<bool> PutIfAbsent(const std::string& key,
+                                  const std::string& value, uint64_t ttl_ms = 0,
+                                  std::string* actual = nullptr);
+
+  // Like MultiPut, but atomic even when the keys span servers: either every
+  // key is written or none is (see two_phase_commit()).
+  bool AtomicMultiPut(const std::vector<std::string>& keys,
+                      const std::vector<std::string>& values);
+
+  // Asks every server, since the owner's keys may be on any of them.
+  std::optional<std::vector<std::string>> DeleteByOwner(
+      const std::string& owner);
+
+  // Sends each server one batch with the ops on its keys, in parallel. Ops on
+  // the same key run in order, but ops on different servers run in no
+  // particular order relative to each other.
+  std::optional<std::vector<BatchResult>> Batch(std::vector<BatchOp> ops);
 
   bool GDPRDelete(const std::string& user) {
     assert(false);
@@ -22,7 +22,8 @@ std::optional<std::string> SimpleClient::Get(const std::string& key) {
   return std::nullopt;
 }
 
-bool SimpleClient::Put(const std::string& key, const std::string& value) {
+bool SimpleClient::Put(const std::string& key, const std::string& value,
+                       uint64_t ttl_ms, const std::string& owner) {
   std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
   if (!conn) {
     cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
@@ -30,7 +31,7 @@ bool SimpleClient::Put(const std::string& key, const std::string& value) {
     return false;
   }
 
-  PutRequest req{key, value};
+  PutRequest req{key, value, ttl_ms, owner};
   if (!conn->send_request(req)) return false;
 
   std::optional<Response> res = conn->recv_response();
@@ -112,7 +113,9 @@ std::optional<std::vector<std::string>> SimpleClient::MultiGet(
 }
 
 bool SimpleClient::MultiPut(const std::vector<std::string>& keys,
-                            const std::vector<std::string>& values) {
+                            const std::vector<std::string>& values,
+                            uint64_t ttl_ms,
+                            const std::vector<std::string>& owners) {
   std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
   if (!conn) {
     cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
@@ -120,7 +123,7 @@ bool SimpleClient::MultiPut(const std::vector<std::string>& keys,
     return false;
   }
 
-  MultiPutRequest req{keys, values};
+  MultiPutRequest req{keys, values, ttl_ms, owners};
   if (!conn->send_request(req)) return false;
 
   std::optional<Response> res = conn->recv_response();
@@ -134,6 +137,133 @@ bool SimpleClient::MultiPut(const std::vector<std::string>& keys,
   return false;
 }
 
+std::optional<std::map<std::string, std::string>> SimpleClient::ScanRange(
+    const std::string& start, const std::string& end, size_t limit) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  ScanRangeRequest req{start, end, limit};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* scan_res = std::get_if<ScanRangeResponse>(&*res)) {
+    std::map<std::string, std::string> pairs;
+    for (size_t i = 0; i < scan_res->keys.size(); i++) {
+      pairs.emplace(std::move(scan_res->keys[i]),
+                    std::move(scan_res->values[i]));
+    }
+    return pairs;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to scan range on server: ", error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+std::optional<bool> SimpleClient::Cas(const std::string& key,
+                                      const std::string& expected,
+                                      const std::string& value,
+                                      std::string* actual) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  CasRequest req{key, expected, value};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* cas_res = std::get_if<CasResponse>(&*res)) {
+    if (!cas_res->swapped && actual) *actual = std::move(cas_res->value);
+    return cas_res->swapped;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to CAS value on server: ", error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+std::optional<int64_t> SimpleClient::Incr(const std::string& key,
+                                          int64_t delta) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  IncrRequest req{key, delta};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* incr_res = std::get_if<IncrResponse>(&*res)) {
+    return incr_res->value;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to increment value on server: ",
+               error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+std::optional<bool> SimpleClient::PutIfAbsent(const std::string& key,
+                                              const std::string& value,
+                                              uint64_t ttl_ms,
+                                              std::string* actual) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  PutIfAbsentRequest req{key, value, ttl_ms};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* absent_res = std::get_if<PutIfAbsentResponse>(&*res)) {
+    if (!absent_res->inserted && actual) *actual = std::move(absent_res->value);
+    return absent_res->inserted;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to put value on server: ", error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::vector<std::string>> SimpleClient::DeleteByOwner(
+    const std::string& owner) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  DeleteByOwnerRequest req{owner};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* owner_res = std::get_if<DeleteByOwnerResponse>(&*res)) {
+    return owner_res->keys;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to delete keys on server: ", error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
 bool SimpleClient::GDPRDelete(const std::string& user) {
   // TODO: Write your GDPR deletion code here!
   // You can invoke operations directly on the client object, like so:
@@ -147,3 +277,148 @@ bool SimpleClient::GDPRDelete(const std::string& user) {
   cerr_color(RED, "GDPR deletion is unimplemented!");
   return false;
 }
+
+std::optional<bool> SimpleClient::Prepare(
+    uint64_t txn_id, const std::vector<std::string>& keys,
+    const std::vector<std::string>& values, bool commit,
+    const std::vector<std::string>& participants) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  PrepareRequest req{txn_id, keys, values, commit, participants};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* prepare_res = std::get_if<PrepareResponse>(&*res)) {
+    return prepare_res->ok;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to prepare transaction on server: ",
+               error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+bool SimpleClient::Commit(uint64_t txn_id) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return false;
+  }
+
+  CommitRequest req{txn_id};
+  if (!conn->send_request(req)) return false;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return false;
+  if (auto* commit_res = std::get_if<CommitResponse>(&*res)) {
+    return true;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to commit transaction on server: ",
+               error_res->msg);
+  }
+
+  return false;
+}
+
+bool SimpleClient::Abort(uint64_t txn_id) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return false;
+  }
+
+  AbortRequest req{txn_id};
+  if (!conn->send_request(req)) return false;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return false;
+  if (auto* abort_res = std::get_if<AbortResponse>(&*res)) {
+    return true;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to abort transaction on server: ",
+               error_res->msg);
+  }
+
+  return false;
+}
+
+std::optional<TxnStatus> SimpleClient::GetTxnStatus(uint64_t txn_id) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  TxnStatusRequest req{txn_id};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* status_res = std::get_if<TxnStatusResponse>(&*res)) {
+    return status_res->status;
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to get transaction status from server: ",
+               error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+std::optional<std::vector<BatchResult>> SimpleClient::Batch(
+    std::vector<BatchOp> ops) {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  size_t n_ops = ops.size();
+  BatchRequest req{std::move(ops)};
+  if (!conn->send_request(std::move(req))) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* batch_res = std::get_if<BatchResponse>(&*res)) {
+    if (batch_res->results.size() == n_ops) {
+      return std::move(batch_res->results);
+    }
+    cerr_color(YELLOW, "Server sent ", batch_res->results.size(),
+               " results for a batch of ", n_ops, " ops");
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to run batch on server: ", error_res->msg);
+  }
+
+  return std::nullopt;
+}
+
+std::optional<StatsResponse> SimpleClient::Stats() {
+  std::shared_ptr<ServerConn> conn = connect_to_server(this->server_addr);
+  if (!conn) {
+    cerr_color(RED, "Failed to connect to KvServer at ", this->server_addr,
+               '.');
+    return std::nullopt;
+  }
+
+  StatsRequest req{};
+  if (!conn->send_request(req)) return std::nullopt;
+
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* stats_res = std::get_if<StatsResponse>(&*res)) {
+    return std::move(*stats_res);
+  } else if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Failed to get stats from server: ", error_res->msg);
+  }
+
+  return std::nullopt;
+}
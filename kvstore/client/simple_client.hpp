@@ -17,7 +17,8 @@ class SimpleClient : public Client {
   // ShardKvStore functions.
   std::optional<std::string> Get(const std::string& key);
 
-  bool Put(const std::string& key, const std::string& value);
+  bool Put(const std::string& key, const std::string& value,
+           uint64_t ttl_ms = 0, const std::string& owner = "");
 
   bool Append(const std::string& key, const std::string& value);
 
@@ -27,10 +28,43 @@ class SimpleClient : public Client {
       const std::vector<std::string>& keys);
 
   bool MultiPut(const std::vector<std::string>& keys,
-                const std::vector<std::string>& values);
+                const std::vector<std::string>& values, uint64_t ttl_ms = 0,
+                const std::vector<std::string>& owners = {});
 
+  std::optional<std::map<std::string, std::string>> ScanRange(
+      const std::string& start, const std::string& end, size_t limit = 0);
+  std::optional<bool> Cas(const std::string& key, const std::string& expected,
+                          const std::string& value,
+                          std::string* actual = nullptr);
+
+  std::optional<int64_t> Incr(const std::string& key, int64_t delta = 1);
+
+  std::optional<bool> PutIfAbsent(const std::string& key,
+                                  const std::string& value, uint64_t ttl_ms = 0,
+                                  std::string* actual = nullptr);
+
+  std::optional<std::vector<std::string>> DeleteByOwner(
+      const std::string& owner);
   bool GDPRDelete(const std::string& user);
 
+  // Sends all of `ops` in a single request (see BatchRequest), and returns
+  // their results in the same order. Ops that fail get an ErrorResponse.
+  std::optional<std::vector<BatchResult>> Batch(std::vector<BatchOp> ops);
+
+  // Two-phase commit messages (see two_phase_commit()). Prepare returns the
+  // server's vote.
+  std::optional<bool> Prepare(
+      uint64_t txn_id, const std::vector<std::string>& keys,
+      const std::vector<std::string>& values, bool commit = false,
+      const std::vector<std::string>& participants = {});
+  bool Commit(uint64_t txn_id);
+  bool Abort(uint64_t txn_id);
+  // How the server says a transaction ended (see TxnStatusRequest).
+  std::optional<TxnStatus> GetTxnStatus(uint64_t txn_id);
+
+  // The server's request latencies and throughput (see StatsRequest).
+  std::optional<StatsResponse> Stats();
+
  private:
   std::string server_addr;
 };
@@ -0,0 +1,109 @@
+#ifndef TASK_HPP
+#define TASK_HPP
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+// Resumes the coroutine that awaited a task, once the task is done.
+struct TaskFinalAwaiter {
+  bool await_ready() noexcept {
+    return false;
+  }
+  template <typename Promise>
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<Promise> handle) noexcept {
+    std::coroutine_handle<> continuation = handle.promise().continuation;
+    return continuation ? continuation : std::noop_coroutine();
+  }
+  void await_resume() noexcept {
+  }
+};
+
+struct TaskPromiseBase {
+  // The coroutine awaiting the task, if any.
+  std::coroutine_handle<> continuation;
+
+  std::suspend_always initial_suspend() noexcept {
+    return {};
+  }
+  TaskFinalAwaiter final_suspend() noexcept {
+    return {};
+  }
+  // Like the rest of the code, tasks report errors in their results.
+  void unhandled_exception() {
+    std::terminate();
+  }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+  std::optional<T> value;
+
+  void return_value(T v) {
+    this->value.emplace(std::move(v));
+  }
+  T result() {
+    return std::move(*this->value);
+  }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+  void return_void() {
+  }
+  void result() {
+  }
+};
+
+/*
+ * The result of a coroutine that produces a T (or nothing, for Task<void>).
+ * Tasks are lazy: the coroutine starts when the task is co_awaited, and the
+ * awaiting coroutine resumes with its result when it finishes. See
+ * EventLoop::spawn to start one without awaiting it.
+ *
+ * g++ 12 miscompiles co_await inside conditions (the coroutine may not run at
+ * all), and temporaries with destructors inside co_await expressions: store
+ * results, and what's passed by reference, in named variables first.
+ */
+template <typename T = void>
+class Task {
+ public:
+  struct promise_type : TaskPromise<T> {
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+  };
+
+  Task(Task&& other) noexcept : handle(std::exchange(other.handle, {})) {
+  }
+  Task& operator=(Task&& other) noexcept {
+    if (this->handle) this->handle.destroy();
+    this->handle = std::exchange(other.handle, {});
+    return *this;
+  }
+  ~Task() {
+    if (this->handle) this->handle.destroy();
+  }
+
+  bool await_ready() const noexcept {
+    return false;
+  }
+  std::coroutine_handle<> await_suspend(
+      std::coroutine_handle<> caller) noexcept {
+    this->handle.promise().continuation = caller;
+    return this->handle;
+  }
+  T await_resume() {
+    return this->handle.promise().result();
+  }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle(handle) {
+  }
+
+  std::coroutine_handle<promise_type> handle;
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,68 @@
+#include "transaction.hpp"
+
+#include <algorithm>
+#include <future>
+#include <optional>
+#include <random>
+#include <thread>
+
+#include "simple_client.hpp"
+
+static constexpr milliseconds MAX_BACKOFF = 20ms;
+
+static std::mt19937_64& rng() {
+  thread_local std::mt19937_64 gen(std::random_device{}());
+  return gen;
+}
+
+bool two_phase_commit(const std::vector<TxnWrites>& writes,
+                      size_t max_attempts) {
+  if (writes.empty()) return true;
+  bool one_phase = writes.size() == 1;
+  std::vector<std::string> participants;
+  for (auto&& w : writes) participants.push_back(w.server);
+
+  for (size_t attempt = 0; attempt < max_attempts; attempt++) {
+    uint64_t txn_id = rng()();
+
+    // Phase one
+    std::vector<std::future<std::optional<bool>>> votes;
+    for (auto&& w : writes) {
+      votes.push_back(std::async(std::launch::async, [&, txn_id] {
+        return SimpleClient{w.server}.Prepare(txn_id, w.keys, w.values,
+                                              one_phase, participants);
+      }));
+    }
+    std::vector<bool> prepared;
+    bool failed = false;
+    for (auto&& vote : votes) {
+      std::optional<bool> ok = vote.get();
+      prepared.push_back(ok && *ok);
+      // No vote at all (e.g. the server isn't responsible for a key) won't
+      // change on a retry
+      if (!ok) failed = true;
+    }
+    if (one_phase && prepared[0]) return true;
+
+    // Phase two. An abort goes to every server, so that one whose vote was
+    // lost refuses the transaction rather than waiting to hear how it ended.
+    bool commit = std::find(prepared.begin(), prepared.end(), false) ==
+                  prepared.end();
+    std::vector<std::future<bool>> acks;
+    for (size_t i = 0; i < writes.size(); i++) {
+      const std::string& server = writes[i].server;
+      acks.push_back(std::async(std::launch::async, [&server, txn_id, commit] {
+        SimpleClient client{server};
+        return commit ? client.Commit(txn_id) : client.Abort(txn_id);
+      }));
+    }
+    bool acked = true;
+    for (auto&& ack : acks) acked &= ack.get();
+    if (commit) return acked;
+    if (failed) return false;
+
+    std::uniform_int_distribution<int64_t> backoff(0, MAX_BACKOFF.count());
+    std::this_thread::sleep_for(milliseconds(backoff(rng())));
+  }
+  return false;
+}
@@ -0,0 +1,42 @@
+#ifndef TRANSACTION_HPP
+#define TRANSACTION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+// The part of a transaction's writes that go to one server.
+struct TxnWrites {
+  std::string server;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+};
+
+/**
+ * Applies `writes` atomically across their servers using two-phase commit,
+ * coordinated by the caller. Returns whether the transaction committed.
+ *
+ * Every server is first asked, in parallel, to prepare its part: to lock its
+ * keys and stage the writes. If all of them vote yes, they're all told to
+ * commit; otherwise, the ones that prepared are told to abort. A server votes
+ * no when another transaction holds one of its keys, in which case the
+ * transaction is retried (with randomized backoff, so that conflicting
+ * transactions don't keep aborting each other) up to `max_attempts` times. A
+ * transaction involving a single server skips the second phase.
+ *
+ * A server that voted yes holds the transaction's keys until it learns the
+ * outcome, even across restarts (see ConcurrentKvStore::PrepareTxn). If the
+ * coordinator doesn't send it within TxnTable::DEFAULT_TIMEOUT, the server
+ * asks the other participants instead: the coordinator is a client, which
+ * nobody can call back. Any that has committed or aborted settles it, and
+ * one that hasn't voted yet refuses the transaction, so that it aborts. Only
+ * if every participant voted yes and none has heard the decision do they
+ * wait, keeping their keys locked, until the coordinator tells one of them.
+ */
+bool two_phase_commit(const std::vector<TxnWrites>& writes,
+                      size_t max_attempts = 10);
+
+#endif /* end of include guard */
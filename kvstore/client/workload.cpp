@@ -0,0 +1,138 @@
+#include "client/workload.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+ZipfianGenerator::ZipfianGenerator(uint64_t n, double theta)
+    : n(std::max<uint64_t>(n, 1)), theta(theta) {
+  this->zetan = 0;
+  for (uint64_t i = 1; i <= this->n; i++) {
+    this->zetan += 1 / std::pow(double(i), theta);
+  }
+  double zeta2 = 1 + 1 / std::pow(2.0, theta);
+  this->alpha = 1 / (1 - theta);
+  this->eta = (1 - std::pow(2.0 / this->n, 1 - theta)) /
+              (1 - zeta2 / this->zetan);
+}
+
+uint64_t ZipfianGenerator::next(std::mt19937_64& rng) const {
+  double u = std::uniform_real_distribution<double>(0, 1)(rng);
+  double uz = u * this->zetan;
+  if (uz < 1) return 0;
+  if (uz < 1 + std::pow(0.5, this->theta)) return 1;
+  auto rank = uint64_t(this->n *
+                       std::pow(this->eta * u - this->eta + 1, this->alpha));
+  return std::min(rank, this->n - 1);
+}
+
+const char* op_kind_name(OpKind kind) {
+  switch (kind) {
+    case OpKind::READ:
+      return "read";
+    case OpKind::UPDATE:
+      return "update";
+    case OpKind::INSERT:
+      return "insert";
+    case OpKind::SCAN:
+      return "scan";
+    case OpKind::READ_MODIFY_WRITE:
+      return "rmw";
+  }
+  return "unknown";
+}
+
+std::optional<KeyDistribution> parse_key_distribution(
+    const std::string& name) {
+  if (name == "uniform") return KeyDistribution::UNIFORM;
+  if (name == "zipfian") return KeyDistribution::ZIPFIAN;
+  if (name == "latest") return KeyDistribution::LATEST;
+  return std::nullopt;
+}
+
+std::optional<WorkloadSpec> ycsb_workload(char name) {
+  WorkloadSpec spec;
+  switch (std::tolower(name)) {
+    case 'a':
+      spec.read = 0.5;
+      spec.update = 0.5;
+      break;
+    case 'b':
+      spec.read = 0.95;
+      spec.update = 0.05;
+      break;
+    case 'c':
+      spec.read = 1;
+      break;
+    case 'd':
+      spec.read = 0.95;
+      spec.insert = 0.05;
+      spec.distribution = KeyDistribution::LATEST;
+      break;
+    case 'e':
+      spec.scan = 0.95;
+      spec.insert = 0.05;
+      break;
+    case 'f':
+      spec.read = 0.5;
+      spec.read_modify_write = 0.5;
+      break;
+    default:
+      return std::nullopt;
+  }
+  return spec;
+}
+
+Workload::Workload(const WorkloadSpec& spec, uint64_t n_records, double theta)
+    : spec(spec), zipfian(n_records, theta), n_keys(n_records) {
+}
+
+std::string Workload::key(uint64_t i) {
+  // 64-bit FNV-1a over the key number's bytes, as YCSB does
+  uint64_t hash = 0xcbf29ce484222325;
+  for (int b = 0; b < 8; b++) {
+    hash ^= (i >> (8 * b)) & 0xff;
+    hash *= 0x100000001b3;
+  }
+  return "user" + std::to_string(hash);
+}
+
+uint64_t Workload::pick_key(std::mt19937_64& rng) {
+  uint64_t n = std::max<uint64_t>(this->n_keys.load(), 1);
+  switch (this->spec.distribution) {
+    case KeyDistribution::UNIFORM:
+      return std::uniform_int_distribution<uint64_t>(0, n - 1)(rng);
+    case KeyDistribution::ZIPFIAN:
+      return this->zipfian.next(rng);
+    case KeyDistribution::LATEST:
+      return n - 1 - std::min(this->zipfian.next(rng), n - 1);
+  }
+  return 0;
+}
+
+Workload::Op Workload::next(std::mt19937_64& rng) {
+  double r = std::uniform_real_distribution<double>(0, 1)(rng);
+  const WorkloadSpec& spec = this->spec;
+  Op op;
+  if ((r -= spec.read) < 0) {
+    op.kind = OpKind::READ;
+  } else if ((r -= spec.update) < 0) {
+    op.kind = OpKind::UPDATE;
+  } else if ((r -= spec.insert) < 0) {
+    op.kind = OpKind::INSERT;
+  } else if ((r -= spec.scan) < 0) {
+    op.kind = OpKind::SCAN;
+  } else {
+    op.kind = OpKind::READ_MODIFY_WRITE;
+  }
+
+  if (op.kind == OpKind::INSERT) {
+    op.key = key(this->n_keys++);
+  } else {
+    op.key = key(this->pick_key(rng));
+  }
+  if (op.kind == OpKind::SCAN) {
+    op.scan_length =
+        std::uniform_int_distribution<uint64_t>(1, MAX_SCAN_LENGTH)(rng);
+  }
+  return op;
+}
@@ -0,0 +1,104 @@
+#ifndef WORKLOAD_HPP
+#define WORKLOAD_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+
+/*
+ * Ranks in [0, n), where rank 0 is the most popular, and rank r comes up in
+ * proportion to 1 / (r + 1)^theta: with YCSB's default theta of 0.99, the top
+ * 1% of 100k keys get about half of all requests. Uses the constant-time
+ * method of Gray et al., "Quickly Generating Billion-Record Synthetic
+ * Databases" (SIGMOD 1994), after O(n) setup.
+ */
+class ZipfianGenerator {
+ public:
+  explicit ZipfianGenerator(uint64_t n, double theta = 0.99);
+
+  uint64_t next(std::mt19937_64& rng) const;
+
+ private:
+  uint64_t n;
+  double theta;
+  double alpha;
+  double zetan;
+  double eta;
+};
+
+// What a benchmark client does next (see Workload).
+enum class OpKind {
+  READ,
+  UPDATE,
+  INSERT,
+  SCAN,
+  READ_MODIFY_WRITE,
+};
+constexpr size_t N_OP_KINDS = 5;
+const char* op_kind_name(OpKind kind);
+
+// Which existing keys operations pick.
+enum class KeyDistribution {
+  UNIFORM,
+  ZIPFIAN,
+  // Zipfian over the most recently inserted keys first.
+  LATEST,
+};
+std::optional<KeyDistribution> parse_key_distribution(const std::string& name);
+
+// The mix of operations in a workload, as fractions that add up to 1.
+struct WorkloadSpec {
+  double read = 0;
+  double update = 0;
+  double insert = 0;
+  double scan = 0;
+  double read_modify_write = 0;
+  KeyDistribution distribution = KeyDistribution::ZIPFIAN;
+};
+
+// The core YCSB workloads (Cooper et al., "Benchmarking Cloud Serving Systems
+// with YCSB", SoCC 2010), by letter:
+//  - A: update heavy, 50% reads and 50% updates.
+//  - B: read mostly, 95% reads and 5% updates.
+//  - C: read only.
+//  - D: read latest, 95% reads and 5% inserts, reading recent keys most.
+//  - E: short ranges, 95% scans (of up to 100 keys) and 5% inserts.
+//  - F: read-modify-write, 50% reads and 50% read-modify-writes.
+std::optional<WorkloadSpec> ycsb_workload(char name);
+
+/*
+ * Generates a workload's operations over `n_records` keys that have been
+ * loaded (see key()), plus those inserted since. Thread-safe, with each
+ * thread passing its own random number generator.
+ */
+class Workload {
+ public:
+  static constexpr uint64_t MAX_SCAN_LENGTH = 100;
+
+  Workload(const WorkloadSpec& spec, uint64_t n_records, double theta = 0.99);
+
+  struct Op {
+    OpKind kind;
+    std::string key;
+    // For scans, how many keys to read.
+    uint64_t scan_length = 0;
+  };
+  Op next(std::mt19937_64& rng);
+
+  // The name of the i-th key. Keys are numbered in insertion order, but
+  // their names are hashed, so that popular keys are spread out (over hash
+  // buckets, servers, and key order).
+  static std::string key(uint64_t i);
+
+ private:
+  WorkloadSpec spec;
+  ZipfianGenerator zipfian;
+  // Keys loaded or inserted so far.
+  std::atomic<uint64_t> n_keys;
+
+  uint64_t pick_key(std::mt19937_64& rng);
+};
+
+#endif /* end of include guard */
@@ -6,14 +6,19 @@
 
 // Commands
 #include "client/cmd/appendcommand.hpp"
+#include "client/cmd/cascommand.hpp"
 #include "client/cmd/deletecommand.hpp"
+#include "client/cmd/deleteownercommand.hpp"
 #include "client/cmd/gdpr_deletecommand.hpp"
 #include "client/cmd/getcommand.hpp"
+#include "client/cmd/incrcommand.hpp"
 #include "client/cmd/movecommand.hpp"
 #include "client/cmd/multigetcommand.hpp"
 #include "client/cmd/multiputcommand.hpp"
 #include "client/cmd/putcommand.hpp"
+#include "client/cmd/putifabsentcommand.hpp"
 #include "client/cmd/querycommand.hpp"
+#include "client/cmd/scancommand.hpp"
 #include "common/color.hpp"
 #include "repl/repl.hpp"
 
@@ -52,12 +57,22 @@ int main(int argc, char* argv[]) {
   repl.add_command(pc);
   AppendCommand ac{client};
   repl.add_command(ac);
+  CasCommand cc{client};
+  repl.add_command(cc);
+  IncrCommand ic{client};
+  repl.add_command(ic);
+  PutIfAbsentCommand pac{client};
+  repl.add_command(pac);
   DeleteCommand dc{client};
   repl.add_command(dc);
   MultiGetCommand mgc{client};
   repl.add_command(mgc);
   MultiPutCommand mpc{client};
   repl.add_command(mpc);
+  ScanCommand sc{client};
+  repl.add_command(sc);
+  DeleteOwnerCommand doc{client};
+  repl.add_command(doc);
   GDPRDeleteCommand gdel{client};
   repl.add_command(gdel);
 
@@ -0,0 +1,451 @@
+// kvbench: a YCSB-style load generator for KvServers
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/async_client.hpp"
+#include "client/event_loop.hpp"
+#include "client/workload.hpp"
+#include "common/color.hpp"
+#include "common/latency_histogram.hpp"
+#include "common/utils.hpp"
+#include "net/network_helpers.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+// Keys per MultiPut when loading.
+constexpr size_t LOAD_BATCH = 100;
+
+struct BenchOptions {
+  char workload = 'a';
+  uint64_t n_records = 100000;
+  size_t value_size = 100;
+  // The workload's own distribution if unset.
+  std::optional<KeyDistribution> distribution;
+  double zipf_theta = 0.99;
+  size_t n_threads = 1;
+  // Requests in flight at once, over all threads (closed loop).
+  size_t n_clients = 16;
+  // Requests started per second, over all threads (open loop if non-zero).
+  double rate = 0;
+  size_t n_connections = 1;
+  uint64_t duration_s = 10;
+  uint64_t interval_ms = 1000;
+  std::string csv_path = "kvbench.csv";
+  bool load = true;
+};
+
+// Parses a `--name=value` flag into `options`. Returns false if the flag is
+// unknown or its value is malformed.
+bool parse_option(const std::string& flag, BenchOptions& options) {
+  size_t eq = flag.find('=');
+  if (eq == std::string::npos) return false;
+  std::string name = flag.substr(2, eq - 2);
+  std::string value = flag.substr(eq + 1);
+
+  if (name == "workload" && value.size() == 1 && ycsb_workload(value[0])) {
+    options.workload = value[0];
+  } else if (name == "records" && is_number(value) && std::stoul(value) > 0) {
+    options.n_records = std::stoul(value);
+  } else if (name == "value-size" && is_number(value)) {
+    options.value_size = std::stoul(value);
+  } else if (name == "distribution" && parse_key_distribution(value)) {
+    options.distribution = parse_key_distribution(value);
+  } else if (name == "zipf-theta") {
+    // Gray et al.'s method needs 0 < theta < 1
+    char* end;
+    options.zipf_theta = std::strtod(value.c_str(), &end);
+    return *end == '\0' && options.zipf_theta > 0 && options.zipf_theta < 1;
+  } else if (name == "threads" && is_number(value) && std::stoul(value) > 0) {
+    options.n_threads = std::stoul(value);
+  } else if (name == "clients" && is_number(value) && std::stoul(value) > 0) {
+    options.n_clients = std::stoul(value);
+  } else if (name == "rate" && is_number(value)) {
+    options.rate = std::stoul(value);
+  } else if (name == "connections" && is_number(value) &&
+             std::stoul(value) > 0) {
+    options.n_connections = std::stoul(value);
+  } else if (name == "duration-s" && is_number(value) &&
+             std::stoul(value) > 0) {
+    options.duration_s = std::stoul(value);
+  } else if (name == "interval-ms" && is_number(value) &&
+             std::stoul(value) > 0) {
+    options.interval_ms = std::stoul(value);
+  } else if (name == "csv") {
+    options.csv_path = value;
+  } else if (name == "load" && (value == "on" || value == "off")) {
+    options.load = value == "on";
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*
+ * One benchmark thread: an EventLoop, with an AsyncClient per server on it,
+ * and latency histograms for each kind of operation, which the main thread
+ * reads every interval.
+ */
+class BenchThread {
+ public:
+  BenchThread(const BenchOptions& options,
+              const std::vector<std::string>& servers, Workload& workload,
+              uint64_t seed)
+      : options(options), workload(workload), rng(seed) {
+    for (const std::string& server : servers) {
+      this->clients.push_back(std::make_unique<AsyncClient>(
+          this->loop, server, options.n_connections));
+    }
+    // Values are cut from random bytes, so that they don't compress
+    std::uniform_int_distribution<int> byte('!', '~');
+    for (size_t i = 0; i < VALUE_BYTES + options.value_size; i++) {
+      this->value_bytes.push_back(char(byte(this->rng)));
+    }
+  }
+
+  const BenchOptions& options;
+  EventLoop loop;
+  Workload& workload;
+  std::mt19937_64 rng;
+  // When the run ends.
+  Clock::time_point end;
+
+  std::array<LatencyHistogram, N_OP_KINDS> latencies;
+  std::array<std::atomic<uint64_t>, N_OP_KINDS> n_errors{};
+
+  // Keys are spread over the servers by hash (each server is its own
+  // Concurrent Store).
+  size_t server_for(const std::string& key) const {
+    return std::hash<std::string>{}(key) % this->clients.size();
+  }
+  AsyncClient& client_for(const std::string& key) {
+    return *this->clients[this->server_for(key)];
+  }
+  AsyncClient& client(size_t server) {
+    return *this->clients[server];
+  }
+
+  std::string value() {
+    size_t offset = this->rng() % VALUE_BYTES;
+    return this->value_bytes.substr(offset, this->options.value_size);
+  }
+
+  // Records an operation of `kind` that started at `start` and just ended.
+  void record(OpKind kind, Clock::time_point start, bool ok) {
+    this->latencies[size_t(kind)].record(Clock::now() - start);
+    if (!ok) this->n_errors[size_t(kind)]++;
+  }
+
+ private:
+  static constexpr size_t VALUE_BYTES = 1 << 16;
+
+  std::vector<std::unique_ptr<AsyncClient>> clients;
+  std::string value_bytes;
+};
+
+// Loads keys [begin, end), in MultiPuts of up to LOAD_BATCH keys per server.
+Task<void> load_keys(BenchThread& t, uint64_t begin, uint64_t end,
+                     size_t n_servers) {
+  std::vector<std::vector<std::string>> keys(n_servers);
+  std::vector<std::vector<std::string>> values(n_servers);
+  for (uint64_t i = begin; i < end; i++) {
+    std::string key = Workload::key(i);
+    size_t s = t.server_for(key);
+    keys[s].push_back(std::move(key));
+    values[s].push_back(t.value());
+    if (keys[s].size() == LOAD_BATCH) {
+      bool ok = co_await t.client(s).MultiPut(std::move(keys[s]),
+                                              std::move(values[s]));
+      if (!ok) t.n_errors[size_t(OpKind::INSERT)]++;
+      keys[s].clear();
+      values[s].clear();
+    }
+  }
+  for (size_t s = 0; s < n_servers; s++) {
+    if (keys[s].empty()) continue;
+    bool ok = co_await t.client(s).MultiPut(std::move(keys[s]),
+                                            std::move(values[s]));
+    if (!ok) t.n_errors[size_t(OpKind::INSERT)]++;
+  }
+}
+
+// Sends `request` to the server for `key`, and returns whether it succeeded.
+Task<bool> send(BenchThread& t, std::string key, Request request) {
+  std::optional<Response> res = co_await t.client_for(key).Send(request);
+  co_return res && !std::holds_alternative<ErrorResponse>(*res);
+}
+
+// Runs one operation, and returns whether it succeeded.
+Task<bool> run_op(BenchThread& t, Workload::Op op) {
+  Request req;
+  switch (op.kind) {
+    case OpKind::READ:
+    case OpKind::READ_MODIFY_WRITE:
+      req = GetRequest{op.key};
+      break;
+    case OpKind::UPDATE:
+    case OpKind::INSERT:
+      req = PutRequest{op.key, t.value()};
+      break;
+    case OpKind::SCAN:
+      // Scans only the server the start key is on
+      req = ScanRangeRequest{op.key, "", op.scan_length};
+      break;
+  }
+  bool ok = co_await send(t, op.key, std::move(req));
+  if (ok && op.kind == OpKind::READ_MODIFY_WRITE) {
+    Request put = PutRequest{op.key, t.value()};
+    ok = co_await send(t, op.key, std::move(put));
+  }
+  co_return ok;
+}
+
+// A closed-loop client: starts the next operation when the last one ends.
+Task<void> closed_loop_client(BenchThread& t) {
+  while (Clock::now() < t.end) {
+    Workload::Op op = t.workload.next(t.rng);
+    OpKind kind = op.kind;
+    Clock::time_point start = Clock::now();
+    bool ok = co_await run_op(t, std::move(op));
+    t.record(kind, start, ok);
+  }
+}
+
+// Runs one open-loop operation, timed from when it was due to start, so that
+// time spent waiting behind slow operations counts too (which timing from
+// when it was sent would leave out, i.e. coordinated omission).
+Task<void> open_loop_op(BenchThread& t, Workload::Op op,
+                        Clock::time_point due) {
+  OpKind kind = op.kind;
+  bool ok = co_await run_op(t, std::move(op));
+  t.record(kind, due, ok);
+}
+
+// Starts `rate` operations per second, spaced as a Poisson process, however
+// long the ones in flight take.
+Task<void> open_loop_arrivals(BenchThread& t, double rate) {
+  std::exponential_distribution<double> gap_s(rate);
+  Clock::time_point due = Clock::now();
+  while (true) {
+    due += std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(gap_s(t.rng)));
+    if (due >= t.end) break;
+    EventLoop::SleepAwaiter sleep = t.loop.sleep_until(due);
+    co_await sleep;
+    t.loop.spawn(open_loop_op(t, t.workload.next(t.rng), due));
+  }
+}
+
+// Per-operation counts, summed over threads.
+using AllCounts = std::array<LatencyHistogram::Counts, N_OP_KINDS + 1>;
+
+// Sums the threads' histograms (and errors) so far, by kind of operation,
+// with all operations together last.
+void collect(const std::vector<std::unique_ptr<BenchThread>>& threads,
+             AllCounts* counts, std::array<uint64_t, N_OP_KINDS + 1>* errors) {
+  *counts = {};
+  *errors = {};
+  for (const auto& t : threads) {
+    for (size_t k = 0; k < N_OP_KINDS; k++) {
+      t->latencies[k].add_to(&(*counts)[k]);
+      t->latencies[k].add_to(&counts->back());
+      (*errors)[k] += t->n_errors[k].load();
+      errors->back() += t->n_errors[k].load();
+    }
+  }
+}
+
+// The counts in `now` but not in `before`. The max is still over both.
+LatencyHistogram::Counts since(const LatencyHistogram::Counts& now,
+                               const LatencyHistogram::Counts& before) {
+  LatencyHistogram::Counts diff = now;
+  for (size_t i = 0; i < LatencyHistogram::N_BUCKETS; i++) {
+    diff.buckets[i] -= before.buckets[i];
+  }
+  diff.total -= before.total;
+  return diff;
+}
+
+uint64_t to_us(std::chrono::nanoseconds ns) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(ns).count();
+}
+
+const char* op_name(size_t k) {
+  return k < N_OP_KINDS ? op_kind_name(OpKind(k)) : "all";
+}
+
+int main(int argc, char* argv[]) {
+  // Split flags (--name=value) from positional arguments
+  BenchOptions options;
+  std::vector<std::string> servers;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.rfind("--", 0) == 0) {
+      if (!parse_option(arg, options)) {
+        cerr_color(RED, "Invalid option: ", arg);
+        return EXIT_FAILURE;
+      }
+    } else {
+      servers.push_back(arg);
+    }
+  }
+
+  if (servers.empty()) {
+    cerr_color(RED,
+               "Usage: ./kvbench [options] <server hostname:port|unix:path> "
+               "[more servers...]\n"
+               "Options:\n"
+               "\t--workload=<a-f>\t\tYCSB core workload (default: a)\n"
+               "\t--records=<n>\t\t\tkeys loaded beforehand (default: "
+               "100000)\n"
+               "\t--value-size=<bytes>\t\t(default: 100)\n"
+               "\t--distribution=<zipfian|uniform|latest>\tkeys operations "
+               "pick (default: the workload's)\n"
+               "\t--zipf-theta=<theta>\t\tskew, between 0 and 1 (default: "
+               "0.99)\n"
+               "\t--threads=<n>\t\t\tthreads sending requests (default: 1)\n"
+               "\t--clients=<n>\t\t\trequests in flight, closed loop "
+               "(default: 16)\n"
+               "\t--rate=<ops/s>\t\t\tstart requests at this rate, open "
+               "loop, instead\n"
+               "\t--connections=<n>\t\tper server per thread (default: 1)\n"
+               "\t--duration-s=<s>\t\t(default: 10)\n"
+               "\t--interval-ms=<ms>\t\treporting interval (default: 1000)\n"
+               "\t--csv=<path>\t\t\tper-interval results (default: "
+               "kvbench.csv)\n"
+               "\t--load=<on|off>\t\t\tload the records first (default: on)");
+    return EXIT_FAILURE;
+  }
+
+  // Fail early, rather than once per request
+  for (const std::string& server : servers) {
+    std::shared_ptr<ServerConn> conn = connect_to_server(server);
+    if (!conn) {
+      cerr_color(RED, "Failed to connect to KvServer at ", server, '.');
+      return EXIT_FAILURE;
+    }
+    conn->close();
+  }
+
+  std::ofstream csv(options.csv_path);
+  if (!csv) {
+    perror_color(RED, options.csv_path.c_str());
+    return EXIT_FAILURE;
+  }
+
+  WorkloadSpec spec = *ycsb_workload(options.workload);
+  if (options.distribution) spec.distribution = *options.distribution;
+  Workload workload(spec, options.n_records, options.zipf_theta);
+
+  std::vector<std::unique_ptr<BenchThread>> threads;
+  for (size_t i = 0; i < options.n_threads; i++) {
+    threads.push_back(
+        std::make_unique<BenchThread>(options, servers, workload, i + 1));
+  }
+  auto run_threads = [&threads] {
+    std::vector<std::thread> running;
+    for (auto& t : threads) {
+      running.emplace_back([&loop = t->loop] { loop.run(); });
+    }
+    return running;
+  };
+
+  // Load phase: each thread loads a slice of the keys, over as many
+  // coroutines as it has clients
+  if (options.load) {
+    cout_color(BLUE, "Loading ", options.n_records, " records...");
+    Clock::time_point start = Clock::now();
+    uint64_t n_loaders = std::max<size_t>(options.n_clients, options.n_threads);
+    for (uint64_t i = 0; i < n_loaders; i++) {
+      BenchThread& t = *threads[i % threads.size()];
+      t.loop.spawn(load_keys(t, options.n_records * i / n_loaders,
+                             options.n_records * (i + 1) / n_loaders,
+                             servers.size()));
+    }
+    for (std::thread& running : run_threads()) running.join();
+    double elapsed_s =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    cout_color(BLUE, "Loaded in ", elapsed_s, "s");
+    for (auto& t : threads) t->n_errors[size_t(OpKind::INSERT)] = 0;
+  }
+
+  // Run phase
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::seconds(options.duration_s);
+  for (size_t i = 0; i < threads.size(); i++) {
+    BenchThread& t = *threads[i];
+    t.end = end;
+    if (options.rate > 0) {
+      t.loop.spawn(open_loop_arrivals(t, options.rate / threads.size()));
+    } else {
+      size_t n_clients = options.n_clients / threads.size() +
+                         (i < options.n_clients % threads.size());
+      for (size_t c = 0; c < std::max<size_t>(n_clients, 1); c++) {
+        t.loop.spawn(closed_loop_client(t));
+      }
+    }
+  }
+  std::vector<std::thread> running = run_threads();
+
+  // Report each interval's throughput and latencies, by operation
+  csv << "time_s,op,count,ops_per_sec,p50_us,p99_us,p999_us,max_us,errors"
+      << std::endl;
+  AllCounts before{}, now;
+  std::array<uint64_t, N_OP_KINDS + 1> errors_before{}, errors;
+  std::chrono::milliseconds interval(options.interval_ms);
+  for (Clock::time_point at = start + interval; at < end + interval;
+       at += interval) {
+    Clock::time_point until = std::min(at, end);
+    std::this_thread::sleep_until(until);
+    collect(threads, &now, &errors);
+    double time_s = std::chrono::duration<double>(until - start).count();
+    double elapsed_s =
+        std::chrono::duration<double>(until - (at - interval)).count();
+    for (size_t k = 0; k <= N_OP_KINDS; k++) {
+      LatencyHistogram::Counts counts = since(now[k], before[k]);
+      if (counts.total == 0) continue;
+      csv << time_s << ',' << op_name(k) << ',' << counts.total << ','
+          << uint64_t(counts.total / elapsed_s) << ','
+          << to_us(counts.percentile(0.5)) << ','
+          << to_us(counts.percentile(0.99)) << ','
+          << to_us(counts.percentile(0.999)) << ','
+          << to_us(counts.percentile(1)) << ',' << errors[k] - errors_before[k]
+          << std::endl;
+    }
+    before = now;
+    errors_before = errors;
+  }
+  for (std::thread& t : running) t.join();
+
+  // And the whole run's, including operations still in flight at the end
+  collect(threads, &now, &errors);
+  double run_s = std::chrono::duration<double>(Clock::now() - start).count();
+  std::cout << std::left << std::setw(10) << "op" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "per sec"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+            << std::setw(10) << "p999 us" << std::setw(10) << "max us"
+            << std::setw(10) << "errors" << std::endl;
+  for (size_t k = 0; k <= N_OP_KINDS; k++) {
+    const LatencyHistogram::Counts& counts = now[k];
+    if (counts.total == 0) continue;
+    std::cout << std::left << std::setw(10) << op_name(k) << std::right
+              << std::setw(10) << counts.total << std::setw(10)
+              << uint64_t(counts.total / run_s) << std::setw(10)
+              << to_us(counts.percentile(0.5)) << std::setw(10)
+              << to_us(counts.percentile(0.99)) << std::setw(10)
+              << to_us(counts.percentile(0.999)) << std::setw(10)
+              << to_us(counts.max) << std::setw(10) << errors[k] << std::endl;
+  }
+  cout_color(BLUE, "Per-interval results written to ", options.csv_path);
+  return 0;
+}
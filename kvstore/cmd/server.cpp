@@ -4,50 +4,206 @@
 #include <iostream>
 #include <stdexcept>
 
+#include "common/cpu_affinity.hpp"
+#include "common/utils.hpp"
 #include "kvstore/kvstore.hpp"
 #include "repl/repl.hpp"
 #include "server/cmd/joincommand.hpp"
 #include "server/cmd/leavecommand.hpp"
 #include "server/cmd/printcommand.hpp"
+#include "server/cmd/statscommand.hpp"
+
+// Parses a `--name=value` flag into `options`. Returns false if the flag is
+// unknown or its value is malformed.
+bool parse_option(const std::string& flag, KvServerOptions& options) {
+  size_t eq = flag.find('=');
+  if (eq == std::string::npos) return false;
+  std::string name = flag.substr(2, eq - 2);
+  std::string value = flag.substr(eq + 1);
+
+  if (name == "data-dir") {
+    options.data_dir = value;
+  } else if (name == "wal-sync") {
+    if (value == "per-op") {
+      options.wal_sync = SyncPolicy::PER_OP;
+    } else if (value == "interval") {
+      options.wal_sync = SyncPolicy::INTERVAL;
+    } else if (value == "none") {
+      options.wal_sync = SyncPolicy::NONE;
+    } else {
+      return false;
+    }
+  } else if (name == "wal-sync-ms" && is_number(value)) {
+    options.wal_sync_interval = milliseconds(std::stoul(value));
+  } else if (name == "snapshot-ms" && is_number(value)) {
+    options.snapshot_interval = milliseconds(std::stoul(value));
+  } else if (name == "max-memory-mb" && is_number(value)) {
+    options.max_memory = std::stoul(value) << 20;
+  } else if (name == "hot-key-cache" && (value == "on" || value == "off")) {
+    options.cache_hot_keys = value == "on";
+  } else if (name == "ordered-index" && (value == "on" || value == "off")) {
+    options.ordered_index = value == "on";
+  } else if (name == "buckets" && is_number(value) && std::stoul(value) > 0) {
+    options.n_buckets = std::stoul(value);
+  } else if (name == "compress-values" && is_number(value)) {
+    options.compress_threshold = std::stoul(value);
+  } else if (name == "max-message-mb" && is_number(value) &&
+             std::stoul(value) > 0) {
+    options.max_message_size = std::stoul(value) << 20;
+  } else if (name == "acceptors" && is_number(value) && std::stoul(value) > 0) {
+    options.n_acceptors = std::stoul(value);
+  } else if (name == "backlog" && is_number(value) && std::stoul(value) > 0) {
+    options.socket_options.backlog = std::stoi(value);
+  } else if (name == "socket-buffer-kb" && is_number(value)) {
+    options.socket_options.send_buffer_size = std::stoi(value) << 10;
+    options.socket_options.recv_buffer_size = std::stoi(value) << 10;
+  } else if (name == "io-engine") {
+    if (value == "threads") {
+      options.io_engine = IoEngineType::THREADS;
+    } else if (value == "epoll") {
+      options.io_engine = IoEngineType::EPOLL;
+    } else if (value == "io_uring") {
+      options.io_engine = IoEngineType::IO_URING;
+    } else {
+      return false;
+    }
+  } else if (name == "shed-target-ms" && is_number(value)) {
+    options.shed_target = milliseconds(std::stoul(value));
+  } else if (name == "shed-interval-ms" && is_number(value) &&
+             std::stoul(value) > 0) {
+    options.shed_interval = milliseconds(std::stoul(value));
+  } else if (name == "max-queue-depth" && is_number(value)) {
+    options.max_queue_depth = std::stoul(value);
+  } else if (name == "pin-workers") {
+    if (value == "off") {
+      options.pin_workers = WorkerPinning::NONE;
+    } else if (value == "cores") {
+      options.pin_workers = WorkerPinning::CORES;
+    } else if (value == "nodes") {
+      options.pin_workers = WorkerPinning::NODES;
+    } else {
+      return false;
+    }
+  } else if (name == "worker-cpus" && parse_cpu_list(value)) {
+    options.worker_cpus = *parse_cpu_list(value);
+  } else if (name == "steer-connections" && (value == "on" || value == "off")) {
+    options.steer_connections = value == "on";
+  } else if (name == "shard-per-core" && (value == "on" || value == "off")) {
+    options.shard_per_core = value == "on";
+  } else if (name == "txn-timeout-ms" && is_number(value) &&
+             std::stoul(value) > 0) {
+    options.txn_timeout = milliseconds(std::stoul(value));
+  } else if (name == "log-level" && parse_log_level(value)) {
+    // Logging is process-wide, rather than one of the server's options
+    log_level = *parse_log_level(value);
+  } else {
+    return false;
+  }
+  return true;
+}
 
 int main(int argc, char* argv[]) {
-  if (argc < 2 || argc > 4) {
+  // Split flags (--name=value) from positional arguments
+  KvServerOptions options;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    if (arg.rfind("--", 0) == 0) {
+      if (!parse_option(arg, options)) {
+        cerr_color(RED, "Invalid option: ", arg);
+        return EXIT_FAILURE;
+      }
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  if (args.size() < 1 || args.size() > 3) {
     cerr_color(RED,
                "\nIf on Concurrent Store:\n"
-               "\t./server <port> [n_workers]\n"
+               "\t./server <port|unix:path> [n_workers] [options]\n"
                "If on Distributed Store:\n"
-               "\t./server <port> <shardcontroller hostname:port> [n_workers]");
+               "\t./server <port> <shardcontroller hostname:port> [n_workers] "
+               "[options]\n"
+               "Options:\n"
+               "\t--data-dir=<dir>\t\tpersist the store to a write-ahead "
+               "log and snapshots\n"
+               "\t--wal-sync=<per-op|interval|none>\t(default: interval)\n"
+               "\t--wal-sync-ms=<ms>\t\tsync interval (default: 10)\n"
+               "\t--snapshot-ms=<ms>\t\tsnapshot interval (default: 0, "
+               "never)\n"
+               "\t--max-memory-mb=<mb>\t\tevict keys to stay under this "
+               "size\n"
+               "\t--hot-key-cache=<on|off>\tcache responses to hot keys' "
+               "Gets (default: on)\n"
+               "\t--ordered-index=<on|off>\tindex keys in order for range "
+               "scans (default: off)\n"
+               "\t--buckets=<n>\t\t\thash buckets in the store (default: "
+               "60)\n"
+               "\t--compress-values=<bytes>\tstore values at least this "
+               "large compressed\n"
+               "\t--max-message-mb=<mb>\t\tlargest request accepted "
+               "(default: 1024)\n"
+               "\t--acceptors=<n>\t\t\tthreads accepting connections "
+               "(default: 1)\n"
+               "\t--backlog=<n>\t\t\tconnections waiting to be accepted "
+               "(default: 1024)\n"
+               "\t--socket-buffer-kb=<kb>\t\tsocket send/receive buffer "
+               "sizes (default: the kernel's)\n"
+               "\t--io-engine=<threads|epoll|io_uring>\t(default: threads)\n"
+               "\t--shed-target-ms=<ms>\t\tshed requests that wait this "
+               "long under overload (default: 0, never)\n"
+               "\t--shed-interval-ms=<ms>\t\tor this long otherwise "
+               "(default: 100)\n"
+               "\t--max-queue-depth=<n>\t\tshed requests with this many "
+               "waiting behind them (default: 0, no limit)\n"
+               "\t--pin-workers=<off|cores|nodes>\tpin each worker to a CPU, "
+               "or a NUMA node's CPUs (default: off)\n"
+               "\t--worker-cpus=<list>\t\tCPUs to pin workers to, e.g. "
+               "0-3,8 (default: all)\n"
+               "\t--steer-connections=<on|off>\thand connections to workers "
+               "on the node they arrive on (default: off)\n"
+               "\t--shard-per-core=<on|off>\tgive each worker its own slice "
+               "of the keys (needs an I/O engine; default: off)\n"
+               "\t--txn-timeout-ms=<ms>\t\task other participants how "
+               "a stalled transaction ended (default: 2000)\n"
+               "\t--log-level=<debug|info|warn|error|off>\t(default: info)");
     return EXIT_FAILURE;
   }
 
   std::shared_ptr<KvServer> server;
 
-  std::string addr = get_host_address(argv[1]);
+  // The first argument is a port, or a local address (unix:<path>) to listen
+  // on instead
+  std::string addr = local_socket_path(args[0])
+                         ? args[0]
+                         : get_host_address(args[0].c_str());
   std::string shardcontroller_addr;
   uint64_t n_workers = N_WORKERS;
 
-  if (argc == 3) {
+  if (args.size() == 2) {
     // if second argument contains a colon, then it's a shardcontroller address
-    if (std::string(argv[2]).find(":") != std::string::npos) {
-      shardcontroller_addr = std::string(argv[2]);
+    if (args[1].find(":") != std::string::npos) {
+      shardcontroller_addr = args[1];
     } else {
       // otherwise, we're running Concurrent Store and specified the number of
       // workers
-      n_workers = std::stoi(argv[2]);
+      n_workers = std::stoi(args[1]);
     }
-  } else if (argc == 4) {
+  } else if (args.size() == 3) {
     // Running Distributed Store with both shardcontroller and n_workers
     // specified
-    shardcontroller_addr = std::string(argv[2]);
-    n_workers = std::stoi(argv[3]);
+    shardcontroller_addr = args[1];
+    n_workers = std::stoi(args[2]);
   }
 
   // If no shardcontroller address specified, Concurrent Store; otherwise,
   // Distributed Store
   if (shardcontroller_addr.empty()) {
-    server = std::make_shared<KvServer>(addr, n_workers);
+    server = std::make_shared<KvServer>(addr, n_workers, options);
   } else {
-    server = std::make_shared<KvServer>(addr, shardcontroller_addr, n_workers);
+    server = std::make_shared<KvServer>(addr, shardcontroller_addr, n_workers,
+                                        options);
   }
 
   int ret = server->start();
@@ -56,7 +212,7 @@ int main(int argc, char* argv[]) {
   }
 
   Repl repl;
-  if (argc == 4) {
+  if (args.size() == 3) {
     // if Distributed Store, add shardcontroller commands
     JoinCommand jc{server};
     repl.add_command(jc);
@@ -66,6 +222,9 @@ int main(int argc, char* argv[]) {
   // - `print <store|config>` (display store/config)
   PrintCommand pc{server};
   repl.add_command(pc);
+  // - `stats` (display request latencies and throughput)
+  StatsCommand sc{server};
+  repl.add_command(sc);
 
   repl.run();
 
@@ -1,6 +1,7 @@
 #include "common/config.hpp"
 
 #include "common/color.hpp"
+#include "common/log.hpp"
 
 std::string ShardControllerConfig::print() {
   std::stringstream ss;
@@ -21,10 +22,9 @@ std::optional<std::string> ShardControllerConfig::get_server(
   std::string key_uppercase = to_upper(key);
   // TODO (Part B, Step 2): Implement!
   // You should use key_uppercase (instead of key) in your implementation
-  cerr_color(
-      RED,
-      "Shardcontroller config does not contain any server responsible for "
-      "the key ",
-      key);
+  log_sampled(LogLevel::WARN,
+              "Shardcontroller config does not contain any server "
+              "responsible for the key ",
+              key);
   return std::nullopt;
 }
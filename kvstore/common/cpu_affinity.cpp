@@ -0,0 +1,107 @@
+#include "common/cpu_affinity.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include "common/utils.hpp"
+
+std::optional<std::vector<int>> parse_cpu_list(const std::string& list) {
+  std::vector<int> cpus;
+  size_t start = 0;
+  while (start < list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) end = list.size();
+    std::string range = list.substr(start, end - start);
+    start = end + 1;
+
+    size_t dash = range.find('-');
+    std::string first = range.substr(0, dash);
+    std::string last =
+        dash == std::string::npos ? first : range.substr(dash + 1);
+    if (!is_number(first) || !is_number(last)) return std::nullopt;
+    int lo = std::stoi(first);
+    int hi = std::stoi(last);
+    if (lo > hi || hi >= CPU_SETSIZE) return std::nullopt;
+    for (int cpu = lo; cpu <= hi; cpu++) cpus.push_back(cpu);
+  }
+  if (cpus.empty()) return std::nullopt;
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+std::vector<int> allowed_cpus() {
+  std::vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+bool pin_thread(const std::vector<int>& cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) CPU_SET(cpu, &set);
+  return !cpus.empty() &&
+         pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+NumaTopology NumaTopology::detect(const std::vector<int>& cpus) {
+  NumaTopology topology;
+  std::vector<int> placed;
+  std::error_code ec;
+  // Nodes are numbered, but not necessarily contiguously
+  std::vector<std::pair<int, std::string>> nodes;
+  for (auto& entry :
+       std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+    std::string name = entry.path().filename();
+    if (name.rfind("node", 0) == 0 && is_number(name.substr(4))) {
+      nodes.emplace_back(std::stoi(name.substr(4)), entry.path() / "cpulist");
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+
+  for (auto& [_, path] : nodes) {
+    std::ifstream in(path);
+    std::string list;
+    std::optional<std::vector<int>> node_cpus;
+    if (!std::getline(in, list) || !(node_cpus = parse_cpu_list(list))) {
+      continue;
+    }
+    std::vector<int> usable;
+    for (int cpu : *node_cpus) {
+      if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) {
+        usable.push_back(cpu);
+        placed.push_back(cpu);
+      }
+    }
+    if (!usable.empty()) topology.node_cpus.push_back(std::move(usable));
+  }
+
+  // CPUs the kernel didn't put on a node (or everything, without NUMA)
+  // go on one of their own
+  std::vector<int> rest;
+  for (int cpu : cpus) {
+    if (std::find(placed.begin(), placed.end(), cpu) == placed.end()) {
+      rest.push_back(cpu);
+    }
+  }
+  if (!rest.empty()) topology.node_cpus.push_back(std::move(rest));
+  return topology;
+}
+
+std::optional<size_t> NumaTopology::node_of(int cpu) const {
+  for (size_t node = 0; node < this->node_cpus.size(); node++) {
+    const std::vector<int>& cpus = this->node_cpus[node];
+    if (std::binary_search(cpus.begin(), cpus.end(), cpu)) return node;
+  }
+  return std::nullopt;
+}
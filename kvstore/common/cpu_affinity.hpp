@@ -0,0 +1,35 @@
+#ifndef COMMON_CPU_AFFINITY_HPP
+#define COMMON_CPU_AFFINITY_HPP
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// Parses a CPU list in the kernel's format, e.g. "0-3,8,10-11". Returns the
+// CPUs in increasing order, without duplicates.
+std::optional<std::vector<int>> parse_cpu_list(const std::string& list);
+
+// The CPUs this process may run on.
+std::vector<int> allowed_cpus();
+
+// Pins the calling thread to `cpus` (any of them). Returns false on error.
+bool pin_thread(const std::vector<int>& cpus);
+
+/*
+ * Which CPUs belong to which NUMA node (socket), as the kernel reports in
+ * /sys/devices/system/node. Memory a thread first touches is allocated on
+ * its node, so a thread that stays on one node finds its own data there.
+ */
+struct NumaTopology {
+  // Each node's CPUs, in increasing order. Nodes without any are left out.
+  std::vector<std::vector<int>> node_cpus;
+
+  // Reads the topology, restricted to `cpus`. Without NUMA information, all
+  // of them are on one node.
+  static NumaTopology detect(const std::vector<int>& cpus);
+
+  // The index in node_cpus of the node `cpu` is on, if it's there.
+  std::optional<size_t> node_of(int cpu) const;
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,59 @@
+#include "common/latency_histogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+static constexpr size_t HALF = LatencyHistogram::SUB_BUCKETS / 2;
+
+size_t LatencyHistogram::bucket(uint64_t ns) {
+  ns = std::min(ns, (uint64_t(1) << MAX_BITS) - 1);
+  if (ns < SUB_BUCKETS) return ns;
+  // The bucket's top SUB_BUCKET_BITS bits, the first of which is always set
+  size_t shift = std::bit_width(ns) - SUB_BUCKET_BITS;
+  return SUB_BUCKETS + (shift - 1) * HALF + ((ns >> shift) - HALF);
+}
+
+uint64_t LatencyHistogram::bucket_max(size_t i) {
+  if (i < SUB_BUCKETS) return i;
+  size_t shift = (i - SUB_BUCKETS) / HALF + 1;
+  uint64_t top = (i - SUB_BUCKETS) % HALF + HALF;
+  return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(std::chrono::nanoseconds latency) {
+  int64_t ns = std::max<int64_t>(latency.count(), 0);
+  // Only this thread writes, so a load and a store can't lose a count
+  auto& count = this->buckets[bucket(ns)];
+  count.store(count.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+  if (ns > this->max_ns.load(std::memory_order_relaxed)) {
+    this->max_ns.store(ns, std::memory_order_relaxed);
+  }
+}
+
+void LatencyHistogram::add_to(Counts* counts) const {
+  for (size_t i = 0; i < N_BUCKETS; i++) {
+    uint64_t n = this->buckets[i].load(std::memory_order_relaxed);
+    counts->buckets[i] += n;
+    counts->total += n;
+  }
+  counts->max = std::max(
+      counts->max,
+      std::chrono::nanoseconds(this->max_ns.load(std::memory_order_relaxed)));
+}
+
+std::chrono::nanoseconds LatencyHistogram::Counts::percentile(
+    double quantile) const {
+  if (this->total == 0) return std::chrono::nanoseconds(0);
+  uint64_t rank = std::max<uint64_t>(std::ceil(quantile * this->total), 1);
+  uint64_t seen = 0;
+  for (size_t i = 0; i < N_BUCKETS; i++) {
+    seen += this->buckets[i];
+    if (seen >= rank) {
+      // The max is exact, so never report more than it
+      return std::min(std::chrono::nanoseconds(bucket_max(i)), this->max);
+    }
+  }
+  return this->max;
+}
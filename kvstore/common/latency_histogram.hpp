@@ -0,0 +1,55 @@
+#ifndef COMMON_LATENCY_HISTOGRAM_HPP
+#define COMMON_LATENCY_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A histogram of latencies in the style of HdrHistogram: buckets are linear
+ * up to SUB_BUCKETS nanoseconds, and from there each power of two is split
+ * into SUB_BUCKETS / 2 buckets, so any latency (up to about 18 minutes) is
+ * counted to within 1/32 of its value, in a fixed ~9KB.
+ *
+ * Each histogram is recorded into by a single thread (e.g. one per worker),
+ * without locks or read-modify-writes, and can be read from any other; to
+ * combine several, add them into one Counts.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t SUB_BUCKET_BITS = 6;
+  static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+  static constexpr size_t MAX_BITS = 40;
+  static constexpr size_t N_BUCKETS =
+      SUB_BUCKETS + (MAX_BITS - SUB_BUCKET_BITS) * (SUB_BUCKETS / 2);
+
+  // A copy of one or more histograms' counts, to compute percentiles from.
+  struct Counts {
+    std::array<uint64_t, N_BUCKETS> buckets{};
+    uint64_t total = 0;
+    std::chrono::nanoseconds max{0};
+
+    // The latency that a `quantile` (e.g. 0.99) of those counted are at or
+    // under, rounded up to the end of its bucket.
+    std::chrono::nanoseconds percentile(double quantile) const;
+  };
+
+  // Only call from the thread that owns the histogram.
+  void record(std::chrono::nanoseconds latency);
+
+  // Adds this histogram's counts to `counts`.
+  void add_to(Counts* counts) const;
+
+  // The bucket a latency of `ns` nanoseconds goes in, and the largest latency
+  // that goes in bucket `i`.
+  static size_t bucket(uint64_t ns);
+  static uint64_t bucket_max(size_t i);
+
+ private:
+  std::array<std::atomic<uint64_t>, N_BUCKETS> buckets{};
+  std::atomic<int64_t> max_ns = 0;
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,175 @@
+#include "common/log.hpp"
+
+#include <array>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+std::atomic<LogLevel> log_level = LogLevel::INFO;
+
+std::optional<LogLevel> parse_log_level(const std::string& name) {
+  if (name == "debug") return LogLevel::DEBUG;
+  if (name == "info") return LogLevel::INFO;
+  if (name == "warn") return LogLevel::WARN;
+  if (name == "error") return LogLevel::ERROR;
+  if (name == "off") return LogLevel::OFF;
+  return std::nullopt;
+}
+
+bool LogSampler::sample(uint64_t* suppressed) {
+  int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch())
+                    .count();
+  int64_t next = this->next.load(std::memory_order_relaxed);
+  // Of the threads that find the interval over, only one logs
+  if (now >= next && this->next.compare_exchange_strong(
+                         next, now + this->interval,
+                         std::memory_order_relaxed)) {
+    *suppressed = this->n_suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  this->n_suppressed.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+namespace {
+
+// A thread's lines, waiting to be written: a ring buffer with one producer
+// (the thread) and one consumer (the flusher).
+struct LogBuffer {
+  static constexpr size_t CAPACITY = 1024;
+
+  struct Line {
+    LogLevel level;
+    std::string text;
+  };
+  std::array<Line, CAPACITY> lines;
+  // Lines [head, tail) are waiting; the flusher moves head, the thread tail.
+  std::atomic<size_t> head = 0;
+  std::atomic<size_t> tail = 0;
+  // Lines the thread dropped because the buffer was full.
+  std::atomic<uint64_t> n_dropped = 0;
+
+  void push(LogLevel level, std::string&& text) {
+    size_t tail = this->tail.load(std::memory_order_relaxed);
+    if (tail - this->head.load(std::memory_order_acquire) == CAPACITY) {
+      this->n_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    this->lines[tail % CAPACITY] = {level, std::move(text)};
+    this->tail.store(tail + 1, std::memory_order_release);
+  }
+
+  // Writes out the waiting lines. Returns whether there were any.
+  bool drain() {
+    size_t head = this->head.load(std::memory_order_relaxed);
+    size_t tail = this->tail.load(std::memory_order_acquire);
+    for (size_t i = head; i < tail; i++) {
+      Line& line = this->lines[i % CAPACITY];
+      (line.level >= LogLevel::WARN ? std::cerr : std::cout)
+          << line.text << '\n';
+      // Frees the text on this thread, rather than the logging one
+      std::string().swap(line.text);
+    }
+    this->head.store(tail, std::memory_order_release);
+    if (uint64_t n = this->n_dropped.exchange(0, std::memory_order_relaxed)) {
+      std::cerr << YELLOW << "Dropped " << n
+                << " log lines that were logged too quickly." << NC << '\n';
+    }
+    return head != tail;
+  }
+};
+
+// Hands out threads' buffers, and runs the thread that drains them.
+class Logger {
+ public:
+  ~Logger() {
+    {
+      std::unique_lock lock(this->mtx);
+      this->stopped = true;
+    }
+    this->cv.notify_all();
+    if (this->flusher.joinable()) this->flusher.join();
+  }
+
+  std::shared_ptr<LogBuffer> new_buffer() {
+    auto buffer = std::make_shared<LogBuffer>();
+    std::unique_lock lock(this->mtx);
+    this->buffers.push_back(buffer);
+    if (!this->flusher.joinable()) {
+      this->flusher = std::thread(&Logger::flush_loop, this);
+    }
+    return buffer;
+  }
+
+  void flush() {
+    std::unique_lock lock(this->mtx);
+    if (!this->flusher.joinable()) return;
+    uint64_t generation = ++this->requested;
+    this->cv.notify_all();
+    this->flushed_cv.wait(lock, [&] {
+      return this->flushed >= generation || this->stopped;
+    });
+  }
+
+ private:
+  // Guards everything below, except the buffers' contents.
+  std::mutex mtx;
+  std::condition_variable cv;
+  std::condition_variable flushed_cv;
+  std::vector<std::shared_ptr<LogBuffer>> buffers;
+  std::thread flusher;
+  bool stopped = false;
+  // flush() calls made, and those the flusher has caught up with.
+  uint64_t requested = 0;
+  uint64_t flushed = 0;
+
+  void flush_loop() {
+    std::unique_lock lock(this->mtx);
+    while (true) {
+      this->cv.wait_for(lock, std::chrono::milliseconds(10), [this] {
+        return this->stopped || this->requested > this->flushed;
+      });
+      uint64_t generation = this->requested;
+      bool stopping = this->stopped;
+
+      // Buffers whose threads have exited are dropped once drained
+      std::vector<std::shared_ptr<LogBuffer>> buffers = this->buffers;
+      lock.unlock();
+      bool wrote = false;
+      for (auto&& buffer : buffers) wrote |= buffer->drain();
+      if (wrote) {
+        std::cout.flush();
+        std::cerr.flush();
+      }
+      buffers.clear();
+      lock.lock();
+      std::erase_if(this->buffers, [](const auto& buffer) {
+        return buffer.use_count() == 1 &&
+               buffer->head.load() == buffer->tail.load();
+      });
+
+      this->flushed = generation;
+      this->flushed_cv.notify_all();
+      if (stopping) return;
+    }
+  }
+};
+
+Logger& logger() {
+  static Logger logger;
+  return logger;
+}
+
+}  // namespace
+
+void log_line(LogLevel level, std::string line) {
+  thread_local std::shared_ptr<LogBuffer> buffer = logger().new_buffer();
+  buffer->push(level, std::move(line));
+}
+
+void flush_logs() {
+  logger().flush();
+}
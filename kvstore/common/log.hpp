@@ -0,0 +1,124 @@
+#ifndef COMMON_LOG_HPP
+#define COMMON_LOG_HPP
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <sstream>
+#include <string>
+
+#include "common/color.hpp"
+
+/*
+ * A leveled, asynchronous logger, for code on a hot path (where cout_color and
+ * cerr_color would have every thread contend for the stream's lock).
+ *
+ * Each thread formats its lines into its own buffer, without locks, and a
+ * background thread writes them out (DEBUG and INFO to std::cout, WARN and
+ * ERROR to std::cerr, in the same colors as before). A thread that logs faster
+ * than they're written drops lines rather than wait, and the flusher reports
+ * how many. If the line's level is disabled, the macros below cost a load and
+ * a branch: their arguments aren't even evaluated.
+ *
+ *   log_info("Received client connection from ", client->address);
+ *   log_sampled(LogLevel::WARN, "Request failed: ", error_res->msg);
+ */
+enum class LogLevel : int {
+  DEBUG,
+  INFO,
+  WARN,
+  ERROR,
+  OFF,
+};
+
+// Lines below this level are dropped (INFO by default).
+extern std::atomic<LogLevel> log_level;
+
+inline bool log_enabled(LogLevel level) {
+  return level >= log_level.load(std::memory_order_relaxed);
+}
+
+// Parses "debug", "info", "warn", "error" or "off".
+std::optional<LogLevel> parse_log_level(const std::string& name);
+
+// Queues a formatted line (without a trailing newline) to be written.
+void log_line(LogLevel level, std::string line);
+
+// Waits until every line logged so far (by any thread) has been written.
+void flush_logs();
+
+/*
+ * Lets through at most one line per `interval` from wherever it's used, and
+ * counts the rest, so that an error repeated for every request is still seen
+ * without being written for every request. Thread-safe.
+ */
+class LogSampler {
+ public:
+  explicit LogSampler(
+      std::chrono::nanoseconds interval = std::chrono::seconds(1))
+      : interval(interval.count()) {
+  }
+
+  // Whether to log this time. If so, `*suppressed` is how many lines weren't
+  // since the last that was.
+  bool sample(uint64_t* suppressed);
+
+ private:
+  int64_t interval;
+  // When the next line may be logged, in steady_clock nanoseconds.
+  std::atomic<int64_t> next = 0;
+  std::atomic<uint64_t> n_suppressed = 0;
+};
+
+// Appended to sampled lines, saying how many were suppressed before them.
+struct Suppressed {
+  uint64_t n;
+};
+inline std::ostream& operator<<(std::ostream& os, Suppressed suppressed) {
+  if (suppressed.n > 0) os << " (" << suppressed.n << " more suppressed)";
+  return os;
+}
+
+// Formats a line like cout_color (or, with a function, file and line, like
+// cerr_color) does, and queues it.
+template <Printable... Args>
+void log_format(LogLevel level, const char* function, const char* file,
+                int line, Args&&... args) {
+  static constexpr std::string_view colors[] = {DIM, BLUE, YELLOW, RED};
+  std::ostringstream os;
+  os << colors[int(level)];
+  if (function) {
+    os << "In function " << function << " (" << file << ':' << line << "): ";
+  }
+  (os << ... << args);
+  os << NC;
+  log_line(level, std::move(os).str());
+}
+
+// Like cout_color and cerr_color, as macros so that disabled lines cost
+// nothing, and so that WARN and ERROR lines say where they're from.
+#define log_at(level, function, ...)                                  \
+  do {                                                                \
+    if (log_enabled(level)) {                                         \
+      log_format(level, function, __FILE__, __LINE__, __VA_ARGS__);   \
+    }                                                                 \
+  } while (0)
+
+#define log_debug(...) log_at(LogLevel::DEBUG, nullptr, __VA_ARGS__)
+#define log_info(...) log_at(LogLevel::INFO, nullptr, __VA_ARGS__)
+#define log_warn(...) log_at(LogLevel::WARN, __FUNCTION__, __VA_ARGS__)
+#define log_error(...) log_at(LogLevel::ERROR, __FUNCTION__, __VA_ARGS__)
+
+// Logs at most one line a second from this call site (see LogSampler).
+#define log_sampled(level, ...)                                             \
+  do {                                                                      \
+    static LogSampler log_sampler_;                                         \
+    uint64_t log_suppressed_;                                               \
+    if (log_enabled(level) && log_sampler_.sample(&log_suppressed_)) {      \
+      log_format(level, level >= LogLevel::WARN ? __FUNCTION__ : nullptr,   \
+                 __FILE__, __LINE__, __VA_ARGS__,                           \
+                 Suppressed{log_suppressed_});                              \
+    }                                                                       \
+  } while (0)
+
+#endif /* end of include guard */
@@ -0,0 +1,160 @@
+#include "lz4.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Format constants: matches are at least MIN_MATCH bytes long and reach back
+// at most MAX_OFFSET bytes; the last LAST_LITERALS bytes are always literals,
+// and no match starts in the last MF_LIMIT bytes.
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MF_LIMIT = 12;
+
+// Match finder: a hash table from 4-byte sequences to their last position.
+constexpr int HASH_BITS = 14;
+
+uint32_t read32(const char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+uint32_t hash(uint32_t v) {
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths of 15 or more spill out of their 4-bit token field into extra bytes
+// of 255, then the remainder.
+void write_length(std::string& out, size_t len) {
+  for (; len >= 255; len -= 255) out.push_back(char(255));
+  out.push_back(char(len));
+}
+
+// Appends a sequence: `n_literals` literal bytes, then a match of `match_len`
+// bytes `offset` back (none if `match_len` is 0, for the last sequence).
+void write_sequence(std::string& out, const char* literals, size_t n_literals,
+                    size_t match_len, size_t offset) {
+  size_t match_code = match_len ? match_len - MIN_MATCH : 0;
+  out.push_back(char((std::min<size_t>(n_literals, 15) << 4) |
+                     std::min<size_t>(match_code, 15)));
+  if (n_literals >= 15) write_length(out, n_literals - 15);
+  out.append(literals, n_literals);
+  if (!match_len) return;
+  out.push_back(char(offset & 0xff));
+  out.push_back(char(offset >> 8));
+  if (match_code >= 15) write_length(out, match_code - 15);
+}
+
+// Reads the extra bytes of a length whose token field was 15, adding them to
+// `len`. Fails if the input ends first or the length exceeds `max`.
+bool read_length(std::string_view in, size_t& i, size_t& len, size_t max) {
+  while (true) {
+    if (i >= in.size()) return false;
+    uint8_t b = in[i++];
+    len += b;
+    if (len > max) return false;
+    if (b != 255) return true;
+  }
+}
+
+}  // namespace
+
+std::string lz4_compress(std::string_view data) {
+  const char* src = data.data();
+  size_t n = data.size();
+
+  std::string out;
+  out.reserve(4 + n + n / 255 + 16);
+  for (int i = 0; i < 4; i++) out.push_back(char((n >> (8 * i)) & 0xff));
+
+  size_t anchor = 0;
+  if (n > MF_LIMIT) {
+    std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+    size_t pos = 0;
+    size_t limit = n - MF_LIMIT;
+    while (pos < limit) {
+      uint32_t seq = read32(src + pos);
+      uint32_t h = hash(seq);
+      size_t candidate = table[h];
+      table[h] = pos;
+      if (candidate >= pos || pos - candidate > MAX_OFFSET ||
+          read32(src + candidate) != seq) {
+        pos++;
+        continue;
+      }
+
+      // Extend the match backwards over pending literals, then forwards
+      while (pos > anchor && candidate > 0 &&
+             src[pos - 1] == src[candidate - 1]) {
+        pos--;
+        candidate--;
+      }
+      size_t len = MIN_MATCH;
+      size_t max_len = n - LAST_LITERALS - pos;
+      while (len < max_len && src[pos + len] == src[candidate + len]) len++;
+
+      write_sequence(out, src + anchor, pos - anchor, len, pos - candidate);
+      pos += len;
+      anchor = pos;
+    }
+  }
+  write_sequence(out, src + anchor, n - anchor, 0, 0);
+  return out;
+}
+
+std::optional<std::string> lz4_decompress(std::string_view in) {
+  if (in.size() < 4) return std::nullopt;
+  size_t size = 0;
+  for (int i = 0; i < 4; i++) size |= size_t(uint8_t(in[i])) << (8 * i);
+  // Each input byte expands to at most 255 output bytes, so don't allocate
+  // more than that on a corrupt header's say-so
+  if (size > LZ4_MAX_SIZE || size > 255 * in.size()) return std::nullopt;
+
+  std::string out(size, '\0');
+  size_t o = 0;
+  size_t i = 4;
+  while (true) {
+    if (i >= in.size()) return std::nullopt;
+    uint8_t token = in[i++];
+
+    size_t n_literals = token >> 4;
+    if (n_literals == 15 && !read_length(in, i, n_literals, size)) {
+      return std::nullopt;
+    }
+    if (n_literals > in.size() - i || n_literals > size - o) {
+      return std::nullopt;
+    }
+    std::memcpy(out.data() + o, in.data() + i, n_literals);
+    i += n_literals;
+    o += n_literals;
+    // The last sequence has no match
+    if (i == in.size()) break;
+
+    if (in.size() - i < 2) return std::nullopt;
+    size_t offset = uint8_t(in[i]) | (size_t(uint8_t(in[i + 1])) << 8);
+    i += 2;
+    if (offset == 0 || offset > o) return std::nullopt;
+    size_t len = token & 0xf;
+    if (len == 15 && !read_length(in, i, len, size)) return std::nullopt;
+    len += MIN_MATCH;
+    if (len > size - o) return std::nullopt;
+
+    // A match may overlap the bytes it produces (e.g. a run of one byte is a
+    // match at offset 1), in which case it has to be copied forwards
+    char* dst = out.data() + o;
+    const char* match = dst - offset;
+    if (offset >= len) {
+      std::memcpy(dst, match, len);
+    } else {
+      for (size_t k = 0; k < len; k++) dst[k] = match[k];
+    }
+    o += len;
+  }
+  if (o != size) return std::nullopt;
+  return out;
+}
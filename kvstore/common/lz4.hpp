@@ -0,0 +1,26 @@
+#ifndef COMMON_LZ4_HPP
+#define COMMON_LZ4_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// An implementation of the LZ4 block format
+// (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), for
+// compressing large values on the wire and in memory. A compressed string is
+// the uncompressed size (4 bytes, little-endian) followed by one LZ4 block.
+
+// The largest input lz4_compress accepts, and the largest output
+// lz4_decompress produces.
+constexpr size_t LZ4_MAX_SIZE = size_t(1) << 30;
+
+// Compresses `data`, which must be at most LZ4_MAX_SIZE bytes. The result is
+// slightly larger than `data` if `data` doesn't compress.
+std::string lz4_compress(std::string_view data);
+
+// Decompresses the output of lz4_compress. Returns std::nullopt if `data` is
+// malformed (it may come from the network, so nothing is taken on trust).
+std::optional<std::string> lz4_decompress(std::string_view data);
+
+#endif /* end of include guard */
@@ -77,6 +77,43 @@ OverlapStatus get_overlap(const Shard& a, const Shard& b) {
   }
 }
 
+bool may_overlap(const Shard& shard, const std::string& start,
+                 const std::string& end) {
+  // Bound the upper-cased prefixes of the keys in the range. They all share
+  // the bounds' common prefix; at the first position where the bounds differ,
+  // a key's character lies between theirs, and after that it can be anything.
+  // (Up to there, `end` can't run out before `start` does, as end > start.)
+  if (!end.empty() && end <= start) return false;
+  std::string lo, hi;
+  for (size_t i = 0; i < shard.granularity(); i++) {
+    int first = i < start.size() ? (unsigned char)start[i] : 0;
+    int last = end.empty() ? 0xff : (unsigned char)end[i];
+    if (i < start.size() && first == last) {
+      lo += std::toupper(first);
+      hi += std::toupper(first);
+      continue;
+    }
+
+    // Upper-casing doesn't preserve order, so check each valid character
+    // (in either case) against the range
+    char min = 0, max = 0;
+    for (char c : VALID_CHARS) {
+      int l = std::tolower(c);
+      if ((first <= c && c <= last) || (first <= l && l <= last)) {
+        if (!min) min = c;
+        max = c;
+      }
+    }
+    if (!min) return true;
+    lo += min;
+    hi += max;
+    lo.resize(shard.granularity(), VALID_CHARS.front());
+    hi.resize(shard.granularity(), VALID_CHARS.back());
+    break;
+  }
+  return !(shard.upper < lo || hi < shard.lower);
+}
+
 /* ==================================================*/
 /* === INTERNALS: DO NOT MODIFY BELOW THIS LINE ===  */
 /* ==================================================*/
@@ -115,6 +115,13 @@ std::pair<Shard, Shard> split_shard(const Shard& shard, const std::string& at,
 // function!
 OverlapStatus get_overlap(const Shard& a, const Shard& b);
 
+// Returns whether `shard` might contain keys in the range [start, end) (an
+// empty `end` means no upper bound). Shards compare keys case-insensitively,
+// which doesn't preserve key order, so this may return true for a shard that
+// holds none of the keys, but never false for one that does.
+bool may_overlap(const Shard& shard, const std::string& start,
+                 const std::string& end);
+
 /* ==================================================*/
 /* === INTERNALS: DO NOT MODIFY BELOW THIS LINE ===  */
 /* ==================================================*/
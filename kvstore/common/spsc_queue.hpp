@@ -0,0 +1,85 @@
+#ifndef COMMON_SPSC_QUEUE_HPP
+#define COMMON_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+/*
+ * An unbounded, lock-free queue for exactly one producer thread and one
+ * consumer thread. Items are stored in blocks of `BLOCK_SIZE`, linked into a
+ * list: the producer appends a block when the last one fills up, and the
+ * consumer frees each block once it has popped everything in it. Since it
+ * never fills up, two threads can push to each other without deadlocking.
+ */
+template <typename T, size_t BLOCK_SIZE = 64>
+class SpscQueue {
+ public:
+  SpscQueue() : head(new Block), tail(head) {
+  }
+  ~SpscQueue() {
+    while (this->head) {
+      Block* next = this->head->next;
+      delete this->head;
+      this->head = next;
+    }
+  }
+
+  // Only the producer may push.
+  void push(T item) {
+    uint64_t n = this->n_pushed.load(std::memory_order_relaxed);
+    size_t i = n % BLOCK_SIZE;
+    if (i == 0 && n > 0) {
+      // The consumer only follows `next` once this block's last item is
+      // published, so it doesn't need to be atomic
+      this->tail->next = new Block;
+      this->tail = this->tail->next;
+    }
+    this->tail->items[i] = std::move(item);
+    this->n_pushed.store(n + 1, std::memory_order_release);
+  }
+
+  // Only the consumer may pop.
+  std::optional<T> pop() {
+    uint64_t n = this->n_popped.load(std::memory_order_relaxed);
+    if (n == this->n_pushed.load(std::memory_order_acquire)) {
+      return std::nullopt;
+    }
+    size_t i = n % BLOCK_SIZE;
+    if (i == 0 && n > 0) {
+      Block* next = this->head->next;
+      delete this->head;
+      this->head = next;
+    }
+    std::optional<T> item(std::move(this->head->items[i]));
+    this->n_popped.store(n + 1, std::memory_order_release);
+    return item;
+  }
+
+  // The number of items queued; only a snapshot, unless called by the
+  // consumer when the producer isn't pushing.
+  size_t size() const {
+    return this->n_pushed.load(std::memory_order_acquire) -
+           this->n_popped.load(std::memory_order_acquire);
+  }
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+ private:
+  struct Block {
+    T items[BLOCK_SIZE];
+    Block* next = nullptr;
+  };
+
+  // The consumer's end, and the producer's, on separate cache lines so that
+  // each thread's writes don't invalidate the other's reads
+  alignas(64) Block* head;
+  std::atomic<uint64_t> n_popped = 0;
+  alignas(64) Block* tail;
+  std::atomic<uint64_t> n_pushed = 0;
+};
+
+#endif /* end of include guard */
@@ -1,5 +1,9 @@
 #include "common/utils.hpp"
 
+#include <array>
+#include <charconv>
+#include <chrono>
+
 std::vector<std::string> split(const std::string& s, char delim) {
   std::vector<std::string> res;
 
@@ -32,3 +36,44 @@ std::string to_lower(const std::string& s) {
                  [](unsigned char c) { return std::tolower(c); });
   return res;
 }
+
+uint32_t crc32(const void* data, size_t len) {
+  // Lookup table for the reflected polynomial 0xEDB88320, built once at
+  // compile time.
+  static constexpr auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  const auto* bytes = static_cast<const unsigned char*>(data);
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc = table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+uint64_t now_ms() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::string prefix_end(const std::string& prefix) {
+  std::string end = prefix;
+  while (!end.empty() && (unsigned char)end.back() == 0xff) end.pop_back();
+  if (!end.empty()) end.back()++;
+  return end;
+}
+
+std::optional<int64_t> parse_int(const std::string& s) {
+  int64_t n;
+  auto [end, err] = std::from_chars(s.data(), s.data() + s.size(), n);
+  if (err != std::errc() || end != s.data() + s.size()) return std::nullopt;
+  return n;
+}
@@ -3,7 +3,10 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cstddef>
+#include <cstdint>
 #include <numeric>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -22,4 +25,21 @@ bool is_number(const std::string& s);
 std::string to_upper(const std::string& s);
 std::string to_lower(const std::string& s);
 
+// Computes the CRC-32 (IEEE 802.3) checksum of `len` bytes at `data`, for
+// detecting torn or corrupt records in on-disk files.
+uint32_t crc32(const void* data, size_t len);
+
+// Milliseconds since the Unix epoch. Used for deadlines that must survive a
+// restart (e.g. key expiry), so it's wall-clock rather than steady time.
+uint64_t now_ms();
+
+// The smallest string that's greater than every string starting with `prefix`,
+// or the empty string if there's none (i.e. `prefix` is all '\xff'). Turns a
+// prefix into the range [prefix, prefix_end(prefix)).
+std::string prefix_end(const std::string& prefix);
+
+// Parses `s` as a base-10 signed 64-bit integer, with nothing else around it.
+// Returns std::nullopt if it isn't one (or is out of range).
+std::optional<int64_t> parse_int(const std::string& s);
+
 #endif /* end of include guard */
\ No newline at end of file
@@ -1,48 +1,876 @@
 #include "concurrent_kvstore.hpp"
 
+#include <algorithm>
+#include <filesystem>
 #include <mutex>
 #include <optional>
+#include <string_view>
+#include <unordered_set>
+
+#include "common/color.hpp"
+#include "snapshot.hpp"
+
+ConcurrentKvStore::~ConcurrentKvStore() {
+  {
+    std::lock_guard lock(this->background_mtx);
+    this->is_stopped = true;
+  }
+  this->background_cv.notify_all();
+  if (this->snapshotter.joinable()) this->snapshotter.join();
+  if (this->expirer.joinable()) this->expirer.join();
+}
 
 bool ConcurrentKvStore::Get(const GetRequest* req, GetResponse* res) {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  return this->Get(req->key, res);
+}
+
+bool ConcurrentKvStore::Get(std::string_view key, GetResponse* res) {
+  uint64_t version, expires_at;
+  return this->GetVersioned(key, res, &version, &expires_at);
+}
+
+bool ConcurrentKvStore::GetVersioned(const GetRequest* req, GetResponse* res,
+                                     uint64_t* version, uint64_t* expires_at) {
+  return this->GetVersioned(req->key, res, version, expires_at);
+}
 
+bool ConcurrentKvStore::GetVersioned(std::string_view key, GetResponse* res,
+                                     uint64_t* version, uint64_t* expires_at) {
+  size_t b = this->store.bucket(key);
+  std::shared_lock lock(this->store.mtxs[b]);
+  *version = this->store.versions[b].load(std::memory_order_acquire);
+
+  std::optional<DbItem> item = this->store.getIfLive(b, key, now_ms());
+  if (!item) {
+    this->counters[b].misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  this->counters[b].hits.fetch_add(1, std::memory_order_relaxed);
+  res->value = std::move(*item).plain_value();
+  *expires_at = item->expires_at;
   return true;
 }
 
+uint64_t ConcurrentKvStore::Version(std::string_view key) {
+  return this->store.versions[this->store.bucket(key)].load(
+      std::memory_order_acquire);
+}
+
 bool ConcurrentKvStore::Put(const PutRequest* req, PutResponse*) {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  size_t b = this->store.bucket(req->key);
+  uint64_t expires_at = req->ttl_ms ? now_ms() + req->ttl_ms : 0;
+  uint64_t lsn = 0;
+  {
+    std::unique_lock lock(this->store.mtxs[b]);
+    if (!this->put_locked(b, req->key, req->value, expires_at, req->owner,
+                          &lsn)) {
+      return false;
+    }
+  }
+  if (expires_at) this->schedule_expiry({req->key}, expires_at);
 
+  // Wait for durability outside of the bucket lock, so that other writers to
+  // this bucket can join the same group commit.
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
+bool ConcurrentKvStore::Cas(const CasRequest* req, CasResponse* res) {
+  size_t b = this->store.bucket(req->key);
+  uint64_t lsn = 0;
+  {
+    std::unique_lock lock(this->store.mtxs[b]);
+    std::optional<DbItem> item = this->store.getIfLive(b, req->key, now_ms());
+    std::optional<std::string> current;
+    if (item) current = std::move(*item).plain_value();
+    if (!current || *current != req->expected) {
+      if (current) res->value = std::move(*current);
+      return true;
+    }
+    if (!this->put_locked(b, req->key, req->value, item->expires_at,
+                          item->owner, &lsn)) {
+      return false;
+    }
+    res->swapped = true;
+  }
+
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
+bool ConcurrentKvStore::Incr(const IncrRequest* req, IncrResponse* res) {
+  IncrError error;
+  return this->Incr(req, res, &error);
+}
+
+bool ConcurrentKvStore::Incr(const IncrRequest* req, IncrResponse* res,
+                             IncrError* error) {
+  size_t b = this->store.bucket(req->key);
+  uint64_t lsn = 0;
+  *error = IncrError::NONE;
+  {
+    std::unique_lock lock(this->store.mtxs[b]);
+    std::optional<DbItem> item = this->store.getIfLive(b, req->key, now_ms());
+    std::optional<int64_t> value = item ? parse_int(item->plain_value()) : 0;
+    if (!value) {
+      *error = IncrError::NOT_AN_INTEGER;
+      return false;
+    }
+    if (__builtin_add_overflow(*value, req->delta, &res->value)) {
+      *error = IncrError::OUT_OF_RANGE;
+      return false;
+    }
+    if (!this->put_locked(b, req->key, std::to_string(res->value),
+                          item ? item->expires_at : 0,
+                          item ? item->owner : "", &lsn)) {
+      *error = IncrError::INTERNAL;
+      return false;
+    }
+  }
+
+  if (this->wal && !this->wal->wait_durable(lsn)) {
+    *error = IncrError::INTERNAL;
+    return false;
+  }
   return true;
 }
 
+bool ConcurrentKvStore::PutIfAbsent(const PutIfAbsentRequest* req,
+                                    PutIfAbsentResponse* res) {
+  size_t b = this->store.bucket(req->key);
+  uint64_t now = now_ms();
+  uint64_t expires_at = req->ttl_ms ? now + req->ttl_ms : 0;
+  uint64_t lsn = 0;
+  {
+    std::unique_lock lock(this->store.mtxs[b]);
+    std::optional<DbItem> item = this->store.getIfLive(b, req->key, now);
+    if (item) {
+      res->value = std::move(*item).plain_value();
+      return true;
+    }
+    if (!this->put_locked(b, req->key, req->value, expires_at, "", &lsn)) {
+      return false;
+    }
+    res->inserted = true;
+  }
+  if (expires_at) this->schedule_expiry({req->key}, expires_at);
+
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
 bool ConcurrentKvStore::Append(const AppendRequest* req, AppendResponse*) {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  size_t b = this->store.bucket(req->key);
+  uint64_t lsn = 0;
+  {
+    std::unique_lock lock(this->store.mtxs[b]);
+    auto& bucket = this->store.buckets[b];
+    auto it = std::find_if(bucket.begin(), bucket.end(),
+                           [&](auto&& item) { return item.key == req->key; });
 
-  return true;
+    // Appending to an expired key starts a new value with no TTL. That's
+    // logged as a Put, since on replay the key may not have expired yet.
+    bool live = it != bucket.end() && !it->expired(now_ms());
+    if (this->wal) {
+      WalOp op = live ? WalOp::APPEND : WalOp::PUT;
+      lsn = this->wal->append({op, {req->key}, {req->value}, 0});
+      if (!lsn) return false;
+      this->store.lsns[b] = lsn;
+    }
+
+    if (live && it->compressed) {
+      // Compressed values can't be appended to in place
+      this->store.insertItem(b, req->key, it->plain_value() + req->value,
+                             it->expires_at, it->owner);
+    } else if (live) {
+      it->value.append(req->value);
+      this->store.bytes[b] += req->value.size();
+      it->touch();
+      this->store.bump(b);
+    } else {
+      this->store.insertItem(b, req->key, req->value);
+    }
+    this->evict(b, req->key);
+  }
+
+  return !this->wal || this->wal->wait_durable(lsn);
 }
 
 bool ConcurrentKvStore::Delete(const DeleteRequest* req, DeleteResponse* res) {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  return this->Delete(req->key, res);
+}
 
-  return true;
+bool ConcurrentKvStore::Delete(std::string_view key, DeleteResponse* res) {
+  size_t b = this->store.bucket(key);
+  uint64_t lsn = 0;
+  {
+    std::unique_lock lock(this->store.mtxs[b]);
+    std::optional<DbItem> item = this->store.getIfLive(b, key, now_ms());
+    if (!item) {
+      return false;
+    }
+    if (this->wal) {
+      lsn = this->wal->append({WalOp::DELETE, {std::string(key)}, {}, 0});
+      if (!lsn) return false;
+      this->store.lsns[b] = lsn;
+    }
+    this->store.removeItem(b, key);
+    res->value = std::move(*item).plain_value();
+  }
+
+  return !this->wal || this->wal->wait_durable(lsn);
 }
 
 bool ConcurrentKvStore::MultiGet(const MultiGetRequest* req,
                                  MultiGetResponse* res) {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  return this->multi_get(req->keys, res);
+}
+
+bool ConcurrentKvStore::MultiGet(const std::vector<std::string_view>& keys,
+                                 MultiGetResponse* res) {
+  return this->multi_get(keys, res);
+}
+
+template <typename Key>
+bool ConcurrentKvStore::multi_get(const std::vector<Key>& keys,
+                                  MultiGetResponse* res) {
+  auto locks = this->lock_buckets<std::shared_lock<std::shared_mutex>>(keys);
 
+  uint64_t now = now_ms();
+  std::vector<std::string> values;
+  values.reserve(keys.size());
+  for (auto&& key : keys) {
+    size_t b = this->store.bucket(key);
+    std::optional<DbItem> item = this->store.getIfLive(b, key, now);
+    if (!item) {
+      this->counters[b].misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    this->counters[b].hits.fetch_add(1, std::memory_order_relaxed);
+    values.push_back(std::move(*item).plain_value());
+  }
+  res->values = std::move(values);
   return true;
 }
 
 bool ConcurrentKvStore::MultiPut(const MultiPutRequest* req,
                                  MultiPutResponse*) {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  if (req->keys.size() != req->values.size() ||
+      (!req->owners.empty() && req->owners.size() != req->keys.size())) {
+    return false;
+  }
 
-  return true;
+  uint64_t expires_at = req->ttl_ms ? now_ms() + req->ttl_ms : 0;
+  uint64_t lsn = 0;
+  {
+    auto locks = this->lock_buckets<std::unique_lock<std::shared_mutex>>(
+        req->keys);
+    if (this->wal) {
+      lsn = this->wal->append({WalOp::MULTI_PUT, req->keys, req->values,
+                               expires_at, 0, {}, req->owners});
+      if (!lsn) return false;
+      for (auto&& key : req->keys) {
+        this->store.lsns[this->store.bucket(key)] = lsn;
+      }
+    }
+    this->insert_all_locked(req->keys, req->values, expires_at, req->owners);
+  }
+  if (expires_at) this->schedule_expiry(req->keys, expires_at);
+
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
+void ConcurrentKvStore::insert_all_locked(
+    const std::vector<std::string>& keys,
+    const std::vector<std::string>& values, uint64_t expires_at,
+    const std::vector<std::string>& owners) {
+  for (size_t i = 0; i < keys.size(); i++) {
+    this->store.insertItem(this->store.bucket(keys[i]), keys[i], values[i],
+                           expires_at, owners.empty() ? "" : owners[i]);
+  }
+  // Only once every key is in, so that making room in a bucket never evicts
+  // a key that was just written there
+  if (this->max_bucket_bytes) {
+    std::unordered_set<std::string_view> written(keys.begin(), keys.end());
+    auto exempt = [&](const std::string& key) {
+      return written.contains(key);
+    };
+    std::vector<size_t> bs;
+    for (auto&& key : keys) bs.push_back(this->store.bucket(key));
+    std::sort(bs.begin(), bs.end());
+    bs.erase(std::unique(bs.begin(), bs.end()), bs.end());
+    for (size_t b : bs) this->evict_except(b, exempt);
+  }
+}
+
+bool ConcurrentKvStore::PrepareTxn(const PreparedTxn& txn) {
+  if (txn.keys.size() != txn.values.size()) return false;
+
+  uint64_t lsn = 0;
+  {
+    std::lock_guard lock(this->txn_mtx);
+    if (this->txn_outcomes.contains(txn.id)) return false;
+    if (this->wal) {
+      lsn = this->wal->append({WalOp::TXN_PREPARE, txn.keys, txn.values, 0,
+                               txn.id, txn.participants});
+      if (!lsn) return false;
+    }
+    this->prepared_txns[txn.id] = txn;
+  }
+
+  // A yes vote is a promise to commit if asked, so it has to survive a crash
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
+bool ConcurrentKvStore::CommitTxn(uint64_t id) {
+  std::vector<std::string> keys;
+  {
+    std::lock_guard lock(this->txn_mtx);
+    if (auto it = this->txn_outcomes.find(id); it != this->txn_outcomes.end()) {
+      return it->second;
+    }
+    auto it = this->prepared_txns.find(id);
+    if (it == this->prepared_txns.end()) return false;
+    keys = it->second.keys;
+  }
+
+  uint64_t lsn = 0;
+  {
+    auto locks = this->lock_buckets<std::unique_lock<std::shared_mutex>>(keys);
+    std::lock_guard lock(this->txn_mtx);
+    // It may have been decided while its buckets were being locked
+    auto it = this->prepared_txns.find(id);
+    if (it == this->prepared_txns.end()) {
+      auto outcome = this->txn_outcomes.find(id);
+      return outcome != this->txn_outcomes.end() && outcome->second;
+    }
+    PreparedTxn& txn = it->second;
+    if (this->wal) {
+      lsn = this->wal->append(
+          {WalOp::TXN_COMMIT, txn.keys, txn.values, 0, id, {}});
+      if (!lsn) return false;
+      for (auto&& key : txn.keys) {
+        this->store.lsns[this->store.bucket(key)] = lsn;
+      }
+    }
+    this->insert_all_locked(txn.keys, txn.values, 0, {});
+    this->prepared_txns.erase(it);
+    this->record_txn_outcome(id, true);
+  }
+
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
+bool ConcurrentKvStore::AbortTxn(uint64_t id) {
+  uint64_t lsn = 0;
+  {
+    std::lock_guard lock(this->txn_mtx);
+    if (auto it = this->txn_outcomes.find(id); it != this->txn_outcomes.end()) {
+      return !it->second;
+    }
+    if (this->wal) {
+      lsn = this->wal->append({WalOp::TXN_ABORT, {}, {}, 0, id, {}});
+      if (!lsn) return false;
+    }
+    this->prepared_txns.erase(id);
+    this->record_txn_outcome(id, false);
+  }
+
+  // Refusing a transaction that isn't prepared is a promise too
+  return !this->wal || this->wal->wait_durable(lsn);
+}
+
+std::optional<TxnStatus> ConcurrentKvStore::QueryTxn(uint64_t id) {
+  uint64_t lsn = 0;
+  {
+    // Checking and refusing at once, so that the transaction can't be
+    // prepared in between
+    std::lock_guard lock(this->txn_mtx);
+    if (auto it = this->txn_outcomes.find(id); it != this->txn_outcomes.end()) {
+      return it->second ? TxnStatus::COMMITTED : TxnStatus::ABORTED;
+    }
+    if (this->prepared_txns.contains(id)) return TxnStatus::PREPARED;
+    if (this->wal) {
+      lsn = this->wal->append({WalOp::TXN_ABORT, {}, {}, 0, id, {}});
+      if (!lsn) return std::nullopt;
+    }
+    this->record_txn_outcome(id, false);
+  }
+
+  if (this->wal && !this->wal->wait_durable(lsn)) return std::nullopt;
+  return TxnStatus::ABORTED;
+}
+
+std::optional<bool> ConcurrentKvStore::TxnOutcome(uint64_t id) {
+  std::lock_guard lock(this->txn_mtx);
+  auto it = this->txn_outcomes.find(id);
+  if (it == this->txn_outcomes.end()) return std::nullopt;
+  return it->second;
+}
+
+std::vector<PreparedTxn> ConcurrentKvStore::PreparedTxns() {
+  std::lock_guard lock(this->txn_mtx);
+  std::vector<PreparedTxn> txns;
+  for (auto&& [id, txn] : this->prepared_txns) txns.push_back(txn);
+  return txns;
+}
+
+void ConcurrentKvStore::record_txn_outcome(uint64_t id, bool committed) {
+  if (!this->txn_outcomes.emplace(id, committed).second) return;
+  this->txn_outcome_order.push_back(id);
+  if (this->txn_outcome_order.size() > MAX_TXN_OUTCOMES) {
+    this->txn_outcomes.erase(this->txn_outcome_order.front());
+    this->txn_outcome_order.pop_front();
+  }
+}
+
+bool ConcurrentKvStore::ScanRange(const ScanRangeRequest* req,
+                                  ScanRangeResponse* res) {
+  return this->ScanRange(req->start, req->end, req->limit, res);
+}
+
+bool ConcurrentKvStore::ScanRange(std::string_view start, std::string_view end,
+                                  uint64_t limit, ScanRangeResponse* res) {
+  uint64_t now = now_ms();
+  auto in_range = [&](const std::string& key) {
+    return start <= key && (end.empty() || key < end);
+  };
+
+  if (!this->store.index) {
+    // Without an index, every bucket has to be searched
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (size_t b = 0; b < this->store.n_buckets(); b++) {
+      std::shared_lock lock(this->store.mtxs[b]);
+      for (auto&& item : this->store.buckets[b]) {
+        if (in_range(item.key) && !item.expired(now)) {
+          pairs.emplace_back(item.key, item.plain_value());
+        }
+      }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    if (limit && pairs.size() > limit) pairs.resize(limit);
+    for (auto&& [key, value] : pairs) {
+      res->keys.push_back(std::move(key));
+      res->values.push_back(std::move(value));
+    }
+    return true;
+  }
+
+  // The index may still list keys that are being removed, or that have
+  // expired, so keep fetching keys until there are enough live ones
+  std::string cursor(start);
+  std::string end_key(end);
+  while (true) {
+    size_t want = limit ? limit - res->keys.size() : 0;
+    std::vector<std::string> keys =
+        this->store.index->scan(cursor, end_key, want);
+    for (auto&& key : keys) {
+      size_t b = this->store.bucket(key);
+      std::shared_lock lock(this->store.mtxs[b]);
+      std::optional<DbItem> item = this->store.getIfLive(b, key, now);
+      if (item) {
+        res->keys.push_back(key);
+        res->values.push_back(std::move(*item).plain_value());
+      }
+    }
+    if (!limit || keys.size() < want || res->keys.size() == limit) {
+      return true;
+    }
+    // The smallest key after the last one
+    cursor = keys.back() + '\0';
+  }
+}
+
+bool ConcurrentKvStore::DeleteByOwner(const DeleteByOwnerRequest* req,
+                                      DeleteByOwnerResponse* res) {
+  using Lock = std::unique_lock<std::shared_mutex>;
+  auto buckets_of = [&](const std::vector<std::string>& keys) {
+    std::vector<size_t> bs;
+    for (auto&& key : keys) bs.push_back(this->store.bucket(key));
+    std::sort(bs.begin(), bs.end());
+    bs.erase(std::unique(bs.begin(), bs.end()), bs.end());
+    return bs;
+  };
+
+  // The owner's keys come from the owner index. A key given to the owner
+  // after the index was read, but before its bucket was locked, would be
+  // missed; so read the index again once the buckets are locked, and start
+  // over if the owner's keys have spread to other buckets
+  std::vector<Lock> locks;
+  std::vector<std::string> keys = this->store.ownedBy(req->owner);
+  while (true) {
+    locks = this->lock_buckets<Lock>(keys);
+    std::vector<std::string> found = this->store.ownedBy(req->owner);
+    std::vector<size_t> locked = buckets_of(keys);
+    std::vector<size_t> needed = buckets_of(found);
+    keys = std::move(found);
+    if (std::includes(locked.begin(), locked.end(), needed.begin(),
+                      needed.end())) {
+      break;
+    }
+    locks.clear();
+  }
+
+  std::vector<std::pair<size_t, std::list<DbItem>::iterator>> items;
+  for (auto&& key : keys) {
+    size_t b = this->store.bucket(key);
+    auto& bucket = this->store.buckets[b];
+    auto it = std::find_if(bucket.begin(), bucket.end(),
+                           [&](auto&& item) { return item.key == key; });
+    if (it != bucket.end()) items.emplace_back(b, it);
+  }
+  if (items.empty()) return true;
+
+  uint64_t now = now_ms();
+  uint64_t lsn = 0;
+  if (this->wal) {
+    lsn = this->wal->append({WalOp::DELETE, keys, {}, 0});
+    if (!lsn) return false;
+    for (auto&& [b, it] : items) this->store.lsns[b] = lsn;
+  }
+  for (auto&& [b, it] : items) {
+    // Expired keys are removed too, but weren't there as far as readers
+    // could tell
+    if (!it->expired(now)) res->keys.push_back(it->key);
+    this->store.eraseItem(b, it);
+  }
+  locks.clear();
+
+  return !this->wal || this->wal->wait_durable(lsn);
 }
 
 std::vector<std::string> ConcurrentKvStore::AllKeys() {
-  // TODO (Part A, Step 3 and Step 4): Implement!
+  uint64_t now = now_ms();
+  std::vector<std::string> keys;
+  for (size_t b = 0; b < this->store.n_buckets(); b++) {
+    std::shared_lock lock(this->store.mtxs[b]);
+    for (auto&& item : this->store.buckets[b]) {
+      if (!item.expired(now)) keys.push_back(item.key);
+    }
+  }
+  return keys;
+}
+
+bool ConcurrentKvStore::EnablePersistence(const PersistenceOptions& options) {
+  this->snapshot_path =
+      (std::filesystem::path(options.dir) / "snapshot.dat").string();
+
+  // Load the latest snapshot, if there is one, placing each item directly at
+  // the end of its bucket (keys in a snapshot are unique)
+  std::vector<uint64_t> snapshot_lsns(this->store.n_buckets(), 0);
+  uint64_t wal_lsn = 0;
+  if (std::filesystem::exists(this->snapshot_path)) {
+    bool same_hasher = true;
+    bool ok = read_snapshot(
+        this->snapshot_path, this->store.n_buckets(), wal_lsn,
+        [&](size_t b, uint64_t lsn) {
+          snapshot_lsns[b] = lsn;
+          this->store.lsns[b] = lsn;
+        },
+        [&](size_t b, std::string_view key, std::string_view value,
+            uint64_t expires_at, std::string_view owner) {
+          std::string k(key), v(value);
+          same_hasher &= this->store.bucket(k) == b;
+          this->store.appendItem(b, k, v, expires_at, std::string(owner));
+        });
+    if (!ok) return false;
+    if (!same_hasher) {
+      cerr_color(RED, "Snapshot ", this->snapshot_path,
+                 " was written by a store with a different hasher");
+      return false;
+    }
+  }
+
+  // Then replay the log records that the snapshot doesn't cover
+  auto wal = std::make_unique<WriteAheadLog>(
+      WalOptions{options.dir, options.sync, options.sync_interval});
+  auto apply = [&](uint64_t lsn, const WalRecord& record) {
+    this->replay(lsn, record, snapshot_lsns);
+  };
+  if (!wal->open(apply, wal_lsn)) {
+    return false;
+  }
+  this->wal = std::move(wal);
+
+  // Recovered keys with a TTL need timers again (those that have expired in
+  // the meantime are reclaimed on the first tick)
+  for (auto&& bucket : this->store.buckets) {
+    for (auto&& item : bucket) {
+      if (item.expires_at) this->schedule_expiry({item.key}, item.expires_at);
+    }
+  }
+
+  if (options.snapshot_interval > 0ms) {
+    this->snapshotter = std::thread(&ConcurrentKvStore::snapshot_loop, this,
+                                    options.snapshot_interval);
+  }
+  return true;
+}
+
+bool ConcurrentKvStore::Snapshot() {
+  if (!this->wal) return false;
+  std::lock_guard snapshot_lock(this->snapshot_mtx);
+
+  // Everything up to the rotation point is applied to the buckets before any
+  // bucket is copied, so the snapshot covers the log up to there. The
+  // snapshot doesn't hold transactions, though, so those that are prepared,
+  // and the outcomes, are logged again after that point, where they survive
+  // the truncation.
+  uint64_t wal_lsn, relogged_lsn = 0;
+  {
+    std::lock_guard txn_lock(this->txn_mtx);
+    wal_lsn = this->wal->rotate();
+    for (auto&& [id, txn] : this->prepared_txns) {
+      relogged_lsn = this->wal->append({WalOp::TXN_PREPARE, txn.keys,
+                                        txn.values, 0, id, txn.participants});
+      if (!relogged_lsn) return false;
+    }
+    for (uint64_t id : this->txn_outcome_order) {
+      WalOp op = this->txn_outcomes[id] ? WalOp::TXN_COMMIT : WalOp::TXN_ABORT;
+      relogged_lsn = this->wal->append({op, {}, {}, 0, id, {}});
+      if (!relogged_lsn) return false;
+    }
+  }
+
+  // Expired items are left out. Any later write to their keys is logged as a
+  // Put (see Append), so replay never needs their old values.
+  uint64_t now = now_ms();
+  SnapshotWriter writer(this->snapshot_path);
+  if (!writer.open(this->store.n_buckets())) return false;
+  for (size_t b = 0; b < this->store.n_buckets(); b++) {
+    {
+      std::shared_lock lock(this->store.mtxs[b]);
+      auto& bucket = this->store.buckets[b];
+      size_t n_live = std::count_if(bucket.begin(), bucket.end(),
+                                    [&](auto&& item) {
+                                      return !item.expired(now);
+                                    });
+      writer.begin_bucket(this->store.lsns[b], n_live);
+      for (auto&& item : bucket) {
+        if (!item.expired(now)) {
+          writer.add_item(item.key, item.plain_value(), item.expires_at,
+                          item.owner);
+        }
+      }
+    }
+    if (!writer.flush_if_full()) return false;
+  }
+  if (!writer.commit(wal_lsn)) return false;
+  if (relogged_lsn && !this->wal->wait_durable(relogged_lsn)) return false;
+
+  this->wal->truncate(wal_lsn);
+  return true;
+}
+
+void ConcurrentKvStore::snapshot_loop(milliseconds interval) {
+  std::unique_lock lock(this->background_mtx);
+  while (!this->background_cv.wait_for(lock, interval,
+                                       [this] { return this->is_stopped; })) {
+    lock.unlock();
+    if (!this->Snapshot()) cerr_color(RED, "Failed to snapshot the store.");
+    lock.lock();
+  }
+}
+
+void ConcurrentKvStore::replay(uint64_t lsn, const WalRecord& record,
+                               const std::vector<uint64_t>& snapshot_lsns) {
+  switch (record.op) {
+    case WalOp::TXN_PREPARE:
+      // A transaction's PREPARE is logged again by each snapshot until it
+      // commits or aborts, so it may follow its outcome
+      if (!this->txn_outcomes.contains(record.txn_id)) {
+        this->prepared_txns[record.txn_id] = {record.txn_id, record.keys,
+                                              record.values,
+                                              record.participants};
+      }
+      return;
+    case WalOp::TXN_ABORT:
+      this->prepared_txns.erase(record.txn_id);
+      this->record_txn_outcome(record.txn_id, false);
+      return;
+    case WalOp::TXN_COMMIT:
+      // Its writes (if it carries them) are applied below
+      this->prepared_txns.erase(record.txn_id);
+      this->record_txn_outcome(record.txn_id, true);
+      break;
+    default:
+      break;
+  }
+
+  for (size_t i = 0; i < record.keys.size(); i++) {
+    auto& key = record.keys[i];
+    size_t b = this->store.bucket(key);
+    if (lsn <= snapshot_lsns[b]) continue;
+    this->store.lsns[b] = lsn;
+
+    switch (record.op) {
+      case WalOp::PUT:
+      case WalOp::MULTI_PUT:
+      case WalOp::TXN_COMMIT:
+        this->store.insertItem(
+            b, key, record.values[i], record.expires_at,
+            record.owners.empty() ? "" : record.owners[i]);
+        break;
+      case WalOp::APPEND: {
+        // Appends are only logged for live keys, so keep the key's TTL
+        std::optional<DbItem> item = this->store.getIfExists(b, key);
+        this->store.insertItem(b, key,
+                               (item ? item->plain_value() : "") +
+                                   record.values[i],
+                               item ? item->expires_at : 0,
+                               item ? item->owner : "");
+        break;
+      }
+      case WalOp::DELETE:
+        this->store.removeItem(b, key);
+        break;
+      case WalOp::TXN_PREPARE:
+      case WalOp::TXN_ABORT:
+        // Handled above
+        break;
+    }
+  }
+}
+
+void ConcurrentKvStore::schedule_expiry(const std::vector<std::string>& keys,
+                                        uint64_t expires_at) {
+  std::call_once(this->expirer_started, [this] {
+    this->expirer = std::thread(&ConcurrentKvStore::expiry_loop, this);
+  });
+
+  std::lock_guard lock(this->expiry_mtx);
+  for (auto&& key : keys) this->expiry_wheel.schedule({key, expires_at});
+}
+
+void ConcurrentKvStore::expiry_loop() {
+  // Timers that have fired, but whose keys haven't been reclaimed yet
+  std::deque<TimingWheel::Timer> due;
+
+  std::unique_lock lock(this->background_mtx);
+  while (!this->background_cv.wait_for(lock, EXPIRY_TICK,
+                                       [this] { return this->is_stopped; })) {
+    lock.unlock();
+    uint64_t now = now_ms();
+    {
+      std::lock_guard wheel_lock(this->expiry_mtx);
+      this->expiry_wheel.advance(now, due);
+    }
+    this->expire(due, std::min(due.size(), MAX_EXPIRIES_PER_TICK), now);
+    lock.lock();
+  }
+}
+
+void ConcurrentKvStore::expire(std::deque<TimingWheel::Timer>& timers,
+                               size_t n, uint64_t now) {
+  // Each key's bucket is locked just long enough to find and remove it.
+  // Timers for keys that were since overwritten or deleted no longer match
+  // the key's deadline, and find nothing to remove.
+  for (size_t i = 0; i < n; i++) {
+    auto& timer = timers.front();
+    size_t b = this->store.bucket(timer.key);
+    {
+      std::unique_lock lock(this->store.mtxs[b]);
+      this->store.removeIfExpired(b, timer.key, timer.deadline, now);
+    }
+    timers.pop_front();
+  }
+}
+
+void ConcurrentKvStore::EnableOrderedIndex() {
+  if (this->store.index) return;
+  this->store.index = std::make_unique<ConcurrentSkipList>();
+  for (auto&& bucket : this->store.buckets) {
+    for (auto&& item : bucket) this->store.index->insert(item.key);
+  }
+}
+
+void ConcurrentKvStore::EnableCompression(size_t threshold) {
+  this->store.compress_threshold = threshold;
+}
+
+void ConcurrentKvStore::SetMemoryLimit(size_t max_bytes) {
+  this->max_bucket_bytes =
+      max_bytes ? std::max<size_t>(max_bytes / this->store.n_buckets(), 1) : 0;
+}
+
+CacheStats ConcurrentKvStore::GetCacheStats() {
+  CacheStats stats;
+  stats.max_bytes = this->max_bucket_bytes * this->store.n_buckets();
+  for (size_t b = 0; b < this->store.n_buckets(); b++) {
+    stats.hits += this->counters[b].hits.load(std::memory_order_relaxed);
+    stats.misses += this->counters[b].misses.load(std::memory_order_relaxed);
+    stats.evictions +=
+        this->counters[b].evictions.load(std::memory_order_relaxed);
+    std::shared_lock lock(this->store.mtxs[b]);
+    stats.used_bytes += this->store.bytes[b];
+  }
+  return stats;
+}
+
+void ConcurrentKvStore::evict(size_t b, const std::string& key) {
+  this->evict_except(b, [&](const std::string& k) { return k == key; });
+}
+
+template <typename Exempt>
+void ConcurrentKvStore::evict_except(size_t b, Exempt exempt) {
+  if (!this->max_bucket_bytes) return;
+
+  // The bucket list doubles as the clock: the hand is always at the front.
+  // A referenced item has its bit cleared and moves to the back (its second
+  // chance); an unreferenced or expired one is evicted. Every item is visited
+  // at most twice.
+  auto& bucket = this->store.buckets[b];
+  uint64_t now = now_ms();
+  size_t max_steps = 2 * bucket.size();
+  for (size_t step = 0; step < max_steps && bucket.size() > 1 &&
+                        this->store.bytes[b] > this->max_bucket_bytes;
+       step++) {
+    auto it = bucket.begin();
+    if (exempt(it->key)) {
+      bucket.splice(bucket.end(), bucket, it);
+      continue;
+    }
+    if (!it->expired(now) &&
+        it->referenced.exchange(false, std::memory_order_relaxed)) {
+      bucket.splice(bucket.end(), bucket, it);
+      continue;
+    }
+
+    // Evictions are logged so that recovery doesn't resurrect the evicted
+    // keys; nothing waits for these records to become durable
+    if (this->wal) {
+      uint64_t lsn = this->wal->append({WalOp::DELETE, {it->key}, {}, 0});
+      if (lsn) this->store.lsns[b] = lsn;
+    }
+    this->store.eraseItem(b, it);
+    this->counters[b].evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool ConcurrentKvStore::put_locked(size_t b, const std::string& key,
+                                   const std::string& value,
+                                   uint64_t expires_at,
+                                   const std::string& owner, uint64_t* lsn) {
+  if (this->wal) {
+    WalRecord record{WalOp::PUT, {key}, {value}, expires_at};
+    if (!owner.empty()) record.owners = {owner};
+    *lsn = this->wal->append(record);
+    if (!*lsn) return false;
+    this->store.lsns[b] = *lsn;
+  }
+  this->store.insertItem(b, key, value, expires_at, owner);
+  this->evict(b, key);
+  return true;
+}
+
+template <typename Lock, typename Key>
+std::vector<Lock> ConcurrentKvStore::lock_buckets(
+    const std::vector<Key>& keys) {
+  std::vector<size_t> bs;
+  bs.reserve(keys.size());
+  for (auto&& key : keys) bs.push_back(this->store.bucket(key));
+  std::sort(bs.begin(), bs.end());
+  bs.erase(std::unique(bs.begin(), bs.end()), bs.end());
 
-  return {};
+  std::vector<Lock> locks;
+  locks.reserve(bs.size());
+  for (size_t b : bs) locks.emplace_back(this->store.mtxs[b]);
+  return locks;
 }
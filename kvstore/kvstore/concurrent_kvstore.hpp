@@ -1,18 +1,33 @@
 #ifndef CONCURRENT_KVSTORE_HPP
 #define CONCURRENT_KVSTORE_HPP
 
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <list>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "common/lz4.hpp"
 #include "common/utils.hpp"
 #include "kvstore.hpp"
 #include "net/server_commands.hpp"
+#include "skiplist.hpp"
+#include "timing_wheel.hpp"
+#include "wal.hpp"
 
 /**
  * Struct encapsulating a database item. This is optional, but you may find this
@@ -20,11 +35,66 @@
  */
 struct DbItem {
   std::string key;
+  // The value, or its lz4_compress()ed form if `compressed` is set (see
+  // DbMap::compress_threshold). Read it with plain_value().
   std::string value;
+  bool compressed = false;
+  // Expiry deadline in milliseconds since the epoch (see now_ms()), or 0 if
+  // the item never expires.
+  uint64_t expires_at = 0;
+  // The user the item belongs to, or empty if none (see DbMap::owned).
+  std::string owner;
+  // CLOCK reference bit for eviction: set whenever an existing item is
+  // accessed, and cleared when the eviction hand passes over it. New items
+  // start unreferenced, so keys that are written but never read again are
+  // evicted first. Reads set it while holding only a shared lock, hence
+  // atomic.
+  mutable std::atomic<bool> referenced = false;
 
-  DbItem(std::string& k, std::string& v) {
+  DbItem(std::string& k, std::string& v, uint64_t expires_at = 0,
+         bool compressed = false, std::string owner = "") {
     this->key = k;
     this->value = v;
+    this->compressed = compressed;
+    this->expires_at = expires_at;
+    this->owner = std::move(owner);
+  }
+
+  DbItem(const DbItem& item)
+      : key(item.key),
+        value(item.value),
+        compressed(item.compressed),
+        expires_at(item.expires_at),
+        owner(item.owner),
+        referenced(item.referenced.load(std::memory_order_relaxed)) {
+  }
+
+  // The value as it was written. Values the store compressed always
+  // decompress.
+  std::string plain_value() const& {
+    return this->compressed ? *lz4_decompress(this->value) : this->value;
+  }
+  std::string plain_value() && {
+    return this->compressed ? *lz4_decompress(this->value)
+                            : std::move(this->value);
+  }
+
+  void touch() const {
+    // Skip the store if the bit is already set, so that concurrent readers of
+    // a hot item don't keep invalidating each other's cache line
+    if (!this->referenced.load(std::memory_order_relaxed)) {
+      this->referenced.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  // Approximate memory footprint: the strings' contents plus the item and its
+  // list node.
+  static size_t footprint(const std::string& key, const std::string& value) {
+    return key.size() + value.size() + sizeof(DbItem) + 2 * sizeof(void*);
+  }
+
+  bool expired(uint64_t now) const {
+    return this->expires_at && this->expires_at <= now;
   }
 
   bool operator==(const DbItem& item) {
@@ -37,61 +107,269 @@ struct DbItem {
  */
 class DbMap {
  public:
-  DbMap(std::function<size_t(std::string)> hasher) : hasher(hasher) {
+  DbMap(std::function<size_t(std::string)> hasher,
+        size_t n_buckets = BUCKET_COUNT)
+      : buckets(n_buckets),
+        mtxs(n_buckets),
+        lsns(n_buckets),
+        bytes(n_buckets),
+        versions(n_buckets),
+        hasher(hasher),
+        default_hasher(hasher.target<std::hash<std::string>>() != nullptr) {
   }
 
+  // Default number of buckets. Stores expected to hold millions of keys should
+  // use more, to keep the per-bucket lists short.
   static constexpr size_t BUCKET_COUNT = 60;
 
   // Bucket associative array, with corresponding mutexes to protect access.
-  std::array<std::list<DbItem>, BUCKET_COUNT> buckets;
+  std::vector<std::list<DbItem>> buckets;
+
+  std::vector<std::shared_mutex> mtxs;
+
+  // LSN of the last write-ahead log record applied to each bucket (0 if the
+  // store isn't persistent). Protected by the bucket's mutex.
+  std::vector<uint64_t> lsns;
+
+  // Approximate memory used by each bucket's items (see DbItem::footprint).
+  // Protected by the bucket's mutex.
+  std::vector<size_t> bytes;
+
+  // Bumped on every change to a bucket's contents, while it's locked
+  // exclusively, so that callers caching values read from a bucket can tell
+  // whether they're still current.
+  std::vector<std::atomic<uint64_t>> versions;
+
+  // Values at least this many bytes long are stored compressed, if that makes
+  // them smaller; 0 disables compression. Item footprints (and so the memory
+  // limit) count the compressed size.
+  size_t compress_threshold = 0;
+
+  // Ordered index of every key in the buckets (including expired ones that
+  // haven't been reclaimed yet), or null if disabled. Kept in sync by the
+  // methods below, while the key's bucket is locked exclusively.
+  std::unique_ptr<ConcurrentSkipList> index;
+
+  // The keys of each owner's items (see DeleteByOwnerRequest). Kept in sync
+  // by the methods below while the key's bucket is locked exclusively, and
+  // protected by `owned_mtx` from changes to other buckets. Always taken
+  // after bucket locks, never before.
+  std::unordered_map<std::string, std::unordered_set<std::string>> owned;
+  std::mutex owned_mtx;
+
+  // The keys of `owner`'s items.
+  std::vector<std::string> ownedBy(const std::string& owner) {
+    std::lock_guard lock(this->owned_mtx);
+    auto it = this->owned.find(owner);
+    if (it == this->owned.end()) return {};
+    return {it->second.begin(), it->second.end()};
+  }
+
+  size_t n_buckets() const {
+    return buckets.size();
+  }
+
+  // Compresses `value` in place if compression is enabled and worth it, and
+  // returns whether it did.
+  bool compress(std::string& value) const {
+    if (!this->compress_threshold || value.size() < this->compress_threshold ||
+        value.size() > LZ4_MAX_SIZE) {
+      return false;
+    }
+    std::string compressed = lz4_compress(value);
+    if (compressed.size() >= value.size()) return false;
+    value = std::move(compressed);
+    return true;
+  }
 
-  // TODO (Part A, Step 4): You will need to add fields to synchronize access to
-  // the hashmap buckets!
+  // Records a change to bucket `b`. Assumes the bucket is locked exclusively.
+  void bump(size_t b) {
+    this->versions[b].fetch_add(1, std::memory_order_release);
+  }
 
   // Return the index of the bucket to search for `key`.
-  size_t bucket(std::string key) const {
-    return hasher(key) % BUCKET_COUNT;
+  size_t bucket(std::string_view key) const {
+    // std::hash gives a string_view the same hash as the equivalent string, so
+    // the default hasher doesn't need a copy of the key
+    if (this->default_hasher) {
+      return std::hash<std::string_view>()(key) % buckets.size();
+    }
+    return hasher(std::string(key)) % buckets.size();
   }
 
   // Returns the DbItem with key 'key' in bucket `b` if it exists, std::nullopt
   // otherwise Assumes that `b` == this->bucket(key).
-  std::optional<DbItem> getIfExists(size_t b, std::string key) {
-    assert(b < BUCKET_COUNT);
+  std::optional<DbItem> getIfExists(size_t b, std::string_view key) {
+    assert(b < buckets.size());
     for (const auto& item : this->buckets[b]) {
       if (item.key == key) {
+        item.touch();
         return item;
       }
     }
     return std::nullopt;
   }
 
+  // Like getIfExists, but treats an item that expired at or before `now` as
+  // missing.
+  std::optional<DbItem> getIfLive(size_t b, std::string_view key,
+                                  uint64_t now) {
+    std::optional<DbItem> item = this->getIfExists(b, key);
+    if (item && item->expired(now)) {
+      return std::nullopt;
+    }
+    return item;
+  }
+
   // Insert a new DbItem with key 'key' and value 'value' to bucket `b`.
-  // If key already exists, updates value to `value`.
+  // If key already exists, updates value to `value`. Either way, the item
+  // expires at `expires_at` (0 for never) and belongs to `owner` (if any).
   // Assumes that `b` == this->bucket(key).
-  void insertItem(size_t b, std::string key, std::string value) {
-    assert(b < BUCKET_COUNT);
+  void insertItem(size_t b, std::string key, std::string value,
+                  uint64_t expires_at = 0, const std::string& owner = "") {
+    assert(b < buckets.size());
 
     for (auto& item : this->buckets[b]) {
       if (item.key == key) {
-        item.value = value;
+        bool compressed = this->compress(value);
+        this->bytes[b] += value.size() - item.value.size();
+        item.value = std::move(value);
+        item.compressed = compressed;
+        item.expires_at = expires_at;
+        if (item.owner != owner) {
+          this->disown(item);
+          item.owner = owner;
+          this->own(item);
+        }
+        item.touch();
+        this->bump(b);
         return;
       }
     }
-    this->buckets[b].emplace_back(key, value);
+    this->appendItem(b, key, value, expires_at, owner);
+  }
+
+  // Adds a DbItem to the end of bucket `b` without checking whether `key` is
+  // already there. Assumes that `b` == this->bucket(key).
+  void appendItem(size_t b, std::string key, std::string value,
+                  uint64_t expires_at = 0, const std::string& owner = "") {
+    assert(b < buckets.size());
+
+    bool compressed = this->compress(value);
+    this->bytes[b] += DbItem::footprint(key, value);
+    if (this->index) this->index->insert(key);
+    this->own(this->buckets[b].emplace_back(key, value, expires_at, compressed,
+                                            owner));
+    this->bump(b);
   }
 
   // Remove a DbItem with key `key` from bucket `b`.
   // Assumes that `b` == this->getBucketIndex(key).
-  bool removeItem(size_t b, std::string key) {
-    assert(b < BUCKET_COUNT);
+  bool removeItem(size_t b, std::string_view key) {
+    assert(b < buckets.size());
 
-    size_t num_removed = this->buckets[b].remove_if(
-        [&](auto&& item) { return item.key == key; });
+    size_t num_removed = this->buckets[b].remove_if([&](auto&& item) {
+      if (item.key != key) return false;
+      this->bytes[b] -= DbItem::footprint(item.key, item.value);
+      if (this->index) this->index->remove(item.key);
+      this->disown(item);
+      return true;
+    });
+    if (num_removed > 0) this->bump(b);
     return num_removed > 0;
   }
 
+  // Removes the item with key `key` from bucket `b` if it's set to expire at
+  // `expires_at` and that is at or before `now`. Assumes that
+  // `b` == this->bucket(key).
+  bool removeIfExpired(size_t b, std::string_view key, uint64_t expires_at,
+                       uint64_t now) {
+    assert(b < buckets.size());
+
+    auto& bucket = this->buckets[b];
+    auto it = std::find_if(bucket.begin(), bucket.end(),
+                           [&](auto&& item) { return item.key == key; });
+    if (it == bucket.end() || it->expires_at != expires_at ||
+        !it->expired(now)) {
+      return false;
+    }
+    this->eraseItem(b, it);
+    return true;
+  }
+
+  // Removes the item at `it` from bucket `b`.
+  void eraseItem(size_t b, std::list<DbItem>::iterator it) {
+    assert(b < buckets.size());
+
+    this->bytes[b] -= DbItem::footprint(it->key, it->value);
+    if (this->index) this->index->remove(it->key);
+    this->disown(*it);
+    this->buckets[b].erase(it);
+    this->bump(b);
+  }
+
  private:
   std::function<size_t(std::string)> hasher;
+  // Whether `hasher` is std::hash<std::string>.
+  bool default_hasher;
+
+  // Adds `item` to, or removes it from, its owner's keys in `owned`.
+  void own(const DbItem& item) {
+    if (item.owner.empty()) return;
+    std::lock_guard lock(this->owned_mtx);
+    this->owned[item.owner].insert(item.key);
+  }
+  void disown(const DbItem& item) {
+    if (item.owner.empty()) return;
+    std::lock_guard lock(this->owned_mtx);
+    auto it = this->owned.find(item.owner);
+    it->second.erase(item.key);
+    if (it->second.empty()) this->owned.erase(it);
+  }
+};
+
+// Settings for ConcurrentKvStore::EnablePersistence.
+struct PersistenceOptions {
+  // Directory holding the write-ahead log segments and the latest snapshot.
+  std::string dir;
+  SyncPolicy sync = SyncPolicy::INTERVAL;
+  milliseconds sync_interval = 10ms;
+  // How often to snapshot the store in the background (which also drops the
+  // log prefix the snapshot covers); 0ms disables periodic snapshots.
+  milliseconds snapshot_interval = 0ms;
+};
+
+// Counters for a store used as a cache (see ConcurrentKvStore::SetMemoryLimit).
+struct CacheStats {
+  // Keys found and not found by Get and MultiGet.
+  uint64_t hits = 0;
+  uint64_t misses = 0;
+  uint64_t evictions = 0;
+  size_t used_bytes = 0;
+  // 0 if the store is unbounded.
+  size_t max_bytes = 0;
+};
+
+// Why an Incr failed.
+enum class IncrError {
+  NONE,
+  // The key's value isn't a 64-bit integer.
+  NOT_AN_INTEGER,
+  // Adding the delta would overflow it.
+  OUT_OF_RANGE,
+  // The increment couldn't be logged, or made durable.
+  INTERNAL,
+};
+
+// A transaction's writes to this store, staged until it commits or aborts
+// (see ConcurrentKvStore::PrepareTxn).
+struct PreparedTxn {
+  uint64_t id = 0;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  // Every server taking part in the transaction, so that a server left in
+  // doubt about its outcome knows whom to ask.
+  std::vector<std::string> participants;
 };
 
 class ConcurrentKvStore : public KvStore {
@@ -100,10 +378,11 @@ class ConcurrentKvStore : public KvStore {
   // See the performance test comments if you're interested in how it works,
   // otherwise, feel free to ignore!
   ConcurrentKvStore(
-      std::function<size_t(std::string)> hasher = std::hash<std::string>())
-      : store(hasher) {
+      std::function<size_t(std::string)> hasher = std::hash<std::string>(),
+      size_t n_buckets = DbMap::BUCKET_COUNT)
+      : store(hasher, n_buckets), counters(n_buckets) {
   }
-  ~ConcurrentKvStore() = default;
+  ~ConcurrentKvStore();
 
   bool Get(const GetRequest* req, GetResponse* res) override;
   bool Put(const PutRequest* req, PutResponse* res) override;
@@ -111,12 +390,217 @@ class ConcurrentKvStore : public KvStore {
   bool Delete(const DeleteRequest* req, DeleteResponse* res) override;
   bool MultiGet(const MultiGetRequest* req, MultiGetResponse* res) override;
   bool MultiPut(const MultiPutRequest* req, MultiPutResponse* res) override;
+  bool ScanRange(const ScanRangeRequest* req, ScanRangeResponse* res) override;
+  // Conditional writes and increments run entirely under the key's bucket
+  // lock, and are logged as the Put they amount to.
+  bool Cas(const CasRequest* req, CasResponse* res) override;
+  bool Incr(const IncrRequest* req, IncrResponse* res) override;
+  // Same, but also says why it failed, if it did.
+  bool Incr(const IncrRequest* req, IncrResponse* res, IncrError* error);
+  bool PutIfAbsent(const PutIfAbsentRequest* req,
+                   PutIfAbsentResponse* res) override;
+  // Deletes the owner's keys atomically: a concurrent multi-key read sees
+  // either all of them or none, and they're logged as a single record. The
+  // keys come from the owner index, so only their buckets are locked.
+  bool DeleteByOwner(const DeleteByOwnerRequest* req,
+                     DeleteByOwnerResponse* res) override;
 
   std::vector<std::string> AllKeys() override;
 
+  // Like Get, but also returns the version of the key's bucket that the value
+  // was read at, and the key's expiry deadline (0 if it has none). A cached
+  // copy of the result stays valid until Version(key) moves past `version`
+  // or the deadline passes.
+  bool GetVersioned(const GetRequest* req, GetResponse* res,
+                    uint64_t* version, uint64_t* expires_at);
+
+  // The current version of `key`'s bucket. Any write to the bucket after
+  // this call returns changes it.
+  uint64_t Version(std::string_view key);
+
+  // The read path, for keys that the caller doesn't own (e.g. views into a
+  // received message; see ReadRequestView). The request-based versions above
+  // call these.
+  bool Get(std::string_view key, GetResponse* res);
+  bool GetVersioned(std::string_view key, GetResponse* res, uint64_t* version,
+                    uint64_t* expires_at);
+  bool Delete(std::string_view key, DeleteResponse* res);
+  bool MultiGet(const std::vector<std::string_view>& keys,
+                MultiGetResponse* res);
+  bool ScanRange(std::string_view start, std::string_view end, uint64_t limit,
+                 ScanRangeResponse* res);
+
+  // Put and MultiPut requests with a TTL make their keys expire: from then on,
+  // reads treat the keys as missing, and a background thread reclaims them.
+
+  // Makes the store durable by logging every mutation to a write-ahead log in
+  // `options.dir`. The store's contents are first recovered from the latest
+  // snapshot and the log records that follow it. Must be called before the
+  // store is shared between threads, and the store must use the same hasher
+  // and bucket count as when the snapshot was taken.
+  bool EnablePersistence(const PersistenceOptions& options);
+
+  // Writes a snapshot of the whole store to disk without blocking writers
+  // (each bucket is only locked while it's copied), then deletes the log
+  // segments the snapshot covers. Requires persistence to be enabled.
+  bool Snapshot();
+
+  // Durable two-phase commit: prepared transactions and transactions'
+  // outcomes are logged, and recovered on startup, so that a store that voted
+  // to commit a transaction still holds its writes after a restart, and
+  // remembers how every recent transaction ended. Locking the transactions'
+  // keys is up to the caller (see TxnTable).
+  //
+  // PrepareTxn stages a transaction's writes, once they're durable. It fails
+  // if the transaction already has an outcome (e.g. AbortTxn refused it).
+  bool PrepareTxn(const PreparedTxn& txn);
+  // Applies a prepared transaction's writes atomically, like a MultiPut.
+  // Returns true if the transaction has committed (now or before), and false
+  // if it isn't prepared or was aborted.
+  bool CommitTxn(uint64_t id);
+  // Drops a prepared transaction's writes; if it isn't prepared, makes sure
+  // it never will be. Returns false if it has committed.
+  bool AbortTxn(uint64_t id);
+  // How a transaction stands, for another of its participants that is in
+  // doubt. One that isn't prepared is refused (as by AbortTxn), so that it
+  // can't be prepared later on. Returns std::nullopt if the refusal couldn't
+  // be logged.
+  std::optional<TxnStatus> QueryTxn(uint64_t id);
+  // Whether a transaction committed (true) or aborted (false), or
+  // std::nullopt if it's still prepared, or unknown to this store. Only the
+  // last MAX_TXN_OUTCOMES outcomes are kept.
+  std::optional<bool> TxnOutcome(uint64_t id);
+  // The transactions that are prepared, e.g. those recovered on startup.
+  std::vector<PreparedTxn> PreparedTxns();
+
+  static constexpr size_t MAX_TXN_OUTCOMES = 10'000;
+
+  // Bounds the store's (approximate) memory use to `max_bytes`; 0 means
+  // unbounded. Each bucket gets an equal share of the budget, and a write
+  // that takes its bucket over its share evicts items from that bucket using
+  // the CLOCK algorithm, so eviction only needs the bucket lock the write
+  // already holds. Must be called before the store is shared between threads.
+  void SetMemoryLimit(size_t max_bytes);
+
+  CacheStats GetCacheStats();
+
+  // Maintains an ordered index of the keys alongside the hash table, so that
+  // ScanRange only visits the keys in its range rather than every key in the
+  // store. The index costs a skip list insert (or remove) whenever a key is
+  // created (or removed); overwrites don't touch it. Must be called before
+  // the store is shared between threads.
+  void EnableOrderedIndex();
+
+  // Stores values of at least `threshold` bytes compressed (see lz4.hpp),
+  // trading CPU on every read and write of them for memory. Only affects
+  // values written from then on. Must be called before the store is shared
+  // between threads.
+  void EnableCompression(size_t threshold);
+
  private:
   // Your internal key-value store implementation!
   DbMap store;
+
+  // Write-ahead log; null if the store is purely in-memory.
+  std::unique_ptr<WriteAheadLog> wal;
+  std::string snapshot_path;
+
+  // Background threads (snapshotting and expiry), and what they need to stop
+  // promptly.
+  std::thread snapshotter;
+  std::thread expirer;
+  std::mutex background_mtx;
+  std::condition_variable background_cv;
+  bool is_stopped = false;
+  // Serializes snapshots.
+  std::mutex snapshot_mtx;
+
+  // Granularity of key expiry, and the most keys reclaimed per tick. Keys
+  // beyond the limit wait for later ticks, so that reclaiming a large batch
+  // of keys that expire together is spread out rather than stalling writers;
+  // Get never returns an expired key in the meantime.
+  static constexpr milliseconds EXPIRY_TICK = 10ms;
+  static constexpr size_t MAX_EXPIRIES_PER_TICK = 10'000;
+
+  // Timers for keys with a TTL, protected by `expiry_mtx`. The expirer
+  // thread is started the first time a TTL is set.
+  TimingWheel expiry_wheel{EXPIRY_TICK, now_ms()};
+  std::mutex expiry_mtx;
+  std::once_flag expirer_started;
+
+  void schedule_expiry(const std::vector<std::string>& keys,
+                       uint64_t expires_at);
+  void expiry_loop();
+  // Removes the keys of the first `n` of `timers` that have expired, and
+  // drops those timers.
+  void expire(std::deque<TimingWheel::Timer>& timers, size_t n, uint64_t now);
+
+  // Per-bucket share of the memory limit; 0 if the store is unbounded.
+  size_t max_bucket_bytes = 0;
+
+  // Per-bucket cache counters, each on its own cache line so that readers of
+  // different buckets don't contend.
+  struct alignas(64) StripeCounters {
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> evictions = 0;
+  };
+  std::vector<StripeCounters> counters;
+
+  // Evicts items other than `key` (which was just written) from bucket `b`
+  // until it's back within its share of the memory limit. Assumes the bucket
+  // is locked exclusively.
+  void evict(size_t b, const std::string& key);
+  // Same, but spares every key for which `exempt(key)` is true, e.g. all of
+  // the keys a MultiPut just wrote.
+  template <typename Exempt>
+  void evict_except(size_t b, Exempt exempt);
+
+  // Prepared transactions, and transactions' outcomes (oldest first, so that
+  // the oldest can be forgotten), protected by `txn_mtx`. It's locked after
+  // any bucket locks, and before the log's.
+  std::mutex txn_mtx;
+  std::unordered_map<uint64_t, PreparedTxn> prepared_txns;
+  std::unordered_map<uint64_t, bool> txn_outcomes;
+  std::deque<uint64_t> txn_outcome_order;
+
+  // Records a transaction's outcome, forgetting the oldest one if there are
+  // too many. Assumes `txn_mtx` is held (or that the store is recovering).
+  void record_txn_outcome(uint64_t id, bool committed);
+
+  // Applies a logged mutation directly to the map, without locking or
+  // logging. Keys in buckets whose snapshotted LSN is at least `lsn` already
+  // reflect the record, and are skipped.
+  void replay(uint64_t lsn, const WalRecord& record,
+              const std::vector<uint64_t>& snapshot_lsns);
+
+  void snapshot_loop(milliseconds interval);
+
+  // Logs and applies a Put of `key`, owned by `owner` (if non-empty), to
+  // bucket `b`, which must be locked exclusively. Returns false if the record
+  // couldn't be logged. Otherwise, `*lsn` is the record's LSN (left alone if
+  // the store isn't persistent), which the caller waits on once it has
+  // released the lock.
+  bool put_locked(size_t b, const std::string& key, const std::string& value,
+                  uint64_t expires_at, const std::string& owner,
+                  uint64_t* lsn);
+
+  // Writes `keys` with `values` (and `owners`, if not empty) to their
+  // buckets, which must be locked exclusively, then makes room in those
+  // buckets without evicting any of the keys just written.
+  void insert_all_locked(const std::vector<std::string>& keys,
+                         const std::vector<std::string>& values,
+                         uint64_t expires_at,
+                         const std::vector<std::string>& owners);
+
+  // MultiGet, for owned keys or views of them.
+  template <typename Key>
+  bool multi_get(const std::vector<Key>& keys, MultiGetResponse* res);
+
+  // Locks the (deduplicated) buckets of `keys` in ascending order, so that
+  // concurrent multi-key operations can't deadlock.
+  template <typename Lock, typename Key>
+  std::vector<Lock> lock_buckets(const std::vector<Key>& keys);
 };
 
-#endif /* end of include guard */
\ No newline at end of file
+#endif /* end of include guard */
@@ -17,6 +17,14 @@ class KvStore {
   virtual bool Delete(const DeleteRequest* req, DeleteResponse* res) = 0;
   virtual bool MultiGet(const MultiGetRequest* req, MultiGetResponse* res) = 0;
   virtual bool MultiPut(const MultiPutRequest* req, MultiPutResponse*) = 0;
+  virtual bool ScanRange(const ScanRangeRequest* req,
+                         ScanRangeResponse* res) = 0;
+  virtual bool Cas(const CasRequest* req, CasResponse* res) = 0;
+  virtual bool Incr(const IncrRequest* req, IncrResponse* res) = 0;
+  virtual bool PutIfAbsent(const PutIfAbsentRequest* req,
+                           PutIfAbsentResponse* res) = 0;
+  virtual bool DeleteByOwner(const DeleteByOwnerRequest* req,
+                             DeleteByOwnerResponse* res) = 0;
 
   virtual std::vector<std::string> AllKeys() = 0;
 };
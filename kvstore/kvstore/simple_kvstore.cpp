@@ -1,44 +1,185 @@
 #include "simple_kvstore.hpp"
 
+#include "common/utils.hpp"
+
 bool SimpleKvStore::Get(const GetRequest* req, GetResponse* res) {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  std::lock_guard lock(this->mtx);
 
+  Entry* entry = this->find(req->key, now_ms());
+  if (!entry) {
+    return false;
+  }
+  res->value = entry->value;
   return true;
 }
 
 bool SimpleKvStore::Put(const PutRequest* req, PutResponse*) {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  std::lock_guard lock(this->mtx);
 
+  uint64_t expires_at = req->ttl_ms ? now_ms() + req->ttl_ms : 0;
+  this->store[req->key] = Entry{req->value, expires_at, req->owner};
   return true;
 }
 
 bool SimpleKvStore::Append(const AppendRequest* req, AppendResponse*) {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  std::lock_guard lock(this->mtx);
 
+  Entry* entry = this->find(req->key, now_ms());
+  if (entry) {
+    entry->value.append(req->value);
+  } else {
+    this->store[req->key] = Entry{req->value};
+  }
   return true;
 }
 
 bool SimpleKvStore::Delete(const DeleteRequest* req, DeleteResponse* res) {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  std::lock_guard lock(this->mtx);
 
+  Entry* entry = this->find(req->key, now_ms());
+  if (!entry) {
+    return false;
+  }
+  res->value = std::move(entry->value);
+  this->store.erase(req->key);
   return true;
 }
 
 bool SimpleKvStore::MultiGet(const MultiGetRequest* req,
                              MultiGetResponse* res) {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  std::lock_guard lock(this->mtx);
 
+  uint64_t now = now_ms();
+  std::vector<std::string> values;
+  values.reserve(req->keys.size());
+  for (auto&& key : req->keys) {
+    Entry* entry = this->find(key, now);
+    if (!entry) {
+      return false;
+    }
+    values.push_back(entry->value);
+  }
+  res->values = std::move(values);
   return true;
 }
 
 bool SimpleKvStore::MultiPut(const MultiPutRequest* req, MultiPutResponse*) {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  if (req->keys.size() != req->values.size() ||
+      (!req->owners.empty() && req->owners.size() != req->keys.size())) {
+    return false;
+  }
+
+  std::lock_guard lock(this->mtx);
+  uint64_t expires_at = req->ttl_ms ? now_ms() + req->ttl_ms : 0;
+  for (size_t i = 0; i < req->keys.size(); i++) {
+    this->store[req->keys[i]] = Entry{
+        req->values[i], expires_at, req->owners.empty() ? "" : req->owners[i]};
+  }
+  return true;
+}
+
+bool SimpleKvStore::ScanRange(const ScanRangeRequest* req,
+                              ScanRangeResponse* res) {
+  std::lock_guard lock(this->mtx);
+
+  uint64_t now = now_ms();
+  for (auto it = this->store.lower_bound(req->start);
+       it != this->store.end() && (req->end.empty() || it->first < req->end) &&
+       (!req->limit || res->keys.size() < req->limit);
+       it++) {
+    auto&& [key, entry] = *it;
+    if (entry.expires_at && entry.expires_at <= now) continue;
+    res->keys.push_back(key);
+    res->values.push_back(entry.value);
+  }
+  return true;
+}
+
+bool SimpleKvStore::Cas(const CasRequest* req, CasResponse* res) {
+  std::lock_guard lock(this->mtx);
+
+  Entry* entry = this->find(req->key, now_ms());
+  if (!entry || entry->value != req->expected) {
+    if (entry) res->value = entry->value;
+    return true;
+  }
+  entry->value = req->value;
+  res->swapped = true;
+  return true;
+}
 
+bool SimpleKvStore::Incr(const IncrRequest* req, IncrResponse* res) {
+  std::lock_guard lock(this->mtx);
+
+  Entry* entry = this->find(req->key, now_ms());
+  std::optional<int64_t> value = entry ? parse_int(entry->value) : 0;
+  if (!value || __builtin_add_overflow(*value, req->delta, &res->value)) {
+    return false;
+  }
+  if (entry) {
+    entry->value = std::to_string(res->value);
+  } else {
+    this->store[req->key] = Entry{std::to_string(res->value)};
+  }
+  return true;
+}
+
+bool SimpleKvStore::PutIfAbsent(const PutIfAbsentRequest* req,
+                                PutIfAbsentResponse* res) {
+  std::lock_guard lock(this->mtx);
+
+  uint64_t now = now_ms();
+  if (Entry* entry = this->find(req->key, now)) {
+    res->value = entry->value;
+    return true;
+  }
+  this->store[req->key] =
+      Entry{req->value, req->ttl_ms ? now + req->ttl_ms : 0};
+  res->inserted = true;
+  return true;
+}
+
+bool SimpleKvStore::DeleteByOwner(const DeleteByOwnerRequest* req,
+                                  DeleteByOwnerResponse* res) {
+  std::lock_guard lock(this->mtx);
+
+  // Entries without an owner don't belong to the empty owner
+  if (req->owner.empty()) return true;
+
+  uint64_t now = now_ms();
+  for (auto it = this->store.begin(); it != this->store.end();) {
+    auto&& [key, entry] = *it;
+    if (entry.owner != req->owner) {
+      it++;
+      continue;
+    }
+    if (!entry.expires_at || entry.expires_at > now) res->keys.push_back(key);
+    it = this->store.erase(it);
+  }
   return true;
 }
 
 std::vector<std::string> SimpleKvStore::AllKeys() {
-  // TODO (Part A, Step 1 and Step 2): Implement!
+  std::lock_guard lock(this->mtx);
+
+  uint64_t now = now_ms();
+  std::vector<std::string> keys;
+  keys.reserve(this->store.size());
+  for (auto&& [key, entry] : this->store) {
+    if (!entry.expires_at || entry.expires_at > now) keys.push_back(key);
+  }
+  return keys;
+}
 
-  return {};
+SimpleKvStore::Entry* SimpleKvStore::find(const std::string& key,
+                                          uint64_t now) {
+  auto it = this->store.find(key);
+  if (it == this->store.end()) {
+    return nullptr;
+  }
+  if (it->second.expires_at && it->second.expires_at <= now) {
+    this->store.erase(it);
+    return nullptr;
+  }
+  return &it->second;
 }
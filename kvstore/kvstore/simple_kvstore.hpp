@@ -1,6 +1,7 @@
 #ifndef SIMPLE_KVSTORE_HPP
 #define SIMPLE_KVSTORE_HPP
 
+#include <cstdint>
 #include <map>
 #include <mutex>
 #include <string>
@@ -19,12 +20,33 @@ class SimpleKvStore : public KvStore {
   bool Delete(const DeleteRequest* req, DeleteResponse* res) override;
   bool MultiGet(const MultiGetRequest* req, MultiGetResponse* res) override;
   bool MultiPut(const MultiPutRequest* req, MultiPutResponse*) override;
+  bool ScanRange(const ScanRangeRequest* req, ScanRangeResponse* res) override;
+  bool Cas(const CasRequest* req, CasResponse* res) override;
+  bool Incr(const IncrRequest* req, IncrResponse* res) override;
+  bool PutIfAbsent(const PutIfAbsentRequest* req,
+                   PutIfAbsentResponse* res) override;
+  bool DeleteByOwner(const DeleteByOwnerRequest* req,
+                     DeleteByOwnerResponse* res) override;
 
   std::vector<std::string> AllKeys() override;
 
  private:
-  // TODO (Part A, Step 1 and Step 2): Implement your internal key-value store
-  // here! You might need to add fields to synchronize access.
+  struct Entry {
+    std::string value;
+    // Expiry deadline in milliseconds since the epoch, or 0 for none.
+    uint64_t expires_at = 0;
+    // The user the entry belongs to, or empty for none.
+    std::string owner = {};
+  };
+
+  // Internal key-value store, protected by a single store-wide mutex. Expired
+  // entries are only dropped when they're next looked up.
+  std::map<std::string, Entry> store;
+  std::mutex mtx;
+
+  // Returns the live entry for `key`, erasing it first if it has expired.
+  // Assumes `mtx` is held.
+  Entry* find(const std::string& key, uint64_t now);
 };
 
 #endif /* end of include guard */
@@ -0,0 +1,285 @@
+#include "skiplist.hpp"
+
+#include <algorithm>
+#include <random>
+#include <thread>
+
+static std::atomic<uint64_t> next_list_id = 0;
+
+// Keeps the calling thread's operation announced in its slot for as long as
+// it's in scope.
+struct ConcurrentSkipList::OpGuard {
+  ConcurrentSkipList& list;
+  Slot& slot;
+  explicit OpGuard(ConcurrentSkipList& list) : list(list), slot(list.slot()) {
+    list.enter(this->slot);
+  }
+  ~OpGuard() {
+    list.exit(this->slot);
+  }
+};
+
+// A thread's slots in every list it has used; when the thread exits, they're
+// released for other threads to adopt.
+struct ConcurrentSkipList::ThreadSlots {
+  std::vector<std::pair<uint64_t, std::shared_ptr<Slot>>> slots;
+  ~ThreadSlots() {
+    for (auto&& [id, slot] : this->slots) {
+      slot->in_use.store(false, std::memory_order_release);
+    }
+  }
+};
+
+ConcurrentSkipList::ConcurrentSkipList() : id(next_list_id++) {
+  this->head = new Node("", MAX_LEVEL - 1);
+  this->tail = new Node("", MAX_LEVEL - 1);
+  this->tail->is_tail = true;
+  for (auto&& next : this->head->next) next.store(this->tail);
+}
+
+ConcurrentSkipList::~ConcurrentSkipList() {
+  Node* node = this->head;
+  while (node) {
+    Node* next = node->is_tail ? nullptr : node->next[0].load();
+    delete node;
+    node = next;
+  }
+  // Threads that used the list may outlive it, and their slots with them
+  std::lock_guard lock(this->slots_mtx);
+  for (auto&& slot : this->slots) {
+    for (auto&& [retired, epoch] : slot->retired) delete retired;
+    slot->retired.clear();
+    slot->list_gone.store(true, std::memory_order_release);
+  }
+}
+
+int ConcurrentSkipList::find(const std::string& key, Node** preds,
+                             Node** succs) {
+  int found = -1;
+  Node* pred = this->head;
+  for (int level = MAX_LEVEL - 1; level >= 0; level--) {
+    Node* curr = pred->next[level].load(std::memory_order_acquire);
+    while (curr->before(key)) {
+      pred = curr;
+      curr = pred->next[level].load(std::memory_order_acquire);
+    }
+    if (found == -1 && !curr->is_tail && curr->key == key) found = level;
+    preds[level] = pred;
+    succs[level] = curr;
+  }
+  return found;
+}
+
+bool ConcurrentSkipList::insert(const std::string& key) {
+  OpGuard guard(*this);
+  int top_level = random_level();
+  Node* preds[MAX_LEVEL];
+  Node* succs[MAX_LEVEL];
+  while (true) {
+    int found = this->find(key, preds, succs);
+    if (found != -1) {
+      Node* node = succs[found];
+      if (!node->marked.load()) {
+        // Present, or about to be: wait until a concurrent insert of the same
+        // key has linked it
+        while (!node->fully_linked.load()) std::this_thread::yield();
+        return false;
+      }
+      // Being removed; try again once it's unlinked
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Lock the predecessors bottom-up (i.e. in descending key order), and
+    // check that each still links to its successor and that neither is being
+    // removed; otherwise, start over
+    std::unique_lock<std::mutex> locks[MAX_LEVEL];
+    bool valid = true;
+    Node* prev = nullptr;
+    for (int level = 0; valid && level <= top_level; level++) {
+      Node* pred = preds[level];
+      Node* succ = succs[level];
+      if (pred != prev) {
+        locks[level] = std::unique_lock(pred->mtx);
+        prev = pred;
+      }
+      valid = !pred->marked.load() && !succ->marked.load() &&
+              pred->next[level].load() == succ;
+    }
+    if (!valid) continue;
+
+    Node* node = new Node(key, top_level);
+    for (int level = 0; level <= top_level; level++) {
+      node->next[level].store(succs[level], std::memory_order_relaxed);
+    }
+    for (int level = 0; level <= top_level; level++) {
+      preds[level]->next[level].store(node, std::memory_order_release);
+    }
+    node->fully_linked.store(true, std::memory_order_release);
+    this->n_keys.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+}
+
+bool ConcurrentSkipList::remove(const std::string& key) {
+  OpGuard guard(*this);
+  Node* victim = nullptr;
+  std::unique_lock<std::mutex> victim_lock;
+  Node* preds[MAX_LEVEL];
+  Node* succs[MAX_LEVEL];
+  while (true) {
+    int found = this->find(key, preds, succs);
+    if (!victim) {
+      // Only a node that's fully linked (and found at its top level) can be
+      // removed; one that isn't is still being inserted
+      if (found == -1) return false;
+      Node* node = succs[found];
+      if (!node->fully_linked.load() || node->top_level != found ||
+          node->marked.load()) {
+        return false;
+      }
+      victim_lock = std::unique_lock(node->mtx);
+      if (node->marked.load()) return false;
+      node->marked.store(true);
+      victim = node;
+    }
+
+    std::unique_lock<std::mutex> locks[MAX_LEVEL];
+    bool valid = true;
+    Node* prev = nullptr;
+    for (int level = 0; valid && level <= victim->top_level; level++) {
+      Node* pred = preds[level];
+      if (pred != prev) {
+        locks[level] = std::unique_lock(pred->mtx);
+        prev = pred;
+      }
+      valid = !pred->marked.load() && pred->next[level].load() == victim;
+    }
+    if (!valid) continue;
+
+    for (int level = victim->top_level; level >= 0; level--) {
+      preds[level]->next[level].store(victim->next[level].load(),
+                                      std::memory_order_release);
+    }
+    this->n_keys.fetch_sub(1, std::memory_order_relaxed);
+    victim_lock.unlock();
+    this->retire(guard.slot, victim);
+    return true;
+  }
+}
+
+bool ConcurrentSkipList::contains(const std::string& key) {
+  OpGuard guard(*this);
+  Node* preds[MAX_LEVEL];
+  Node* succs[MAX_LEVEL];
+  int found = this->find(key, preds, succs);
+  return found != -1 && succs[found]->fully_linked.load() &&
+         !succs[found]->marked.load();
+}
+
+std::vector<std::string> ConcurrentSkipList::scan(const std::string& start,
+                                                  const std::string& end,
+                                                  size_t limit) {
+  OpGuard guard(*this);
+  Node* pred = this->head;
+  for (int level = MAX_LEVEL - 1; level >= 0; level--) {
+    Node* curr = pred->next[level].load(std::memory_order_acquire);
+    while (curr->before(start)) {
+      pred = curr;
+      curr = pred->next[level].load(std::memory_order_acquire);
+    }
+  }
+
+  // Walk the bottom level. A node unlinked under us still points forward
+  // into the list, so the walk stays in order.
+  std::vector<std::string> keys;
+  Node* curr = pred->next[0].load(std::memory_order_acquire);
+  while (!curr->is_tail && (end.empty() || curr->key < end) &&
+         (limit == 0 || keys.size() < limit)) {
+    if (curr->fully_linked.load() && !curr->marked.load()) {
+      keys.push_back(curr->key);
+    }
+    curr = curr->next[0].load(std::memory_order_acquire);
+  }
+  return keys;
+}
+
+int ConcurrentSkipList::random_level() {
+  // Each level is half as likely as the one below it
+  thread_local std::mt19937_64 gen(std::random_device{}());
+  return __builtin_ctzll(gen() | (1ull << (MAX_LEVEL - 1)));
+}
+
+ConcurrentSkipList::Slot& ConcurrentSkipList::slot() {
+  thread_local ThreadSlots mine;
+  for (auto&& [id, slot] : mine.slots) {
+    if (id == this->id) return *slot;
+  }
+
+  // First use of this list by this thread: forget the slots of lists that
+  // are gone, and adopt a slot whose thread exited, if there is one
+  std::erase_if(mine.slots, [](auto&& entry) {
+    return entry.second->list_gone.load(std::memory_order_acquire);
+  });
+  std::shared_ptr<Slot> slot;
+  {
+    std::lock_guard lock(this->slots_mtx);
+    for (auto&& free_slot : this->slots) {
+      bool in_use = false;
+      if (free_slot->in_use.compare_exchange_strong(
+              in_use, true, std::memory_order_acquire)) {
+        slot = free_slot;
+        break;
+      }
+    }
+    if (!slot) {
+      slot = std::make_shared<Slot>();
+      this->slots.push_back(slot);
+    }
+  }
+  mine.slots.emplace_back(this->id, slot);
+  return *slot;
+}
+
+void ConcurrentSkipList::enter(Slot& slot) {
+  uint64_t epoch = this->epoch.load(std::memory_order_relaxed);
+  slot.state.store((epoch << 1) | 1, std::memory_order_relaxed);
+  // The announcement must be visible to try_advance before this operation
+  // reads any links
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+void ConcurrentSkipList::exit(Slot& slot) {
+  slot.state.store(0, std::memory_order_release);
+}
+
+void ConcurrentSkipList::retire(Slot& slot, Node* node) {
+  // The node is already unlinked, so only operations that started by now
+  // (in this epoch or an earlier one) can be looking at it
+  slot.retired.emplace_back(node, this->epoch.load(std::memory_order_seq_cst));
+  if (slot.retired.size() % RECLAIM_BATCH != 0) return;
+
+  this->try_advance();
+  uint64_t epoch = this->epoch.load(std::memory_order_acquire);
+  // Nodes are retired in epoch order
+  auto reclaimable = std::find_if(
+      slot.retired.begin(), slot.retired.end(),
+      [&](auto&& retired) { return retired.second + 2 > epoch; });
+  for (auto it = slot.retired.begin(); it != reclaimable; it++) {
+    delete it->first;
+  }
+  slot.retired.erase(slot.retired.begin(), reclaimable);
+}
+
+void ConcurrentSkipList::try_advance() {
+  uint64_t epoch = this->epoch.load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  {
+    std::lock_guard lock(this->slots_mtx);
+    for (auto&& slot : this->slots) {
+      uint64_t state = slot->state.load(std::memory_order_acquire);
+      if ((state & 1) && (state >> 1) != epoch) return;
+    }
+  }
+  this->epoch.compare_exchange_strong(epoch, epoch + 1);
+}
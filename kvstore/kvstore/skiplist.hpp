@@ -0,0 +1,127 @@
+#ifndef SKIPLIST_HPP
+#define SKIPLIST_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A concurrent ordered set of strings: a "lazy" skip list (Herlihy, Lev,
+ * Luchangco and Shavit).
+ *
+ * Lookups and scans take no locks. Inserts and removes lock only the nodes
+ * whose links they change, after finding them optimistically and checking
+ * that nothing changed in between (retrying if it did). A removed node is
+ * first marked, which logically deletes it, and then unlinked.
+ *
+ * Readers may still be traversing a node after it's unlinked, so unlinked
+ * nodes are freed by epoch-based reclamation (Fraser): each operation
+ * announces the global epoch it started in, in a slot of its own thread's,
+ * and a node unlinked in epoch e is freed once the epoch reaches e + 2, by
+ * which time every operation that could have seen it has finished. The epoch
+ * advances only when every operation in progress has announced the current
+ * one, which the thread that unlinks nodes checks every RECLAIM_BATCH nodes;
+ * so nodes are reclaimed steadily under load, and starting or finishing an
+ * operation writes only to the thread's own slot.
+ */
+class ConcurrentSkipList {
+ public:
+  ConcurrentSkipList();
+  ~ConcurrentSkipList();
+
+  // Returns false if `key` was already present.
+  bool insert(const std::string& key);
+  // Returns false if `key` wasn't present.
+  bool remove(const std::string& key);
+  bool contains(const std::string& key);
+
+  // Returns up to `limit` keys (0 for no limit) with start <= key < end in
+  // ascending order; an empty `end` means no upper bound. Keys inserted or
+  // removed during the scan may or may not be included.
+  std::vector<std::string> scan(const std::string& start,
+                                const std::string& end, size_t limit = 0);
+
+  size_t size() const {
+    return this->n_keys.load(std::memory_order_relaxed);
+  }
+
+  ConcurrentSkipList(const ConcurrentSkipList&) = delete;
+  ConcurrentSkipList& operator=(const ConcurrentSkipList&) = delete;
+
+ private:
+  static constexpr int MAX_LEVEL = 24;
+
+  struct Node {
+    std::string key;
+    // Sentinels: the head precedes every key, the tail follows every key.
+    bool is_tail = false;
+    int top_level;
+    std::vector<std::atomic<Node*>> next;
+    std::mutex mtx;
+    // Set once the node is linked at every level, and once it's logically
+    // removed, respectively.
+    std::atomic<bool> fully_linked = false;
+    std::atomic<bool> marked = false;
+
+    Node(const std::string& key, int top_level)
+        : key(key), top_level(top_level), next(top_level + 1) {
+    }
+
+    // Whether this node orders before `k`.
+    bool before(const std::string& k) const {
+      return !this->is_tail && this->key < k;
+    }
+  };
+
+  Node* head;
+  Node* tail;
+  std::atomic<size_t> n_keys = 0;
+
+  static constexpr size_t RECLAIM_BATCH = 64;
+
+  // A thread's view of the list (see ThreadSlot): the epoch its operation in
+  // progress started in, and the nodes it unlinked, with the epochs they were
+  // unlinked in.
+  struct Slot {
+    // (epoch << 1) | 1 while an operation is in progress, 0 otherwise.
+    alignas(64) std::atomic<uint64_t> state = 0;
+    // Whether a live thread owns the slot; a slot whose thread exited is
+    // adopted by the next thread to use the list, along with its nodes.
+    std::atomic<bool> in_use = true;
+    // Set when the list is destroyed, so that threads drop the slot.
+    std::atomic<bool> list_gone = false;
+    std::vector<std::pair<Node*, uint64_t>> retired;
+  };
+  struct ThreadSlots;
+
+  // Distinguishes lists in each thread's slots, since a new list may reuse a
+  // destroyed one's address.
+  const uint64_t id;
+  std::atomic<uint64_t> epoch = 1;
+  std::mutex slots_mtx;
+  std::vector<std::shared_ptr<Slot>> slots;
+
+  // Fills in each level's last node before `key` and first node at or after
+  // it. Returns the highest level at which `key` was found, or -1.
+  int find(const std::string& key, Node** preds, Node** succs);
+
+  static int random_level();
+
+  // Brackets every operation (see OpGuard), so that retired nodes are freed
+  // only when no operation could still be looking at them.
+  struct OpGuard;
+  // The calling thread's slot, registering one on its first call.
+  Slot& slot();
+  void enter(Slot& slot);
+  void exit(Slot& slot);
+  void retire(Slot& slot, Node* node);
+  // Advances the epoch if every operation in progress started in the current
+  // one.
+  void try_advance();
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,213 @@
+#include "snapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+#include "common/color.hpp"
+#include "wal.hpp"
+
+static constexpr char MAGIC[8] = {'K', 'V', 'S', 'N', 'A', 'P', '0', '1'};
+// Version 2 added per-item expiry deadlines, and version 3 owners. Version 2
+// snapshots are still read, as items without owners.
+static constexpr uint32_t VERSION = 3;
+
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t n_buckets;
+  uint64_t n_items;
+  uint64_t wal_lsn;
+  uint64_t file_size;
+};
+
+// Buffer size at which flush_if_full writes to disk.
+static constexpr size_t FLUSH_THRESHOLD = 1 << 20;
+
+template <typename T>
+static void put(std::vector<char>& buf, T value) {
+  const char* bytes = reinterpret_cast<const char*>(&value);
+  buf.insert(buf.end(), bytes, bytes + sizeof(T));
+}
+
+SnapshotWriter::~SnapshotWriter() {
+  // If the snapshot wasn't committed, throw away the partial file
+  if (this->fd >= 0) {
+    ::close(this->fd);
+    unlink(this->tmp_path().c_str());
+  }
+}
+
+bool SnapshotWriter::open(uint32_t n_buckets) {
+  this->fd = ::open(this->tmp_path().c_str(), O_WRONLY | O_CREAT | O_TRUNC,
+                    0644);
+  if (this->fd < 0) {
+    perror_color(RED, "open");
+    return false;
+  }
+  this->n_buckets = n_buckets;
+
+  // Leave room for the header, which is filled in by commit()
+  this->buf.reserve(2 * FLUSH_THRESHOLD);
+  this->buf.resize(sizeof(SnapshotHeader));
+  return true;
+}
+
+void SnapshotWriter::begin_bucket(uint64_t lsn, uint64_t n_items) {
+  put(this->buf, lsn);
+  put(this->buf, n_items);
+  this->n_items += n_items;
+}
+
+void SnapshotWriter::add_item(const std::string& key, const std::string& value,
+                              uint64_t expires_at, const std::string& owner) {
+  put(this->buf, static_cast<uint32_t>(key.size()));
+  put(this->buf, static_cast<uint32_t>(value.size()));
+  put(this->buf, expires_at);
+  put(this->buf, static_cast<uint32_t>(owner.size()));
+  this->buf.insert(this->buf.end(), key.begin(), key.end());
+  this->buf.insert(this->buf.end(), value.begin(), value.end());
+  this->buf.insert(this->buf.end(), owner.begin(), owner.end());
+}
+
+bool SnapshotWriter::flush_if_full() {
+  return this->buf.size() < FLUSH_THRESHOLD || this->flush();
+}
+
+bool SnapshotWriter::commit(uint64_t wal_lsn) {
+  if (!this->flush()) return false;
+
+  SnapshotHeader header;
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.n_buckets = this->n_buckets;
+  header.n_items = this->n_items;
+  header.wal_lsn = wal_lsn;
+  header.file_size = this->file_size;
+  if (pwrite(this->fd, &header, sizeof(header), 0) != sizeof(header) ||
+      fsync(this->fd) < 0) {
+    perror_color(RED, "snapshot");
+    return false;
+  }
+  ::close(this->fd);
+  this->fd = -1;
+
+  if (rename(this->tmp_path().c_str(), this->path.c_str()) < 0) {
+    perror_color(RED, "rename");
+    return false;
+  }
+  return sync_dir(std::filesystem::path(this->path).parent_path());
+}
+
+std::string SnapshotWriter::tmp_path() const {
+  return this->path + ".tmp";
+}
+
+bool SnapshotWriter::flush() {
+  const char* data = this->buf.data();
+  size_t len = this->buf.size();
+  while (len > 0) {
+    ssize_t n = ::write(this->fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror_color(RED, "snapshot");
+      return false;
+    }
+    data += n;
+    len -= n;
+  }
+  this->file_size += this->buf.size();
+  this->buf.clear();
+  return true;
+}
+
+bool read_snapshot(
+    const std::string& path, uint32_t n_buckets, uint64_t& wal_lsn,
+    const std::function<void(size_t, uint64_t)>& on_bucket,
+    const std::function<void(size_t, std::string_view, std::string_view,
+                             uint64_t, std::string_view)>& on_item) {
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    perror_color(RED, "open");
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror_color(RED, "fstat");
+    ::close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+
+  SnapshotHeader header;
+  if (size < sizeof(header) ||
+      pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 ||
+      header.version < 2 || header.version > VERSION ||
+      header.file_size != size) {
+    cerr_color(RED, "Snapshot ", path, " is malformed");
+    ::close(fd);
+    return false;
+  }
+  if (header.n_buckets != n_buckets) {
+    cerr_color(RED, "Snapshot ", path, " has ", header.n_buckets,
+               " buckets, but the store has ", n_buckets);
+    ::close(fd);
+    return false;
+  }
+
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    perror_color(RED, "mmap");
+    return false;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const char* data = static_cast<const char*>(map);
+
+  // Bounds-checked cursor over the mapping
+  size_t pos = sizeof(header);
+  auto read = [&](void* out, size_t len) {
+    if (len > size - pos) return false;
+    memcpy(out, data + pos, len);
+    pos += len;
+    return true;
+  };
+
+  bool ok = true;
+  for (size_t b = 0; ok && b < n_buckets; b++) {
+    uint64_t lsn, n_items;
+    ok = read(&lsn, sizeof(lsn)) && read(&n_items, sizeof(n_items));
+    if (!ok) break;
+    on_bucket(b, lsn);
+
+    for (uint64_t i = 0; ok && i < n_items; i++) {
+      uint32_t key_len, value_len, owner_len = 0;
+      uint64_t expires_at;
+      ok = read(&key_len, sizeof(key_len)) &&
+           read(&value_len, sizeof(value_len)) &&
+           read(&expires_at, sizeof(expires_at)) &&
+           (header.version < 3 || read(&owner_len, sizeof(owner_len))) &&
+           uint64_t(key_len) + value_len + owner_len <= size - pos;
+      if (!ok) break;
+      on_item(b, std::string_view(data + pos, key_len),
+              std::string_view(data + pos + key_len, value_len), expires_at,
+              std::string_view(data + pos + key_len + value_len, owner_len));
+      pos += key_len + value_len + owner_len;
+    }
+  }
+  munmap(map, size);
+
+  if (!ok) {
+    cerr_color(RED, "Snapshot ", path, " is truncated");
+    return false;
+  }
+  wal_lsn = header.wal_lsn;
+  return true;
+}
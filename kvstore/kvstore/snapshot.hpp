@@ -0,0 +1,81 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * On-disk snapshot of a bucketed store.
+ *
+ * The file is laid out so that it can be mmap'd and parsed in a single
+ * sequential pass; all integers are in host byte order:
+ *
+ *    header:   [8-byte magic "KVSNAP01"][u32 version][u32 n_buckets]
+ *              [u64 n_items][u64 wal_lsn][u64 file_size]
+ *    buckets:  n_buckets times:
+ *                [u64 bucket LSN][u64 n_items]
+ *                n_items times:
+ *                  [u32 key length][u32 value length][u64 expires_at]
+ *                  [u32 owner length][key][value][owner]
+ *
+ * `wal_lsn` is the last write-ahead log record that's fully reflected in the
+ * snapshot, and each bucket's LSN is the last record applied to that bucket
+ * when it was copied. Since buckets are copied one at a time while writes
+ * continue, recovery replays a log record into a bucket only if its LSN is
+ * greater than the bucket's.
+ *
+ * Snapshots are written to a temporary file, fsync'd and then renamed over the
+ * previous snapshot, so a crash never leaves a partial snapshot behind.
+ */
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const std::string& path) : path(path) {
+  }
+  ~SnapshotWriter();
+
+  // Starts writing a snapshot with `n_buckets` buckets.
+  bool open(uint32_t n_buckets);
+
+  // Appends a bucket header or item to the in-memory buffer. These never do
+  // I/O, so they can be called while holding a bucket lock.
+  void begin_bucket(uint64_t lsn, uint64_t n_items);
+  void add_item(const std::string& key, const std::string& value,
+                uint64_t expires_at, const std::string& owner);
+
+  // Writes out the buffer if it has grown large; call after releasing locks.
+  bool flush_if_full();
+
+  // Finishes the snapshot and atomically replaces any previous one.
+  bool commit(uint64_t wal_lsn);
+
+  SnapshotWriter(const SnapshotWriter&) = delete;
+  SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+ private:
+  std::string path;
+  int fd = -1;
+  std::vector<char> buf;
+  uint32_t n_buckets = 0;
+  uint64_t n_items = 0;
+  uint64_t file_size = 0;
+
+  std::string tmp_path() const;
+  bool flush();
+};
+
+// Reads the snapshot at `path`, which must have `n_buckets` buckets. Calls
+// `on_bucket` with each bucket's index and LSN, then `on_item` with each of
+// the bucket's items, their expiry deadlines and their owners; the views are
+// only valid during the call. Sets
+// `wal_lsn` from the header. Returns false if the snapshot is unreadable or
+// malformed.
+bool read_snapshot(
+    const std::string& path, uint32_t n_buckets, uint64_t& wal_lsn,
+    const std::function<void(size_t, uint64_t)>& on_bucket,
+    const std::function<void(size_t, std::string_view, std::string_view,
+                             uint64_t, std::string_view)>& on_item);
+
+#endif /* end of include guard */
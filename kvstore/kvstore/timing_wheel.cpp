@@ -0,0 +1,70 @@
+#include "timing_wheel.hpp"
+
+#include <algorithm>
+
+TimingWheel::TimingWheel(milliseconds resolution, uint64_t now)
+    : resolution(std::max<uint64_t>(resolution.count(), 1)),
+      current(now / this->resolution) {
+}
+
+uint64_t TimingWheel::tick_of(uint64_t deadline) const {
+  return (deadline + this->resolution - 1) / this->resolution;
+}
+
+void TimingWheel::schedule(Timer timer) {
+  // The current tick's slot has already fired
+  uint64_t tick = std::max(this->tick_of(timer.deadline), this->current + 1);
+  this->place(std::move(timer), tick);
+  this->n_timers++;
+}
+
+void TimingWheel::place(Timer&& timer, uint64_t tick) {
+  // Deadlines past the wheel's range park in the top level, and are placed
+  // again (closer to their deadline) each time they cascade
+  uint64_t delta = tick - this->current;
+  uint64_t max_delta = (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1;
+  if (delta > max_delta) {
+    tick = this->current + max_delta;
+    delta = max_delta;
+  }
+
+  size_t level = 0;
+  while (delta >> (SLOT_BITS * (level + 1))) level++;
+  size_t slot = (tick >> (SLOT_BITS * level)) & (SLOTS - 1);
+  this->slots[level][slot].push_back(std::move(timer));
+}
+
+void TimingWheel::advance(uint64_t now, std::deque<Timer>& due) {
+  uint64_t target = now / this->resolution;
+  while (this->current < target) {
+    this->current++;
+
+    // When a level wraps around, move the next slot of the level above down.
+    // Timers cascaded into the current tick's level-0 slot fire below.
+    for (size_t level = 1; level < LEVELS; level++) {
+      uint64_t mask = (uint64_t{1} << (SLOT_BITS * level)) - 1;
+      if (this->current & mask) break;
+
+      size_t slot = (this->current >> (SLOT_BITS * level)) & (SLOTS - 1);
+      std::vector<Timer> timers;
+      timers.swap(this->slots[level][slot]);
+      for (auto& timer : timers) {
+        uint64_t tick = std::max(this->tick_of(timer.deadline), this->current);
+        this->place(std::move(timer), tick);
+      }
+    }
+
+    auto& slot = this->slots[0][this->current & (SLOTS - 1)];
+    std::vector<Timer> timers;
+    timers.swap(slot);
+    for (auto& timer : timers) {
+      if (this->tick_of(timer.deadline) <= this->current) {
+        due.push_back(std::move(timer));
+        this->n_timers--;
+      } else {
+        // Only timers parked beyond the wheel's range get here
+        this->place(std::move(timer), this->tick_of(timer.deadline));
+      }
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+/**
+ * Hierarchical timing wheel for key expiry.
+ *
+ * Time is divided into ticks of `resolution`. Level 0 has one slot per tick
+ * for the next SLOTS ticks; each higher level has slots SLOTS times as wide,
+ * so LEVELS levels cover SLOTS^LEVELS ticks (~46 hours at 10ms ticks). A
+ * timer is placed in the lowest level whose range covers its deadline, and is
+ * moved ("cascaded") one level down whenever the lower level wraps around.
+ * Scheduling is O(1), and advancing the wheel by one tick is O(1) plus the
+ * timers that fire or cascade, each of which cascades at most LEVELS - 1
+ * times.
+ *
+ * Timers are never cancelled: when a key is overwritten or deleted, its old
+ * timer still fires, and the caller checks whether the key really expired.
+ *
+ * Not thread-safe; callers synchronize access.
+ */
+class TimingWheel {
+ public:
+  struct Timer {
+    std::string key;
+    // Milliseconds since the epoch (see now_ms()).
+    uint64_t deadline;
+  };
+
+  TimingWheel(milliseconds resolution, uint64_t now);
+
+  void schedule(Timer timer);
+
+  // Advances the wheel to `now`, moving every timer whose deadline has passed
+  // to the end of `due`.
+  void advance(uint64_t now, std::deque<Timer>& due);
+
+  size_t size() const {
+    return this->n_timers;
+  }
+
+ private:
+  static constexpr size_t SLOT_BITS = 6;
+  static constexpr size_t SLOTS = 1 << SLOT_BITS;
+  static constexpr size_t LEVELS = 4;
+
+  uint64_t resolution;
+  // The last tick that has been processed.
+  uint64_t current;
+  size_t n_timers = 0;
+  std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> slots;
+
+  // First tick at or after `deadline`, so a timer never fires early.
+  uint64_t tick_of(uint64_t deadline) const;
+  // Places `timer` so that it's processed at tick `tick` (>= current).
+  void place(Timer&& timer, uint64_t tick);
+};
+
+#endif /* end of include guard */
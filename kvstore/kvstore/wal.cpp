@@ -0,0 +1,343 @@
+#include "wal.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+
+#include "common/color.hpp"
+#include "common/utils.hpp"
+#include "common/zpp_bits.hpp"
+
+// Size of the [length][crc] header in front of every record.
+static constexpr size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// Writes all `len` bytes at `buf` to `fd`, retrying on partial writes.
+static bool write_all(int fd, const std::byte* buf, size_t len) {
+  while (len > 0) {
+    ssize_t n = ::write(fd, buf, len);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
+
+// Replays the intact frames of the segment open at `fd`, numbering them from
+// `next_lsn` + 1 and advancing `next_lsn`. Sets `valid_end` to the offset just
+// past the last intact frame, and `size` to the size of the file.
+static bool replay_segment(
+    int fd, const std::function<void(uint64_t, const WalRecord&)>& apply,
+    uint64_t& next_lsn, size_t& valid_end, size_t& size) {
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    perror_color(RED, "fstat");
+    return false;
+  }
+
+  // The segment is mapped so that replay is a single sequential pass without
+  // copying the file into memory first.
+  size = st.st_size;
+  valid_end = 0;
+  if (size == 0) return true;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    perror_color(RED, "mmap");
+    return false;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const auto* data = static_cast<const std::byte*>(map);
+
+  while (valid_end + FRAME_HEADER_SIZE <= size) {
+    uint32_t len, crc;
+    memcpy(&len, data + valid_end, sizeof(len));
+    memcpy(&crc, data + valid_end + sizeof(len), sizeof(crc));
+    const std::byte* payload = data + valid_end + FRAME_HEADER_SIZE;
+    if (len > size - valid_end - FRAME_HEADER_SIZE ||
+        crc32(payload, len) != crc) {
+      break;
+    }
+
+    // Fields were added to the end of WalRecord over time, and a record
+    // logged before a field existed simply ends before it
+    WalRecord record{};
+    auto in = zpp::bits::in(std::span<const std::byte>(payload, len));
+    bool ok = success(
+        in(record.op, record.keys, record.values, record.expires_at));
+    if (ok && in.position() < len) {
+      ok = success(in(record.txn_id, record.participants));
+    }
+    if (ok && in.position() < len) ok = success(in(record.owners));
+    if (!ok) break;
+    apply(++next_lsn, record);
+    valid_end += FRAME_HEADER_SIZE + len;
+  }
+  munmap(map, size);
+  return true;
+}
+
+bool sync_dir(const std::string& dir) {
+  int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (dir_fd < 0) {
+    perror_color(RED, "open");
+    return false;
+  }
+  bool ok = fsync(dir_fd) == 0;
+  if (!ok) perror_color(RED, "fsync");
+  ::close(dir_fd);
+  return ok;
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  this->close();
+}
+
+bool WriteAheadLog::open(
+    const std::function<void(uint64_t, const WalRecord&)>& apply,
+    uint64_t min_lsn) {
+  std::error_code ec;
+  std::filesystem::create_directories(this->options.dir, ec);
+  if (ec) {
+    cerr_color(RED, "Failed to create ", this->options.dir, ": ", ec.message());
+    return false;
+  }
+
+  // Find the existing segments, ordered by their first LSN. Other files that
+  // merely look like segments (e.g. "wal-backup.log") are ignored.
+  for (auto&& entry : std::filesystem::directory_iterator(this->options.dir)) {
+    std::string name = entry.path().filename();
+    if (!name.starts_with("wal-") || !name.ends_with(".log")) continue;
+    const char* first = name.data() + 4;
+    const char* last = name.data() + name.size() - 4;
+    uint64_t first_lsn;
+    auto [ptr, err] = std::from_chars(first, last, first_lsn);
+    if (err != std::errc{} || ptr != last ||
+        std::filesystem::path(this->segment_path(first_lsn)).filename() !=
+            name) {
+      continue;
+    }
+    this->segments.push_back(first_lsn);
+  }
+  std::sort(this->segments.begin(), this->segments.end());
+
+  if (this->segments.empty()) {
+    this->next_lsn = min_lsn;
+  } else if (this->segments.front() > min_lsn + 1) {
+    cerr_color(RED, "Write-ahead log in ", this->options.dir,
+               " is missing records ", min_lsn + 1, " to ",
+               this->segments.front() - 1);
+    return false;
+  } else {
+    this->next_lsn = this->segments.front() - 1;
+  }
+
+  for (size_t i = 0; i < this->segments.size(); i++) {
+    bool last = i + 1 == this->segments.size();
+    std::string path = this->segment_path(this->segments[i]);
+    if (this->segments[i] != this->next_lsn + 1) {
+      cerr_color(RED, "Write-ahead log segment ", path, " is out of sequence");
+      return false;
+    }
+
+    int seg_fd = ::open(path.c_str(), O_RDWR | O_APPEND);
+    if (seg_fd < 0) {
+      perror_color(RED, "open");
+      return false;
+    }
+    size_t valid_end, size;
+    if (!replay_segment(seg_fd, apply, this->next_lsn, valid_end, size)) {
+      ::close(seg_fd);
+      return false;
+    }
+
+    if (valid_end < size) {
+      if (!last) {
+        cerr_color(RED, "Corrupt record in the middle of the write-ahead log ",
+                   path);
+        ::close(seg_fd);
+        return false;
+      }
+      cerr_color(YELLOW, "Discarding ", size - valid_end,
+                 " bytes of torn or corrupt records at the end of ", path);
+      if (ftruncate(seg_fd, valid_end) < 0) {
+        perror_color(RED, "ftruncate");
+        ::close(seg_fd);
+        return false;
+      }
+    }
+
+    if (last) {
+      this->fd = seg_fd;
+    } else {
+      ::close(seg_fd);
+    }
+  }
+  if (this->segments.empty() && !this->open_segment(min_lsn + 1)) {
+    return false;
+  }
+  this->durable_lsn = this->next_lsn;
+
+  if (this->options.sync != SyncPolicy::PER_OP) {
+    this->flusher = std::thread(&WriteAheadLog::flush_loop, this);
+  }
+  return true;
+}
+
+void WriteAheadLog::close() {
+  if (this->fd < 0) return;
+
+  this->is_stopped = true;
+  if (this->flusher.joinable()) this->flusher.join();
+
+  std::unique_lock lock(this->mtx);
+  this->cv.wait(lock, [this] { return !this->flushing; });
+  if (!this->pending.empty()) this->flush(lock);
+  ::close(this->fd);
+  this->fd = -1;
+}
+
+uint64_t WriteAheadLog::append(const WalRecord& record) {
+  // Serialize outside of the lock, leaving room for the frame header.
+  std::vector<std::byte> frame;
+  auto out = zpp::bits::out(frame);
+  if (!success(out(uint32_t{0}, uint32_t{0}, record))) {
+    return 0;
+  }
+  uint32_t len = frame.size() - FRAME_HEADER_SIZE;
+  uint32_t crc = crc32(frame.data() + FRAME_HEADER_SIZE, len);
+  memcpy(frame.data(), &len, sizeof(len));
+  memcpy(frame.data() + sizeof(len), &crc, sizeof(crc));
+
+  std::unique_lock lock(this->mtx);
+  this->pending.insert(this->pending.end(), frame.begin(), frame.end());
+  return ++this->next_lsn;
+}
+
+bool WriteAheadLog::wait_durable(uint64_t lsn) {
+  if (lsn == 0) return false;
+
+  std::unique_lock lock(this->mtx);
+  if (this->options.sync != SyncPolicy::PER_OP) {
+    return !this->io_error;
+  }
+
+  // Group commit: whichever waiter finds no flush in progress becomes the
+  // leader and writes out everything buffered so far (including records from
+  // other waiters); everyone else waits for a flush that covers their LSN.
+  while (this->durable_lsn < lsn && !this->io_error) {
+    if (this->flushing) {
+      this->cv.wait(lock);
+    } else {
+      this->flush(lock);
+    }
+  }
+  return this->durable_lsn >= lsn;
+}
+
+bool WriteAheadLog::flush(std::unique_lock<std::mutex>& lock) {
+  this->flushing = true;
+  std::vector<std::byte> batch;
+  batch.swap(this->pending);
+  uint64_t batch_lsn = this->next_lsn;
+  int fd = this->fd;
+  lock.unlock();
+
+  bool ok = write_all(fd, batch.data(), batch.size());
+  if (ok && this->options.sync != SyncPolicy::NONE) {
+    ok = fdatasync(fd) == 0;
+  }
+  if (!ok) perror_color(RED, "write-ahead log");
+
+  lock.lock();
+  this->flushing = false;
+  if (ok) {
+    this->durable_lsn = batch_lsn;
+  } else {
+    this->io_error = true;
+  }
+  this->cv.notify_all();
+  return ok;
+}
+
+void WriteAheadLog::flush_loop() {
+  while (!this->is_stopped) {
+    std::this_thread::sleep_for(this->options.sync_interval);
+
+    std::unique_lock lock(this->mtx);
+    if (!this->flushing && !this->pending.empty()) this->flush(lock);
+  }
+}
+
+uint64_t WriteAheadLog::rotate() {
+  std::unique_lock lock(this->mtx);
+
+  // Write out everything buffered so far. Holding `mtx` once the loop exits
+  // keeps new records out until the new segment is in place.
+  while (this->flushing || !this->pending.empty()) {
+    if (this->flushing) {
+      this->cv.wait(lock);
+    } else {
+      this->flush(lock);
+    }
+  }
+  // Records in the old segment must be durable before anything (e.g. a
+  // snapshot) relies on them, even under SyncPolicy::NONE.
+  if (fdatasync(this->fd) < 0) perror_color(RED, "fdatasync");
+
+  // No need for a new segment if the current one is still empty
+  uint64_t boundary = this->next_lsn;
+  if (this->segments.back() != boundary + 1) {
+    int old_fd = this->fd;
+    if (this->open_segment(boundary + 1)) ::close(old_fd);
+  }
+  return boundary;
+}
+
+void WriteAheadLog::truncate(uint64_t lsn) {
+  std::vector<uint64_t> to_delete;
+  {
+    std::unique_lock lock(this->mtx);
+    // Segment i holds LSNs [segments[i], segments[i + 1]), so it can go once
+    // the next segment starts at or before lsn + 1. The last segment is
+    // always kept.
+    while (this->segments.size() > 1 && this->segments[1] <= lsn + 1) {
+      to_delete.push_back(this->segments.front());
+      this->segments.erase(this->segments.begin());
+    }
+  }
+
+  for (uint64_t first_lsn : to_delete) {
+    std::error_code ec;
+    std::filesystem::remove(this->segment_path(first_lsn), ec);
+  }
+  if (!to_delete.empty()) sync_dir(this->options.dir);
+}
+
+std::string WriteAheadLog::segment_path(uint64_t first_lsn) const {
+  // Zero-pad so that segments sort by name as well as by LSN
+  char name[32];
+  snprintf(name, sizeof(name), "wal-%020lu.log", first_lsn);
+  return (std::filesystem::path(this->options.dir) / name).string();
+}
+
+bool WriteAheadLog::open_segment(uint64_t first_lsn) {
+  std::string path = this->segment_path(first_lsn);
+  int seg_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+  if (seg_fd < 0) {
+    perror_color(RED, "open");
+    return false;
+  }
+  sync_dir(this->options.dir);
+  this->fd = seg_fd;
+  this->segments.push_back(first_lsn);
+  return true;
+}
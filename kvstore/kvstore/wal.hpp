@@ -0,0 +1,160 @@
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+// How aggressively the write-ahead log forces records to stable storage.
+enum class SyncPolicy {
+  // Every mutating request waits until its record has been fsync'd. Concurrent
+  // writers share fsyncs (group commit), so the cost is amortized under load.
+  PER_OP,
+  // A background thread fsyncs the log every `sync_interval`; requests return
+  // as soon as their record is buffered. A crash loses at most one interval.
+  INTERVAL,
+  // Records are handed to the OS every `sync_interval` but never fsync'd.
+  NONE
+};
+
+struct WalOptions {
+  // Directory holding the log segments; created if it doesn't exist.
+  std::string dir;
+  SyncPolicy sync = SyncPolicy::INTERVAL;
+  milliseconds sync_interval = 10ms;
+};
+
+enum class WalOp : uint8_t {
+  PUT,
+  APPEND,
+  DELETE,
+  MULTI_PUT,
+  // Two-phase commit (see ConcurrentKvStore::PrepareTxn): a transaction's
+  // staged writes, and its outcome. A TXN_COMMIT carries the writes it
+  // applies, or none if it only records the outcome.
+  TXN_PREPARE,
+  TXN_COMMIT,
+  TXN_ABORT,
+};
+
+// A single logged mutation. Single-key operations use keys[0] (and values[0]);
+// MULTI_PUT logs the whole batch as one record so it is replayed atomically,
+// and so does a DELETE of several keys (see DeleteByOwner).
+struct WalRecord {
+  WalOp op;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  // Expiry deadline (ms since the epoch) of the keys set by a PUT or
+  // MULTI_PUT, or 0 for none. Expiry itself isn't logged: it's a function of
+  // the deadline, so replay reproduces it.
+  uint64_t expires_at = 0;
+  // For the TXN_* ops, the transaction, and (for TXN_PREPARE) every server
+  // taking part in it. Records logged before these were added end before
+  // them (see replay_segment).
+  uint64_t txn_id = 0;
+  std::vector<std::string> participants = {};
+  // For a PUT or MULTI_PUT, either empty or each key's owner (see
+  // DeleteByOwnerRequest). Records logged before it was added end before it.
+  std::vector<std::string> owners = {};
+};
+
+/**
+ * Append-only, checksummed log of store mutations.
+ *
+ * Every record gets a log sequence number (LSN); LSNs are consecutive, starting
+ * at 1. The log is split into segment files named after the LSN of their first
+ * record (wal-<first LSN>.log), so that a prefix of the log can be dropped by
+ * deleting whole segments once a snapshot covers it. Within a segment, the log
+ * is a sequence of frames:
+ *
+ *    [u32 payload length][u32 crc32 of payload][payload]
+ *
+ * where the payload is a zpp_bits-serialized WalRecord. A torn or corrupt
+ * frame at the tail of the last segment (e.g. from a crash mid-write) ends
+ * replay, and the segment is truncated back to the last intact frame.
+ *
+ * Writers call append() while holding whatever lock orders their mutation
+ * (for ConcurrentKvStore, the bucket lock), which makes the log order agree
+ * with the order in which mutations were applied. They then drop the lock and
+ * call wait_durable(), so fsyncs never happen under a bucket lock.
+ */
+class WriteAheadLog {
+ public:
+  explicit WriteAheadLog(const WalOptions& options) : options(options) {
+  }
+  ~WriteAheadLog();
+
+  // Opens (or creates) the log, calling `apply` on every intact record in LSN
+  // order. `min_lsn` is the highest LSN known to be covered elsewhere (i.e. by
+  // a snapshot); numbering continues after it if no segments remain. Returns
+  // false if the log couldn't be opened.
+  bool open(const std::function<void(uint64_t, const WalRecord&)>& apply,
+            uint64_t min_lsn = 0);
+
+  // Flushes any buffered records and closes the log.
+  void close();
+
+  // Buffers a record, returning its LSN, or 0 if the record couldn't be
+  // serialized.
+  uint64_t append(const WalRecord& record);
+
+  // Blocks until the record with the given LSN is as durable as the sync
+  // policy promises. Returns false on I/O error.
+  bool wait_durable(uint64_t lsn);
+
+  // Makes everything appended so far durable and starts a new segment.
+  // Returns the LSN of the last record in the old segments.
+  uint64_t rotate();
+
+  // Deletes the segments whose records all have LSNs <= `lsn`.
+  void truncate(uint64_t lsn);
+
+  WriteAheadLog(const WriteAheadLog&) = delete;
+  WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+ private:
+  WalOptions options;
+  // Current (last) segment, and the first LSNs of all live segments, in order.
+  int fd = -1;
+  std::vector<uint64_t> segments;
+
+  // Serialized frames that haven't been written to the file yet, and the LSN
+  // of the last record appended to them.
+  std::vector<std::byte> pending;
+  uint64_t next_lsn = 0;
+  // Highest LSN that has reached the file (and been fsync'd, unless NONE).
+  uint64_t durable_lsn = 0;
+  // Whether a thread is currently writing out a batch.
+  bool flushing = false;
+  bool io_error = false;
+
+  std::mutex mtx;
+  std::condition_variable cv;
+
+  // Background flusher, used by the INTERVAL and NONE policies.
+  std::thread flusher;
+  std::atomic<bool> is_stopped = false;
+
+  std::string segment_path(uint64_t first_lsn) const;
+  // Creates a new segment starting at `first_lsn` and makes it current.
+  bool open_segment(uint64_t first_lsn);
+
+  // Writes (and maybe fsyncs) everything buffered so far; `lock` must hold
+  // `mtx`, and is released while doing I/O.
+  bool flush(std::unique_lock<std::mutex>& lock);
+  void flush_loop();
+};
+
+// fsyncs a directory, making file creations, renames and deletions in it
+// durable.
+bool sync_dir(const std::string& dir);
+
+#endif /* end of include guard */
@@ -1,13 +1,75 @@
 #include "net/network_conn.hpp"
 
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 
 #include <mutex>
 
+// Connection receive buffers larger than this are freed after use, so that an
+// occasional huge message doesn't pin its memory for the connection's lifetime
+static constexpr size_t MAX_RETAINED_BUF = 1 << 20;
+
+static void trim(Message* msg) {
+  if (msg->buf.capacity() > MAX_RETAINED_BUF) msg->buf = {};
+}
+
+// The first byte a client sends on a Unix domain socket, saying which
+// transport the rest of its messages use. A shared memory channel's memfd
+// comes along with it.
+static constexpr char SOCKET_TRANSPORT = 's';
+static constexpr char SHM_TRANSPORT = 'm';
+
+// Sends `byte` over a Unix domain socket, along with `fd_to_send` unless it's
+// -1.
+static bool send_byte_with_fd(int sock, char byte, int fd_to_send) {
+  struct iovec iov = {&byte, 1};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+  if (fd_to_send >= 0) {
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd_to_send, sizeof(int));
+  }
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) != 1) {
+    perror_color(RED, "sendmsg");
+    return false;
+  }
+  return true;
+}
+
+// Receives a byte sent by send_byte_with_fd, and the file descriptor that came
+// with it (or -1).
+static bool recv_byte_with_fd(int sock, char* byte, int* received_fd) {
+  struct iovec iov = {byte, 1};
+  struct msghdr msg = {};
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+  *received_fd = -1;
+  if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) != 1) return false;
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+      cmsg->cmsg_type == SCM_RIGHTS &&
+      cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+    memcpy(received_fd, CMSG_DATA(cmsg), sizeof(int));
+  }
+  return true;
+}
+
 bool ClientConn::close() {
   if (this->is_connected) {
     this->is_connected = false;
+    if (this->shm) this->shm->close();
     ::close(this->fd);
   }
   return true;
@@ -16,81 +78,170 @@ bool ClientConn::close() {
 bool ClientConn::shutdown() {
   if (this->is_connected) {
     this->is_connected = false;
+    if (this->shm) this->shm->close();
     ::shutdown(this->fd, SHUT_RDWR);
   }
   return true;
 }
 
+bool ClientConn::accept_transport() {
+  this->transport_chosen = true;
+  char transport;
+  int memfd;
+  if (!recv_byte_with_fd(this->fd, &transport, &memfd)) return false;
+  if (transport == SHM_TRANSPORT && memfd >= 0) {
+    this->shm = ShmChannel::attach(memfd, this->fd);
+    return this->shm != nullptr;
+  }
+  if (memfd >= 0) ::close(memfd);
+  return transport == SOCKET_TRANSPORT;
+}
+
+bool ClientConn::transport_send(const Message& msg) {
+  bool sent = this->shm ? this->shm->send_message(msg)
+                        : send_message(fd, &msg);
+  if (sent) this->bytes_sent += MESSAGE_HEADER_SIZE + msg.sz;
+  return sent;
+}
+
+bool ClientConn::transport_recv() {
+  if (this->local && !this->transport_chosen && !this->accept_transport()) {
+    return false;
+  }
+  bool received = this->shm ? this->shm->recv_message(&this->recv_buf, 400ms,
+                                                      this->max_message_size)
+                            : recv_message(fd, &this->recv_buf, 400ms,
+                                           this->max_message_size);
+  if (received) this->bytes_received += MESSAGE_HEADER_SIZE + this->recv_buf.sz;
+  return received;
+}
+
 std::optional<Request> ClientConn::recv_request() {
-  Message msg{};
+  std::unique_lock lock(this->recv_mtx);
+  if (!this->transport_recv()) {
+    return std::nullopt;
+  }
+  return this->decode_request();
+}
+
+std::optional<RequestOrView> ClientConn::recv_request_or_view() {
+  std::unique_lock lock(this->recv_mtx);
+  if (!this->transport_recv()) {
+    return std::nullopt;
+  }
 
-  {
-    std::unique_lock lock(this->recv_mtx);
-    if (!recv_message(fd, &msg)) {
-      return std::nullopt;
+  // A buffer that trim would free can't be viewed after this returns
+  if (this->recv_buf.buf.capacity() <= MAX_RETAINED_BUF) {
+    WireFormat format;
+    if (auto view = deserialize_read_request(this->recv_buf, &format)) {
+      this->wire_format = format;
+      return std::move(*view);
     }
   }
+  return this->decode_request();
+}
 
-  auto req = deserialize_request(msg);
+std::optional<Request> ClientConn::decode_request() {
+  WireFormat format;
+  auto req = deserialize_request(this->recv_buf, &format);
+  trim(&this->recv_buf);
   if (!req) {
     perror_color(RED, "Error deserializing request.");
+    return std::nullopt;
   }
+  this->wire_format = format;
   return req;
 }
 
-bool ClientConn::send_response(Response response) {
-  std::optional<Message> msg = serialize_response(response);
+bool ClientConn::send_response(const Response& response) {
+  std::optional<Message> msg =
+      serialize_response(response, this->wire_format);
   if (!msg) {
     perror_color(RED, "Error serializing response.");
     return false;
   }
 
   std::unique_lock lock(this->send_mtx);
-  return send_message(fd, &*msg);
+  return this->transport_send(*msg);
+}
+
+bool ClientConn::reject(const Response& response, milliseconds linger) {
+  bool sent = this->send_response(response);
+  if (sent && this->is_connected) {
+    ::shutdown(this->fd, SHUT_WR);
+    auto deadline = steady_clock::now() + linger;
+    char discard[4096];
+    while (true) {
+      auto left = ceil<milliseconds>(deadline - steady_clock::now());
+      struct pollfd pfd = {this->fd, POLLIN, 0};
+      if (left <= 0ms || poll(&pfd, 1, int(left.count())) <= 0) break;
+      // Stop once the client closes its end too
+      if (recv(this->fd, discard, sizeof(discard), MSG_DONTWAIT) <= 0) break;
+    }
+  }
+  this->close();
+  return sent;
+}
+
+bool ClientConn::send_serialized(const Message& msg) {
+  std::unique_lock lock(this->send_mtx);
+  return this->transport_send(msg);
 }
 
 bool ServerConn::close() {
+  if (this->shm) this->shm->close();
   ::close(this->fd);
   return true;
 }
 
 bool ServerConn::shutdown() {
+  if (this->shm) this->shm->close();
   ::shutdown(this->fd, SHUT_RDWR);
   return true;
 }
 
-bool ServerConn::send_request(Request req) {
-  std::optional<Message> msg = serialize_request(req);
+bool ServerConn::send_request(const Request& req) {
+  std::optional<Message> msg = serialize_request(req, this->wire_format);
   if (!msg) {
     perror_color(RED, "Error serializing request.");
     return false;
   }
 
   std::unique_lock lock(this->send_mtx);
+  if (this->shm) return this->shm->send_message(*msg);
   return send_message(fd, &*msg);
 }
 
 std::optional<Response> ServerConn::recv_response() {
-  Message msg{};
-
-  {
-    std::unique_lock lock(this->recv_mtx);
-    if (!recv_message(fd, &msg)) {
-      return std::nullopt;
-    }
+  std::unique_lock lock(this->recv_mtx);
+  bool received =
+      this->shm ? this->shm->recv_message(&this->recv_buf, 400ms,
+                                          this->max_message_size)
+                : recv_message(fd, &this->recv_buf, 400ms,
+                               this->max_message_size);
+  if (!received) {
+    return std::nullopt;
   }
 
-  auto res = deserialize_response(msg);
+  auto res = deserialize_response(this->recv_buf);
+  trim(&this->recv_buf);
   if (!res) {
     perror_color(RED, "Error deserializing response.");
   }
   return res;
 }
 
+bool ServerConn::choose_transport(bool use_shm) {
+  if (!use_shm) return send_byte_with_fd(this->fd, SOCKET_TRANSPORT, -1);
+  this->shm = ShmChannel::create(this->fd);
+  return this->shm &&
+         send_byte_with_fd(this->fd, SHM_TRANSPORT, this->shm->fd());
+}
+
 std::shared_ptr<ClientConn> accept_client(int listener_fd) {
-  // NOTE: ideally, we should use a sockaddr_storage and handle INET vs INET6,
-  // but since we're only supporting IPv4 here, this should be fine.
-  struct sockaddr_in client_addr;
+  // NOTE: ideally, we should handle INET vs INET6, but since we're only
+  // supporting IPv4 (and Unix domain sockets) here, this should be fine.
+  struct sockaddr_storage client_addr;
   socklen_t sin_size = sizeof(client_addr);
   int cfd = accept(listener_fd, (struct sockaddr*)&client_addr, &sin_size);
   if (cfd < 0) {
@@ -98,17 +249,31 @@ std::shared_ptr<ClientConn> accept_client(int listener_fd) {
     return nullptr;
   }
 
+  // Local clients are anonymous, so name them after the server's socket
+  if (client_addr.ss_family == AF_UNIX) {
+    struct sockaddr_un local_addr;
+    socklen_t local_size = sizeof(local_addr);
+    std::string path;
+    if (getsockname(cfd, (struct sockaddr*)&local_addr, &local_size) == 0) {
+      path = local_addr.sun_path;
+    }
+    return std::make_shared<ClientConn>(cfd, UNIX_SCHEME + path, true);
+  }
+
   // get hostname:port for presentability.
   char hostbuf[NI_MAXHOST], servbuf[NI_MAXSERV];
   if (getnameinfo((struct sockaddr*)&client_addr, sin_size, hostbuf,
                   sizeof(hostbuf), servbuf, sizeof(servbuf),
                   NI_NUMERICSERV) != 0) {
     perror_color(RED, "getnameinfo");
+    ::close(cfd);
     return nullptr;
   }
   char s[NI_MAXHOST + NI_MAXSERV] = {0};
   snprintf(s, sizeof(s), "%s:%s", hostbuf, servbuf);
 
+  set_nodelay(cfd);
+
   return std::make_shared<ClientConn>(cfd, std::string(s));
 }
 
@@ -118,5 +283,10 @@ std::shared_ptr<ServerConn> connect_to_server(const std::string& server_addr) {
     return nullptr;
   }
 
-  return std::make_shared<ServerConn>(sfd, server_addr);
+  auto conn = std::make_shared<ServerConn>(sfd, server_addr);
+  if (local_socket_path(server_addr) &&
+      !conn->choose_transport(server_addr.rfind(SHM_SCHEME, 0) == 0)) {
+    return nullptr;
+  }
+  return conn;
 }
@@ -6,6 +6,7 @@
 
 #include "net/network_messages.hpp"
 #include "net/server_commands.hpp"
+#include "net/shm_channel.hpp"
 #include "net/shardcontroller_commands.hpp"
 
 /*
@@ -14,8 +15,8 @@
  */
 struct ClientConn {
   // for make_shared to work
-  explicit ClientConn(int fd, std::string addr)
-      : fd(fd), address(addr), is_connected(true) {
+  explicit ClientConn(int fd, std::string addr, bool local = false)
+      : fd(fd), address(addr), is_connected(true), local(local) {
   }
   ~ClientConn() {
     // cerr_color(YELLOW, "in ClientConn destructor");  // in case if there's a
@@ -34,6 +35,18 @@ struct ClientConn {
   // Whether the client is still connected
   std::atomic<bool> is_connected = true;
 
+  // The wire format of the client's latest request, which responses are sent
+  // in.
+  std::atomic<WireFormat> wire_format = WIRE_FORMAT;
+
+  // The largest request body accepted; a client that sends a larger one is
+  // disconnected.
+  size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+
+  // Bytes of messages received and sent so far, including headers.
+  std::atomic<uint64_t> bytes_received = 0;
+  std::atomic<uint64_t> bytes_sent = 0;
+
   /*
    * Shuts down communication over the socket associated with the connection and
    * destroys it.
@@ -50,15 +63,53 @@ struct ClientConn {
    * std::optional returned contains no value.
    */
   std::optional<Request> recv_request();
+  /*
+   * Like recv_request, but returns read-path requests as views into the
+   * connection's receive buffer (see deserialize_read_request), which stay
+   * valid until the next request is received. Only for connections that a
+   * single thread receives on.
+   */
+  std::optional<RequestOrView> recv_request_or_view();
   /*
    * Sends a given response to the client, returning true on success.
    */
-  bool send_response(Response response);
+  bool send_response(const Response& response);
+  /*
+   * Sends `response` (e.g. an OVERLOADED error) without waiting for a request,
+   * then closes the connection. Anything the client sends in the meantime is
+   * read and discarded, for at most `linger`, so that the close doesn't reset
+   * the connection (and drop the response) over unread data.
+   */
+  bool reject(const Response& response, milliseconds linger = 10ms);
+  /*
+   * Sends a response that has already been serialized (e.g. a cached one) to
+   * the client, returning true on success.
+   */
+  bool send_serialized(const Message& msg);
 
  private:
   // Mutexes to prevent sending/receiving from multiple threads at once
   std::mutex send_mtx;
   std::mutex recv_mtx;
+  // Reused for every message received, so that its buffer is only allocated
+  // once per connection (guarded by recv_mtx)
+  Message recv_buf;
+
+  // Whether the client connected over a Unix domain socket, in which case the
+  // first thing it sends says which transport its messages use.
+  bool local;
+  bool transport_chosen = false;
+  // The channel messages go over instead of the socket, if the client chose
+  // shared memory.
+  std::unique_ptr<ShmChannel> shm;
+
+  // Reads which transport a local client chose, and sets it up.
+  bool accept_transport();
+  // Sends/receives a message over the connection's transport.
+  bool transport_send(const Message& msg);
+  bool transport_recv();
+  // Decodes the request in recv_buf.
+  std::optional<Request> decode_request();
 };
 
 /*
@@ -79,6 +130,12 @@ struct ServerConn {
   // The address (hostname:port) server-client communication occurs over
   std::string address;
 
+  // The wire format to send requests in.
+  WireFormat wire_format = WIRE_FORMAT;
+
+  // The largest response body accepted.
+  size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+
   /*
    * Shuts down communication over the socket associated with the connection and
    * destroys it.
@@ -92,7 +149,7 @@ struct ServerConn {
   /*
    * Sends a given request to the server, returning true on success.
    */
-  bool send_request(Request request);
+  bool send_request(const Request& request);
   /*
    * Receives a response from the server, if one has been sent. Otherwise, if
    * the server has disconnected, no request has been sent, or an error occurs,
@@ -100,10 +157,23 @@ struct ServerConn {
    */
   std::optional<Response> recv_response();
 
+  /*
+   * Tells a server listening on a Unix domain socket which transport this
+   * connection's messages use: the socket, or (if `use_shm`) a new shared
+   * memory channel. Must come before anything else on the connection.
+   */
+  bool choose_transport(bool use_shm);
+
  private:
   // Mutexes to prevent sending/receiving from multiple threads at once
   std::mutex send_mtx;
   std::mutex recv_mtx;
+  // Reused for every message received, so that its buffer is only allocated
+  // once per connection (guarded by recv_mtx)
+  Message recv_buf;
+
+  // The channel messages go over instead of the socket, if any.
+  std::unique_ptr<ShmChannel> shm;
 };
 
 /*
@@ -114,9 +184,10 @@ struct ServerConn {
 std::shared_ptr<ClientConn> accept_client(int listener_fd);
 
 /*
- * Establishes a connection to a server at the specified address.
- * On success, returns a shared pointer to a ServerConn wrapper of the server
- * connection, and a null pointer otherwise.
+ * Establishes a connection to a server at the specified address (hostname:port,
+ * or a local address; see local_socket_path). On success, returns a shared
+ * pointer to a ServerConn wrapper of the server connection, and a null pointer
+ * otherwise.
  */
 std::shared_ptr<ServerConn> connect_to_server(const std::string& server_addr);
 
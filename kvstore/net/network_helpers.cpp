@@ -1,56 +1,123 @@
 #include "net/network_helpers.hpp"
 
-int sendall(int fd, void* buf, size_t len, int flags, milliseconds timeout) {
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/un.h>
+
+#include <climits>
+
+// Waits until `fd` is ready for `events` (POLLIN/POLLOUT), or until `deadline`
+// passes. Returns 1 if it's ready (or has an error that the next send/recv will
+// report), 0 on timeout, and -1 on error.
+static int wait_until(int fd, short events,
+                      steady_clock::time_point deadline) {
+  while (true) {
+    auto left = ceil<milliseconds>(deadline - steady_clock::now());
+    if (left <= 0ms) return 0;
+    struct pollfd pfd = {fd, events, 0};
+    int ready = poll(&pfd, 1, int(std::min(left, INT_MAX * 1ms).count()));
+    if (ready < 0 && errno == EINTR) continue;
+    return ready;
+  }
+}
+
+ssize_t sendall(int fd, const void* buf, size_t len, int flags,
+                milliseconds timeout) {
   size_t n_sent = 0, n_to_send = len;
-  char* data = (char*)buf;
-  auto begin = system_clock::now();
+  const char* data = (const char*)buf;
+  // With a timeout, never block in send itself; wait for the socket to be
+  // writable instead, up to the deadline
+  if (timeout > 0ms) flags |= MSG_DONTWAIT;
+  auto deadline = steady_clock::now() + timeout;
   while (n_sent < n_to_send) {
-    // If desired, check if timed out
-    if (timeout > 0ms &&
-        duration_cast<milliseconds>(system_clock::now() - begin) > timeout) {
-      return ETIMEOUT;
+    ssize_t curr = send(fd, data + n_sent, n_to_send - n_sent, flags);
+    if (curr < 0 && timeout > 0ms &&
+        (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      int ready = wait_until(fd, POLLOUT, deadline);
+      if (ready <= 0) return ready == 0 ? ETIMEOUT : ready;
+      continue;
     }
-
-    int curr = send(fd, data + n_sent, n_to_send - n_sent, flags);
+    if (curr < 0 && errno == EINTR) continue;
     if (curr <= 0) {
       return curr;
     }
-
-    // update bytes sent; if not completed, network is likely saturated, so wait
     n_sent += curr;
-    if (n_sent < n_to_send) {
-      if (timeout > 0ms) std::this_thread::sleep_for(timeout / 10);
-    }
   }
   return n_sent;
 }
 
-int recvall(int fd, void* buf, size_t len, int flags, milliseconds timeout) {
+ssize_t recvall(int fd, void* buf, size_t len, int flags,
+                milliseconds timeout) {
   size_t n_recvd = 0, n_to_recv = len;
   char* data = (char*)buf;
-  auto begin = system_clock::now();
+  if (timeout > 0ms) flags |= MSG_DONTWAIT;
+  auto deadline = steady_clock::now() + timeout;
   while (n_recvd < n_to_recv) {
-    // Check if timed out
-    if (timeout > 0ms &&
-        duration_cast<milliseconds>(system_clock::now() - begin) > timeout) {
-      return ETIMEOUT;
+    ssize_t curr = recv(fd, data + n_recvd, n_to_recv - n_recvd, flags);
+    if (curr < 0 && timeout > 0ms &&
+        (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      int ready = wait_until(fd, POLLIN, deadline);
+      if (ready <= 0) return ready == 0 ? ETIMEOUT : ready;
+      continue;
     }
-
-    int curr = recv(fd, data + n_recvd, n_to_recv - n_recvd, flags);
+    if (curr < 0 && errno == EINTR) continue;
     if (curr <= 0) {
       return curr;
     }
-
-    // update bytes sent; if not completed, network is likely saturated, so wait
     n_recvd += curr;
-    if (n_recvd < n_to_recv) {
-      if (timeout > 0ms) std::this_thread::sleep_for(timeout / 10);
-    }
   }
   return n_recvd;
 }
 
-int open_listener_socket(const std::string& address) {
+std::optional<std::string> local_socket_path(const std::string& address) {
+  for (std::string scheme : {UNIX_SCHEME, SHM_SCHEME}) {
+    if (address.rfind(scheme, 0) == 0) return address.substr(scheme.size());
+  }
+  return std::nullopt;
+}
+
+// Fills in the address of the Unix domain socket at `path`, returning false if
+// the path is too long.
+static bool make_unix_address(const std::string& path,
+                              struct sockaddr_un* addr) {
+  memset(addr, 0, sizeof(*addr));
+  addr->sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr->sun_path)) {
+    cerr_color(RED, "Invalid socket path: ", path);
+    return false;
+  }
+  memcpy(addr->sun_path, path.data(), path.size());
+  return true;
+}
+
+static int open_local_listener_socket(const std::string& path,
+                                      const SocketOptions& options) {
+  struct sockaddr_un addr;
+  if (!make_unix_address(path, &addr)) return -1;
+  int listener_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listener_fd == -1) {
+    perror_color(RED, "socket");
+    return -1;
+  }
+
+  // Like SO_REUSEADDR for ports, take over the path from a previous server
+  // that didn't clean up after itself
+  unlink(path.c_str());
+  if (bind(listener_fd, (struct sockaddr*)&addr, sizeof(addr)) == -1 ||
+      listen(listener_fd, options.backlog) == -1) {
+    perror_color(RED, "bind/listen");
+    close(listener_fd);
+    return -1;
+  }
+  return listener_fd;
+}
+
+int open_listener_socket(const std::string& address,
+                         const SocketOptions& options) {
+  if (auto path = local_socket_path(address)) {
+    return open_local_listener_socket(*path, options);
+  }
+
   size_t splitIdx = address.find(':');
   if (splitIdx == std::string::npos) {
     cerr_color(RED, "Invalid address: ", address);
@@ -94,6 +161,27 @@ int open_listener_socket(const std::string& address) {
       perror_color(YELLOW, "setsockopt");
       continue;
     }
+    if (options.reuse_port &&
+        setsockopt(listener_fd, SOL_SOCKET, SO_REUSEPORT, &yes,
+                   sizeof(yes)) == -1) {
+      close(listener_fd);
+      perror_color(YELLOW, "setsockopt");
+      continue;
+    }
+    // Buffer sizes have to be set before listening to take full effect, since
+    // the TCP window scale is agreed on during the handshake
+    if ((options.send_buffer_size > 0 &&
+         setsockopt(listener_fd, SOL_SOCKET, SO_SNDBUF,
+                    &options.send_buffer_size,
+                    sizeof(options.send_buffer_size)) == -1) ||
+        (options.recv_buffer_size > 0 &&
+         setsockopt(listener_fd, SOL_SOCKET, SO_RCVBUF,
+                    &options.recv_buffer_size,
+                    sizeof(options.recv_buffer_size)) == -1)) {
+      close(listener_fd);
+      perror_color(YELLOW, "setsockopt");
+      continue;
+    }
 
     // assign name to the desired socket
     if ((ret = bind(listener_fd, cur->ai_addr, cur->ai_addrlen)) == -1) {
@@ -113,7 +201,7 @@ int open_listener_socket(const std::string& address) {
 
   freeaddrinfo(res);
   // configure listening backlog
-  if ((ret = listen(listener_fd, BACKLOG)) < 0) {
+  if ((ret = listen(listener_fd, options.backlog)) < 0) {
     close(listener_fd);
     perror_color(RED, "listen");
     return -1;
@@ -123,6 +211,22 @@ int open_listener_socket(const std::string& address) {
 };
 
 int connect_to_address(const std::string& address) {
+  if (auto path = local_socket_path(address)) {
+    struct sockaddr_un addr;
+    if (!make_unix_address(*path, &addr)) return -1;
+    int cfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (cfd == -1) {
+      perror_color(YELLOW, "socket");
+      return -1;
+    }
+    if (connect(cfd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+      close(cfd);
+      perror_color(YELLOW, "connect");
+      return -1;
+    }
+    return cfd;
+  }
+
   size_t splitIdx = address.find(':');
   if (splitIdx == std::string::npos) {
     cerr_color(RED, "Invalid address: ", address);
@@ -158,13 +262,24 @@ int connect_to_address(const std::string& address) {
     break;
   }
 
+  freeaddrinfo(res);
   if (!cur) {
     return -1;
   }
 
+  set_nodelay(cfd);
   return cfd;
 }
 
+bool set_nodelay(int fd) {
+  int yes = 1;
+  if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes)) == -1) {
+    perror_color(YELLOW, "setsockopt");
+    return false;
+  }
+  return true;
+}
+
 std::string get_host_address(const char* port) {
   // Get our hostname for readability
   char hostnamebuf[256] = {0};
@@ -19,29 +19,65 @@
 
 using namespace std::chrono;
 
-#define BACKLOG 100
+#define BACKLOG 1024
 
 #define ETIMEOUT -2
 
 /*
- * Sends/receives all of the bytes in buf, according to len. Times out after the
- * specified amount if timeout > 0 (in this case, returns ETIMEOUT. Otherwise,
- * returns the result of send/recv).
+ * Sends/receives all of the bytes in buf, according to len. If timeout > 0,
+ * waits (with poll) for the socket to be ready whenever it isn't, and gives up
+ * with ETIMEOUT once timeout has passed since the call. Otherwise, returns the
+ * number of bytes sent/received, or the result of a failed send/recv.
  */
-int sendall(int fd, void* buf, size_t len, int flags,
-            milliseconds timeout = 0ms);
-int recvall(int fd, void* buf, size_t len, int flags,
-            milliseconds timeout = 0ms);
+ssize_t sendall(int fd, const void* buf, size_t len, int flags,
+                milliseconds timeout = 0ms);
+ssize_t recvall(int fd, void* buf, size_t len, int flags,
+                milliseconds timeout = 0ms);
+
+// Settings for listener sockets, which the connections they accept inherit.
+struct SocketOptions {
+  // How many connections can wait to be accepted (capped by the kernel's
+  // net.core.somaxconn). Connections past that are dropped, and have to retry.
+  int backlog = BACKLOG;
+  // Kernel send/receive buffer sizes in bytes; 0 keeps the kernel's defaults.
+  int send_buffer_size = 0;
+  int recv_buffer_size = 0;
+  // Whether other sockets can listen on the same port (SO_REUSEPORT), with the
+  // kernel spreading incoming connections across them.
+  bool reuse_port = false;
+};
+
+// Addresses of the form unix:<path> are Unix domain sockets at that path, for
+// clients on the same host as their server. shm:<path> is the same socket, but
+// the client then sends its messages over shared memory (see ShmChannel).
+constexpr const char* UNIX_SCHEME = "unix:";
+constexpr const char* SHM_SCHEME = "shm:";
+
+/*
+ * Returns the socket path of a unix: or shm: address, or std::nullopt if it's a
+ * hostname:port address.
+ */
+std::optional<std::string> local_socket_path(const std::string& address);
 
 /*
- * Opens a listener socket on the specified address (hostname:port).
+ * Opens a listener socket on the specified address (hostname:port, or a local
+ * address).
  * On success, a file descriptor for the new socket is returned.  On error, -1
  * is returned.
  */
-int open_listener_socket(const std::string& address);
+int open_listener_socket(const std::string& address,
+                         const SocketOptions& options = {});
+
+/*
+ * Disables Nagle's algorithm on a connected socket, so that small messages are
+ * sent right away rather than held back until earlier ones are acknowledged.
+ * Returns false on error.
+ */
+bool set_nodelay(int fd);
 
 /*
- * Establishes a connection to the specified address.
+ * Establishes a connection to the specified address (hostname:port, or the
+ * socket of a local address).
  * On success, a file descriptor for the new socket is returned.  On error, -1
  * is returned.
  */
@@ -1,226 +1,454 @@
 #include "net/network_messages.hpp"
 
+#include <endian.h>
+
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 
+#include "common/lz4.hpp"
 #include "net/network_helpers.hpp"
 
-bool send_message(int fd, Message* msg, milliseconds timeout) {
+static_assert(size_t(MessageType::ERROR) < (1 << (64 - MESSAGE_SIZE_BITS)),
+              "message types must fit in the header's top byte");
+
+// Report a failed sendall/recvall on `fd`, unless it was the result of the
+// socket closing.
+static void report_send_error(int fd, ssize_t result) {
+  if (result == ETIMEOUT) {
+    cerr_color(RED, "Send on ", fd, " timed out.");
+  } else if (errno != EBADF && errno != EPIPE) {
+    perror_color(RED, "send");
+  }
+}
+
+static void report_recv_error(int fd, ssize_t result) {
+  if (result == ETIMEOUT) {
+    cerr_color(RED, "Recv on ", fd, " timed out.");
+  } else if (errno != EBADF) {
+    perror_color(RED, "recv");
+  }
+}
+
+uint64_t pack_header(const Message& msg) {
+  return htobe64(uint64_t(msg.type) << MESSAGE_SIZE_BITS | uint64_t(msg.sz));
+}
+
+void unpack_header(uint64_t header, Message* msg) {
+  header = be64toh(header);
+  msg->type = static_cast<MessageType>(header >> MESSAGE_SIZE_BITS);
+  msg->sz = header & ((uint64_t(1) << MESSAGE_SIZE_BITS) - 1);
+}
+
+bool send_message(int fd, const Message* msg, milliseconds timeout) {
   // must specify non-zero timeout
   assert(timeout > 0ms);
   assert(msg->sz == msg->buf.size());
-
-  // First, send message type
-  int curr = sendall(fd, &msg->type, sizeof(msg->type), MSG_NOSIGNAL);
-  if (curr < 0) {
-    if (curr == ETIMEOUT) {
-      // Print if timed out
-      cerr_color(RED, "Send on ", fd, " timed out.");
-    } else if (errno != EBADF && errno != EPIPE) {
-      // Only emit errors if it wasn't the result of the socket closing
-      perror_color(RED, "send");
-    }
+  if (msg->sz >> MESSAGE_SIZE_BITS) {
+    cerr_color(RED, "Message of ", msg->sz, " bytes is too large to send.");
     return false;
   }
-  assert(curr == sizeof(msg->type));
 
-  // Convert size to network order, then send
-  size_t size_nbo = htonl(msg->sz);
-  curr = sendall(fd, &size_nbo, sizeof(size_nbo), MSG_NOSIGNAL);
+  // First, send the header (type and size) in network order. Sockets don't
+  // wait to coalesce small writes (see set_nodelay), so if a body follows, ask
+  // for the header to go out in the same packet as it.
+  uint64_t header = pack_header(*msg);
+  ssize_t curr = sendall(fd, &header, sizeof(header),
+                         MSG_NOSIGNAL | (msg->sz > 0 ? MSG_MORE : 0));
   if (curr < 0) {
-    if (curr == ETIMEOUT) {
-      cerr_color(RED, "Send on ", fd, " timed out.");
-    } else if (errno != EBADF && errno != EPIPE) {
-      perror_color(RED, "send");
-    }
+    report_send_error(fd, curr);
     return false;
   }
-  assert(curr == sizeof(size_nbo));
+  assert(curr == sizeof(header));
 
-  if (msg->sz > 0) {
-    std::byte* data = &msg->buf[0];
-    curr = sendall(fd, data, msg->sz, 0, timeout);
+  // Then the body, straight from the message's buffer, a chunk at a time
+  for (size_t sent = 0; sent < msg->sz; sent += curr) {
+    size_t len = std::min(MESSAGE_CHUNK_SIZE, msg->sz - sent);
+    curr = sendall(fd, msg->buf.data() + sent, len, MSG_NOSIGNAL, timeout);
     if (curr < 0) {
-      if (curr == ETIMEOUT) {
-        cerr_color(RED, "Send on ", fd, " timed out.");
-      } else if (errno != EBADF && errno != EPIPE) {
-        perror_color(RED, "send");
-      }
+      report_send_error(fd, curr);
       return false;
     }
-    assert(size_t(curr) == msg->sz);
+    assert(size_t(curr) == len);
   }
 
   return true;
 }
 
-bool recv_message(int fd, Message* msg, milliseconds timeout) {
+bool recv_message(int fd, Message* msg, milliseconds timeout,
+                  size_t max_size) {
   // must specify non-zero timeout
   assert(timeout > 0ms);
 
-  // get message type
-  int curr = recvall(fd, &msg->type, sizeof(msg->type), 0);
+  // get the header; its size informs how much to read into the vector
+  uint64_t header;
+  ssize_t curr = recvall(fd, &header, sizeof(header), 0);
   if (curr == 0) {
     // In this case, recv got an EOF, so other end closed the connection.
     return false;
   } else if (curr < 0) {
-    if (curr == ETIMEOUT) {
-      // Print if timed out
-      cerr_color(RED, "Recv on ", fd, " timed out.");
-    } else if (errno != EBADF) {
-      // Only emit errors if it wasn't the result of the socket closing
-      perror_color(RED, "recv");
-    }
+    report_recv_error(fd, curr);
     return false;
   }
-  assert(curr == sizeof(msg->type));
-
-  // get size; need this to inform how much to read into the vector
-  curr = recvall(fd, &msg->sz, sizeof(msg->sz), 0);
-  if (curr == 0) {
-    return false;
-  } else if (curr < 0) {
-    if (curr == ETIMEOUT) {
-      cerr_color(RED, "Recv on ", fd, " timed out.");
-    } else if (errno != EBADF) {
-      perror_color(RED, "recv");
-    }
+  assert(curr == sizeof(header));
+  unpack_header(header, msg);
+  if (msg->sz > max_size) {
+    cerr_color(RED, "Message of ", msg->sz, " bytes on ", fd,
+               " is larger than the maximum of ", max_size, ".");
     return false;
   }
-  // Convert to host order
-  msg->sz = ntohl(msg->sz);
-  assert(curr == sizeof(msg->sz));
-
-  if (msg->sz > 0) {
-    msg->buf.resize(msg->sz);
-    std::byte* data = &msg->buf[0];
-    curr = recvall(fd, data, msg->sz, 0, timeout);
+
+  // Read the body a chunk at a time, growing the buffer (which may hold a
+  // previous message) only as the data arrives
+  for (size_t received = 0; received < msg->sz; received += curr) {
+    size_t len = std::min(MESSAGE_CHUNK_SIZE, msg->sz - received);
+    if (msg->buf.size() < received + len) {
+      if (msg->buf.capacity() < received + len) {
+        msg->buf.reserve(std::min(
+            msg->sz, std::max(received + len, 2 * msg->buf.capacity())));
+      }
+      msg->buf.resize(received + len);
+    }
+    curr = recvall(fd, msg->buf.data() + received, len, 0, timeout);
     if (curr == 0) {
       return false;
     } else if (curr < 0) {
-      if (curr == ETIMEOUT) {
-        cerr_color(RED, "Recv on ", fd, " timed out.");
-      } else if (errno != EBADF) {
-        perror_color(RED, "recv");
-      }
+      report_recv_error(fd, curr);
       return false;
     }
-    assert(size_t(curr) == msg->sz);
+    assert(size_t(curr) == len);
   }
+  msg->buf.resize(msg->sz);
 
   return true;
 }
 
-std::optional<Message> serialize_request(Request request) {
+// Layout of the byte at the start of every body: the version in the low bits,
+// then whether the sender accepts compression, and whether the rest of this
+// body is compressed.
+static constexpr uint8_t VERSION_MASK = 0x3f;
+static constexpr uint8_t ACCEPTS_COMPRESSION = 0x40;
+static constexpr uint8_t COMPRESSED = 0x80;
+
+// Appends `body` to `msg`, encoded in the given wire version.
+template <typename T>
+static bool encode(Message* msg, WireVersion version, const T& body) {
+  switch (version) {
+    case WireVersion::V1:
+      return success(zpp::bits::out(msg->buf, zpp::bits::append{})(body));
+    case WireVersion::V2:
+      return success(zpp::bits::out(msg->buf, zpp::bits::append{},
+                                    zpp::bits::size_varint{})(body));
+  }
+  return false;
+}
+
+// Reads `body` from `data`, encoded in the given wire version.
+template <typename T>
+static bool decode(std::span<const std::byte> data, WireVersion version,
+                   T* body) {
+  switch (version) {
+    case WireVersion::V1:
+      return success(zpp::bits::in(data)(*body));
+    case WireVersion::V2:
+      return success(zpp::bits::in(data, zpp::bits::size_varint{})(*body));
+  }
+  return false;
+}
+
+// Reads `body` from `data` like decode, but with the strings in it decoded as
+// views into `data`.
+template <typename T>
+static bool decode_view(std::span<const std::byte> data, WireVersion version,
+                        T* body) {
+  std::span<const char> chars{reinterpret_cast<const char*>(data.data()),
+                              data.size()};
+  switch (version) {
+    case WireVersion::V1:
+      return success(zpp::bits::in(chars)(*body));
+    case WireVersion::V2:
+      return success(zpp::bits::in(chars, zpp::bits::size_varint{})(*body));
+  }
+  return false;
+}
+
+// Fills in the format byte of an encoded message, compressing the rest of the
+// body if the format allows it and it's worth it.
+static void seal(Message* msg, WireFormat format) {
+  uint8_t header = uint8_t(format.version);
+  if (format.compression) {
+    header |= ACCEPTS_COMPRESSION;
+    size_t size = msg->buf.size() - 1;
+    if (size >= COMPRESSION_THRESHOLD && size <= LZ4_MAX_SIZE) {
+      std::string compressed = lz4_compress(std::string_view(
+          reinterpret_cast<const char*>(msg->buf.data() + 1), size));
+      if (compressed.size() < size) {
+        header |= COMPRESSED;
+        auto bytes = reinterpret_cast<const std::byte*>(compressed.data());
+        msg->buf.resize(1);
+        msg->buf.insert(msg->buf.end(), bytes, bytes + compressed.size());
+      }
+    }
+  }
+  msg->buf[0] = std::byte(header);
+  msg->sz = msg->buf.size();
+}
+
+// Parses the format byte at the start of `msg`'s body into `format`, and
+// returns the rest of the body, decompressed into `scratch` if need be.
+static std::optional<std::span<const std::byte>> open_body(
+    const Message& msg, WireFormat* format, std::string* scratch) {
+  if (msg.buf.empty()) return std::nullopt;
+  uint8_t header = uint8_t(msg.buf[0]);
+  format->version = static_cast<WireVersion>(header & VERSION_MASK);
+  format->compression = header & ACCEPTS_COMPRESSION;
+  if (format->version != WireVersion::V1 &&
+      format->version != WireVersion::V2) {
+    cerr_color(RED, "Unknown wire format version ", header & VERSION_MASK);
+    return std::nullopt;
+  }
+
+  auto body = std::span{msg.buf}.subspan(1);
+  if (!(header & COMPRESSED)) return body;
+  std::optional<std::string> decompressed = lz4_decompress(std::string_view(
+      reinterpret_cast<const char*>(body.data()), body.size()));
+  if (!decompressed) {
+    cerr_color(RED, "Malformed compressed message");
+    return std::nullopt;
+  }
+  *scratch = std::move(*decompressed);
+  return std::span{reinterpret_cast<const std::byte*>(scratch->data()),
+                   scratch->size()};
+}
+
+std::optional<Message> serialize_request(const Request& request,
+                                         WireFormat format) {
   Message msg{};
+  // Leave room for the format byte
+  msg.buf.push_back(std::byte(0));
 
   // Serialize into message, depending on type
-  auto out = zpp::bits::output(msg.buf);
   if (auto* req = std::get_if<JoinRequest>(&request)) {
     msg.type = MessageType::JOIN;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<LeaveRequest>(&request)) {
     msg.type = MessageType::LEAVE;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<MoveRequest>(&request)) {
     msg.type = MessageType::MOVE;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<QueryRequest>(&request)) {
     msg.type = MessageType::QUERY;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<GetRequest>(&request)) {
     msg.type = MessageType::GET;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<PutRequest>(&request)) {
     msg.type = MessageType::PUT;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<AppendRequest>(&request)) {
     msg.type = MessageType::APPEND;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<DeleteRequest>(&request)) {
     msg.type = MessageType::DELETE;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<MultiGetRequest>(&request)) {
     msg.type = MessageType::MULTI_GET;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else if (auto* req = std::get_if<MultiPutRequest>(&request)) {
     msg.type = MessageType::MULTI_PUT;
-    if (!success(out(*req))) return std::nullopt;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<ScanRangeRequest>(&request)) {
+    msg.type = MessageType::SCAN_RANGE;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<CasRequest>(&request)) {
+    msg.type = MessageType::CAS;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<IncrRequest>(&request)) {
+    msg.type = MessageType::INCR;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<PutIfAbsentRequest>(&request)) {
+    msg.type = MessageType::PUT_IF_ABSENT;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<PrepareRequest>(&request)) {
+    msg.type = MessageType::PREPARE;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<CommitRequest>(&request)) {
+    msg.type = MessageType::COMMIT;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<AbortRequest>(&request)) {
+    msg.type = MessageType::ABORT;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<DeleteByOwnerRequest>(&request)) {
+    msg.type = MessageType::DELETE_BY_OWNER;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<BatchRequest>(&request)) {
+    msg.type = MessageType::BATCH;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<StatsRequest>(&request)) {
+    msg.type = MessageType::STATS;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
+  } else if (auto* req = std::get_if<TxnStatusRequest>(&request)) {
+    msg.type = MessageType::TXN_STATUS;
+    if (!encode(&msg, format.version, *req)) return std::nullopt;
   } else {
     throw std::logic_error{
         "Invalid request variant! Please post privately on Edstem if this "
         "occurs."};
   }
 
-  // Set size, for easier network parsing
-  msg.sz = msg.buf.size();
+  // Set the format byte and size, for easier network parsing
+  seal(&msg, format);
 
   return msg;
 }
 
-std::optional<Request> deserialize_request(Message message) {
+std::optional<Request> deserialize_request(const Message& message,
+                                           WireFormat* format) {
+  WireFormat message_format;
+  std::string scratch;
+  auto body = open_body(message, &message_format, &scratch);
+  if (!body) return std::nullopt;
+  if (format) *format = message_format;
+
   Request request;
   // Deserialize from message, depending on type
-  auto in = zpp::bits::input(message.buf);
   switch (message.type) {
     case MessageType::JOIN: {
       JoinRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::LEAVE: {
       LeaveRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::MOVE: {
       MoveRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::QUERY: {
       QueryRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::GET: {
       GetRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::PUT: {
       PutRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::APPEND: {
       AppendRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::DELETE: {
       DeleteRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::MULTI_GET: {
       MultiGetRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     case MessageType::MULTI_PUT: {
       MultiPutRequest req{};
-      if (!success(in(req))) return std::nullopt;
-      request = req;
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::SCAN_RANGE: {
+      ScanRangeRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::CAS: {
+      CasRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::INCR: {
+      IncrRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::PUT_IF_ABSENT: {
+      PutIfAbsentRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::PREPARE: {
+      PrepareRequest req{};
+      if (!decode(*body, message_format.version, &req)) {
+        // From a coordinator that predates participant lists
+        struct OldPrepareRequest {
+          uint64_t txn_id;
+          std::vector<std::string> keys;
+          std::vector<std::string> values;
+          bool commit = false;
+        } old{};
+        if (!decode(*body, message_format.version, &old)) return std::nullopt;
+        req = {old.txn_id, std::move(old.keys), std::move(old.values),
+               old.commit, {}};
+      }
+      request = std::move(req);
+      break;
+    }
+    case MessageType::COMMIT: {
+      CommitRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::ABORT: {
+      AbortRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::DELETE_BY_OWNER: {
+      DeleteByOwnerRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::BATCH: {
+      BatchRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::STATS: {
+      StatsRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
+      break;
+    }
+    case MessageType::TXN_STATUS: {
+      TxnStatusRequest req{};
+      if (!decode(*body, message_format.version, &req)) return std::nullopt;
+      request = std::move(req);
       break;
     }
     default:
@@ -233,125 +461,283 @@ std::optional<Request> deserialize_request(Message message) {
   return request;
 }
 
-std::optional<Message> serialize_response(Response response) {
+std::optional<ReadRequestView> deserialize_read_request(
+    const Message& message, WireFormat* format) {
+  if (message.type != MessageType::GET &&
+      message.type != MessageType::DELETE &&
+      message.type != MessageType::MULTI_GET &&
+      message.type != MessageType::SCAN_RANGE) {
+    return std::nullopt;
+  }
+  if (message.buf.empty() || (uint8_t(message.buf[0]) & COMPRESSED)) {
+    return std::nullopt;
+  }
+  WireFormat message_format;
+  std::string scratch;
+  auto body = open_body(message, &message_format, &scratch);
+  if (!body) return std::nullopt;
+  if (format) *format = message_format;
+
+  switch (message.type) {
+    case MessageType::GET: {
+      GetRequestView req{};
+      if (!decode_view(*body, message_format.version, &req)) break;
+      return req;
+    }
+    case MessageType::DELETE: {
+      DeleteRequestView req{};
+      if (!decode_view(*body, message_format.version, &req)) break;
+      return req;
+    }
+    case MessageType::MULTI_GET: {
+      MultiGetRequestView req{};
+      if (!decode_view(*body, message_format.version, &req)) break;
+      return req;
+    }
+    case MessageType::SCAN_RANGE: {
+      ScanRangeRequestView req{};
+      if (!decode_view(*body, message_format.version, &req)) break;
+      return req;
+    }
+    default:
+      break;
+  }
+  return std::nullopt;
+}
+
+std::optional<Message> serialize_response(const Response& response,
+                                         WireFormat format) {
   Message msg{};
+  // Leave room for the format byte
+  msg.buf.push_back(std::byte(0));
 
   // Serialize into message, depending on type
-  auto out = zpp::bits::output(msg.buf);
   if (auto* res = std::get_if<JoinResponse>(&response)) {
     msg.type = MessageType::JOIN;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<LeaveResponse>(&response)) {
     msg.type = MessageType::LEAVE;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<MoveResponse>(&response)) {
     msg.type = MessageType::MOVE;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<QueryResponse>(&response)) {
     msg.type = MessageType::QUERY;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<GetResponse>(&response)) {
     msg.type = MessageType::GET;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<PutResponse>(&response)) {
     msg.type = MessageType::PUT;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<AppendResponse>(&response)) {
     msg.type = MessageType::APPEND;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<DeleteResponse>(&response)) {
     msg.type = MessageType::DELETE;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<MultiGetResponse>(&response)) {
     msg.type = MessageType::MULTI_GET;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<MultiPutResponse>(&response)) {
     msg.type = MessageType::MULTI_PUT;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<ScanRangeResponse>(&response)) {
+    msg.type = MessageType::SCAN_RANGE;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<CasResponse>(&response)) {
+    msg.type = MessageType::CAS;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<IncrResponse>(&response)) {
+    msg.type = MessageType::INCR;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<PutIfAbsentResponse>(&response)) {
+    msg.type = MessageType::PUT_IF_ABSENT;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<PrepareResponse>(&response)) {
+    msg.type = MessageType::PREPARE;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<CommitResponse>(&response)) {
+    msg.type = MessageType::COMMIT;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<AbortResponse>(&response)) {
+    msg.type = MessageType::ABORT;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<DeleteByOwnerResponse>(&response)) {
+    msg.type = MessageType::DELETE_BY_OWNER;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<BatchResponse>(&response)) {
+    msg.type = MessageType::BATCH;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<StatsResponse>(&response)) {
+    msg.type = MessageType::STATS;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
+  } else if (auto* res = std::get_if<TxnStatusResponse>(&response)) {
+    msg.type = MessageType::TXN_STATUS;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else if (auto* res = std::get_if<ErrorResponse>(&response)) {
     msg.type = MessageType::ERROR;
-    if (!success(out(*res))) return std::nullopt;
+    if (!encode(&msg, format.version, *res)) return std::nullopt;
   } else {
     throw std::logic_error{
         "Invalid response variant! Please post privately on Edstem if this "
         "occurs."};
   }
 
-  // Set size, for easier network parsing
-  msg.sz = msg.buf.size();
+  // Set the format byte and size, for easier network parsing
+  seal(&msg, format);
 
   return msg;
 }
 
-std::optional<Response> deserialize_response(Message message) {
+std::optional<Response> deserialize_response(const Message& message,
+                                           WireFormat* format) {
+  WireFormat message_format;
+  std::string scratch;
+  auto body = open_body(message, &message_format, &scratch);
+  if (!body) return std::nullopt;
+  if (format) *format = message_format;
+
   Response response;
   // Deserialize from message, depending on type
-  auto in = zpp::bits::input(message.buf);
   switch (message.type) {
     case MessageType::JOIN: {
       JoinResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::LEAVE: {
       LeaveResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::MOVE: {
       MoveResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::QUERY: {
       QueryResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::GET: {
       GetResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::PUT: {
       PutResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::APPEND: {
       AppendResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::DELETE: {
       DeleteResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::MULTI_GET: {
       MultiGetResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::MULTI_PUT: {
       MultiPutResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::SCAN_RANGE: {
+      ScanRangeResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::CAS: {
+      CasResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::INCR: {
+      IncrResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::PUT_IF_ABSENT: {
+      PutIfAbsentResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::PREPARE: {
+      PrepareResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::COMMIT: {
+      CommitResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::ABORT: {
+      AbortResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::DELETE_BY_OWNER: {
+      DeleteByOwnerResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::BATCH: {
+      BatchResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::STATS: {
+      StatsResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
+      break;
+    }
+    case MessageType::TXN_STATUS: {
+      TxnStatusResponse res{};
+      if (!decode(*body, message_format.version, &res)) return std::nullopt;
+      response = std::move(res);
       break;
     }
     case MessageType::ERROR: {
       ErrorResponse res{};
-      if (!success(in(res))) return std::nullopt;
-      response = res;
+      if (!decode(*body, message_format.version, &res)) {
+        // From a peer that predates error codes
+        struct OldErrorResponse {
+          std::string msg;
+        } old{};
+        if (!decode(*body, message_format.version, &old)) return std::nullopt;
+        res.msg = std::move(old.msg);
+      }
+      response = std::move(res);
       break;
     }
     default:
@@ -3,6 +3,7 @@
 
 #include <cassert>
 #include <chrono>
+#include <string_view>
 #include <thread>
 #include <variant>
 #include <vector>
@@ -30,9 +31,59 @@ enum class MessageType {
   MOVE,
   QUERY,
   // Error
-  ERROR
+  ERROR,
+  // Types added since, at the end so that the ones above keep their numbers
+  SCAN_RANGE,
+  CAS,
+  INCR,
+  PUT_IF_ABSENT,
+  PREPARE,
+  COMMIT,
+  ABORT,
+  DELETE_BY_OWNER,
+  BATCH,
+  STATS,
+  TXN_STATUS,
 };
 
+// How message bodies are encoded. Every body starts with a byte holding its
+// format, and a server answers each request in the format it was sent in, so
+// clients and servers can be upgraded independently.
+//  - V1: zpp::bits' defaults, with a 4-byte length before every string and
+//    vector.
+//  - V2: the same, but with varint lengths (one byte for anything under 128).
+enum class WireVersion : uint8_t {
+  V1 = 1,
+  V2 = 2,
+};
+
+struct WireFormat {
+  WireVersion version = WireVersion::V2;
+  // Whether the sender compresses bodies of at least COMPRESSION_THRESHOLD
+  // bytes (see lz4.hpp), and so can read compressed ones. Each body is only
+  // sent compressed if that makes it smaller.
+  bool compression = true;
+
+  bool operator==(const WireFormat&) const = default;
+};
+// The format clients send requests in.
+constexpr WireFormat WIRE_FORMAT{};
+constexpr size_t COMPRESSION_THRESHOLD = 1024;
+
+// On the wire, every message starts with a fixed 64-bit header in network byte
+// order: the message type in the top byte, and the size of the body in the
+// other 56 bits.
+constexpr size_t MESSAGE_HEADER_SIZE = sizeof(uint64_t);
+constexpr size_t MESSAGE_SIZE_BITS = 56;
+// The largest body recv_message accepts unless told otherwise. Peers that
+// announce larger ones are disconnected before anything is allocated.
+constexpr size_t DEFAULT_MAX_MESSAGE_SIZE = size_t(1) << 30;
+// Bodies are sent and received in chunks of this many bytes, each with its own
+// timeout, so a large body only has to keep making progress rather than arrive
+// within one timeout. Receive buffers grow as data actually arrives, rather
+// than to whatever size the header claims.
+constexpr size_t MESSAGE_CHUNK_SIZE = size_t(1) << 20;
+
 struct Message {
   MessageType type;
   size_t sz = 0;
@@ -41,17 +92,52 @@ struct Message {
   std::vector<std::byte> buf;
 
   size_t size() {
-    return sizeof(type) + sizeof(sz) + buf.size();
+    return MESSAGE_HEADER_SIZE + buf.size();
   }
 };
 
-// Generic send/receive message helper functions.
-bool send_message(int fd, Message* msg, milliseconds timeout = 400ms);
-bool recv_message(int fd, Message* msg, milliseconds timeout = 400ms);
+// Packs a message's type and size into its header (in network byte order), and
+// unpacks them again.
+uint64_t pack_header(const Message& msg);
+void unpack_header(uint64_t header, Message* msg);
+
+// Generic send/receive message helper functions. recv_message fails (without
+// reading the body) if the body is larger than `max_size`.
+bool send_message(int fd, const Message* msg, milliseconds timeout = 400ms);
+bool recv_message(int fd, Message* msg, milliseconds timeout = 400ms,
+                  size_t max_size = DEFAULT_MAX_MESSAGE_SIZE);
+
+// What kind of error an ErrorResponse reports, for clients that handle some
+// differently.
+enum class ErrorCode : uint8_t {
+  GENERIC = 0,
+  // The server shed the request under load, without processing it (see
+  // CoDel). Retrying after a backoff, or on another server, may succeed.
+  OVERLOADED = 1,
+};
 
 // define a generic Error response message.
 struct ErrorResponse {
   std::string msg;
+  // Sent after `msg`, so peers that predate it still read the message.
+  ErrorCode code = ErrorCode::GENERIC;
+};
+
+// A batch of single-key operations, sent in one message. The server runs them
+// in order, each as if it were sent on its own (so the batch isn't atomic, and
+// one failing doesn't stop the rest), and sends back one result per op.
+using BatchOp = std::variant<GetRequest, PutRequest, AppendRequest,
+                             DeleteRequest, CasRequest, IncrRequest,
+                             PutIfAbsentRequest>;
+using BatchResult =
+    std::variant<GetResponse, PutResponse, AppendResponse, DeleteResponse,
+                 CasResponse, IncrResponse, PutIfAbsentResponse, ErrorResponse>;
+
+struct BatchRequest {
+  std::vector<BatchOp> ops;
+};
+struct BatchResponse {
+  std::vector<BatchResult> results;
 };
 
 using Request = std::variant<
@@ -59,20 +145,59 @@ using Request = std::variant<
     JoinRequest, LeaveRequest, MoveRequest, QueryRequest,
     // KvServer requests
     GetRequest, PutRequest, AppendRequest, DeleteRequest, MultiGetRequest,
-    MultiPutRequest>;
+    MultiPutRequest, ScanRangeRequest, CasRequest, IncrRequest,
+    PutIfAbsentRequest, PrepareRequest, CommitRequest, AbortRequest,
+    DeleteByOwnerRequest, BatchRequest, StatsRequest, TxnStatusRequest>;
 using Response = std::variant<
     // Shardcontroller responses
     JoinResponse, LeaveResponse, MoveResponse, QueryResponse,
     // KvServer responses
     GetResponse, PutResponse, AppendResponse, DeleteResponse, MultiGetResponse,
-    MultiPutResponse,
+    MultiPutResponse, ScanRangeResponse, CasResponse, IncrResponse,
+    PutIfAbsentResponse, PrepareResponse, CommitResponse, AbortResponse,
+    DeleteByOwnerResponse, BatchResponse, StatsResponse, TxnStatusResponse,
     // Error response
     ErrorResponse>;
 
-std::optional<Message> serialize_request(Request request);
-std::optional<Request> deserialize_request(Message message);
+// Deserialization also reports the message's wire `format`, if asked, and
+// fails on versions it doesn't know.
+std::optional<Message> serialize_request(const Request& request,
+                                         WireFormat format = WIRE_FORMAT);
+std::optional<Request> deserialize_request(const Message& message,
+                                           WireFormat* format = nullptr);
+
+std::optional<Message> serialize_response(const Response& response,
+                                          WireFormat format = WIRE_FORMAT);
+std::optional<Response> deserialize_response(const Message& message,
+                                             WireFormat* format = nullptr);
+
+// Read-path requests whose keys are views into the body of the message they
+// were decoded from, so that decoding them doesn't allocate (beyond
+// MultiGetRequestView's vector). They're only valid as long as that message's
+// buffer is, and isn't modified.
+struct GetRequestView {
+  std::string_view key;
+};
+struct DeleteRequestView {
+  std::string_view key;
+};
+struct MultiGetRequestView {
+  std::vector<std::string_view> keys;
+};
+struct ScanRangeRequestView {
+  std::string_view start;
+  std::string_view end;
+  uint64_t limit = 0;
+};
+
+using ReadRequestView = std::variant<GetRequestView, DeleteRequestView,
+                                     MultiGetRequestView, ScanRangeRequestView>;
+using RequestOrView = std::variant<Request, ReadRequestView>;
 
-std::optional<Message> serialize_response(Response response);
-std::optional<Response> deserialize_response(Message message);
+// Decodes a Get, Delete, MultiGet or ScanRange without copying its keys. Fails
+// for every other request, and for compressed bodies (whose keys would point
+// into a scratch buffer), which deserialize_request handles instead.
+std::optional<ReadRequestView> deserialize_read_request(
+    const Message& message, WireFormat* format = nullptr);
 
 #endif /* end of include guard */
@@ -1,6 +1,7 @@
 #ifndef NET_SERVER_COMMANDS_HPP
 #define NET_SERVER_COMMANDS_HPP
 
+#include <cstdint>
 #include <string>
 #include <variant>
 #include <vector>
@@ -13,6 +14,10 @@ struct GetRequest {
 struct PutRequest {
   std::string key;
   std::string value;
+  // If non-zero, the key expires this many milliseconds after the Put.
+  uint64_t ttl_ms = 0;
+  // If non-empty, the user the key belongs to (see DeleteByOwnerRequest).
+  std::string owner = {};
 };
 
 struct AppendRequest {
@@ -31,8 +36,84 @@ struct MultiGetRequest {
 struct MultiPutRequest {
   std::vector<std::string> keys;
   std::vector<std::string> values;
+  // If non-zero, every key in the request expires this many milliseconds
+  // after the MultiPut.
+  uint64_t ttl_ms = 0;
+  // Either empty, or the user each key belongs to ("" for none).
+  std::vector<std::string> owners = {};
 };
 
+// Asks for the key-value pairs with start <= key < end, in key order. An empty
+// `end` means no upper bound, and a `limit` of 0 means no limit.
+struct ScanRangeRequest {
+  std::string start;
+  std::string end;
+  uint64_t limit = 0;
+};
+
+// Sets `key` to `value`, but only if its current value is `expected`. A
+// missing key never matches (see PutIfAbsentRequest). The key keeps its TTL.
+struct CasRequest {
+  std::string key;
+  std::string expected;
+  std::string value;
+};
+
+// Adds `delta` (which may be negative) to the integer stored at `key`, and
+// fails if the value isn't a base-10 64-bit integer or the sum overflows. A
+// missing key counts as 0. The key keeps its TTL.
+struct IncrRequest {
+  std::string key;
+  int64_t delta = 1;
+};
+
+// Like a Put, but only if `key` doesn't exist yet.
+struct PutIfAbsentRequest {
+  std::string key;
+  std::string value;
+  uint64_t ttl_ms = 0;
+};
+
+// Two-phase commit of a MultiPut spanning servers (see two_phase_commit()).
+// Phase one: the server locks the keys for transaction `txn_id` and stages
+// the writes, or votes no if another transaction holds any of them. If
+// `commit` is set, the transaction only involves this server, which commits
+// it right away instead of waiting for a CommitRequest. `participants` are
+// all of the transaction's servers, which the server asks how the transaction
+// ended if it doesn't hear back (see TxnStatusRequest).
+struct PrepareRequest {
+  uint64_t txn_id;
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+  bool commit = false;
+  std::vector<std::string> participants = {};
+};
+
+// Phase two: applies a prepared transaction's writes, or drops them.
+struct CommitRequest {
+  uint64_t txn_id;
+};
+struct AbortRequest {
+  uint64_t txn_id;
+};
+
+// Asks a server how a transaction ended, on behalf of another participant
+// that voted yes and hasn't heard back from the coordinator. A server that
+// hasn't prepared the transaction refuses it, so that it can only abort.
+struct TxnStatusRequest {
+  uint64_t txn_id;
+};
+
+// Deletes all of a user's data at once: every key that was last written by a
+// Put or MultiPut naming `owner` as its owner, whatever the key is called.
+// Cas, Incr and Append keep a key's owner.
+struct DeleteByOwnerRequest {
+  std::string owner;
+};
+
+// Asks for the server's statistics (see KvServer::stats).
+struct StatsRequest {};
+
 // Responses
 struct GetResponse {
   std::string value;
@@ -47,5 +128,67 @@ struct MultiGetResponse {
   std::vector<std::string> values;
 };
 struct MultiPutResponse {};
+struct ScanRangeResponse {
+  std::vector<std::string> keys;
+  std::vector<std::string> values;
+};
+// Whether the value was swapped. If it wasn't, `value` is the key's current
+// value (empty if it doesn't exist), so that the caller can retry right away.
+struct CasResponse {
+  bool swapped = false;
+  std::string value;
+};
+// The key's value after the increment.
+struct IncrResponse {
+  int64_t value = 0;
+};
+// Whether the key was inserted. If it already existed, `value` is its value.
+struct PutIfAbsentResponse {
+  bool inserted = false;
+  std::string value;
+};
+// The server's vote.
+struct PrepareResponse {
+  bool ok = false;
+};
+struct CommitResponse {};
+struct AbortResponse {};
+enum class TxnStatus : uint8_t { PREPARED, COMMITTED, ABORTED };
+// PREPARED if the server voted yes and is still waiting for the outcome too.
+struct TxnStatusResponse {
+  TxnStatus status = TxnStatus::PREPARED;
+};
+// The keys that were deleted.
+struct DeleteByOwnerResponse {
+  std::vector<std::string> keys;
+};
+// How many of one kind of request the server has processed, and how long they
+// took, in microseconds.
+struct LatencyStats {
+  std::string name;
+  uint64_t count = 0;
+  uint64_t p50_us = 0;
+  uint64_t p99_us = 0;
+  uint64_t p999_us = 0;
+  uint64_t max_us = 0;
+};
+// Everything since the server started, so that rates can be computed from
+// two polls.
+struct StatsResponse {
+  uint64_t uptime_ms = 0;
+  // Time spent processing each type of request, and (as "queue") waiting for
+  // a worker.
+  std::vector<LatencyStats> latencies;
+  // Bytes of requests received and responses sent, including headers.
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  // Requests shed under load.
+  uint64_t n_shed = 0;
+  // The store's cache counters (see CacheStats): keys found and not found by
+  // Gets and MultiGets, and keys evicted to stay within the memory limit.
+  uint64_t cache_hits = 0;
+  uint64_t cache_misses = 0;
+  uint64_t cache_evictions = 0;
+};
 
 #endif /* end of include guard */
@@ -0,0 +1,291 @@
+#include "net/shm_channel.hpp"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+              "ring indices must work across processes");
+
+// How often a waiting side checks whether the other side is still there.
+static constexpr milliseconds LIVENESS_INTERVAL = 50ms;
+
+// Seals on the memfd that stop it from being resized.
+static constexpr int REQUIRED_SEALS = F_SEAL_SHRINK | F_SEAL_GROW;
+
+// Identifies a region created by this version of ShmChannel.
+static constexpr uint64_t REGION_MAGIC = 0x6b7673686d763031;  // "kvshmv01"
+
+struct ShmChannel::Ring {
+  // Total bytes written and read; only the producer moves `head`, and only the
+  // consumer `tail`. Each is on its own cache line, so the two sides don't
+  // contend for it.
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  // Bumped after `head` moves, for a consumer waiting for data to sleep on,
+  // and whether one is.
+  alignas(64) std::atomic<uint32_t> written;
+  std::atomic<uint32_t> reader_waiting;
+  // The same, after `tail` moves, for a producer waiting for space.
+  alignas(64) std::atomic<uint32_t> consumed;
+  std::atomic<uint32_t> writer_waiting;
+  alignas(64) std::byte data[RING_SIZE];
+};
+
+struct ShmChannel::Region {
+  uint64_t magic = REGION_MAGIC;
+  std::atomic<uint32_t> closed;
+  // Client to server, and server to client.
+  Ring rings[2];
+};
+
+// Sleeps until `*word` isn't `expected`, someone wakes it, or `timeout`
+// passes. The futexes are shared between processes, so not FUTEX_PRIVATE.
+static void futex_wait(std::atomic<uint32_t>* word, uint32_t expected,
+                       nanoseconds timeout) {
+  struct timespec ts;
+  ts.tv_sec = duration_cast<seconds>(timeout).count();
+  ts.tv_nsec = (timeout % 1s).count();
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+          &ts, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX,
+          nullptr, nullptr, 0);
+}
+
+// Tells the other side that `seq`'s ring moved, waking it if it's waiting.
+static void notify(std::atomic<uint32_t>& seq,
+                   std::atomic<uint32_t>& waiting) {
+  seq.fetch_add(1);
+  if (waiting.exchange(0)) futex_wake(&seq);
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::create(int socket_fd) {
+  int memfd = memfd_create("kvstore-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0) {
+    perror_color(RED, "memfd_create");
+    return nullptr;
+  }
+  // Fix the size for good, so that the server can rely on it
+  if (ftruncate(memfd, sizeof(Region)) < 0 ||
+      fcntl(memfd, F_ADD_SEALS, REQUIRED_SEALS | F_SEAL_SEAL) < 0) {
+    perror_color(RED, "memfd");
+    ::close(memfd);
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, memfd, 0);
+  if (addr == MAP_FAILED) {
+    perror_color(RED, "mmap");
+    ::close(memfd);
+    return nullptr;
+  }
+  // A new memfd is zeroed, which is what the atomics start at anyway
+  auto* region = new (addr) Region;
+  return std::unique_ptr<ShmChannel>(
+      new ShmChannel(memfd, socket_fd, region, true));
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::attach(int memfd, int socket_fd) {
+  // The region comes from a client, so check that it's what we expect, and
+  // that it can't shrink out from under us
+  struct stat st;
+  int seals = fcntl(memfd, F_GET_SEALS);
+  if (fstat(memfd, &st) < 0 || size_t(st.st_size) != sizeof(Region) ||
+      seals < 0 || (seals & REQUIRED_SEALS) != REQUIRED_SEALS) {
+    cerr_color(RED, "Shared memory region has the wrong size or seals.");
+    ::close(memfd);
+    return nullptr;
+  }
+  void* addr = mmap(nullptr, sizeof(Region), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, memfd, 0);
+  if (addr == MAP_FAILED) {
+    perror_color(RED, "mmap");
+    ::close(memfd);
+    return nullptr;
+  }
+  auto* region = static_cast<Region*>(addr);
+  if (region->magic != REGION_MAGIC) {
+    cerr_color(RED, "Shared memory region has the wrong format.");
+    munmap(addr, sizeof(Region));
+    ::close(memfd);
+    return nullptr;
+  }
+  return std::unique_ptr<ShmChannel>(
+      new ShmChannel(memfd, socket_fd, region, false));
+}
+
+ShmChannel::ShmChannel(int memfd, int socket_fd, Region* region,
+                       bool is_client)
+    : memfd(memfd),
+      socket_fd(socket_fd),
+      region(region),
+      out(&region->rings[is_client ? 0 : 1]),
+      in(&region->rings[is_client ? 1 : 0]) {
+}
+
+ShmChannel::~ShmChannel() {
+  this->close();
+  munmap(this->region, sizeof(Region));
+  ::close(this->memfd);
+}
+
+void ShmChannel::close() {
+  if (this->region->closed.exchange(1)) return;
+  for (auto& ring : this->region->rings) {
+    ring.written.fetch_add(1);
+    ring.consumed.fetch_add(1);
+    futex_wake(&ring.written);
+    futex_wake(&ring.consumed);
+  }
+}
+
+template <typename F>
+bool ShmChannel::wait(std::atomic<uint32_t>& seq,
+                      std::atomic<uint32_t>& waiting, F ready,
+                      steady_clock::time_point deadline) {
+  while (true) {
+    waiting.store(1);
+    uint32_t expected = seq.load();
+    if (ready()) return true;
+    if (this->region->closed.load()) return false;
+
+    auto now = steady_clock::now();
+    if (now >= deadline) return false;
+    nanoseconds timeout = LIVENESS_INTERVAL;
+    if (deadline != steady_clock::time_point::max()) {
+      timeout = std::min(timeout, nanoseconds(deadline - now));
+    }
+    futex_wait(&seq, expected, timeout);
+
+    // A process that dies can't close the channel, but the kernel does close
+    // its end of the socket
+    struct pollfd pfd = {this->socket_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLHUP | POLLERR))) {
+      return false;
+    }
+  }
+}
+
+bool ShmChannel::write(const std::byte* data, size_t len,
+                       steady_clock::time_point deadline) {
+  Ring* ring = this->out;
+  while (len > 0) {
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    size_t space = 0;
+    auto has_space = [&] {
+      space = RING_SIZE - (head - ring->tail.load(std::memory_order_acquire));
+      return space > 0;
+    };
+    if (!has_space() && !this->wait(ring->consumed, ring->writer_waiting,
+                                    has_space, deadline)) {
+      return false;
+    }
+    if (this->region->closed.load()) return false;
+
+    // Copy in up to the end of the ring, then wrap around. The indices are
+    // shared with the other process, so never trust them to be in range.
+    size_t n = std::min({len, space, RING_SIZE});
+    size_t offset = head % RING_SIZE;
+    size_t first = std::min(n, RING_SIZE - offset);
+    memcpy(ring->data + offset, data, first);
+    memcpy(ring->data, data + first, n - first);
+    ring->head.store(head + n, std::memory_order_release);
+    notify(ring->written, ring->reader_waiting);
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool ShmChannel::read(std::byte* data, size_t len,
+                      steady_clock::time_point deadline) {
+  Ring* ring = this->in;
+  while (len > 0) {
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t available = 0;
+    auto has_data = [&] {
+      available = ring->head.load(std::memory_order_acquire) - tail;
+      return available > 0;
+    };
+    if (!has_data() && !this->wait(ring->written, ring->reader_waiting,
+                                   has_data, deadline)) {
+      return false;
+    }
+
+    size_t n = std::min({len, available, RING_SIZE});
+    size_t offset = tail % RING_SIZE;
+    size_t first = std::min(n, RING_SIZE - offset);
+    memcpy(data, ring->data + offset, first);
+    memcpy(data + first, ring->data, n - first);
+    ring->tail.store(tail + n, std::memory_order_release);
+    notify(ring->consumed, ring->writer_waiting);
+    data += n;
+    len -= n;
+  }
+  return true;
+}
+
+bool ShmChannel::send_message(const Message& msg, milliseconds timeout) {
+  assert(timeout > 0ms);
+  assert(msg.sz == msg.buf.size());
+
+  uint64_t header = pack_header(msg);
+  if (!this->write(reinterpret_cast<const std::byte*>(&header), sizeof(header),
+                   steady_clock::time_point::max())) {
+    return false;
+  }
+  for (size_t sent = 0; sent < msg.sz; sent += MESSAGE_CHUNK_SIZE) {
+    size_t len = std::min(MESSAGE_CHUNK_SIZE, msg.sz - sent);
+    if (!this->write(msg.buf.data() + sent, len,
+                     steady_clock::now() + timeout)) {
+      cerr_color(RED, "Send on shared memory channel timed out or closed.");
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ShmChannel::recv_message(Message* msg, milliseconds timeout,
+                              size_t max_size) {
+  assert(timeout > 0ms);
+
+  // Like on a socket, wait for the next message for as long as it takes
+  uint64_t header;
+  if (!this->read(reinterpret_cast<std::byte*>(&header), sizeof(header),
+                  steady_clock::time_point::max())) {
+    return false;
+  }
+  unpack_header(header, msg);
+  if (msg->sz > max_size) {
+    cerr_color(RED, "Message of ", msg->sz,
+               " bytes on shared memory channel is larger than the maximum of ",
+               max_size, ".");
+    return false;
+  }
+
+  // Unlike on a socket, the sender is a process on this host that we've
+  // already mapped memory from, so there's no need to grow the buffer warily
+  msg->buf.resize(msg->sz);
+  for (size_t received = 0; received < msg->sz;
+       received += MESSAGE_CHUNK_SIZE) {
+    size_t len = std::min(MESSAGE_CHUNK_SIZE, msg->sz - received);
+    if (!this->read(msg->buf.data() + received, len,
+                    steady_clock::now() + timeout)) {
+      cerr_color(RED, "Recv on shared memory channel timed out or closed.");
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,84 @@
+#ifndef NET_SHM_CHANNEL_HPP
+#define NET_SHM_CHANNEL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "net/network_messages.hpp"
+
+/*
+ * A transport for clients on the same host as their server: a pair of
+ * single-producer single-consumer byte rings (one in each direction) in a
+ * shared memory region backed by a memfd. The client creates the region and
+ * hands its file descriptor to the server over a Unix domain socket (see
+ * connect_to_server), which then stays open only so that each side notices if
+ * the other goes away.
+ *
+ * Messages are framed just as on a socket, but copied straight into and out of
+ * the rings, so they don't go through the kernel at all unless one side has to
+ * wait for the other (on a futex).
+ */
+class ShmChannel {
+ public:
+  // Bytes in each ring. Larger messages stream through it in pieces.
+  static constexpr size_t RING_SIZE = size_t(1) << 20;
+
+  // Creates a channel, for the client end of the connection on `socket_fd`.
+  // Returns nullptr on error.
+  static std::unique_ptr<ShmChannel> create(int socket_fd);
+  // Maps the channel a client created, for the server end of the connection
+  // on `socket_fd`. Takes ownership of `memfd`. Returns nullptr on error.
+  static std::unique_ptr<ShmChannel> attach(int memfd, int socket_fd);
+
+  ~ShmChannel();
+
+  // The memfd backing the channel.
+  int fd() const {
+    return this->memfd;
+  }
+
+  // The equivalents of send_message and recv_message. They must not be called
+  // from several threads at once, just like on a socket.
+  bool send_message(const Message& msg, milliseconds timeout = 400ms);
+  bool recv_message(Message* msg, milliseconds timeout = 400ms,
+                    size_t max_size = DEFAULT_MAX_MESSAGE_SIZE);
+
+  // Closes the channel: sends and receives on both ends fail from now on,
+  // including ones already waiting.
+  void close();
+
+  ShmChannel(const ShmChannel&) = delete;
+  ShmChannel& operator=(const ShmChannel&) = delete;
+
+ private:
+  struct Ring;
+  struct Region;
+
+  ShmChannel(int memfd, int socket_fd, Region* region, bool is_client);
+
+  // Copies `len` bytes into the outgoing ring, waiting for space up to
+  // `deadline`.
+  bool write(const std::byte* data, size_t len,
+             steady_clock::time_point deadline);
+  // Copies `len` bytes out of the incoming ring, waiting for them up to
+  // `deadline`.
+  bool read(std::byte* data, size_t len, steady_clock::time_point deadline);
+  // Waits until `ready()`, sleeping on `seq` (which the other side bumps as it
+  // makes progress) with `waiting` set so that it knows to wake us. Fails on
+  // timeout, or if the channel is closed or the other side has gone away.
+  template <typename F>
+  bool wait(std::atomic<uint32_t>& seq, std::atomic<uint32_t>& waiting,
+            F ready, steady_clock::time_point deadline);
+
+  int memfd;
+  // The connection's socket, checked for hangups while waiting.
+  int socket_fd;
+  Region* region;
+  Ring* out;
+  Ring* in;
+};
+
+#endif /* end of include guard */
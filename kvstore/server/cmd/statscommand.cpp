@@ -0,0 +1,42 @@
+#include "statscommand.hpp"
+
+#include <iomanip>
+
+void StatsCommand::handle(const std::string&) {
+  StatsResponse stats = this->server->stats();
+  double uptime_s = std::max<uint64_t>(stats.uptime_ms, 1) / 1000.0;
+  std::cout << "Up " << uptime_s << "s, " << stats.bytes_in
+            << " bytes in, " << stats.bytes_out << " bytes out, "
+            << stats.n_shed << " requests shed" << std::endl;
+  std::cout << "Cache: " << stats.cache_hits << " hits, "
+            << stats.cache_misses << " misses, " << stats.cache_evictions
+            << " evictions" << std::endl;
+
+  std::cout << std::left << std::setw(10) << "type" << std::right
+            << std::setw(10) << "count" << std::setw(10) << "per sec"
+            << std::setw(10) << "p50 us" << std::setw(10) << "p99 us"
+            << std::setw(10) << "p999 us" << std::setw(10) << "max us"
+            << std::endl;
+  for (const LatencyStats& latency : stats.latencies) {
+    std::cout << std::left << std::setw(10) << latency.name << std::right
+              << std::setw(10) << latency.count << std::setw(10)
+              << uint64_t(latency.count / uptime_s) << std::setw(10)
+              << latency.p50_us << std::setw(10) << latency.p99_us
+              << std::setw(10) << latency.p999_us << std::setw(10)
+              << latency.max_us << std::endl;
+  }
+}
+
+std::string StatsCommand::name() const {
+  return "stats";
+}
+
+std::string StatsCommand::params() const {
+  return "";
+}
+
+std::string StatsCommand::description() const {
+  return "Prints request counts and latency percentiles by request type, "
+         "time spent waiting for a worker (\"queue\"), bytes received "
+         "and sent, and cache hits, misses and evictions.";
+}
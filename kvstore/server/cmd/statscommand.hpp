@@ -0,0 +1,24 @@
+#ifndef SERVER_STATSCOMMAND_HPP
+#define SERVER_STATSCOMMAND_HPP
+
+#include <memory>
+
+#include "../server.hpp"
+#include "repl/replcommand.hpp"
+
+class StatsCommand : public ReplCommand {
+ public:
+  explicit StatsCommand(std::shared_ptr<KvServer> s) : server(s) {
+  }
+
+  void handle(const std::string&) override;
+
+  std::string name() const override;
+  std::string params() const override;
+  std::string description() const override;
+
+ private:
+  std::shared_ptr<KvServer> server;
+};
+
+#endif /* end of include guard */
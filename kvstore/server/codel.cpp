@@ -0,0 +1,8 @@
+#include "server/codel.hpp"
+
+bool CoDel::shed(Clock::time_point queued_at, Clock::time_point now,
+                 size_t remaining) {
+  if (remaining == 0) this->last_empty = now;
+  bool overloaded = now - this->last_empty > this->interval;
+  return now - queued_at > (overloaded ? this->target : this->interval);
+}
@@ -0,0 +1,42 @@
+#ifndef CODEL_HPP
+#define CODEL_HPP
+
+#include <chrono>
+#include <cstddef>
+
+/**
+ * CoDel ("controlled delay") load shedding for one worker's queue, in the
+ * variant used for RPC servers (see "Fail at Scale", ACM Queue 2015). It
+ * looks at how long each request (or connection) the worker takes has waited
+ * in the queue:
+ *
+ *  - Normally, requests are only shed once they've waited `interval`: bursts
+ *    queue up, and drain.
+ *  - If the queue hasn't been empty for a whole `interval`, the queue isn't
+ *    draining, and the server is overloaded. Then anything that's waited more
+ *    than `target` is shed, keeping the queue short so that the requests that
+ *    are processed are answered quickly, rather than all of them too late.
+ *
+ * It isn't thread-safe: use it under the lock of the queue it watches.
+ */
+class CoDel {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  CoDel(Clock::duration target, Clock::duration interval)
+      : target(target), interval(interval), last_empty(Clock::now()) {
+  }
+
+  // Called as the worker takes something that was queued at `queued_at`,
+  // leaving `remaining` in the queue. Returns whether to shed it.
+  bool shed(Clock::time_point queued_at, Clock::time_point now,
+            size_t remaining);
+
+ private:
+  Clock::duration target;
+  Clock::duration interval;
+  // When the queue was last seen empty.
+  Clock::time_point last_empty;
+};
+
+#endif /* end of include guard */
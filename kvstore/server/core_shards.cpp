@@ -0,0 +1,165 @@
+#include "server/core_shards.hpp"
+
+#include <functional>
+
+CoreShards::CoreShards(size_t n_cores) : shards(split_into(n_cores)) {
+}
+
+size_t CoreShards::core_of(const std::string& key) const {
+  // The shards' bounds are all as long, and they cover every string of valid
+  // characters that long, in order
+  size_t granularity = this->shards.front().granularity();
+  if (key.size() >= granularity) {
+    std::string prefix = key.substr(0, granularity);
+    for (char& c : prefix) c = std::toupper((unsigned char)c);
+    if (is_valid(prefix)) {
+      auto it = std::upper_bound(
+          this->shards.begin(), this->shards.end(), prefix,
+          [](const std::string& s, const Shard& shard) {
+            return s < shard.lower;
+          });
+      return it - this->shards.begin() - 1;
+    }
+  }
+  return std::hash<std::string>()(key) % this->shards.size();
+}
+
+// Groups the keys of a multi-key request by core: calls `add(req, i)` to add
+// the i-th key to `req`, the request in its core's part.
+template <typename Add>
+static std::vector<CoreShards::Part> group_by_core(
+    const CoreShards& shards, const std::vector<std::string>& keys, Add add) {
+  std::vector<CoreShards::Part> parts;
+  std::vector<size_t> part_of(shards.n_cores(), SIZE_MAX);
+  for (size_t i = 0; i < keys.size(); i++) {
+    size_t core = shards.core_of(keys[i]);
+    if (part_of[core] == SIZE_MAX) {
+      part_of[core] = parts.size();
+      parts.push_back({core, {}, {}, {}});
+    }
+    CoreShards::Part& part = parts[part_of[core]];
+    part.positions.push_back(i);
+    add(part.req, i);
+  }
+  std::sort(parts.begin(), parts.end(),
+            [](const CoreShards::Part& a, const CoreShards::Part& b) {
+              return a.core < b.core;
+            });
+  return parts;
+}
+
+std::vector<CoreShards::Part> CoreShards::split(Request req,
+                                                size_t home) const {
+  std::vector<Part> parts;
+  if (auto* r = std::get_if<MultiGetRequest>(&req)) {
+    parts = group_by_core(*this, r->keys, [&](Request& part, size_t i) {
+      if (!std::holds_alternative<MultiGetRequest>(part)) {
+        part = MultiGetRequest{};
+      }
+      std::get<MultiGetRequest>(part).keys.push_back(std::move(r->keys[i]));
+    });
+  } else if (auto* r = std::get_if<MultiPutRequest>(&req);
+             r && r->keys.size() == r->values.size() &&
+             (r->owners.empty() || r->owners.size() == r->keys.size())) {
+    parts = group_by_core(*this, r->keys, [&](Request& part, size_t i) {
+      if (!std::holds_alternative<MultiPutRequest>(part)) {
+        part = MultiPutRequest{{}, {}, r->ttl_ms};
+      }
+      auto& multiput = std::get<MultiPutRequest>(part);
+      multiput.keys.push_back(std::move(r->keys[i]));
+      multiput.values.push_back(std::move(r->values[i]));
+      if (!r->owners.empty()) {
+        multiput.owners.push_back(std::move(r->owners[i]));
+      }
+    });
+  } else if (auto* r = std::get_if<BatchRequest>(&req)) {
+    std::vector<std::string> keys;
+    for (auto&& op : r->ops) {
+      keys.push_back(std::visit([](auto&& op_req) { return op_req.key; }, op));
+    }
+    parts = group_by_core(*this, keys, [&](Request& part, size_t i) {
+      if (!std::holds_alternative<BatchRequest>(part)) part = BatchRequest{};
+      std::get<BatchRequest>(part).ops.push_back(std::move(r->ops[i]));
+    });
+  } else if (std::holds_alternative<ScanRangeRequest>(req) ||
+             std::holds_alternative<DeleteByOwnerRequest>(req)) {
+    for (size_t core = 0; core < this->n_cores(); core++) {
+      parts.push_back({core, req, {}, {}});
+    }
+  } else {
+    // Single-key requests go to the key's core, and the rest stay home
+    std::optional<std::string> key = std::visit(
+        [](auto&& r) -> std::optional<std::string> {
+          if constexpr (requires { r.key; }) {
+            return r.key;
+          } else {
+            return std::nullopt;
+          }
+        },
+        req);
+    parts.push_back({key ? this->core_of(*key) : home, std::move(req), {}, {}});
+  }
+  // Requests without any keys (e.g. an empty MultiGet) stay home too
+  if (parts.empty()) parts.push_back({home, std::move(req), {}, {}});
+  return parts;
+}
+
+Response CoreShards::merge(std::vector<Part>& parts, uint64_t scan_limit) {
+  if (parts.size() == 1) return std::move(parts[0].res);
+  for (auto&& part : parts) {
+    if (std::holds_alternative<ErrorResponse>(part.res)) {
+      return std::move(part.res);
+    }
+  }
+
+  size_t n_results = 0;
+  for (auto&& part : parts) n_results += part.positions.size();
+  Response& first = parts[0].res;
+  if (std::holds_alternative<MultiGetResponse>(first)) {
+    MultiGetResponse res;
+    res.values.resize(n_results);
+    for (auto&& part : parts) {
+      auto& values = std::get<MultiGetResponse>(part.res).values;
+      for (size_t i = 0; i < values.size(); i++) {
+        res.values[part.positions[i]] = std::move(values[i]);
+      }
+    }
+    return res;
+  } else if (std::holds_alternative<BatchResponse>(first)) {
+    BatchResponse res;
+    res.results.resize(n_results);
+    for (auto&& part : parts) {
+      auto& results = std::get<BatchResponse>(part.res).results;
+      for (size_t i = 0; i < results.size(); i++) {
+        res.results[part.positions[i]] = std::move(results[i]);
+      }
+    }
+    return res;
+  } else if (std::holds_alternative<ScanRangeResponse>(first)) {
+    // Each core's keys are in order, but they interleave
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (auto&& part : parts) {
+      auto& scan = std::get<ScanRangeResponse>(part.res);
+      for (size_t i = 0; i < scan.keys.size(); i++) {
+        pairs.emplace_back(std::move(scan.keys[i]), std::move(scan.values[i]));
+      }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    if (scan_limit && pairs.size() > scan_limit) pairs.resize(scan_limit);
+    ScanRangeResponse res;
+    for (auto&& [key, value] : pairs) {
+      res.keys.push_back(std::move(key));
+      res.values.push_back(std::move(value));
+    }
+    return res;
+  } else if (std::holds_alternative<DeleteByOwnerResponse>(first)) {
+    DeleteByOwnerResponse res;
+    for (auto&& part : parts) {
+      auto& keys = std::get<DeleteByOwnerResponse>(part.res).keys;
+      std::move(keys.begin(), keys.end(), std::back_inserter(res.keys));
+    }
+    return res;
+  }
+  // MultiPuts have nothing to merge
+  return std::move(first);
+}
@@ -0,0 +1,55 @@
+#ifndef CORE_SHARDS_HPP
+#define CORE_SHARDS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/shard.hpp"
+#include "net/network_messages.hpp"
+
+/*
+ * How a server in shard-per-core mode (see KvServerOptions::shard_per_core)
+ * splits its keys over its cores: by range, the way the shardcontroller
+ * splits them over servers (see split_into), so that each core owns a
+ * contiguous slice of the key space. Keys that fall outside every range
+ * (those shorter than the ranges' bounds, or with characters other than
+ * VALID_CHARS) are spread over the cores by hash instead.
+ *
+ * A request for keys on several cores is split into a part per core, and the
+ * parts' responses are merged into the response to the whole.
+ */
+class CoreShards {
+ public:
+  explicit CoreShards(size_t n_cores);
+
+  size_t n_cores() const {
+    return this->shards.size();
+  }
+  // The core that owns `key`.
+  size_t core_of(const std::string& key) const;
+
+  // A request limited to one core's keys, and where those keys are in the
+  // original request (for MultiGets, MultiPuts and batches).
+  struct Part {
+    size_t core;
+    Request req;
+    std::vector<size_t> positions;
+    Response res;
+  };
+
+  // Splits `req` into a part for each core whose keys it reads or writes, in
+  // order of core. Scans and DeleteByOwners go to every core, and requests
+  // without keys to the `home` core.
+  std::vector<Part> split(Request req, size_t home) const;
+
+  // Merges the responses of the parts that `split` made of a request into
+  // the response to it. `scan_limit` is the request's limit, if it's a
+  // ScanRange.
+  static Response merge(std::vector<Part>& parts, uint64_t scan_limit = 0);
+
+ private:
+  std::vector<Shard> shards;
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,73 @@
+#include "hot_key_cache.hpp"
+
+#include "common/utils.hpp"
+
+HotKeyCache::Slot& HotKeyCache::slot(std::string_view key) {
+  return this->slots[std::hash<std::string_view>()(key) % this->slots.size()];
+}
+
+std::shared_ptr<const Message> HotKeyCache::get(std::string_view key,
+                                                uint64_t version) {
+  Slot& slot = this->slot(key);
+  if (slot.key != key) {
+    // Another key owns the slot; cool it down, and take over once it's cold
+    if (slot.heat > 0) slot.heat--;
+    if (slot.heat == 0) {
+      slot.key = key;
+      slot.heat = 1;
+      slot.res = CachedResponse{};
+    }
+    return nullptr;
+  }
+
+  if (slot.heat < MAX_HEAT) slot.heat++;
+  if (!slot.res.msg || slot.res.version != version) return nullptr;
+  if (slot.res.expires_at && slot.res.expires_at <= now_ms()) return nullptr;
+  return slot.res.msg;
+}
+
+bool HotKeyCache::is_hot(std::string_view key) {
+  Slot& slot = this->slot(key);
+  return slot.key == key && slot.heat >= HOT_THRESHOLD;
+}
+
+void HotKeyCache::put(std::string_view key, const CachedResponse& res) {
+  if (!res.found || !this->is_hot(key)) return;
+  this->slot(key).res = res;
+}
+
+CachedResponse GetCoalescer::get(const std::string& key, uint64_t version,
+                                 const std::function<CachedResponse()>& fetch) {
+  std::promise<CachedResponse> promise;
+  std::shared_ptr<Flight> flight;
+  {
+    std::unique_lock lock(this->mtx);
+    auto it = this->flights.find(key);
+    if (it != this->flights.end()) {
+      if (it->second->version == version) {
+        // Nothing has been written to the key's bucket since that Get started,
+        // so whatever it reads is also a valid result for this one
+        auto result = it->second->result;
+        lock.unlock();
+        return result.get();
+      }
+      // A write completed in between, so that Get might miss it
+      lock.unlock();
+      return fetch();
+    }
+    flight = std::make_shared<Flight>(
+        Flight{version, promise.get_future().share()});
+    this->flights[key] = flight;
+  }
+
+  CachedResponse res = fetch();
+  promise.set_value(res);
+  {
+    std::lock_guard lock(this->mtx);
+    auto it = this->flights.find(key);
+    if (it != this->flights.end() && it->second == flight) {
+      this->flights.erase(it);
+    }
+  }
+  return res;
+}
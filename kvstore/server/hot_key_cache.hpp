@@ -0,0 +1,91 @@
+#ifndef HOT_KEY_CACHE_HPP
+#define HOT_KEY_CACHE_HPP
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "net/network_messages.hpp"
+
+// A serialized Get response, and what's needed to tell whether it's still
+// current (see ConcurrentKvStore::GetVersioned).
+struct CachedResponse {
+  std::shared_ptr<const Message> msg;
+  // Whether the Get found the key; only responses that did are cached.
+  bool found = false;
+  uint64_t version = 0;
+  // Expiry deadline of the key (see now_ms()), or 0 if it has none.
+  uint64_t expires_at = 0;
+};
+
+/**
+ * A small cache of serialized Get responses for the keys a worker reads the
+ * most. Each worker owns one, so it needs no locking.
+ *
+ * Keys map to a fixed number of slots by hash. Each slot tracks how often its
+ * key has been read, and the key's response is only cached once it's been
+ * read HOT_THRESHOLD times. Reads of other keys that map to the same slot cool
+ * it down, and take it over once it's cold, so a stream of one-off reads can't
+ * displace a hot key.
+ */
+class HotKeyCache {
+ public:
+  explicit HotKeyCache(size_t n_slots = DEFAULT_SLOTS) : slots(n_slots) {
+  }
+
+  static constexpr size_t DEFAULT_SLOTS = 1024;
+  static constexpr uint32_t HOT_THRESHOLD = 4;
+  static constexpr uint32_t MAX_HEAT = 64;
+
+  // Records a read of `key`, and returns its cached response if it's current
+  // as of `version` (the version of the key's bucket) and hasn't expired.
+  // Otherwise, returns nullptr.
+  std::shared_ptr<const Message> get(std::string_view key, uint64_t version);
+
+  // Whether `key` has been read often enough to be cached.
+  bool is_hot(std::string_view key);
+
+  // Caches `res` as the response for `key`, if the key is hot and the Get
+  // found it.
+  void put(std::string_view key, const CachedResponse& res);
+
+ private:
+  struct Slot {
+    std::string key;
+    uint32_t heat = 0;
+    CachedResponse res;
+  };
+  std::vector<Slot> slots;
+
+  Slot& slot(std::string_view key);
+};
+
+/**
+ * Coalesces identical Gets that run concurrently on different workers: while
+ * one worker looks a key up and serializes the response, the others wait for
+ * its result instead of repeating the work.
+ */
+class GetCoalescer {
+ public:
+  // Returns the response to a Get of `key`, which the caller started when the
+  // key's bucket was at `version`. Calls `fetch` to produce it, unless a Get of
+  // the same key that started at the same version is already in flight; its
+  // result is then equally valid, and is returned instead.
+  CachedResponse get(const std::string& key, uint64_t version,
+                     const std::function<CachedResponse()>& fetch);
+
+ private:
+  struct Flight {
+    uint64_t version;
+    std::shared_future<CachedResponse> result;
+  };
+  std::mutex mtx;
+  std::unordered_map<std::string, std::shared_ptr<Flight>> flights;
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,782 @@
+#include "server/io_engine.hpp"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+
+#include "common/color.hpp"
+#include "net/network_helpers.hpp"
+
+// Bytes read by each recv (epoll) or into each provided buffer (io_uring).
+static constexpr size_t EPOLL_RECV_SIZE = 64 << 10;
+static constexpr size_t URING_BUFFER_SIZE = 16 << 10;
+
+IoEngine::IoEngine(int listener_fd, int wake_fd, MessageHandler on_message,
+                   size_t max_message_size)
+    : listener_fd(listener_fd),
+      wake_fd(wake_fd),
+      on_message(std::move(on_message)),
+      max_message_size(max_message_size) {
+}
+
+IoEngine::~IoEngine() {
+  for (auto& [id, conn] : this->conns) close(conn.fd);
+  close(this->wake_fd);
+}
+
+void IoEngine::stop() {
+  this->stopping = true;
+  uint64_t one = 1;
+  if (write(this->wake_fd, &one, sizeof(one)) < 0) {
+    perror_color(RED, "write");
+  }
+}
+
+void IoEngine::respond(uint64_t conn_id, std::shared_ptr<const Message> msg) {
+  {
+    std::unique_lock lock(this->responses_mtx);
+    this->responses.emplace_back(conn_id, std::move(msg));
+  }
+  // One wakeup covers all the responses queued until the loop gets to it
+  if (!this->wake_pending.exchange(true)) {
+    uint64_t one = 1;
+    this->n_syscalls++;
+    if (write(this->wake_fd, &one, sizeof(one)) < 0) {
+      perror_color(RED, "write");
+    }
+  }
+}
+
+uint64_t IoEngine::add_conn(int fd) {
+  uint64_t id = this->next_conn_id++;
+  this->conns[id].fd = fd;
+  return id;
+}
+
+void IoEngine::received(uint64_t id, Conn& conn, const std::byte* data,
+                        size_t len) {
+  // Drop what's already been handed over before appending
+  if (conn.in_offset > 0) {
+    conn.in.erase(conn.in.begin(), conn.in.begin() + conn.in_offset);
+    conn.in_offset = 0;
+  }
+  conn.in.insert(conn.in.end(), data, data + len);
+  this->dispatch(id, conn);
+
+  // A client may send its next request before the last one is answered, but
+  // not an unbounded backlog of them
+  if (!conn.closing && conn.in.size() - conn.in_offset >
+                           MESSAGE_HEADER_SIZE + this->max_message_size) {
+    cerr_color(RED, "Client on ", conn.fd, " sent too much ahead.");
+    this->close_conn(id, conn);
+  }
+}
+
+void IoEngine::dispatch(uint64_t id, Conn& conn) {
+  size_t available = conn.in.size() - conn.in_offset;
+  if (conn.busy || conn.closing || available < MESSAGE_HEADER_SIZE) return;
+
+  const std::byte* start = conn.in.data() + conn.in_offset;
+  uint64_t header;
+  memcpy(&header, start, sizeof(header));
+  Message msg;
+  unpack_header(header, &msg);
+  if (msg.sz > this->max_message_size) {
+    cerr_color(RED, "Message of ", msg.sz, " bytes on ", conn.fd,
+               " is larger than the maximum of ", this->max_message_size,
+               ".");
+    this->close_conn(id, conn);
+    return;
+  }
+  if (available - MESSAGE_HEADER_SIZE < msg.sz) return;
+
+  start += MESSAGE_HEADER_SIZE;
+  msg.buf.assign(start, start + msg.sz);
+  conn.in_offset += MESSAGE_HEADER_SIZE + msg.sz;
+  if (conn.in_offset == conn.in.size()) {
+    // Don't hold on to a large message's buffer while the connection idles
+    if (conn.in.capacity() > MESSAGE_CHUNK_SIZE) {
+      conn.in = {};
+    } else {
+      conn.in.clear();
+    }
+    conn.in_offset = 0;
+  }
+  conn.busy = true;
+  this->on_message(id, std::move(msg));
+}
+
+void IoEngine::prepare_send(Conn& conn) {
+  size_t n_iov = 0;
+  if (conn.sent < MESSAGE_HEADER_SIZE) {
+    conn.iov[n_iov++] = {reinterpret_cast<std::byte*>(&conn.out_header) +
+                             conn.sent,
+                         MESSAGE_HEADER_SIZE - conn.sent};
+  }
+  size_t body_sent = conn.sent - std::min(conn.sent, MESSAGE_HEADER_SIZE);
+  if (body_sent < conn.out->sz) {
+    conn.iov[n_iov++] = {
+        const_cast<std::byte*>(conn.out->buf.data()) + body_sent,
+        conn.out->sz - body_sent};
+  }
+  conn.out_msg = {};
+  conn.out_msg.msg_iov = conn.iov;
+  conn.out_msg.msg_iovlen = n_iov;
+}
+
+void IoEngine::finished_sending(uint64_t id, Conn& conn) {
+  conn.out.reset();
+  conn.busy = false;
+  this->dispatch(id, conn);
+}
+
+void IoEngine::flush_responses() {
+  std::vector<std::pair<uint64_t, std::shared_ptr<const Message>>> batch;
+  {
+    std::unique_lock lock(this->responses_mtx);
+    batch.swap(this->responses);
+  }
+  for (auto& [id, msg] : batch) {
+    // The client may have gone away while its request was processed
+    auto it = this->conns.find(id);
+    if (it == this->conns.end() || it->second.closing) continue;
+    Conn& conn = it->second;
+    if (!msg) {
+      this->close_conn(id, conn);
+      continue;
+    }
+    conn.out_header = pack_header(*msg);
+    conn.out = std::move(msg);
+    conn.sent = 0;
+    this->start_send(id, conn);
+  }
+}
+
+/*
+ * The epoll engine. Sockets are non-blocking, and watched for input all the
+ * time, and for room to send only while a response doesn't fit.
+ */
+class EpollEngine : public IoEngine {
+ public:
+  static std::unique_ptr<IoEngine> create(int listener_fd,
+                                          MessageHandler on_message,
+                                          size_t max_message_size);
+  ~EpollEngine() override {
+    close(this->epoll_fd);
+  }
+
+  IoEngineType type() const override {
+    return IoEngineType::EPOLL;
+  }
+  void run() override;
+
+ protected:
+  void start_send(uint64_t id, Conn& conn) override;
+  void close_conn(uint64_t id, Conn& conn) override;
+
+ private:
+  // Tags of the listener's and the eventfd's events; a connection's events
+  // are tagged with its ID.
+  static constexpr uint64_t LISTENER_TAG = 0;
+  static constexpr uint64_t WAKE_TAG = UINT64_MAX;
+  static constexpr int MAX_EVENTS = 256;
+
+  EpollEngine(int epoll_fd, int listener_fd, int wake_fd,
+              MessageHandler on_message, size_t max_message_size)
+      : IoEngine(listener_fd, wake_fd, std::move(on_message),
+                 max_message_size),
+        epoll_fd(epoll_fd) {
+  }
+
+  // Accepts all pending connections.
+  void accept_all();
+  // Reads everything available on a connection.
+  void receive(uint64_t id, Conn& conn);
+  // Adds `fd` to, or modifies it in, the epoll set.
+  bool watch(int op, int fd, uint64_t tag, uint32_t events);
+
+  int epoll_fd;
+  // Connections closed in this loop iteration, to forget at its end.
+  std::vector<uint64_t> closed;
+  std::array<std::byte, EPOLL_RECV_SIZE> recv_buf;
+};
+
+std::unique_ptr<IoEngine> EpollEngine::create(int listener_fd,
+                                              MessageHandler on_message,
+                                              size_t max_message_size) {
+  int flags = fcntl(listener_fd, F_GETFL);
+  if (flags < 0 || fcntl(listener_fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    perror_color(RED, "fcntl");
+    return nullptr;
+  }
+  int wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wake_fd < 0) {
+    perror_color(RED, "eventfd");
+    return nullptr;
+  }
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    perror_color(RED, "epoll_create1");
+    close(wake_fd);
+    return nullptr;
+  }
+  std::unique_ptr<EpollEngine> engine(new EpollEngine(
+      epoll_fd, listener_fd, wake_fd, std::move(on_message), max_message_size));
+  if (!engine->watch(EPOLL_CTL_ADD, listener_fd, LISTENER_TAG, EPOLLIN) ||
+      !engine->watch(EPOLL_CTL_ADD, wake_fd, WAKE_TAG, EPOLLIN)) {
+    return nullptr;
+  }
+  return engine;
+}
+
+bool EpollEngine::watch(int op, int fd, uint64_t tag, uint32_t events) {
+  struct epoll_event event = {};
+  event.events = events;
+  event.data.u64 = tag;
+  this->n_syscalls++;
+  if (epoll_ctl(this->epoll_fd, op, fd, &event) < 0) {
+    perror_color(RED, "epoll_ctl");
+    return false;
+  }
+  return true;
+}
+
+void EpollEngine::run() {
+  std::array<struct epoll_event, MAX_EVENTS> events;
+  while (!this->stopping.load()) {
+    this->n_syscalls++;
+    int n = epoll_wait(this->epoll_fd, events.data(), MAX_EVENTS, -1);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      perror_color(RED, "epoll_wait");
+      return;
+    }
+
+    for (int i = 0; i < n; i++) {
+      uint64_t tag = events[i].data.u64;
+      if (tag == LISTENER_TAG) {
+        this->accept_all();
+      } else if (tag == WAKE_TAG) {
+        uint64_t count;
+        this->n_syscalls++;
+        if (read(this->wake_fd, &count, sizeof(count)) < 0 &&
+            errno != EAGAIN) {
+          perror_color(RED, "read");
+        }
+        this->wake_pending = false;
+        this->flush_responses();
+      } else {
+        auto it = this->conns.find(tag);
+        if (it == this->conns.end() || it->second.closing) continue;
+        // Finish sending a response first, which may hand over the next
+        // request that's already been received
+        if (events[i].events & EPOLLOUT) this->start_send(tag, it->second);
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+          this->receive(tag, it->second);
+        }
+      }
+    }
+
+    for (uint64_t id : this->closed) this->conns.erase(id);
+    this->closed.clear();
+  }
+}
+
+void EpollEngine::accept_all() {
+  while (true) {
+    this->n_syscalls++;
+    int fd = accept4(this->listener_fd, nullptr, nullptr,
+                     SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) continue;
+      if (errno != EAGAIN && errno != EWOULDBLOCK && !this->stopping) {
+        perror_color(RED, "accept4");
+      }
+      return;
+    }
+    this->n_syscalls++;
+    set_nodelay(fd);
+    uint64_t id = this->add_conn(fd);
+    if (!this->watch(EPOLL_CTL_ADD, fd, id, EPOLLIN)) {
+      this->close_conn(id, this->conns[id]);
+    }
+  }
+}
+
+void EpollEngine::receive(uint64_t id, Conn& conn) {
+  while (!conn.closing) {
+    this->n_syscalls++;
+    ssize_t n = recv(conn.fd, this->recv_buf.data(), this->recv_buf.size(), 0);
+    if (n > 0) {
+      this->received(id, conn, this->recv_buf.data(), n);
+      // A short read drained the socket; if it didn't, epoll says so again
+      if (size_t(n) < this->recv_buf.size()) return;
+    } else if (n < 0 && errno == EINTR) {
+      continue;
+    } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    } else {
+      // The client closed the connection, or it broke
+      this->close_conn(id, conn);
+    }
+  }
+}
+
+void EpollEngine::start_send(uint64_t id, Conn& conn) {
+  if (!conn.out) return;
+  while (conn.sent < MESSAGE_HEADER_SIZE + conn.out->sz) {
+    this->prepare_send(conn);
+    this->n_syscalls++;
+    ssize_t n = sendmsg(conn.fd, &conn.out_msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Carry on once the socket has room
+      if (!conn.sending) {
+        conn.sending = true;
+        this->watch(EPOLL_CTL_MOD, conn.fd, id, EPOLLIN | EPOLLOUT);
+      }
+      return;
+    }
+    if (n < 0) {
+      this->close_conn(id, conn);
+      return;
+    }
+    conn.sent += n;
+  }
+  if (conn.sending) {
+    conn.sending = false;
+    this->watch(EPOLL_CTL_MOD, conn.fd, id, EPOLLIN);
+  }
+  this->finished_sending(id, conn);
+}
+
+void EpollEngine::close_conn(uint64_t id, Conn& conn) {
+  if (conn.closing) return;
+  conn.closing = true;
+  // Closing the socket also takes it out of the epoll set
+  this->n_syscalls++;
+  close(conn.fd);
+  conn.fd = -1;
+  this->closed.push_back(id);
+}
+
+// There's no liburing here, so the engine talks to the kernel directly (see
+// io_uring(7)).
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+  return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags) {
+  return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                 nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void* arg,
+                                 unsigned nr_args) {
+  return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/*
+ * The io_uring engine. The listener has a multishot accept armed, and each
+ * connection a multishot recv, which picks buffers from a ring of them
+ * registered with the kernel; the loop copies the data out of each buffer and
+ * hands the buffer straight back. Sends are queued as the loop goes, and each
+ * iteration submits them all and waits for the next completions in a single
+ * io_uring_enter.
+ */
+class UringEngine : public IoEngine {
+ public:
+  static std::unique_ptr<IoEngine> create(int listener_fd,
+                                          MessageHandler on_message,
+                                          size_t max_message_size);
+  ~UringEngine() override;
+
+  IoEngineType type() const override {
+    return IoEngineType::IO_URING;
+  }
+  void run() override;
+
+ protected:
+  void start_send(uint64_t id, Conn& conn) override;
+  void close_conn(uint64_t id, Conn& conn) override;
+
+ private:
+  static constexpr unsigned QUEUE_DEPTH = 4096;
+  // A power of two, as the kernel requires.
+  static constexpr unsigned N_BUFFERS = 256;
+  static constexpr uint16_t BUFFER_GROUP = 0;
+
+  // What a completion is for, in the low bits of its user_data; the rest is
+  // the connection's ID.
+  enum Op : uint64_t { ACCEPT, WAKE, RECV, SEND };
+  static constexpr int OP_BITS = 2;
+
+  UringEngine(int listener_fd, int wake_fd, MessageHandler on_message,
+              size_t max_message_size)
+      : IoEngine(listener_fd, wake_fd, std::move(on_message),
+                 max_message_size) {
+  }
+
+  // Sets up the rings, and registers the buffers. Returns false on error.
+  bool setup();
+
+  // Queues a submission, first submitting what's queued if the queue is full.
+  struct io_uring_sqe* get_sqe(uint64_t id, Op op);
+  // Submits what's queued, and waits for at least `wait_for` completions.
+  bool enter(unsigned wait_for);
+
+  void arm_accept();
+  void arm_wake();
+  void arm_recv(uint64_t id, Conn& conn);
+
+  void on_accept(int res, uint32_t flags);
+  void on_recv(uint64_t id, int res, uint32_t flags);
+  void on_send(uint64_t id, int res);
+
+  // Hands buffer `bid` back to the kernel to receive into.
+  void recycle(uint16_t bid);
+  // Forgets a closing connection once nothing is in flight on it.
+  void release(uint64_t id, Conn& conn);
+
+  int ring_fd = -1;
+  // The submission and completion rings (in one mapping), the submission
+  // entries, and pointers into them.
+  void* rings = MAP_FAILED;
+  size_t rings_size = 0;
+  struct io_uring_sqe* sqes = static_cast<struct io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size = 0;
+  unsigned* sq_head;
+  unsigned* sq_tail;
+  unsigned* sq_array;
+  unsigned sq_mask;
+  unsigned sq_entries;
+  unsigned* cq_head;
+  unsigned* cq_tail;
+  struct io_uring_cqe* cqes;
+  unsigned cq_mask;
+  // Submissions queued since the last io_uring_enter, and the tail they've
+  // taken the submission ring to.
+  unsigned to_submit = 0;
+  unsigned sq_tail_local = 0;
+
+  // The ring of buffers registered for receives, and the buffers themselves.
+  struct io_uring_buf_ring* buf_ring =
+      static_cast<struct io_uring_buf_ring*>(MAP_FAILED);
+  uint16_t buf_ring_tail = 0;
+  std::unique_ptr<std::byte[]> buffers;
+
+  // Where reads of the eventfd land.
+  uint64_t wake_count = 0;
+};
+
+std::unique_ptr<IoEngine> UringEngine::create(int listener_fd,
+                                              MessageHandler on_message,
+                                              size_t max_message_size) {
+  int wake_fd = eventfd(0, EFD_CLOEXEC);
+  if (wake_fd < 0) {
+    perror_color(RED, "eventfd");
+    return nullptr;
+  }
+  std::unique_ptr<UringEngine> engine(new UringEngine(
+      listener_fd, wake_fd, std::move(on_message), max_message_size));
+  if (!engine->setup()) return nullptr;
+  return engine;
+}
+
+bool UringEngine::setup() {
+  struct io_uring_params params = {};
+  this->ring_fd = sys_io_uring_setup(QUEUE_DEPTH, &params);
+  if (this->ring_fd < 0) {
+    perror_color(YELLOW, "io_uring_setup");
+    return false;
+  }
+  // Without these, completions could be dropped when the completion ring is
+  // full, and the rings would need separate mappings
+  if (!(params.features & IORING_FEAT_NODROP) ||
+      !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+    cerr_color(YELLOW, "io_uring lacks needed features.");
+    return false;
+  }
+
+  this->rings_size =
+      std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+               params.cq_off.cqes +
+                   params.cq_entries * sizeof(struct io_uring_cqe));
+  this->rings = mmap(nullptr, this->rings_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, this->ring_fd,
+                     IORING_OFF_SQ_RING);
+  this->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = mmap(nullptr, this->sqes_size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES);
+  this->sqes = static_cast<struct io_uring_sqe*>(sqes);
+  if (this->rings == MAP_FAILED || sqes == MAP_FAILED) {
+    perror_color(RED, "mmap");
+    return false;
+  }
+  auto* base = static_cast<std::byte*>(this->rings);
+  this->sq_head = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+  this->sq_tail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+  this->sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+  this->sq_mask = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+  this->sq_entries = params.sq_entries;
+  this->sq_tail_local = *this->sq_tail;
+  this->cq_head = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+  this->cq_tail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+  this->cqes =
+      reinterpret_cast<struct io_uring_cqe*>(base + params.cq_off.cqes);
+  this->cq_mask = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+
+  // Register the ring of buffers that receives pick from (Linux 5.19)
+  void* buf_ring = mmap(nullptr, N_BUFFERS * sizeof(struct io_uring_buf),
+                        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                        -1, 0);
+  if (buf_ring == MAP_FAILED) {
+    perror_color(RED, "mmap");
+    return false;
+  }
+  this->buf_ring = static_cast<struct io_uring_buf_ring*>(buf_ring);
+  struct io_uring_buf_reg reg = {};
+  reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring);
+  reg.ring_entries = N_BUFFERS;
+  reg.bgid = BUFFER_GROUP;
+  if (sys_io_uring_register(this->ring_fd, IORING_REGISTER_PBUF_RING, &reg,
+                            1) < 0) {
+    perror_color(YELLOW, "io_uring_register");
+    return false;
+  }
+  this->buffers.reset(new std::byte[N_BUFFERS * URING_BUFFER_SIZE]);
+  for (uint16_t bid = 0; bid < N_BUFFERS; bid++) this->recycle(bid);
+  return true;
+}
+
+UringEngine::~UringEngine() {
+  // Closing the ring cancels whatever is still in flight
+  if (this->ring_fd >= 0) close(this->ring_fd);
+  if (this->rings != MAP_FAILED) munmap(this->rings, this->rings_size);
+  if (this->sqes != MAP_FAILED) munmap(this->sqes, this->sqes_size);
+  if (this->buf_ring != MAP_FAILED) {
+    munmap(this->buf_ring, N_BUFFERS * sizeof(struct io_uring_buf));
+  }
+}
+
+struct io_uring_sqe* UringEngine::get_sqe(uint64_t id, Op op) {
+  unsigned head =
+      std::atomic_ref(*this->sq_head).load(std::memory_order_acquire);
+  if (this->sq_tail_local - head >= this->sq_entries) this->enter(0);
+
+  unsigned index = this->sq_tail_local & this->sq_mask;
+  struct io_uring_sqe* sqe = &this->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = id << OP_BITS | op;
+  this->sq_array[index] = index;
+  this->sq_tail_local++;
+  this->to_submit++;
+  return sqe;
+}
+
+bool UringEngine::enter(unsigned wait_for) {
+  // The kernel only reads the queued entries once it's told about them here
+  std::atomic_ref(*this->sq_tail)
+      .store(this->sq_tail_local, std::memory_order_release);
+  unsigned flags = wait_for > 0 ? IORING_ENTER_GETEVENTS : 0;
+  while (true) {
+    this->n_syscalls++;
+    int ret =
+        sys_io_uring_enter(this->ring_fd, this->to_submit, wait_for, flags);
+    if (ret >= 0) {
+      this->to_submit -= ret;
+      return true;
+    }
+    if (errno == EINTR) continue;
+    // Too many completions are waiting; handle them and come back
+    if (errno == EAGAIN || errno == EBUSY) return true;
+    perror_color(RED, "io_uring_enter");
+    return false;
+  }
+}
+
+void UringEngine::run() {
+  this->arm_accept();
+  this->arm_wake();
+  while (!this->stopping.load()) {
+    if (!this->enter(1)) return;
+
+    unsigned head = *this->cq_head;
+    unsigned tail =
+        std::atomic_ref(*this->cq_tail).load(std::memory_order_acquire);
+    for (; head != tail; head++) {
+      struct io_uring_cqe cqe = this->cqes[head & this->cq_mask];
+      std::atomic_ref(*this->cq_head)
+          .store(head + 1, std::memory_order_release);
+
+      uint64_t id = cqe.user_data >> OP_BITS;
+      switch (cqe.user_data & ((1 << OP_BITS) - 1)) {
+        case ACCEPT:
+          this->on_accept(cqe.res, cqe.flags);
+          break;
+        case WAKE:
+          this->wake_pending = false;
+          this->flush_responses();
+          this->arm_wake();
+          break;
+        case RECV:
+          this->on_recv(id, cqe.res, cqe.flags);
+          break;
+        case SEND:
+          this->on_send(id, cqe.res);
+          break;
+      }
+    }
+  }
+}
+
+void UringEngine::arm_accept() {
+  struct io_uring_sqe* sqe = this->get_sqe(0, ACCEPT);
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = this->listener_fd;
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->accept_flags = SOCK_CLOEXEC;
+}
+
+void UringEngine::arm_wake() {
+  struct io_uring_sqe* sqe = this->get_sqe(0, WAKE);
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = this->wake_fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&this->wake_count);
+  sqe->len = sizeof(this->wake_count);
+}
+
+void UringEngine::arm_recv(uint64_t id, Conn& conn) {
+  struct io_uring_sqe* sqe = this->get_sqe(id, RECV);
+  sqe->opcode = IORING_OP_RECV;
+  sqe->fd = conn.fd;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = BUFFER_GROUP;
+  conn.recv_armed = true;
+}
+
+void UringEngine::on_accept(int res, uint32_t flags) {
+  if (res >= 0) {
+    this->n_syscalls++;
+    set_nodelay(res);
+    uint64_t id = this->add_conn(res);
+    this->arm_recv(id, this->conns[id]);
+  } else if (res != -EINTR && res != -ECONNABORTED) {
+    // The listener was shut down, or we're out of file descriptors
+    if (!this->stopping) {
+      errno = -res;
+      perror_color(RED, "accept");
+    }
+    return;
+  }
+  if (!(flags & IORING_CQE_F_MORE)) this->arm_accept();
+}
+
+void UringEngine::on_recv(uint64_t id, int res, uint32_t flags) {
+  auto it = this->conns.find(id);
+  Conn* conn = it == this->conns.end() ? nullptr : &it->second;
+  if (flags & IORING_CQE_F_BUFFER) {
+    uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+    if (conn && !conn->closing && res > 0) {
+      this->received(id, *conn,
+                     this->buffers.get() + bid * URING_BUFFER_SIZE, res);
+    }
+    this->recycle(bid);
+  }
+  if (!conn) return;
+
+  if (!(flags & IORING_CQE_F_MORE)) conn->recv_armed = false;
+  if (res == 0 || (res < 0 && res != -ENOBUFS)) {
+    // The client closed the connection, or it broke
+    this->close_conn(id, *conn);
+  } else if (!conn->recv_armed && !conn->closing) {
+    // The kernel ended the multishot recv, e.g. because it ran out of
+    // buffers for a moment
+    this->arm_recv(id, *conn);
+  }
+  this->release(id, *conn);
+}
+
+void UringEngine::on_send(uint64_t id, int res) {
+  auto it = this->conns.find(id);
+  if (it == this->conns.end()) return;
+  Conn& conn = it->second;
+  conn.sending = false;
+  if (res < 0) {
+    this->close_conn(id, conn);
+  } else if (!conn.closing) {
+    conn.sent += res;
+    this->start_send(id, conn);
+  }
+  this->release(id, conn);
+}
+
+void UringEngine::start_send(uint64_t id, Conn& conn) {
+  if (conn.sent == MESSAGE_HEADER_SIZE + conn.out->sz) {
+    this->finished_sending(id, conn);
+    return;
+  }
+  this->prepare_send(conn);
+  struct io_uring_sqe* sqe = this->get_sqe(id, SEND);
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = conn.fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&conn.out_msg);
+  sqe->len = 1;
+  sqe->msg_flags = MSG_NOSIGNAL;
+  conn.sending = true;
+}
+
+void UringEngine::close_conn(uint64_t id, Conn& conn) {
+  if (conn.closing) return;
+  conn.closing = true;
+  // This ends the connection's multishot recv, after which it's released
+  this->n_syscalls++;
+  shutdown(conn.fd, SHUT_RDWR);
+}
+
+void UringEngine::release(uint64_t id, Conn& conn) {
+  if (!conn.closing || conn.recv_armed || conn.sending) return;
+  this->n_syscalls++;
+  close(conn.fd);
+  this->conns.erase(id);
+}
+
+void UringEngine::recycle(uint16_t bid) {
+  // Not `bufs[...]`: compiled as C++, the header's flexible array doesn't
+  // start at the beginning of the ring
+  struct io_uring_buf* buf =
+      reinterpret_cast<struct io_uring_buf*>(this->buf_ring) +
+      (this->buf_ring_tail & (N_BUFFERS - 1));
+  buf->addr = reinterpret_cast<uint64_t>(this->buffers.get() +
+                                         bid * URING_BUFFER_SIZE);
+  buf->len = URING_BUFFER_SIZE;
+  buf->bid = bid;
+  this->buf_ring_tail++;
+  std::atomic_ref(this->buf_ring->tail)
+      .store(this->buf_ring_tail, std::memory_order_release);
+}
+
+std::unique_ptr<IoEngine> IoEngine::create(IoEngineType type, int listener_fd,
+                                           MessageHandler on_message,
+                                           size_t max_message_size) {
+  if (type == IoEngineType::IO_URING) {
+    if (auto engine =
+            UringEngine::create(listener_fd, on_message, max_message_size)) {
+      return engine;
+    }
+    cerr_color(YELLOW, "io_uring is unavailable; falling back to epoll.");
+  }
+  return EpollEngine::create(listener_fd, std::move(on_message),
+                             max_message_size);
+}
@@ -0,0 +1,145 @@
+#ifndef IO_ENGINE_HPP
+#define IO_ENGINE_HPP
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "net/network_messages.hpp"
+
+// How a KvServer does its network I/O.
+enum class IoEngineType {
+  // Each worker blocks on one connection at a time, until the client closes
+  // it.
+  THREADS,
+  // One thread multiplexes all connections with epoll, and hands their
+  // requests to the workers.
+  EPOLL,
+  // The same, with io_uring (Linux 6.0 or later). Falls back to EPOLL where
+  // the kernel doesn't support it.
+  IO_URING,
+};
+
+/*
+ * An event loop doing the network I/O for all of a server's client
+ * connections on one thread: it accepts connections, receives messages and
+ * hands them to `on_message` (which queues them for the workers), and sends
+ * the responses that the workers pass to respond().
+ *
+ * A connection's messages are handed over one at a time: the next one waits
+ * until the previous one has been answered, so that responses go out in the
+ * order the requests came in.
+ */
+class IoEngine {
+ public:
+  using MessageHandler = std::function<void(uint64_t conn_id, Message&& msg)>;
+
+  // Creates an engine of type `type` (EPOLL or IO_URING) that accepts
+  // connections from `listener_fd`, and disconnects clients that send
+  // messages larger than `max_message_size`. Returns nullptr on error.
+  static std::unique_ptr<IoEngine> create(IoEngineType type, int listener_fd,
+                                          MessageHandler on_message,
+                                          size_t max_message_size);
+
+  virtual ~IoEngine();
+
+  // The type of the engine, after any fallback.
+  virtual IoEngineType type() const = 0;
+
+  // Runs the event loop until stop() is called.
+  virtual void run() = 0;
+  // Makes run() return. Connections are closed when the engine is destroyed.
+  void stop();
+
+  // Sends `msg` in response to the last message handed over from connection
+  // `conn_id`, or closes the connection if `msg` is nullptr. Can be called
+  // from any thread.
+  void respond(uint64_t conn_id, std::shared_ptr<const Message> msg);
+
+  // System calls made for network I/O so far, by the loop and by respond().
+  uint64_t syscalls() const {
+    return this->n_syscalls.load();
+  }
+
+  IoEngine(const IoEngine&) = delete;
+  IoEngine& operator=(const IoEngine&) = delete;
+
+ protected:
+  struct Conn {
+    int fd;
+    // Bytes received but not yet handed over, from `in_offset` on.
+    std::vector<std::byte> in;
+    size_t in_offset = 0;
+    // Whether a message has been handed over and not yet answered.
+    bool busy = false;
+    // The response being sent, and how much of it (header included) has
+    // been.
+    uint64_t out_header = 0;
+    std::shared_ptr<const Message> out;
+    size_t sent = 0;
+    // What's left of the response, for sendmsg.
+    struct iovec iov[2];
+    struct msghdr out_msg;
+    // Whether the connection is being closed.
+    bool closing = false;
+    // Whether a send is waiting for room in the socket (epoll) or in flight
+    // (io_uring), and whether a multishot recv is armed (io_uring).
+    bool sending = false;
+    bool recv_armed = false;
+  };
+
+  IoEngine(int listener_fd, int wake_fd, MessageHandler on_message,
+           size_t max_message_size);
+
+  // Starts tracking a new connection on `fd`, and returns its ID.
+  uint64_t add_conn(int fd);
+
+  // Appends bytes received on a connection to its input, and hands over its
+  // next message if that's complete and the last one has been answered.
+  void received(uint64_t id, Conn& conn, const std::byte* data, size_t len);
+  void dispatch(uint64_t id, Conn& conn);
+  // Points the connection's `out_msg` at what's left of its response.
+  void prepare_send(Conn& conn);
+  // Called once the connection's response has gone out in full.
+  void finished_sending(uint64_t id, Conn& conn);
+
+  // Starts sending the responses queued by respond() since the last call.
+  void flush_responses();
+
+  // Starts sending (what's left of) the connection's response.
+  virtual void start_send(uint64_t id, Conn& conn) = 0;
+  // Closes the connection. It stays in `conns`, marked as closing, until the
+  // engine is done with it: until the end of the loop iteration, or (with
+  // io_uring) until nothing is in flight on it.
+  virtual void close_conn(uint64_t id, Conn& conn) = 0;
+
+  int listener_fd;
+  // An eventfd that respond() and stop() use to wake the loop.
+  int wake_fd;
+  std::atomic<bool> stopping = false;
+  // Whether `wake_fd` has been signaled since the loop last handled it.
+  std::atomic<bool> wake_pending = false;
+  std::atomic<uint64_t> n_syscalls = 0;
+
+  std::unordered_map<uint64_t, Conn> conns;
+  uint64_t next_conn_id = 1;
+
+ private:
+  MessageHandler on_message;
+  size_t max_message_size;
+
+  // Responses queued by respond(), for the loop to send.
+  std::mutex responses_mtx;
+  std::vector<std::pair<uint64_t, std::shared_ptr<const Message>>> responses;
+};
+
+#endif /* end of include guard */
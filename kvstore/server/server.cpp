@@ -1,30 +1,148 @@
 #include "server.hpp"
 
+// The response to a request shed under load.
+static const ErrorResponse OVERLOADED_RESPONSE{"server overloaded",
+                                               ErrorCode::OVERLOADED};
+
 int KvServer::start() {
   this->is_stopped = false;
+  bool local = local_socket_path(address).has_value();
+  bool use_engine =
+      this->options.io_engine != IoEngineType::THREADS && !local;
+  if (this->options.shard_per_core && !use_engine) {
+    cerr_color(YELLOW, "Shard-per-core mode needs an I/O engine; running "
+                       "with one shared store instead");
+  }
+  bool sharded = this->options.shard_per_core && use_engine;
 
-  // Initialize KvStore
-  // TODO (Part B, Step 2): Change your underlying KvStore to the
-  // ConcurrentKvStore!
-  this->store = std::make_unique<SimpleKvStore>();
+  // Initialize KvStore (or each core's), recovering its contents from the
+  // latest snapshot and write-ahead log if persistence is enabled
+  if (sharded) {
+    size_t n_cores = std::max<uint64_t>(this->n_workers, 1);
+    this->n_workers = n_cores;
+    this->core_shards = std::make_unique<CoreShards>(n_cores);
+    this->cores.resize(n_cores);
+    for (size_t i = 0; i < n_cores; i++) {
+      std::string data_dir = this->options.data_dir.empty()
+                                 ? ""
+                                 : this->options.data_dir + "/core" +
+                                       std::to_string(i);
+      Core& core = this->cores[i];
+      core.store =
+          this->open_store(data_dir, this->options.max_memory / n_cores);
+      if (!core.store) return -1;
+      core.inbox.resize(n_cores);
+    }
+  } else {
+    this->store = this->open_store(this->options.data_dir,
+                                   this->options.max_memory);
+    if (!this->store) return -1;
+    // The transactions it had voted to commit hold their keys again
+    for (auto&& txn : this->store->PreparedTxns()) {
+      this->txns.prepare(txn.id, {txn.keys, txn.values}, txn.participants);
+    }
+  }
 
-  // Create listener socket, and start client listener
-  this->listener_fd = open_listener_socket(address);
-  if (this->listener_fd < 0) {
-    return -1;
+  // Create listener sockets, all on the same port. A Unix domain socket's
+  // path can only be bound once, so its acceptors share a single socket, and
+  // an I/O engine does all its accepting from one.
+  SocketOptions socket_options = this->options.socket_options;
+  size_t n_acceptors =
+      use_engine ? 1 : std::max<size_t>(this->options.n_acceptors, 1);
+  socket_options.reuse_port = n_acceptors > 1 && !local;
+  for (size_t i = 0; i < n_acceptors; i++) {
+    int listener_fd = local && i > 0
+                          ? this->listener_fds[0]
+                          : open_listener_socket(address, socket_options);
+    if (listener_fd < 0) {
+      for (int fd : this->listener_fds) close(fd);
+      this->listener_fds.clear();
+      return -1;
+    }
+    this->listener_fds.push_back(listener_fd);
   }
-  this->client_listener = std::thread(&KvServer::accept_clients_loop, this);
-  cout_color(BLUE, "Listening on: ", this->address);
 
-  // Initialize worker threads
-  this->workers.resize(this->n_workers);
-  this->conn_queues.resize(this->n_workers);
-  this->conn_queue_mtxs.resize(this->n_workers);
-  size_t i = 0;
-  for (auto&& worker : this->workers) {
-    worker = std::thread(&KvServer::work_loop, this, i);
-    i++;
+  // Workers allocate their own stats once pinned (see init_worker)
+  this->worker_stats.resize(this->n_workers);
+  this->workers_ready = std::make_unique<std::latch>(this->n_workers);
+  this->assign_worker_cpus();
+  this->started_at = steady_clock::now();
+  bool shedding = this->options.shed_target > 0ms;
+  if (use_engine) {
+    // The engine's loop receives requests and sends responses; the workers
+    // just process them
+    if (shedding) {
+      this->requests_codel = std::make_unique<CoDel>(
+          this->options.shed_target, this->options.shed_interval);
+      for (auto&& core : this->cores) {
+        core.codel = std::make_unique<CoDel>(this->options.shed_target,
+                                             this->options.shed_interval);
+      }
+    }
+    IoEngine::MessageHandler handler = [this](uint64_t conn_id,
+                                              Message&& msg) {
+      {
+        std::unique_lock lock(this->requests_mtx);
+        this->requests.push_back(
+            {conn_id, std::move(msg), CoDel::Clock::now()});
+      }
+      this->requests_cv.notify_one();
+    };
+    if (sharded) {
+      // Each connection is homed on a core, which gets its requests (the
+      // engine's loop is the only thread that queues them)
+      handler = [this](uint64_t conn_id, Message&& msg) {
+        Core& core = this->cores[conn_id % this->cores.size()];
+        core.requests.push({conn_id, std::move(msg), CoDel::Clock::now()});
+        core.wakeups.fetch_add(1, std::memory_order_release);
+        core.wakeups.notify_one();
+      };
+    }
+    this->io_engine =
+        IoEngine::create(this->options.io_engine, this->listener_fds[0],
+                         std::move(handler), this->options.max_message_size);
+    if (!this->io_engine) {
+      close(this->listener_fds[0]);
+      this->listener_fds.clear();
+      return -1;
+    }
+    for (size_t i = 0; i < this->n_workers; i++) {
+      this->workers.emplace_back(
+          sharded ? &KvServer::core_loop : &KvServer::engine_work_loop, this,
+          i);
+    }
+    this->workers_ready->wait();
+    this->io_thread = std::thread(&IoEngine::run, this->io_engine.get());
+  } else {
+    // Initialize worker threads
+    this->workers.resize(this->n_workers);
+    this->conn_queues.resize(this->n_workers);
+    this->conn_queue_mtxs.resize(this->n_workers);
+    this->conn_queue_codels.resize(this->n_workers);
+    if (shedding) {
+      for (auto&& codel : this->conn_queue_codels) {
+        codel = std::make_unique<CoDel>(this->options.shed_target,
+                                        this->options.shed_interval);
+      }
+    }
+    size_t i = 0;
+    for (auto&& worker : this->workers) {
+      worker = std::thread(&KvServer::work_loop, this, i);
+      i++;
+    }
+
+    // Only accept connections once there are queues to hand them to, and
+    // workers to take them
+    this->workers_ready->wait();
+    for (int listener_fd : this->listener_fds) {
+      this->client_listeners.emplace_back(&KvServer::accept_clients_loop, this,
+                                          listener_fd);
+    }
   }
+  if (!sharded) {
+    this->txn_resolver = std::thread(&KvServer::resolve_txns_loop, this);
+  }
+  cout_color(BLUE, "Listening on: ", this->address);
 
   // If shardcontroller address not empty, connect to shardcontroller,
   // tell the shardcontroller that the server has joined, and start query thread
@@ -32,14 +150,14 @@ int KvServer::start() {
     this->shardcontroller_conn =
         connect_to_server(this->shardcontroller_address);
     if (!this->shardcontroller_conn) {
-      close(this->listener_fd);
+      for (int fd : this->listener_fds) close(fd);
       return -1;
     }
 
     this->shardcontroller_querier_conn =
         connect_to_server(this->shardcontroller_address);
     if (!this->shardcontroller_querier_conn) {
-      close(this->listener_fd);
+      for (int fd : this->listener_fds) close(fd);
       return -1;
     }
 
@@ -58,22 +176,41 @@ int KvServer::start() {
 void KvServer::stop() {
   this->is_stopped = true;
 
-  // Close client listener
-  shutdown(this->listener_fd, SHUT_RDWR);
-  cout_color(BLUE, "Joining client listener thread...");
-  this->client_listener.join();
+  // Stop the I/O engine's loop, and wake the workers waiting for requests
+  if (this->io_engine) {
+    this->io_engine->stop();
+    this->io_thread.join();
+    std::unique_lock lock(this->requests_mtx);
+    this->requests_cv.notify_all();
+  }
+  for (auto&& core : this->cores) {
+    core.wakeups.fetch_add(1, std::memory_order_release);
+    core.wakeups.notify_all();
+  }
+
+  // Close client listeners
+  for (int listener_fd : this->listener_fds) {
+    shutdown(listener_fd, SHUT_RDWR);
+  }
+  cout_color(BLUE, "Joining client listener threads...");
+  for (auto&& thr : this->client_listeners) thr.join();
+  if (auto path = local_socket_path(this->address)) unlink(path->c_str());
 
   // Stop connection queue, and close & join workers
-  for (size_t i = 0; i < this->n_workers; i++) {
+  for (size_t i = 0; i < this->conn_queues.size(); i++) {
     auto& queue = this->conn_queues[i];
     this->conn_queue_mtxs[i].lock();
-    for (auto&& client : queue) {
-      cout_color(BLUE, "Closing connection from ", client->address);
-      client->shutdown();
+    for (auto&& queued : queue) {
+      cout_color(BLUE, "Closing connection from ", queued.conn->address);
+      queued.conn->shutdown();
     }
     this->conn_queue_mtxs[i].unlock();
   }
   for (auto&& thr : this->workers) thr.join();
+  if (this->txn_resolver.joinable()) this->txn_resolver.join();
+  flush_logs();
+  // Closes the engine's connections
+  this->io_engine.reset();
 
   // If shardcontroller exists, tell shardcontroller the server is leaving,
   // join shardcontroller querier thread, and close shardcontroller connection
@@ -190,21 +327,21 @@ bool KvServer::process_config() {
 /* === INTERNALS: DO NOT MODIFY BELOW THIS LINE ===  */
 /* ==================================================*/
 
-void KvServer::accept_clients_loop() {
-  size_t next_worker = 0;
+void KvServer::accept_clients_loop(int listener_fd) {
   // While the server is not stopped, accept clients from the listener socket,
   // then add them to the work queue.
   while (!this->is_stopped.load()) {
-    std::shared_ptr<ClientConn> client = accept_client(this->listener_fd);
+    std::shared_ptr<ClientConn> client = accept_client(listener_fd);
     if (!client) {
       return;
     }
-    cout_color(BLUE, "Received client connection from ", client->address,
-               " on socket ", client->fd);
-    this->conn_queue_mtxs[next_worker].lock();
-    this->conn_queues[next_worker].push_back(client);
-    this->conn_queue_mtxs[next_worker].unlock();
-    next_worker = (next_worker + 1) % this->n_workers;
+    client->max_message_size = this->options.max_message_size;
+    log_debug("Received client connection from ", client->address,
+              " on socket ", client->fd);
+    size_t worker = this->pick_worker(client->fd);
+    this->conn_queue_mtxs[worker].lock();
+    this->conn_queues[worker].push_back({client, CoDel::Clock::now()});
+    this->conn_queue_mtxs[worker].unlock();
   }
 }
 
@@ -212,77 +349,582 @@ void KvServer::work_loop(size_t worker_id) {
   // Each worker thread will run this function. While the server is not stopped,
   // pop an accepted connection off of the work queue, and process client
   // requests until the client closes the connection.
+  this->init_worker(worker_id);
+  HotKeyCache hot_keys;
   while (!this->is_stopped) {
     std::shared_ptr<ClientConn> client;
+    bool shed;
     // if this returns false, queue stopped
     this->conn_queue_mtxs[worker_id].lock();
-    if (!this->conn_queues[worker_id].empty()) {
-      client = this->conn_queues[worker_id].front();
-      this->conn_queues[worker_id].pop_front();
+    auto& queue = this->conn_queues[worker_id];
+    if (!queue.empty()) {
+      client = std::move(queue.front().conn);
+      shed = this->should_shed(worker_id,
+                               this->conn_queue_codels[worker_id].get(),
+                               queue.front().queued_at, queue.size() - 1);
+      queue.pop_front();
       this->conn_queue_mtxs[worker_id].unlock();
     } else {
       this->conn_queue_mtxs[worker_id].unlock();
       continue;
     }
 
+    if (shed) {
+      // Tell the client to back off right away, rather than wait for a request
+      // that it may be slow to send (or never send)
+      client->reject(OVERLOADED_RESPONSE);
+      this->worker_stats[worker_id]->bytes_in += client->bytes_received;
+      this->worker_stats[worker_id]->bytes_out += client->bytes_sent;
+      continue;
+    }
+
+    // The connection's bytes already recorded
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
     while (true) {
-      std::optional<Request> req = client->recv_request();
+      std::optional<RequestOrView> req = client->recv_request_or_view();
       if (!req) {
         client->close();
         break;
       }
-      Response res = this->process_request(*req);
-      if (auto* error_res = std::get_if<ErrorResponse>(&res)) {
-        cerr_color(RED, "Request on server ", this->address,
-                   " failed: ", error_res->msg);
+      auto start = steady_clock::now();
+      auto* view = std::get_if<ReadRequestView>(&*req);
+      OpType op = view ? op_type(*view) : op_type(std::get<Request>(*req));
+
+      // Cached responses are serialized in the default wire format
+      std::shared_ptr<const Message> cached;
+      auto* get_req = view ? std::get_if<GetRequestView>(view) : nullptr;
+      if (get_req && client->wire_format.load() == WIRE_FORMAT) {
+        cached = this->cached_get(get_req->key, hot_keys);
+      }
+      bool sent;
+      if (cached) {
+        sent = client->send_serialized(*cached);
+      } else {
+        Response res =
+            view ? this->process_read_request(*view, *this->store)
+                 : this->process_request(std::move(std::get<Request>(*req)));
+        if (auto* error_res = std::get_if<ErrorResponse>(&res)) {
+          log_sampled(LogLevel::WARN, "Request on server ", this->address,
+                      " failed: ", error_res->msg);
+        }
+        sent = client->send_response(res);
       }
-      if (!client->send_response(res)) {
+      if (!sent) {
         client->close();
         break;
       }
+
+      uint64_t received = client->bytes_received;
+      uint64_t sent_bytes = client->bytes_sent;
+      this->record_request(worker_id, op, start, received - bytes_in,
+                           sent_bytes - bytes_out);
+      bytes_in = received;
+      bytes_out = sent_bytes;
+    }
+  }
+}
+
+void KvServer::engine_work_loop(size_t worker_id) {
+  // Each worker thread will run this function. While the server is not stopped,
+  // pop a request that the I/O engine received, and hand it the response.
+  this->init_worker(worker_id);
+  HotKeyCache hot_keys;
+  // Shed requests are answered in the default wire format, which every client
+  // reads
+  static const auto overloaded = std::make_shared<const Message>(
+      *serialize_response(OVERLOADED_RESPONSE));
+  while (true) {
+    std::unique_lock lock(this->requests_mtx);
+    this->requests_cv.wait(lock, [this] {
+      return this->is_stopped || !this->requests.empty();
+    });
+    if (this->is_stopped) return;
+    auto [conn_id, msg, queued_at] = std::move(this->requests.front());
+    this->requests.pop_front();
+    bool shed = this->should_shed(worker_id, this->requests_codel.get(),
+                                  queued_at, this->requests.size());
+    lock.unlock();
+    WorkerStats& stats = *this->worker_stats[worker_id];
+    stats.bytes_in += msg.size();
+    if (shed) {
+      stats.bytes_out += MESSAGE_HEADER_SIZE + overloaded->sz;
+      this->io_engine->respond(conn_id, overloaded);
+      continue;
+    }
+
+    auto start = steady_clock::now();
+    WireFormat format;
+    // Read-path requests are handled as views into `msg`, which outlives them
+    std::optional<RequestOrView> req;
+    if (auto view = deserialize_read_request(msg, &format)) {
+      req = std::move(*view);
+    } else if (auto owned = deserialize_request(msg, &format)) {
+      req = std::move(*owned);
+    } else {
+      log_error("Error deserializing request.");
+      this->io_engine->respond(conn_id, nullptr);
+      continue;
+    }
+    auto* view = std::get_if<ReadRequestView>(&*req);
+    OpType op = view ? op_type(*view) : op_type(std::get<Request>(*req));
+
+    // Cached responses are serialized in the default wire format
+    auto* get_req = view ? std::get_if<GetRequestView>(view) : nullptr;
+    if (get_req && format == WIRE_FORMAT) {
+      if (auto cached = this->cached_get(get_req->key, hot_keys)) {
+        uint64_t size = MESSAGE_HEADER_SIZE + cached->sz;
+        this->io_engine->respond(conn_id, std::move(cached));
+        this->record_request(worker_id, op, start, 0, size);
+        continue;
+      }
     }
+
+    Response res =
+        view ? this->process_read_request(*view, *this->store)
+             : this->process_request(std::move(std::get<Request>(*req)));
+    if (auto* error_res = std::get_if<ErrorResponse>(&res)) {
+      log_sampled(LogLevel::WARN, "Request on server ", this->address,
+                  " failed: ", error_res->msg);
+    }
+    std::optional<Message> out = serialize_response(res, format);
+    if (!out) {
+      log_error("Error serializing response.");
+      this->io_engine->respond(conn_id, nullptr);
+      continue;
+    }
+    uint64_t size = MESSAGE_HEADER_SIZE + out->sz;
+    this->io_engine->respond(conn_id,
+                             std::make_shared<const Message>(std::move(*out)));
+    this->record_request(worker_id, op, start, 0, size);
   }
 }
 
-bool KvServer::responsible_for(const std::string& key) {
+void KvServer::core_loop(size_t core_id) {
+  this->init_worker(core_id);
+  Core& core = this->cores[core_id];
+  WorkerStats& stats = *this->worker_stats[core_id];
+  static const auto overloaded = std::make_shared<const Message>(
+      *serialize_response(OVERLOADED_RESPONSE));
+
+  // Requests homed on this core that are waiting for other cores' parts or
+  // locks, by id. Only this core touches them, so they need no locks.
+  struct Pending {
+    uint64_t conn_id;
+    WireFormat format;
+    OpType op;
+    steady_clock::time_point start;
+    uint64_t scan_limit;
+    std::vector<CoreShards::Part> parts;
+    size_t n_waiting;
+    // For a MultiPut or MultiGet of several cores' keys, whether it locks
+    // them exclusively, and the next part whose core it asks to lock
+    bool exclusive = false;
+    size_t next_lock = 0;
+  };
+  std::unordered_map<uint64_t, Pending> pending;
+  uint64_t next_id = 0;
+
+  // This core's lock (see KvServer::core_loop), and the requests waiting
+  // for it, by home core and id. They get it in the order they asked, so
+  // that a stream of MultiGets can't starve a MultiPut.
+  struct LockWaiter {
+    size_t home;
+    uint64_t id;
+    bool exclusive;
+  };
+  size_t n_readers = 0;
+  bool writer = false;
+  std::deque<LockWaiter> lock_waiters;
+
+  auto grant = [&](const LockWaiter& waiter) {
+    if (waiter.exclusive) {
+      writer = true;
+    } else {
+      n_readers++;
+    }
+    this->send_to_core(core_id, waiter.home,
+                       {CoreMessage::LOCKED, waiter.id, 0, {}, {}});
+  };
+  auto can_grant = [&](const LockWaiter& waiter) {
+    return !writer && (!waiter.exclusive || n_readers == 0);
+  };
+  auto lock = [&](const LockWaiter& waiter) {
+    if (lock_waiters.empty() && can_grant(waiter)) {
+      grant(waiter);
+    } else {
+      lock_waiters.push_back(waiter);
+    }
+  };
+  auto unlock = [&] {
+    if (writer) {
+      writer = false;
+    } else {
+      n_readers--;
+    }
+    while (!lock_waiters.empty() && can_grant(lock_waiters.front())) {
+      grant(lock_waiters.front());
+      lock_waiters.pop_front();
+    }
+  };
+
+  // Asks the next core that a multi-core request needs to lock itself, or
+  // once they all have, has each apply its part and unlock
+  auto lock_next = [&](uint64_t id) {
+    Pending& request = pending.at(id);
+    if (request.next_lock < request.parts.size()) {
+      size_t core = request.parts[request.next_lock++].core;
+      this->send_to_core(core_id, core,
+                         {CoreMessage::LOCK, id, 0, {}, {},
+                          request.exclusive});
+      return;
+    }
+    for (size_t i = 0; i < request.parts.size(); i++) {
+      this->send_to_core(core_id, request.parts[i].core,
+                         {CoreMessage::COMMIT, id, i,
+                          std::move(request.parts[i].req), {}});
+    }
+    request.n_waiting = request.parts.size();
+  };
+
+  auto respond = [&](uint64_t conn_id, WireFormat format, OpType op,
+                     steady_clock::time_point start, const Response& res) {
+    if (auto* error_res = std::get_if<ErrorResponse>(&res)) {
+      log_sampled(LogLevel::WARN, "Request on server ", this->address,
+                  " failed: ", error_res->msg);
+    }
+    std::optional<Message> out = serialize_response(res, format);
+    if (!out) {
+      log_error("Error serializing response.");
+      this->io_engine->respond(conn_id, nullptr);
+      return;
+    }
+    uint64_t size = MESSAGE_HEADER_SIZE + out->sz;
+    this->io_engine->respond(conn_id,
+                             std::make_shared<const Message>(std::move(*out)));
+    this->record_request(core_id, op, start, 0, size);
+  };
+
+  while (true) {
+    // Read before looking at the queues, so that anything queued after they
+    // were found empty wakes the core back up
+    uint32_t wakeups = core.wakeups.load(std::memory_order_acquire);
+    if (this->is_stopped) return;
+    bool idle = true;
+
+    // Other cores' messages first, so that requests already under way finish
+    // before new ones start
+    for (size_t from = 0; from < core.inbox.size(); from++) {
+      while (std::optional<CoreMessage> msg = core.inbox[from].pop()) {
+        idle = false;
+        if (msg->kind == CoreMessage::LOCK) {
+          lock({from, msg->id, msg->exclusive});
+          continue;
+        } else if (msg->kind == CoreMessage::LOCKED) {
+          lock_next(msg->id);
+          continue;
+        } else if (msg->kind != CoreMessage::REPLY) {
+          msg->res = this->process_request(std::move(msg->req), *core.store);
+          if (msg->kind == CoreMessage::COMMIT) unlock();
+          msg->kind = CoreMessage::REPLY;
+          this->send_to_core(core_id, from, std::move(*msg));
+          continue;
+        }
+        auto it = pending.find(msg->id);
+        Pending& request = it->second;
+        request.parts[msg->part].res = std::move(msg->res);
+        if (--request.n_waiting > 0) continue;
+        respond(request.conn_id, request.format, request.op, request.start,
+                CoreShards::merge(request.parts, request.scan_limit));
+        pending.erase(it);
+      }
+    }
+
+    while (std::optional<QueuedRequest> queued = core.requests.pop()) {
+      idle = false;
+      auto& [conn_id, msg, queued_at] = *queued;
+      stats.bytes_in += msg.size();
+      if (this->should_shed(core_id, core.codel.get(), queued_at,
+                            core.requests.size())) {
+        stats.bytes_out += MESSAGE_HEADER_SIZE + overloaded->sz;
+        this->io_engine->respond(conn_id, overloaded);
+        continue;
+      }
+
+      auto start = steady_clock::now();
+      WireFormat format;
+      std::optional<Request> req = deserialize_request(msg, &format);
+      if (!req) {
+        log_error("Error deserializing request.");
+        this->io_engine->respond(conn_id, nullptr);
+        continue;
+      }
+      OpType op = op_type(*req);
+      if (std::holds_alternative<PrepareRequest>(*req) ||
+          std::holds_alternative<CommitRequest>(*req) ||
+          std::holds_alternative<AbortRequest>(*req) ||
+          std::holds_alternative<TxnStatusRequest>(*req)) {
+        respond(conn_id, format, op, start,
+                ErrorResponse{"transactions aren't supported in "
+                              "shard-per-core mode"});
+        continue;
+      }
+
+      // Process this core's part now, and send the rest to their cores
+      auto* scan_req = std::get_if<ScanRangeRequest>(&*req);
+      uint64_t scan_limit = scan_req ? scan_req->limit : 0;
+      bool is_multiput = std::holds_alternative<MultiPutRequest>(*req);
+      bool is_multiget = std::holds_alternative<MultiGetRequest>(*req);
+      std::vector<CoreShards::Part> parts =
+          this->core_shards->split(std::move(*req), core_id);
+      uint64_t id = next_id++;
+      if (parts.size() > 1 && (is_multiput || is_multiget)) {
+        // Lock the cores, this one included, before any applies its part
+        pending.emplace(id, Pending{conn_id, format, op, start, scan_limit,
+                                    std::move(parts), 0, is_multiput});
+        lock_next(id);
+        continue;
+      }
+      size_t n_waiting = 0;
+      for (size_t i = 0; i < parts.size(); i++) {
+        if (parts[i].core == core_id) {
+          parts[i].res =
+              this->process_request(std::move(parts[i].req), *core.store);
+        } else {
+          this->send_to_core(core_id, parts[i].core,
+                             {CoreMessage::PART, id, i,
+                              std::move(parts[i].req), {}});
+          n_waiting++;
+        }
+      }
+      if (n_waiting == 0) {
+        respond(conn_id, format, op, start,
+                CoreShards::merge(parts, scan_limit));
+      } else {
+        pending.emplace(id, Pending{conn_id, format, op, start, scan_limit,
+                                    std::move(parts), n_waiting});
+      }
+    }
+
+    if (idle) core.wakeups.wait(wakeups, std::memory_order_acquire);
+  }
+}
+
+void KvServer::send_to_core(size_t from, size_t to, CoreMessage msg) {
+  Core& core = this->cores[to];
+  core.inbox[from].push(std::move(msg));
+  core.wakeups.fetch_add(1, std::memory_order_release);
+  core.wakeups.notify_one();
+}
+
+bool KvServer::should_shed(size_t worker_id, CoDel* codel,
+                           CoDel::Clock::time_point queued_at,
+                           size_t remaining) {
+  auto now = CoDel::Clock::now();
+  WorkerStats& stats = *this->worker_stats[worker_id];
+  stats.queue_delay_us = duration_cast<microseconds>(now - queued_at).count();
+  stats.queue_wait.record(now - queued_at);
+  size_t max_depth = this->options.max_queue_depth;
+  bool shed = (codel && codel->shed(queued_at, now, remaining)) ||
+              (max_depth > 0 && remaining >= max_depth);
+  if (shed) stats.n_shed++;
+  return shed;
+}
+
+void KvServer::assign_worker_cpus() {
+  this->pinned_cpus.assign(this->n_workers, {});
+  this->node_workers.clear();
+  if (this->options.pin_workers == WorkerPinning::NONE) return;
+
+  std::vector<int> cpus = this->options.worker_cpus.empty()
+                              ? allowed_cpus()
+                              : this->options.worker_cpus;
+  this->topology = NumaTopology::detect(cpus);
+  size_t n_nodes = this->topology.node_cpus.size();
+  if (n_nodes == 0) return;
+  this->node_workers.resize(n_nodes);
+  for (size_t i = 0; i < this->n_workers; i++) {
+    // Round robin over the nodes, then over each node's CPUs
+    size_t node = i % n_nodes;
+    const std::vector<int>& node_cpus = this->topology.node_cpus[node];
+    if (this->options.pin_workers == WorkerPinning::CORES) {
+      this->pinned_cpus[i] = {node_cpus[(i / n_nodes) % node_cpus.size()]};
+    } else {
+      this->pinned_cpus[i] = node_cpus;
+    }
+    this->node_workers[node].push_back(i);
+  }
+}
+
+void KvServer::init_worker(size_t worker_id) {
+  std::vector<int>& cpus = this->pinned_cpus[worker_id];
+  if (!cpus.empty() && !pin_thread(cpus)) {
+    cerr_color(YELLOW, "Failed to pin worker ", worker_id,
+               " to its CPUs; leaving it unpinned");
+    cpus.clear();
+  }
+  // Memory is allocated on the node of the thread that first touches it, so
+  // the worker allocates what it uses most: its stats, and the first block of
+  // its connection queue (its hot key cache is a local of its loop).
+  this->worker_stats[worker_id] = std::make_unique<WorkerStats>();
+  if (worker_id < this->conn_queues.size()) {
+    this->conn_queues[worker_id] = std::deque<QueuedConn>();
+  }
+  this->workers_ready->count_down();
+}
+
+size_t KvServer::pick_worker(int fd) {
+  size_t next = this->next_worker++;
+  if (this->options.steer_connections && !this->node_workers.empty()) {
+    // The CPU that handled the connection's packets, if the kernel knows it
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (getsockopt(fd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0 &&
+        cpu >= 0) {
+      std::optional<size_t> node = this->topology.node_of(cpu);
+      if (node && !this->node_workers[*node].empty()) {
+        const std::vector<size_t>& workers = this->node_workers[*node];
+        return workers[next % workers.size()];
+      }
+    }
+  }
+  return next % this->n_workers;
+}
+
+std::unique_ptr<ConcurrentKvStore> KvServer::open_store(
+    const std::string& data_dir, size_t max_memory) {
+  auto store = std::make_unique<ConcurrentKvStore>(std::hash<std::string>(),
+                                                   this->options.n_buckets);
+  store->SetMemoryLimit(max_memory);
+  store->EnableCompression(this->options.compress_threshold);
+  if (this->options.ordered_index) store->EnableOrderedIndex();
+  if (!data_dir.empty()) {
+    PersistenceOptions persistence{data_dir, this->options.wal_sync,
+                                   this->options.wal_sync_interval,
+                                   this->options.snapshot_interval};
+    if (!store->EnablePersistence(persistence)) {
+      cerr_color(RED, "Failed to recover store from ", data_dir);
+      return nullptr;
+    }
+    cout_color(BLUE, "Recovered store from ", data_dir);
+  }
+  return store;
+}
+
+std::vector<ConcurrentKvStore*> KvServer::stores() {
+  std::vector<ConcurrentKvStore*> stores;
+  if (this->store) stores.push_back(this->store.get());
+  for (auto&& core : this->cores) stores.push_back(core.store.get());
+  return stores;
+}
+
+bool KvServer::responsible_for(std::string_view key) {
   // For Concurrent Store, no shardcontroller exists, so no-op
   if (this->shardcontroller_address.empty()) return true;
 
   std::shared_lock lock(this->config_mtx);
-  auto server = this->config.get_server(key);
+  auto server = this->config.get_server(std::string(key));
   if (!server) return false;
   return *server == this->address;
 }
 
-bool KvServer::responsible_for(const std::vector<std::string>& keys) {
+template <typename Key>
+bool KvServer::responsible_for(const std::vector<Key>& keys) {
   // For Concurrent Store, no shardcontroller exists, so no-op
   if (this->shardcontroller_address.empty()) return true;
 
   std::shared_lock lock(this->config_mtx);
   for (auto&& k : keys) {
-    auto server = this->config.get_server(k);
+    auto server = this->config.get_server(std::string(k));
     if (!server) return false;
     if (*server != this->address) return false;
   }
   return true;
 }
 
+// The keys that `req` reads or writes, if it's a single- or multi-key request.
+static std::vector<std::string_view> accessed_keys(const Request& req) {
+  if (auto* r = std::get_if<GetRequest>(&req)) return {r->key};
+  if (auto* r = std::get_if<PutRequest>(&req)) return {r->key};
+  if (auto* r = std::get_if<AppendRequest>(&req)) return {r->key};
+  if (auto* r = std::get_if<DeleteRequest>(&req)) return {r->key};
+  if (auto* r = std::get_if<MultiGetRequest>(&req)) {
+    return {r->keys.begin(), r->keys.end()};
+  }
+  if (auto* r = std::get_if<MultiPutRequest>(&req)) {
+    return {r->keys.begin(), r->keys.end()};
+  }
+  if (auto* r = std::get_if<CasRequest>(&req)) return {r->key};
+  if (auto* r = std::get_if<IncrRequest>(&req)) return {r->key};
+  if (auto* r = std::get_if<PutIfAbsentRequest>(&req)) return {r->key};
+  return {};
+}
+// Views of `req`'s own keys, so nothing is copied.
+static std::span<const std::string_view> accessed_keys(
+    const ReadRequestView& req) {
+  if (auto* r = std::get_if<GetRequestView>(&req)) return {&r->key, 1};
+  if (auto* r = std::get_if<DeleteRequestView>(&req)) return {&r->key, 1};
+  if (auto* r = std::get_if<MultiGetRequestView>(&req)) return r->keys;
+  return {};
+}
+
+// A view of `req`, if it's one that process_read_request handles.
+static std::optional<ReadRequestView> view_of(const Request& req) {
+  if (auto* r = std::get_if<GetRequest>(&req)) return GetRequestView{r->key};
+  if (auto* r = std::get_if<DeleteRequest>(&req)) {
+    return DeleteRequestView{r->key};
+  }
+  if (auto* r = std::get_if<MultiGetRequest>(&req)) {
+    return MultiGetRequestView{{r->keys.begin(), r->keys.end()}};
+  }
+  if (auto* r = std::get_if<ScanRangeRequest>(&req)) {
+    return ScanRangeRequestView{r->start, r->end, r->limit};
+  }
+  return std::nullopt;
+}
+
+KvServer::OpType KvServer::op_type(const Request& req) {
+  if (std::holds_alternative<GetRequest>(req)) return OP_GET;
+  if (std::holds_alternative<PutRequest>(req)) return OP_PUT;
+  if (std::holds_alternative<AppendRequest>(req)) return OP_APPEND;
+  if (std::holds_alternative<DeleteRequest>(req)) return OP_DELETE;
+  if (std::holds_alternative<MultiGetRequest>(req)) return OP_MULTI_GET;
+  if (std::holds_alternative<MultiPutRequest>(req)) return OP_MULTI_PUT;
+  return OP_OTHER;
+}
+
+KvServer::OpType KvServer::op_type(const ReadRequestView& req) {
+  if (std::holds_alternative<GetRequestView>(req)) return OP_GET;
+  if (std::holds_alternative<DeleteRequestView>(req)) return OP_DELETE;
+  if (std::holds_alternative<MultiGetRequestView>(req)) return OP_MULTI_GET;
+  return OP_OTHER;
+}
+
 Response KvServer::process_request(Request req) {
+  return this->process_request(std::move(req), *this->store);
+}
+
+Response KvServer::process_request(Request req, ConcurrentKvStore& store) {
+  if (std::holds_alternative<PrepareRequest>(req) ||
+      std::holds_alternative<CommitRequest>(req) ||
+      std::holds_alternative<AbortRequest>(req) ||
+      std::holds_alternative<TxnStatusRequest>(req)) {
+    return this->process_txn_request(req);
+  }
+  if (std::optional<ReadRequestView> view = view_of(req)) {
+    return this->process_read_request(*view, store);
+  }
+  // While a transaction is prepared, its keys are off limits, so that nobody
+  // sees its writes on one server but not yet on another
+  if (!this->txns.empty() && this->txns.is_locked(accessed_keys(req))) {
+    return ErrorResponse{"key is locked by a pending transaction"};
+  }
+
   Response res;
-  if (auto* get_req = std::get_if<GetRequest>(&req)) {
-    bool responsible = this->responsible_for(get_req->key);
-    GetResponse get_res;
-    if (responsible && this->store->Get(get_req, &get_res)) {
-      res = get_res;
-    } else {
-      res = ErrorResponse{
-          !responsible ? std::string("server not responsible for key")
-                       : std::string("key does not exist in the KVStore")};
-    }
-  } else if (auto* put_req = std::get_if<PutRequest>(&req)) {
+  if (auto* put_req = std::get_if<PutRequest>(&req)) {
     bool responsible = this->responsible_for(put_req->key);
     PutResponse put_res;
-    if (responsible && this->store->Put(put_req, &put_res)) {
+    if (responsible && store.Put(put_req, &put_res)) {
       res = put_res;
     } else {
       // Put should never fail
@@ -293,49 +935,289 @@ Response KvServer::process_request(Request req) {
   } else if (auto* append_req = std::get_if<AppendRequest>(&req)) {
     bool responsible = this->responsible_for(append_req->key);
     AppendResponse append_res;
-    if (responsible && this->store->Append(append_req, &append_res)) {
+    if (responsible && store.Append(append_req, &append_res)) {
       res = append_res;
     } else {
       res = ErrorResponse{!responsible
                               ? std::string("server not responsible for key")
                               : std::string("internal KVStore error")};
     }
-  } else if (auto* delete_req = std::get_if<DeleteRequest>(&req)) {
+  } else if (auto* multiput_req = std::get_if<MultiPutRequest>(&req)) {
+    bool responsible = this->responsible_for(multiput_req->keys);
+    MultiPutResponse multiput_res;
+    if (responsible && store.MultiPut(multiput_req, &multiput_res)) {
+      res = multiput_res;
+    } else {
+      res = ErrorResponse{!responsible
+                              ? std::string("server not responsible for key(s)")
+                              : std::string("internal KVStore error")};
+    }
+  } else if (auto* cas_req = std::get_if<CasRequest>(&req)) {
+    bool responsible = this->responsible_for(cas_req->key);
+    CasResponse cas_res;
+    if (responsible && store.Cas(cas_req, &cas_res)) {
+      res = cas_res;
+    } else {
+      res = ErrorResponse{!responsible
+                              ? std::string("server not responsible for key")
+                              : std::string("internal KVStore error")};
+    }
+  } else if (auto* incr_req = std::get_if<IncrRequest>(&req)) {
+    IncrResponse incr_res;
+    IncrError error;
+    if (!this->responsible_for(incr_req->key)) {
+      res = ErrorResponse{std::string("server not responsible for key")};
+    } else if (store.Incr(incr_req, &incr_res, &error)) {
+      res = incr_res;
+    } else if (error == IncrError::NOT_AN_INTEGER) {
+      res = ErrorResponse{std::string("value is not an integer")};
+    } else if (error == IncrError::OUT_OF_RANGE) {
+      res = ErrorResponse{std::string("the result would overflow")};
+    } else {
+      res = ErrorResponse{std::string("internal KVStore error")};
+    }
+  } else if (auto* absent_req = std::get_if<PutIfAbsentRequest>(&req)) {
+    bool responsible = this->responsible_for(absent_req->key);
+    PutIfAbsentResponse absent_res;
+    if (responsible && store.PutIfAbsent(absent_req, &absent_res)) {
+      res = absent_res;
+    } else {
+      res = ErrorResponse{!responsible
+                              ? std::string("server not responsible for key")
+                              : std::string("internal KVStore error")};
+    }
+  } else if (auto* owner_req = std::get_if<DeleteByOwnerRequest>(&req)) {
+    // Unlike other requests, this one isn't limited to the keys the server is
+    // responsible for: a copy of the user's data that's left over from a move
+    // has to go too
+    DeleteByOwnerResponse owner_res;
+    if (store.DeleteByOwner(owner_req, &owner_res)) {
+      res = owner_res;
+    } else {
+      res = ErrorResponse{std::string("internal KVStore error")};
+    }
+  } else if (auto* batch_req = std::get_if<BatchRequest>(&req)) {
+    // Each op goes through process_request like a standalone request would,
+    // so it gets the same checks; only the framing and syscalls are shared
+    BatchResponse batch_res;
+    batch_res.results.reserve(batch_req->ops.size());
+    for (auto&& op : batch_req->ops) {
+      Response op_res = std::visit(
+          [&](auto&& op_req) {
+            return this->process_request(std::move(op_req), store);
+          },
+          op);
+      batch_res.results.push_back(std::visit(
+          [](auto&& r) -> BatchResult {
+            if constexpr (std::is_constructible_v<BatchResult, decltype(r)>) {
+              return std::move(r);
+            } else {
+              throw std::logic_error{"invalid variant!"};
+            }
+          },
+          std::move(op_res)));
+    }
+    res = std::move(batch_res);
+  } else if (std::holds_alternative<StatsRequest>(req)) {
+    res = this->stats();
+  } else {
+    throw std::logic_error{"invalid variant!"};
+  }
+  return res;
+}
+
+Response KvServer::process_read_request(const ReadRequestView& req,
+                                        ConcurrentKvStore& store) {
+  // See process_request; the keys are only copied if there's a transaction
+  // that could lock them
+  if (!this->txns.empty() && this->txns.is_locked(accessed_keys(req))) {
+    return ErrorResponse{"key is locked by a pending transaction"};
+  }
+
+  Response res;
+  if (auto* get_req = std::get_if<GetRequestView>(&req)) {
+    bool responsible = this->responsible_for(get_req->key);
+    GetResponse get_res;
+    if (responsible && store.Get(get_req->key, &get_res)) {
+      res = get_res;
+    } else {
+      res = ErrorResponse{
+          !responsible ? std::string("server not responsible for key")
+                       : std::string("key does not exist in the KVStore")};
+    }
+  } else if (auto* delete_req = std::get_if<DeleteRequestView>(&req)) {
     bool responsible = this->responsible_for(delete_req->key);
     DeleteResponse delete_res;
-    if (responsible && this->store->Delete(delete_req, &delete_res)) {
+    if (responsible && store.Delete(delete_req->key, &delete_res)) {
       res = delete_res;
     } else {
       res = ErrorResponse{
           !responsible ? std::string("server not responsible for key")
                        : std::string("key does not exist in the KVStore")};
     }
-  } else if (auto* multiget_req = std::get_if<MultiGetRequest>(&req)) {
+  } else if (auto* multiget_req = std::get_if<MultiGetRequestView>(&req)) {
     bool responsible = this->responsible_for(multiget_req->keys);
     MultiGetResponse multiget_res;
-    if (responsible && this->store->MultiGet(multiget_req, &multiget_res)) {
+    if (responsible && store.MultiGet(multiget_req->keys, &multiget_res)) {
       res = multiget_res;
     } else {
       res = ErrorResponse{
           !responsible ? std::string("server not responsible for key(s)")
                        : std::string("key(s) do not exist in the KVStore")};
     }
-  } else if (auto* multiput_req = std::get_if<MultiPutRequest>(&req)) {
-    bool responsible = this->responsible_for(multiput_req->keys);
-    MultiPutResponse multiput_res;
-    if (responsible && this->store->MultiPut(multiput_req, &multiput_res)) {
-      res = multiput_res;
+  } else if (auto* scan_req = std::get_if<ScanRangeRequestView>(&req)) {
+    ScanRangeResponse scan_res;
+    if (store.ScanRange(scan_req->start, scan_req->end, scan_req->limit,
+                        &scan_res)) {
+      // Leave out keys this server still holds but is no longer responsible
+      // for (e.g. while they're being moved)
+      ScanRangeResponse owned;
+      for (size_t i = 0; i < scan_res.keys.size(); i++) {
+        if (this->responsible_for(scan_res.keys[i])) {
+          owned.keys.push_back(std::move(scan_res.keys[i]));
+          owned.values.push_back(std::move(scan_res.values[i]));
+        }
+      }
+      res = owned;
     } else {
-      res = ErrorResponse{!responsible
-                              ? std::string("server not responsible for key(s)")
-                              : std::string("internal KVStore error")};
+      res = ErrorResponse{std::string("internal KVStore error")};
     }
-  } else {
-    throw std::logic_error{"invalid variant!"};
   }
   return res;
 }
 
+Response KvServer::process_txn_request(const Request& req) {
+  // The store makes votes and outcomes durable (see
+  // ConcurrentKvStore::PrepareTxn), while `txns` locks the keys
+  if (auto* prepare_req = std::get_if<PrepareRequest>(&req)) {
+    if (!this->responsible_for(prepare_req->keys)) {
+      return ErrorResponse{"server not responsible for key(s)"};
+    }
+    if (prepare_req->keys.size() != prepare_req->values.size()) {
+      return ErrorResponse{"keys and values don't match up"};
+    }
+    uint64_t id = prepare_req->txn_id;
+    bool ok = this->txns.prepare(id, {prepare_req->keys, prepare_req->values},
+                                 prepare_req->participants);
+    if (ok && !this->store->PrepareTxn({id, prepare_req->keys,
+                                        prepare_req->values,
+                                        prepare_req->participants})) {
+      this->txns.release(id);
+      // It's too late to vote yes on a transaction that was already decided
+      // (e.g. refused when another participant asked about it)
+      if (!this->store->TxnOutcome(id)) {
+        return ErrorResponse{"internal KVStore error"};
+      }
+      ok = false;
+    }
+    if (ok && prepare_req->commit) {
+      Response res = this->process_txn_request(CommitRequest{id});
+      if (std::holds_alternative<ErrorResponse>(res)) return res;
+    }
+    return PrepareResponse{ok};
+  } else if (auto* commit_req = std::get_if<CommitRequest>(&req)) {
+    uint64_t id = commit_req->txn_id;
+    if (!this->txns.begin_commit(id)) {
+      // Committing twice is harmless, e.g. when the coordinator retries
+      if (this->store->TxnOutcome(id) == true) return CommitResponse{};
+      return ErrorResponse{"transaction isn't prepared"};
+    }
+    // The keys stay locked until the writes are applied
+    bool ok = this->store->CommitTxn(id);
+    this->txns.release(id);
+    if (!ok) {
+      return ErrorResponse{this->store->TxnOutcome(id) == false
+                               ? "transaction was aborted"
+                               : "internal KVStore error"};
+    }
+    return CommitResponse{};
+  } else if (auto* abort_req = std::get_if<AbortRequest>(&req)) {
+    uint64_t id = abort_req->txn_id;
+    if (!this->store->AbortTxn(id)) {
+      return ErrorResponse{this->store->TxnOutcome(id) == true
+                               ? "transaction already committed"
+                               : "internal KVStore error"};
+    }
+    this->txns.release(id);
+    return AbortResponse{};
+  } else if (auto* status_req = std::get_if<TxnStatusRequest>(&req)) {
+    std::optional<TxnStatus> status =
+        this->store->QueryTxn(status_req->txn_id);
+    if (!status) return ErrorResponse{"internal KVStore error"};
+    return TxnStatusResponse{*status};
+  }
+  throw std::logic_error{"invalid variant!"};
+}
+
+void KvServer::resolve_txns_loop() {
+  while (!this->is_stopped) {
+    for (auto&& txn : this->txns.stalled(steady_clock::now())) {
+      this->resolve_txn(txn);
+    }
+    std::this_thread::sleep_for(TXN_RESOLVE_INTERVAL);
+  }
+}
+
+void KvServer::resolve_txn(const TxnTable::Stalled& txn) {
+  // The coordinator is a client, so it can't be asked; but any other
+  // participant that has learned the outcome, or hasn't voted yet (and so
+  // refuses the transaction), settles it
+  for (auto&& server : txn.participants) {
+    if (server == this->address) continue;
+    std::shared_ptr<ServerConn> conn = connect_to_server(server);
+    if (!conn || !conn->send_request(TxnStatusRequest{txn.id})) continue;
+    std::optional<Response> res = conn->recv_response();
+    auto* status_res = res ? std::get_if<TxnStatusResponse>(&*res) : nullptr;
+    if (!status_res) continue;
+    if (status_res->status == TxnStatus::COMMITTED) {
+      this->process_txn_request(CommitRequest{txn.id});
+      return;
+    } else if (status_res->status == TxnStatus::ABORTED) {
+      this->process_txn_request(AbortRequest{txn.id});
+      return;
+    }
+  }
+  // Every other participant is in doubt too, or unreachable: keep the keys
+  // locked, and ask again later (see TxnTable::stalled)
+}
+
+std::shared_ptr<const Message> KvServer::cached_get(std::string_view key,
+                                                    HotKeyCache& cache) {
+  if (!this->options.cache_hot_keys || !this->responsible_for(key)) {
+    return nullptr;
+  }
+  // A locked key is rejected by process_request
+  if (!this->txns.empty() && this->txns.is_locked({&key, 1})) {
+    return nullptr;
+  }
+
+  uint64_t version = this->store->Version(key);
+  if (auto msg = cache.get(key, version)) {
+    return msg;
+  }
+  if (!cache.is_hot(key)) {
+    return nullptr;
+  }
+
+  CachedResponse res = this->get_coalescer.get(std::string(key), version, [&] {
+    CachedResponse res;
+    GetResponse get_res;
+    res.found = this->store->GetVersioned(key, &get_res, &res.version,
+                                          &res.expires_at);
+    Response response;
+    if (res.found) {
+      response = get_res;
+    } else {
+      response = ErrorResponse{"key does not exist in the KVStore"};
+    }
+    std::optional<Message> msg = serialize_response(response);
+    if (msg) res.msg = std::make_shared<const Message>(std::move(*msg));
+    return res;
+  });
+  cache.put(key, res);
+  return res.msg;
+}
+
 void KvServer::process_config_loop() {
   int failure_count = 0;
   while (!this->is_stopped) {
@@ -358,15 +1240,106 @@ ShardControllerConfig KvServer::get_config() {
   return this->config;
 }
 
+IoEngineType KvServer::io_engine_type() {
+  return this->io_engine ? this->io_engine->type() : IoEngineType::THREADS;
+}
+
+uint64_t KvServer::io_syscalls() {
+  return this->io_engine ? this->io_engine->syscalls() : 0;
+}
+
+std::vector<WorkerLoad> KvServer::worker_loads() {
+  std::vector<WorkerLoad> loads(this->worker_stats.size());
+  for (size_t i = 0; i < loads.size(); i++) {
+    if (!this->cores.empty()) {
+      loads[i].queue_depth = this->cores[i].requests.size();
+    } else if (this->io_engine) {
+      std::unique_lock lock(this->requests_mtx);
+      loads[i].queue_depth = this->requests.size();
+    } else {
+      std::unique_lock lock(this->conn_queue_mtxs[i]);
+      loads[i].queue_depth = this->conn_queues[i].size();
+    }
+    loads[i].queue_delay =
+        microseconds(this->worker_stats[i]->queue_delay_us.load());
+    loads[i].n_shed = this->worker_stats[i]->n_shed.load();
+  }
+  return loads;
+}
+
+std::vector<std::vector<int>> KvServer::worker_cpus() {
+  return this->pinned_cpus;
+}
+
+bool KvServer::shard_per_core() {
+  return this->core_shards != nullptr;
+}
+
+void KvServer::record_request(size_t worker_id, OpType op,
+                              steady_clock::time_point start,
+                              uint64_t bytes_in, uint64_t bytes_out) {
+  WorkerStats& stats = *this->worker_stats[worker_id];
+  stats.latencies[op].record(steady_clock::now() - start);
+  stats.bytes_in += bytes_in;
+  stats.bytes_out += bytes_out;
+}
+
+StatsResponse KvServer::stats() {
+  static const std::array<std::string, N_OP_TYPES> op_names{
+      "get", "put", "append", "delete", "multiget", "multiput", "other"};
+  auto summarize = [](const std::string& name,
+                      const LatencyHistogram::Counts& counts) {
+    auto us = [](nanoseconds ns) {
+      return uint64_t(duration_cast<microseconds>(ns).count());
+    };
+    return LatencyStats{name,
+                        counts.total,
+                        us(counts.percentile(0.5)),
+                        us(counts.percentile(0.99)),
+                        us(counts.percentile(0.999)),
+                        us(counts.max)};
+  };
+
+  StatsResponse res;
+  res.uptime_ms =
+      duration_cast<milliseconds>(steady_clock::now() - this->started_at)
+          .count();
+  for (size_t op = 0; op < N_OP_TYPES; op++) {
+    LatencyHistogram::Counts counts;
+    for (auto&& stats : this->worker_stats) {
+      stats->latencies[op].add_to(&counts);
+    }
+    res.latencies.push_back(summarize(op_names[op], counts));
+  }
+  LatencyHistogram::Counts queue_counts;
+  for (auto&& stats : this->worker_stats) {
+    stats->queue_wait.add_to(&queue_counts);
+    res.bytes_in += stats->bytes_in;
+    res.bytes_out += stats->bytes_out;
+    res.n_shed += stats->n_shed;
+  }
+  res.latencies.push_back(summarize("queue", queue_counts));
+
+  for (ConcurrentKvStore* store : this->stores()) {
+    CacheStats cache = store->GetCacheStats();
+    res.cache_hits += cache.hits;
+    res.cache_misses += cache.misses;
+    res.cache_evictions += cache.evictions;
+  }
+  return res;
+}
+
 std::map<std::string, std::string> KvServer::all_kvpairs() {
-  auto keys = this->store->AllKeys();
   std::map<std::string, std::string> map;
-  for (auto&& k : keys) {
-    auto req = GetRequest{k};
-    auto res = GetResponse{};
-    // Only add if key still exists
-    if (this->store->Get(&req, &res)) {
-      map[k] = res.value;
+  for (ConcurrentKvStore* store : this->stores()) {
+    auto keys = store->AllKeys();
+    for (auto&& k : keys) {
+      auto req = GetRequest{k};
+      auto res = GetResponse{};
+      // Only add if key still exists
+      if (store->Get(&req, &res)) {
+        map[k] = res.value;
+      }
     }
   }
 
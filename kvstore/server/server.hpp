@@ -2,38 +2,152 @@
 #define KVSERVER_HPP
 
 #include <array>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <deque>
 #include <iostream>
+#include <latch>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "common/cpu_affinity.hpp"
+#include "common/latency_histogram.hpp"
+#include "common/log.hpp"
+#include "common/spsc_queue.hpp"
 #include "kvstore/concurrent_kvstore.hpp"
 #include "kvstore/kvstore.hpp"
 #include "kvstore/simple_kvstore.hpp"
 #include "net/network_conn.hpp"
 #include "net/network_helpers.hpp"
 #include "net/network_messages.hpp"
+#include "server/codel.hpp"
+#include "server/core_shards.hpp"
+#include "server/hot_key_cache.hpp"
+#include "server/io_engine.hpp"
+#include "server/txn_table.hpp"
 
 #define N_WORKERS 5
 
 using namespace std::chrono;
 
+// Whether, and how, workers are pinned to CPUs (see KvServerOptions).
+enum class WorkerPinning {
+  NONE,
+  // Each worker to one CPU, spreading them over the NUMA nodes.
+  CORES,
+  // Each worker to every CPU of one NUMA node, round robin over the nodes.
+  NODES
+};
+
+// Optional server settings. The defaults give a purely in-memory server.
+struct KvServerOptions {
+  // If non-empty, the store logs every mutation to a write-ahead log in this
+  // directory, snapshots itself there every `snapshot_interval` (if non-zero),
+  // and recovers from both on startup.
+  std::string data_dir;
+  SyncPolicy wal_sync = SyncPolicy::INTERVAL;
+  milliseconds wal_sync_interval = 10ms;
+  milliseconds snapshot_interval = 0ms;
+  // If non-zero, the store evicts keys to stay within this many bytes.
+  size_t max_memory = 0;
+  // Whether workers cache the serialized responses to Gets of hot keys.
+  bool cache_hot_keys = true;
+  // Whether the store keeps an ordered index of its keys for range scans.
+  bool ordered_index = false;
+  // Number of hash buckets in the store; more buckets mean shorter chains
+  // (and less lock contention) for large datasets. A persistent store must be
+  // restarted with the same number.
+  size_t n_buckets = DbMap::BUCKET_COUNT;
+  // If non-zero, values at least this many bytes long are stored compressed.
+  size_t compress_threshold = 0;
+  // The largest request body accepted from a client; clients that send larger
+  // ones are disconnected.
+  size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+  // Number of threads accepting client connections. With more than one, each
+  // accepts from its own socket on the server's port (see
+  // SocketOptions::reuse_port).
+  size_t n_acceptors = 1;
+  // Listen backlog and socket buffer sizes for client connections.
+  SocketOptions socket_options;
+  // How the server does its network I/O. With an event loop (EPOLL or
+  // IO_URING), idle connections don't tie up workers, and workers wait for
+  // requests instead of polling for connections. Local addresses (unix:<path>)
+  // always use THREADS.
+  IoEngineType io_engine = IoEngineType::THREADS;
+  // Load shedding (see CoDel). If `shed_target` is non-zero, requests that
+  // have waited for a worker longer than `shed_interval`, or longer than
+  // `shed_target` once the queue hasn't emptied for `shed_interval`, are
+  // answered with an OVERLOADED error instead of processed. With THREADS, it's
+  // new connections that wait, and their first request that's answered so.
+  milliseconds shed_target = 0ms;
+  milliseconds shed_interval = 100ms;
+  // If non-zero, requests (or with THREADS, connections) that a worker finds
+  // this many others waiting behind are shed too.
+  size_t max_queue_depth = 0;
+  // CPU pinning. Pinned workers stay on one NUMA node, where they allocate
+  // their stats and caches, instead of migrating away from them. Workers are
+  // pinned to `worker_cpus`, or if empty, to any CPU the server may run on.
+  WorkerPinning pin_workers = WorkerPinning::NONE;
+  std::vector<int> worker_cpus;
+  // With THREADS and pinned workers, hand each connection to a worker on the
+  // node of the CPU that its packets arrive on (the one handling its NIC
+  // queue's interrupts), rather than round robin.
+  bool steer_connections = false;
+  // Shard-per-core mode: rather than all workers sharing one store, each is a
+  // "core" with its own slice of the keys (see CoreShards), in a store that
+  // only it touches. A connection is homed on a core, which hands each part
+  // of a request for other cores' keys to them through lock-free queues, and
+  // answers once they reply. Needs an I/O engine; the store's options apply
+  // to each core's store (with `max_memory` split between them, and core i
+  // persisting to <data_dir>/core<i>), but there's no hot key cache, and
+  // transactions aren't supported. MultiPuts and MultiGets of keys on several
+  // cores stay atomic by locking those cores through the queues before any
+  // of them applies its part (see KvServer::core_loop).
+  bool shard_per_core = false;
+  // How long a transaction this server voted to commit waits for its
+  // coordinator before the server asks the other participants how it ended
+  // (see TxnTable).
+  milliseconds txn_timeout = TxnTable::DEFAULT_TIMEOUT;
+};
+
+// How loaded a worker is (see KvServer::worker_loads).
+struct WorkerLoad {
+  // Connections waiting for the worker with THREADS, or requests waiting with
+  // an I/O engine (whose workers share one queue).
+  size_t queue_depth = 0;
+  // How long the last request or connection the worker took had waited.
+  microseconds queue_delay{0};
+  // Requests shed so far (see KvServerOptions::shed_target).
+  uint64_t n_shed = 0;
+};
+
 class KvServer {
  public:
-  explicit KvServer(const std::string& address, uint64_t n_workers)
-      : address(address), shardcontroller_address(), n_workers(n_workers) {
+  explicit KvServer(const std::string& address, uint64_t n_workers,
+                    const KvServerOptions& options = {})
+      : address(address),
+        txns(options.txn_timeout),
+        shardcontroller_address(),
+        n_workers(n_workers),
+        options(options) {
   }
   explicit KvServer(const std::string& address,
-                    const std::string& shardcontroller_addr, uint64_t n_workers)
+                    const std::string& shardcontroller_addr, uint64_t n_workers,
+                    const KvServerOptions& options = {})
       : address(address),
+        txns(options.txn_timeout),
         shardcontroller_address(shardcontroller_addr),
-        n_workers(n_workers) {
+        n_workers(n_workers),
+        options(options) {
   }
   ~KvServer() {
     if (!this->is_stopped) {
@@ -58,6 +172,28 @@ class KvServer {
   // For debugging purposes, get the shardcontroller config from the server.
   ShardControllerConfig get_config();
 
+  // For benchmarking, the I/O engine in use (after any fallback), and the
+  // system calls it has made so far (none are counted with THREADS).
+  IoEngineType io_engine_type();
+  uint64_t io_syscalls();
+
+  // For monitoring, each worker's queue and how much it has shed.
+  std::vector<WorkerLoad> worker_loads();
+
+  // For monitoring, the latency percentiles of the requests processed so far,
+  // by type, and the bytes received and sent (see StatsResponse). Latencies
+  // run from when a worker takes a request until it sends the response (or
+  // with an I/O engine, hands it to the engine).
+  StatsResponse stats();
+
+  // Whether the server runs in shard-per-core mode (which it can't without an
+  // I/O engine).
+  bool shard_per_core();
+
+  // For testing purposes, the CPUs each worker is pinned to (empty if it
+  // isn't).
+  std::vector<std::vector<int>> worker_cpus();
+
   // For testing purposes, make ServerTest a friend of KvServer
   // so that ServerTest can access KvServer's private fields
   friend class ServerTest;
@@ -75,8 +211,17 @@ class KvServer {
   // The address on which the server is listening.
   std::string address;
 
-  // Internal key-value store.
-  std::unique_ptr<KvStore> store;
+  // Internal key-value store (null in shard-per-core mode, where each core
+  // has its own).
+  std::unique_ptr<ConcurrentKvStore> store;
+
+  // Shared by the workers, so that concurrent Gets of a hot key only look it
+  // up once.
+  GetCoalescer get_coalescer;
+
+  // Cross-server transactions that this server has prepared. Their keys can't
+  // be read or written until they commit or abort.
+  TxnTable txns;
 
   // Persistent shardcontroller connection.
   std::shared_ptr<ServerConn> shardcontroller_conn;
@@ -93,22 +238,118 @@ class KvServer {
   // stopped.
   std::atomic<bool> is_stopped;
 
-  // Listener socket for incoming client connections.
-  int listener_fd;
-  // Thread that listens for client connections and accepts them.
-  std::thread client_listener;
+  // Listener sockets for incoming client connections, each with a thread that
+  // accepts connections from it.
+  std::vector<int> listener_fds;
+  std::vector<std::thread> client_listeners;
+  // The worker that the next accepted connection is handed to.
+  std::atomic<size_t> next_worker = 0;
+
+  // With an event-driven I/O engine, the engine, the thread running its loop,
+  // and the requests it has received, waiting for a worker.
+  std::unique_ptr<IoEngine> io_engine;
+  std::thread io_thread;
+  struct QueuedRequest {
+    uint64_t conn_id;
+    Message msg;
+    CoDel::Clock::time_point queued_at;
+  };
+  std::deque<QueuedRequest> requests;
+  std::mutex requests_mtx;
+  std::condition_variable requests_cv;
+  // Load shedding for `requests` (guarded by requests_mtx).
+  std::unique_ptr<CoDel> requests_codel;
 
   // Thread that periodically queries the shardcontroller for the current
   // configuration.
   std::thread shardcontroller_querier;  // bro this name goofy
   std::shared_ptr<ServerConn> shardcontroller_querier_conn;
 
+  // Thread running resolve_txns_loop (unless in shard-per-core mode), and
+  // how often it looks for stalled transactions.
+  std::thread txn_resolver;
+  static constexpr milliseconds TXN_RESOLVE_INTERVAL = 50ms;
+
   // Vector of worker threads.
   std::vector<std::thread> workers;
 
-  // Per-worker queues of client connections to handle.
-  std::vector<std::deque<std::shared_ptr<ClientConn>>> conn_queues;
+  // Per-worker queues of client connections to handle, with load shedding
+  // for each (guarded by the queue's mutex).
+  struct QueuedConn {
+    std::shared_ptr<ClientConn> conn;
+    CoDel::Clock::time_point queued_at;
+  };
+  std::vector<std::deque<QueuedConn>> conn_queues;
   std::deque<std::mutex> conn_queue_mtxs;
+  std::vector<std::unique_ptr<CoDel>> conn_queue_codels;
+
+  // Request types whose latencies stats() reports separately; the rest are
+  // counted together as OP_OTHER.
+  enum OpType : size_t {
+    OP_GET,
+    OP_PUT,
+    OP_APPEND,
+    OP_DELETE,
+    OP_MULTI_GET,
+    OP_MULTI_PUT,
+    OP_OTHER,
+    N_OP_TYPES
+  };
+
+  // What each worker last waited for, and has shed (see WorkerLoad), and its
+  // share of stats(). Only the worker records into its histograms.
+  struct WorkerStats {
+    std::atomic<int64_t> queue_delay_us = 0;
+    std::atomic<uint64_t> n_shed = 0;
+    std::array<LatencyHistogram, N_OP_TYPES> latencies;
+    LatencyHistogram queue_wait;
+    std::atomic<uint64_t> bytes_in = 0;
+    std::atomic<uint64_t> bytes_out = 0;
+  };
+  // Each worker allocates its own, once pinned, so that it's on the worker's
+  // node; start() returns once they all have.
+  std::vector<std::unique_ptr<WorkerStats>> worker_stats;
+  std::unique_ptr<std::latch> workers_ready;
+  // The CPUs each worker is pinned to (empty if it isn't), the NUMA nodes of
+  // those CPUs, and the workers on each node, for steering connections (see
+  // KvServerOptions).
+  std::vector<std::vector<int>> pinned_cpus;
+  NumaTopology topology;
+  std::vector<std::vector<size_t>> node_workers;
+
+  // In shard-per-core mode, the message one core sends another about a
+  // request homed on one of them. PART asks the receiver to process `req`,
+  // the sender's part of it, and REPLY answers with `res`. MultiPuts and
+  // MultiGets of keys on several cores lock those cores first (see
+  // core_loop): LOCK asks the receiver to lock itself for the request, LOCKED
+  // answers once it has, and COMMIT is a PART that then unlocks it.
+  struct CoreMessage {
+    enum Kind { PART, REPLY, LOCK, LOCKED, COMMIT };
+    Kind kind;
+    // The request's id on its home core, and the part's index in it
+    uint64_t id;
+    size_t part;
+    Request req;
+    Response res;
+    // For LOCK, whether the request writes (a MultiPut)
+    bool exclusive = false;
+  };
+  // A core's store, and its queues: the requests the I/O engine received on
+  // connections homed on it, and the messages from each other core (indexed
+  // by sender). Each queue has one producer and one consumer, the core.
+  struct Core {
+    std::unique_ptr<ConcurrentKvStore> store;
+    SpscQueue<QueuedRequest> requests;
+    std::deque<SpscQueue<CoreMessage>> inbox;
+    // Load shedding for `requests`
+    std::unique_ptr<CoDel> codel;
+    // Bumped whenever something is queued for the core, which waits on it
+    // when it's idle.
+    std::atomic<uint32_t> wakeups = 0;
+  };
+  std::unique_ptr<CoreShards> core_shards;
+  std::deque<Core> cores;
+  steady_clock::time_point started_at;
 
   // The address on which the shardcontroller is listening.
   std::string shardcontroller_address;
@@ -116,13 +357,16 @@ class KvServer {
   // Number of worker threads.
   uint64_t n_workers;
 
+  // Optional settings (persistence, ...).
+  KvServerOptions options;
+
   /**
-   * In a loop, accept client connections, then pass each connection into the
-   * work queue of client connections to process.
+   * In a loop, accept client connections from a listener socket, then pass
+   * each connection into the work queue of client connections to process.
    *
    * Exits when the server has been stopped.
    */
-  void accept_clients_loop();
+  void accept_clients_loop(int listener_fd);
 
   /**
    * In a loop, pop a client connection from the work queue and process a
@@ -131,11 +375,86 @@ class KvServer {
    */
   void work_loop(size_t worker_id);
 
+  /**
+   * Like work_loop, but with an I/O engine: in a loop, pop a request that the
+   * engine received, process it, and hand the response back to the engine.
+   * The argument specifies the worker thread ID running the loop. Exits when
+   * the server has been stopped.
+   */
+  void engine_work_loop(size_t worker_id);
+
+  /**
+   * Assigns each worker the CPUs to pin itself to, according to
+   * `options.pin_workers`.
+   */
+  void assign_worker_cpus();
+
+  /**
+   * Run by each worker before its loop: pins the worker to its CPUs, then
+   * allocates its stats, and counts down workers_ready.
+   */
+  void init_worker(size_t worker_id);
+
+  // The worker to hand a connection accepted on `fd` to.
+  size_t pick_worker(int fd);
+
+  /**
+   * Opens a store with the server's options, persisting it to `data_dir` (if
+   * non-empty) and evicting keys to stay within `max_memory`. Returns nullptr
+   * if it can't be recovered.
+   */
+  std::unique_ptr<ConcurrentKvStore> open_store(const std::string& data_dir,
+                                                size_t max_memory);
+
+  // The server's store, or in shard-per-core mode each core's.
+  std::vector<ConcurrentKvStore*> stores();
+
+  /**
+   * In shard-per-core mode, each worker runs this instead of
+   * engine_work_loop: in a loop, process the parts of requests that other
+   * cores forwarded, collect the replies to parts that this core forwarded,
+   * and take the requests homed on this core, splitting each between the
+   * cores that own its keys. Exits when the server has been stopped.
+   *
+   * A MultiPut or MultiGet of keys on several cores first locks each of
+   * them, one at a time in order of core, so that two such requests never
+   * wait on each other. Once it holds every lock, each core applies its part
+   * and unlocks. MultiPuts lock cores exclusively and MultiGets share them,
+   * so no MultiGet sees some of a MultiPut's keys written but not the rest.
+   * Requests for one core's keys don't lock: that core's store makes them
+   * atomic, and the core keeps serving them while it's locked.
+   */
+  void core_loop(size_t core_id);
+
+  // Queues `msg` from core `from` to core `to`, and wakes `to` up.
+  void send_to_core(size_t from, size_t to, CoreMessage msg);
+
+  /**
+   * Records that worker `worker_id` took something that was queued at
+   * `queued_at`, leaving `remaining` in the queue, and returns whether to shed
+   * it (see KvServerOptions::shed_target). Call with the queue's lock held.
+   */
+  bool should_shed(size_t worker_id, CoDel* codel,
+                   CoDel::Clock::time_point queued_at, size_t remaining);
+
+  // The type `req` is counted as in stats().
+  static OpType op_type(const Request& req);
+  static OpType op_type(const ReadRequestView& req);
+
+  /**
+   * Records that worker `worker_id` answered a request of type `op` that it
+   * took at `start`, receiving `bytes_in` and sending `bytes_out`.
+   */
+  void record_request(size_t worker_id, OpType op,
+                      steady_clock::time_point start, uint64_t bytes_in,
+                      uint64_t bytes_out);
+
   /**
    * Check whether this server is responsible for a key (or list of keys).
    */
-  bool responsible_for(const std::string& key);
-  bool responsible_for(const std::vector<std::string>& keys);
+  bool responsible_for(std::string_view key);
+  template <typename Key>
+  bool responsible_for(const std::vector<Key>& keys);
 
   /**
    * Query the shardcontroller, then update the config and move outdated pairs
@@ -148,6 +467,28 @@ class KvServer {
    * handler (Get, Put, etc.), then get a response.
    */
   Response process_request(Request req);
+  // The same, against one of the cores' stores in shard-per-core mode.
+  Response process_request(Request req, ConcurrentKvStore& store);
+  // Handles the read-path requests (and Deletes) without copying their keys;
+  // process_request hands those requests to it too.
+  Response process_read_request(const ReadRequestView& req,
+                                ConcurrentKvStore& store);
+
+  // Handles the two-phase commit requests (see TxnTable).
+  Response process_txn_request(const Request& req);
+
+  // Periodically settles the prepared transactions whose coordinator has gone
+  // quiet, by asking their other participants how they ended.
+  void resolve_txns_loop();
+  void resolve_txn(const TxnTable::Stalled& txn);
+
+  /**
+   * If `key` is hot, returns the serialized response to a Get of it, either
+   * from the worker's `cache` or by (coalesced) lookup. Returns nullptr for
+   * other keys, which go through process_request instead.
+   */
+  std::shared_ptr<const Message> cached_get(std::string_view key,
+                                            HotKeyCache& cache);
 
   // Extracts a query response from the shardcontroller, or an std::nullopt if
   // one doesn't exist. You might need this when implementing process_config!
@@ -0,0 +1,61 @@
+#include "txn_table.hpp"
+
+bool TxnTable::prepare(uint64_t id, Writes writes,
+                       std::vector<std::string> participants) {
+  std::lock_guard lock(this->mtx);
+  if (this->txns.contains(id)) return false;
+  for (auto&& key : writes.keys) {
+    if (this->locks.contains(key)) return false;
+  }
+  for (auto&& key : writes.keys) this->locks[key] = id;
+  this->txns[id] = Txn{std::move(writes), std::move(participants),
+                       steady_clock::now() + this->timeout};
+  this->n_txns.store(this->txns.size(), std::memory_order_release);
+  return true;
+}
+
+bool TxnTable::begin_commit(uint64_t id) {
+  std::lock_guard lock(this->mtx);
+  auto it = this->txns.find(id);
+  if (it == this->txns.end() || it->second.committing) return false;
+  it->second.committing = true;
+  return true;
+}
+
+void TxnTable::release(uint64_t id) {
+  std::lock_guard lock(this->mtx);
+  this->erase(id);
+}
+
+bool TxnTable::is_locked(std::span<const std::string_view> keys) {
+  if (this->empty()) return false;
+
+  std::lock_guard lock(this->mtx);
+  for (auto&& key : keys) {
+    if (this->locks.contains(key)) return true;
+  }
+  return false;
+}
+
+std::vector<TxnTable::Stalled> TxnTable::stalled(
+    steady_clock::time_point now) {
+  std::vector<Stalled> stalled;
+  if (this->empty()) return stalled;
+
+  std::lock_guard lock(this->mtx);
+  for (auto&& [id, txn] : this->txns) {
+    if (!txn.committing && txn.next_check <= now) {
+      stalled.push_back({id, txn.participants});
+      txn.next_check = now + this->timeout;
+    }
+  }
+  return stalled;
+}
+
+void TxnTable::erase(uint64_t id) {
+  auto it = this->txns.find(id);
+  if (it == this->txns.end()) return;
+  for (auto&& key : it->second.writes.keys) this->locks.erase(key);
+  this->txns.erase(it);
+  this->n_txns.store(this->txns.size(), std::memory_order_release);
+}
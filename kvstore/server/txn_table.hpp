@@ -0,0 +1,108 @@
+#ifndef TXN_TABLE_HPP
+#define TXN_TABLE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std::chrono;
+
+/**
+ * A server's side of two-phase commit: the transactions it has prepared (i.e.
+ * voted to commit) and hasn't committed or aborted yet, and the keys they
+ * hold. The votes themselves, and the outcomes, are made durable by the store
+ * (see ConcurrentKvStore::PrepareTxn).
+ *
+ * Preparing locks the transaction's keys, so that they can't be read or
+ * written until it commits or aborts; a transaction that finds a key already
+ * locked votes no rather than waiting, so transactions can't deadlock. Having
+ * voted yes, a server can't decide on its own to abort, since the other
+ * servers may already have been told to commit. So a prepared transaction
+ * that hears nothing within `timeout` (e.g. because its coordinator died)
+ * isn't aborted, but reported by stalled(), for the server to ask the other
+ * participants how it ended; it holds its keys until one of them knows.
+ */
+class TxnTable {
+ public:
+  static constexpr milliseconds DEFAULT_TIMEOUT = 2s;
+
+  explicit TxnTable(milliseconds timeout = DEFAULT_TIMEOUT) : timeout(timeout) {
+  }
+
+  struct Writes {
+    std::vector<std::string> keys;
+    std::vector<std::string> values;
+  };
+
+  // Locks the keys of `writes` for transaction `id`, and stages the writes.
+  // `participants` are all of the transaction's servers. Returns false if
+  // another transaction holds any of the keys.
+  bool prepare(uint64_t id, Writes writes,
+               std::vector<std::string> participants);
+
+  // Starts committing transaction `id`; its keys stay locked until
+  // release(id). Returns false if the transaction isn't prepared, or is
+  // already committing.
+  bool begin_commit(uint64_t id);
+
+  // Forgets transaction `id` (after it committed, or to abort it), unlocking
+  // its keys.
+  void release(uint64_t id);
+
+  // Whether any of `keys` is held by a transaction.
+  bool is_locked(std::span<const std::string_view> keys);
+
+  // Whether no transaction is prepared. Cheap, so that requests can skip the
+  // lock checks entirely when transactions aren't in use.
+  bool empty() const {
+    return this->n_txns.load(std::memory_order_acquire) == 0;
+  }
+
+  // A prepared transaction whose outcome is in doubt, and whom to ask.
+  struct Stalled {
+    uint64_t id;
+    std::vector<std::string> participants;
+  };
+  // The prepared transactions that haven't started committing within
+  // `timeout` of being prepared. Each is reported again every `timeout` for
+  // as long as it stays in doubt.
+  std::vector<Stalled> stalled(steady_clock::time_point now);
+
+ private:
+  struct Txn {
+    Writes writes;
+    std::vector<std::string> participants;
+    // When stalled() next reports the transaction.
+    steady_clock::time_point next_check;
+    // Set once the transaction starts committing; it's no longer in doubt.
+    bool committing = false;
+  };
+
+  milliseconds timeout;
+  std::mutex mtx;
+  std::unordered_map<uint64_t, Txn> txns;
+  // Hashes keys and views of them alike, so that `locks` can be searched
+  // without copying the key.
+  struct KeyHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const {
+      return std::hash<std::string_view>()(key);
+    }
+  };
+
+  // Which transaction holds each locked key.
+  std::unordered_map<std::string, uint64_t, KeyHash, std::equal_to<>> locks;
+  std::atomic<size_t> n_txns = 0;
+
+  // Assumes `mtx` is held.
+  void erase(uint64_t id);
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,437 @@
+#include "test_utils/cluster.hpp"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+
+#include "common/color.hpp"
+#include "net/network_conn.hpp"
+#include "test_utils/test_utils.hpp"
+
+// Whether something accepts connections on `address` (hostname:port),
+// without the errors connect_to_server prints while nothing does.
+static bool is_listening(const std::string& address) {
+  size_t colon = address.rfind(':');
+  if (colon == std::string::npos) return false;
+  std::string host = address.substr(0, colon);
+  std::string port = address.substr(colon + 1);
+
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addrs;
+  if (getaddrinfo(host.c_str(), port.c_str(), &hints, &addrs) != 0) {
+    return false;
+  }
+  bool listening = false;
+  for (addrinfo* ai = addrs; ai && !listening; ai = ai->ai_next) {
+    int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                    ai->ai_protocol);
+    if (fd < 0) continue;
+    listening = ::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+    close(fd);
+  }
+  freeaddrinfo(addrs);
+  return listening;
+}
+
+LocalCluster::LocalCluster(ClusterOptions options)
+    : options(std::move(options)) {
+  const ClusterOptions& opts = this->options;
+  std::vector<std::string> addrs =
+      make_server_addresses(opts.n_servers + 1, opts.start_port);
+
+  this->shardcontroller.name = "shardcontroller";
+  this->shardcontroller.address = addrs[0];
+  this->shardcontroller.args = {opts.bin_dir + "/shardcontroller",
+                                std::to_string(opts.start_port)};
+
+  for (size_t i = 0; i < opts.n_servers; i++) {
+    Process server;
+    server.name = "server" + std::to_string(i);
+    server.address = addrs[i + 1];
+    server.args = {opts.bin_dir + "/server",
+                   std::to_string(opts.start_port + i + 1)};
+    if (opts.use_shardcontroller) {
+      server.args.push_back(this->shardcontroller.address);
+    }
+    server.args.push_back(std::to_string(opts.n_workers));
+    server.args.insert(server.args.end(), opts.server_flags.begin(),
+                       opts.server_flags.end());
+    if (!opts.data_dir.empty()) {
+      server.args.push_back("--data-dir=" + opts.data_dir + "/" +
+                            server.name);
+    }
+    this->servers.push_back(std::move(server));
+  }
+}
+
+LocalCluster::~LocalCluster() {
+  this->stop();
+}
+
+bool LocalCluster::start() {
+  std::error_code ec;
+  std::filesystem::create_directories(this->options.log_dir, ec);
+  if (ec) {
+    cerr_color(RED, "Failed to create ", this->options.log_dir, ": ",
+               ec.message());
+    return false;
+  }
+
+  std::lock_guard lock(this->mtx);
+  bool ok = true;
+  if (this->options.use_shardcontroller) {
+    ok = this->spawn(this->shardcontroller) &&
+         this->wait_until_listening(this->shardcontroller);
+  }
+  // Start the servers at once, then wait for them all
+  for (size_t i = 0; ok && i < this->servers.size(); i++) {
+    ok = this->spawn(this->servers[i]);
+  }
+  for (size_t i = 0; ok && i < this->servers.size(); i++) {
+    ok = this->wait_until_listening(this->servers[i]);
+  }
+  if (!ok) {
+    for (Process& server : this->servers) this->stop_process(server, true);
+    this->stop_process(this->shardcontroller, true);
+  }
+  return ok;
+}
+
+void LocalCluster::stop() {
+  std::lock_guard lock(this->mtx);
+  // Servers first, so that they can still leave the shardcontroller
+  for (Process& server : this->servers) this->stop_process(server, false);
+  this->stop_process(this->shardcontroller, false);
+}
+
+std::vector<std::string> LocalCluster::server_addresses() const {
+  std::vector<std::string> addrs;
+  for (const Process& server : this->servers) addrs.push_back(server.address);
+  return addrs;
+}
+
+bool LocalCluster::is_running(size_t server) {
+  std::lock_guard lock(this->mtx);
+  return this->reap(this->servers.at(server));
+}
+
+bool LocalCluster::start_server(size_t server) {
+  std::lock_guard lock(this->mtx);
+  Process& process = this->servers.at(server);
+  if (this->reap(process)) {
+    cerr_color(YELLOW, process.name, " is already running.");
+    return false;
+  }
+  return this->spawn(process) && this->wait_until_listening(process);
+}
+
+bool LocalCluster::stop_server(size_t server) {
+  std::lock_guard lock(this->mtx);
+  return this->stop_process(this->servers.at(server), false);
+}
+
+bool LocalCluster::kill_server(size_t server) {
+  std::lock_guard lock(this->mtx);
+  return this->stop_process(this->servers.at(server), true);
+}
+
+template <typename Expected>
+bool LocalCluster::request(const Request& req) {
+  std::shared_ptr<ServerConn> conn =
+      connect_to_server(this->shardcontroller.address);
+  if (!conn || !conn->send_request(req)) return false;
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return false;
+  if (auto* error_res = std::get_if<ErrorResponse>(&*res)) {
+    cerr_color(YELLOW, "Shardcontroller request failed: ", error_res->msg);
+  }
+  return std::holds_alternative<Expected>(*res);
+}
+
+bool LocalCluster::join(size_t server) {
+  return this->request<JoinResponse>(
+      JoinRequest{this->servers.at(server).address});
+}
+
+bool LocalCluster::leave(size_t server) {
+  return this->request<LeaveResponse>(
+      LeaveRequest{this->servers.at(server).address});
+}
+
+bool LocalCluster::move(size_t server, const std::vector<Shard>& shards) {
+  return this->request<MoveResponse>(
+      MoveRequest{this->servers.at(server).address, shards});
+}
+
+std::optional<ShardControllerConfig> LocalCluster::query() {
+  std::shared_ptr<ServerConn> conn =
+      connect_to_server(this->shardcontroller.address);
+  if (!conn || !conn->send_request(QueryRequest{})) return std::nullopt;
+  std::optional<Response> res = conn->recv_response();
+  if (!res) return std::nullopt;
+  if (auto* query_res = std::get_if<QueryResponse>(&*res)) {
+    return std::move(query_res->config);
+  }
+  return std::nullopt;
+}
+
+bool LocalCluster::spawn(Process& process) {
+  // A process already on the port would look like this one starting
+  if (is_listening(process.address)) {
+    cerr_color(RED, "Can't start ", process.name, ": ", process.address,
+               " is already in use.");
+    return false;
+  }
+
+  int fds[2];
+  if (pipe2(fds, O_CLOEXEC) < 0) {
+    perror_color(RED, "pipe2");
+    return false;
+  }
+  std::string log_path = this->options.log_dir + "/" + process.name + ".log";
+  std::vector<char*> argv;
+  for (std::string& arg : process.args) argv.push_back(arg.data());
+  argv.push_back(nullptr);
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    perror_color(RED, "fork");
+    close(fds[0]);
+    close(fds[1]);
+    return false;
+  }
+  if (pid == 0) {
+    // Other threads (e.g. a ClusterLoad's) may hold locks, so only
+    // async-signal-safe calls from here to exec
+    int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (log_fd < 0 || dup2(fds[0], STDIN_FILENO) < 0 ||
+        dup2(log_fd, STDOUT_FILENO) < 0 || dup2(log_fd, STDERR_FILENO) < 0) {
+      _exit(127);
+    }
+    execv(argv[0], argv.data());
+    _exit(127);
+  }
+
+  close(fds[0]);
+  process.pid = pid;
+  process.stdin_fd = fds[1];
+  return true;
+}
+
+bool LocalCluster::wait_until_listening(Process& process) {
+  auto deadline = steady_clock::now() + this->options.timeout;
+  while (steady_clock::now() < deadline) {
+    if (is_listening(process.address)) return true;
+    if (!this->reap(process)) {
+      cerr_color(RED, process.name,
+                 " exited before accepting connections; see ",
+                 this->options.log_dir, "/", process.name, ".log.");
+      return false;
+    }
+    std::this_thread::sleep_for(10ms);
+  }
+  cerr_color(RED, process.name, " didn't accept connections on ",
+             process.address, " within ", this->options.timeout.count(),
+             "ms.");
+  return false;
+}
+
+bool LocalCluster::reap(Process& process) {
+  if (process.pid < 0) return false;
+  int status;
+  if (waitpid(process.pid, &status, WNOHANG) != process.pid) return true;
+  process.pid = -1;
+  close(process.stdin_fd);
+  process.stdin_fd = -1;
+  return false;
+}
+
+bool LocalCluster::stop_process(Process& process, bool kill) {
+  if (process.pid < 0) return true;
+  if (kill) ::kill(process.pid, SIGKILL);
+  // On EOF, the REPL returns, and the process stops
+  close(process.stdin_fd);
+  process.stdin_fd = -1;
+
+  bool stopped = false;
+  int status = 0;
+  auto deadline = steady_clock::now() + this->options.timeout;
+  while (!stopped && steady_clock::now() < deadline) {
+    stopped = waitpid(process.pid, &status, WNOHANG) == process.pid;
+    if (!stopped) std::this_thread::sleep_for(10ms);
+  }
+  if (!stopped) {
+    cerr_color(RED, process.name, " didn't stop within ",
+               this->options.timeout.count(), "ms; killing it.");
+    ::kill(process.pid, SIGKILL);
+    waitpid(process.pid, &status, 0);
+  }
+  process.pid = -1;
+  return stopped && (kill || (WIFEXITED(status) && WEXITSTATUS(status) == 0));
+}
+
+ClusterLoad::ClusterLoad(LocalCluster& cluster, size_t n_clients,
+                         double put_fraction, milliseconds interval,
+                         size_t keys_per_client)
+    : cluster(cluster),
+      n_clients(n_clients),
+      put_fraction(put_fraction),
+      interval(interval),
+      keys_per_client(keys_per_client) {
+}
+
+ClusterLoad::~ClusterLoad() {
+  if (this->running) this->stop();
+}
+
+double ClusterLoad::Interval::throughput() const {
+  return this->n_ok / this->length_s;
+}
+
+double ClusterLoad::Interval::availability() const {
+  uint64_t n = this->n_ok + this->n_failed;
+  return n == 0 ? 1 : double(this->n_ok) / n;
+}
+
+void ClusterLoad::start() {
+  this->started_at = steady_clock::now();
+  this->running = true;
+  this->counts.assign(this->n_clients, {});
+  for (size_t i = 0; i < this->n_clients; i++) {
+    this->clients.emplace_back(&ClusterLoad::run_client, this, i);
+  }
+}
+
+void ClusterLoad::mark(const std::string& event) {
+  std::lock_guard lock(this->events_mtx);
+  this->events.emplace_back(steady_clock::now(), event);
+}
+
+std::vector<ClusterLoad::Interval> ClusterLoad::stop() {
+  this->running = false;
+  for (std::thread& client : this->clients) client.join();
+  this->clients.clear();
+  double elapsed_s =
+      duration<double>(steady_clock::now() - this->started_at).count();
+
+  size_t n_intervals = 0;
+  for (auto& client_counts : this->counts) {
+    n_intervals = std::max(n_intervals, client_counts.size());
+  }
+  std::vector<Interval> timeline(n_intervals);
+  double interval_s = duration<double>(this->interval).count();
+  for (size_t i = 0; i < n_intervals; i++) {
+    timeline[i].end_s = std::min((i + 1) * interval_s, elapsed_s);
+    timeline[i].length_s = timeline[i].end_s - i * interval_s;
+    for (auto& client_counts : this->counts) {
+      if (i >= client_counts.size()) continue;
+      timeline[i].n_ok += client_counts[i].first;
+      timeline[i].n_failed += client_counts[i].second;
+    }
+  }
+
+  std::lock_guard lock(this->events_mtx);
+  for (auto& [at, event] : this->events) {
+    size_t i = (at - this->started_at) / this->interval;
+    if (i < timeline.size()) timeline[i].events.push_back(event);
+  }
+  this->events.clear();
+  return timeline;
+}
+
+bool ClusterLoad::write_csv(const std::vector<Interval>& timeline,
+                            const std::string& path) {
+  std::ofstream csv(path);
+  if (!csv) return false;
+  csv << "time_s,ok,failed,ops_per_sec,availability,events\n";
+  for (const Interval& interval : timeline) {
+    csv << interval.end_s << ',' << interval.n_ok << ',' << interval.n_failed
+        << ',' << uint64_t(interval.throughput()) << ','
+        << interval.availability() << ",\"";
+    for (const std::string& event : interval.events) {
+      csv << event << (&event != &interval.events.back() ? "; " : "");
+    }
+    csv << "\"\n";
+  }
+  return bool(csv);
+}
+
+void ClusterLoad::run_client(size_t client) {
+  std::mt19937_64 rng(client + 1);
+  std::uniform_real_distribution<double> coin(0, 1);
+  std::vector<std::string> servers = this->cluster.server_addresses();
+  bool use_shardcontroller = this->cluster.uses_shardcontroller();
+  std::string prefix = "client" + std::to_string(client) + "_key";
+
+  // The version of each key last put, or 0 if unknown (never put, or the
+  // last Put failed), in which case the next op on the key is a Put
+  std::vector<uint64_t> versions(this->keys_per_client, 0);
+  uint64_t next_version = 1;
+  std::map<std::string, std::shared_ptr<ServerConn>> conns;
+  std::optional<ShardControllerConfig> config;
+  auto& counts = this->counts[client];
+
+  while (this->running) {
+    size_t k = rng() % this->keys_per_client;
+    std::string key = prefix + std::to_string(k);
+    bool put = versions[k] == 0 || coin(rng) < this->put_fraction;
+    uint64_t version = put ? next_version++ : versions[k];
+    std::string value = "value" + std::to_string(version);
+
+    std::optional<std::string> server;
+    if (!use_shardcontroller) {
+      server = servers[std::hash<std::string>{}(key) % servers.size()];
+    } else {
+      if (!config) config = this->cluster.query();
+      if (config) server = config->get_server(key);
+    }
+
+    bool ok = false;
+    if (server) {
+      std::shared_ptr<ServerConn>& conn = conns[*server];
+      if (!conn && is_listening(*server)) conn = connect_to_server(*server);
+      std::optional<Response> res;
+      if (conn) {
+        Request req;
+        if (put) {
+          req = PutRequest{key, value};
+        } else {
+          req = GetRequest{key};
+        }
+        if (conn->send_request(req)) res = conn->recv_response();
+        // Reconnect on the next request
+        if (!res) conn.reset();
+      }
+      if (res && put) {
+        ok = std::holds_alternative<PutResponse>(*res);
+      } else if (res) {
+        auto* get_res = std::get_if<GetResponse>(&*res);
+        ok = get_res && get_res->value == value;
+      }
+    }
+    if (put) versions[k] = ok ? version : 0;
+
+    size_t i = (steady_clock::now() - this->started_at) / this->interval;
+    if (counts.size() <= i) counts.resize(i + 1);
+    if (ok) {
+      counts[i].first++;
+    } else {
+      counts[i].second++;
+      // The configuration may have changed, or the server be down: look
+      // again, after a moment so as not to spin
+      config.reset();
+      std::this_thread::sleep_for(10ms);
+    }
+  }
+}
@@ -0,0 +1,194 @@
+#ifndef CLUSTER_HPP
+#define CLUSTER_HPP
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/config.hpp"
+#include "common/shard.hpp"
+#include "net/network_messages.hpp"
+
+using namespace std::chrono;
+
+struct ClusterOptions {
+  size_t n_servers = 3;
+  // The shardcontroller listens on this port, and the servers on the ones
+  // after it.
+  uint64_t start_port = 10000;
+  // Without a shardcontroller, each server is its own Concurrent Store, and
+  // ClusterLoad spreads keys over them by hash.
+  bool use_shardcontroller = true;
+  uint64_t n_workers = 2;
+  // Passed to every server (see ./server's usage).
+  std::vector<std::string> server_flags;
+  // If set, server i persists its store to <data_dir>/server<i>, so that it
+  // recovers its keys when restarted.
+  std::string data_dir;
+  // Where the server and shardcontroller executables are (tests run from the
+  // build directory).
+  std::string bin_dir = ".";
+  // Where each process's output goes, as <name>.log.
+  std::string log_dir = "cluster-logs";
+  // How long a process gets to start listening, or to exit when stopped.
+  milliseconds timeout = 5s;
+};
+
+/*
+ * A shardcontroller and `n_servers` KvServers, each in its own process on
+ * this machine, for experiments that start_server (with every server in the
+ * test's process) can't do: killing a server, or measuring how throughput
+ * scales with the number of servers.
+ *
+ * Each process's REPL reads from a pipe the cluster holds; closing it stops
+ * the process cleanly. Processes only count as started once they accept
+ * connections, rather than after a fixed sleep (as in start_server_in_thread).
+ */
+class LocalCluster {
+ public:
+  explicit LocalCluster(ClusterOptions options);
+  // Stops every process still running.
+  ~LocalCluster();
+
+  // Starts the shardcontroller (if any) and every server. Returns false (and
+  // stops what did start) if any fails to.
+  bool start();
+  void stop();
+
+  bool uses_shardcontroller() const {
+    return this->options.use_shardcontroller;
+  }
+  const std::string& shardcontroller_address() const {
+    return this->shardcontroller.address;
+  }
+  std::vector<std::string> server_addresses() const;
+  size_t n_servers() const {
+    return this->servers.size();
+  }
+  bool is_running(size_t server);
+
+  // (Re)starts server i, waiting until it accepts connections.
+  bool start_server(size_t server);
+  // Stops server i cleanly, as if its REPL got EOF.
+  bool stop_server(size_t server);
+  // Kills server i with SIGKILL, as if its machine crashed.
+  bool kill_server(size_t server);
+
+  // Sends the shardcontroller a Join, Leave or Move for server i, and
+  // returns whether it succeeded. Thread-safe.
+  bool join(size_t server);
+  bool leave(size_t server);
+  bool move(size_t server, const std::vector<Shard>& shards);
+  // The shardcontroller's configuration. Thread-safe.
+  std::optional<ShardControllerConfig> query();
+
+  LocalCluster(const LocalCluster&) = delete;
+  LocalCluster& operator=(const LocalCluster&) = delete;
+
+ private:
+  struct Process {
+    std::string name;
+    std::string address;
+    std::vector<std::string> args;
+    pid_t pid = -1;
+    // The write end of the process's stdin.
+    int stdin_fd = -1;
+  };
+
+  ClusterOptions options;
+  Process shardcontroller;
+  std::vector<Process> servers;
+  // Guards the processes, so that a test can kill a server while another
+  // thread restarts a different one.
+  std::mutex mtx;
+
+  bool spawn(Process& process);
+  // Waits until `process` accepts connections, or exits.
+  bool wait_until_listening(Process& process);
+  bool stop_process(Process& process, bool kill);
+  // Reaps `process` if it has exited; returns whether it's still running.
+  bool reap(Process& process);
+  // Sends the shardcontroller a Join, Leave or Move, and checks that it
+  // answered with a `Expected` response.
+  template <typename Expected>
+  bool request(const Request& req);
+};
+
+/*
+ * Runs a mix of Gets and Puts against a LocalCluster from `n_clients`
+ * threads (routed by the shardcontroller's configuration, or by hash without
+ * one), and counts the requests that succeed and fail in each interval, to
+ * see throughput and availability over time as servers join, leave, take
+ * over shards, fail and come back. Mark events as they happen, to line them
+ * up with the timeline:
+ *
+ *   ClusterLoad load(cluster, 4);
+ *   load.start();
+ *   std::this_thread::sleep_for(1s);
+ *   load.mark("kill server 1");
+ *   cluster.kill_server(1);
+ *   ...
+ *   std::vector<ClusterLoad::Interval> timeline = load.stop();
+ *
+ * Each client reads and writes its own keys; a Get only counts as a success
+ * if it returns the value the client last put.
+ */
+class ClusterLoad {
+ public:
+  ClusterLoad(LocalCluster& cluster, size_t n_clients,
+              double put_fraction = 0.5, milliseconds interval = 100ms,
+              size_t keys_per_client = 1000);
+  ~ClusterLoad();
+
+  struct Interval {
+    // Seconds since start(), at the interval's end.
+    double end_s;
+    double length_s;
+    uint64_t n_ok = 0;
+    uint64_t n_failed = 0;
+    // Marked during the interval.
+    std::vector<std::string> events;
+
+    double throughput() const;
+    // The fraction of requests that succeeded (1 if there were none).
+    double availability() const;
+  };
+
+  void start();
+  // Notes that `event` happened now.
+  void mark(const std::string& event);
+  // Stops the clients, and returns the timeline.
+  std::vector<Interval> stop();
+
+  // Writes a timeline as CSV, with a row per interval.
+  static bool write_csv(const std::vector<Interval>& timeline,
+                        const std::string& path);
+
+ private:
+  LocalCluster& cluster;
+  size_t n_clients;
+  double put_fraction;
+  milliseconds interval;
+  size_t keys_per_client;
+
+  steady_clock::time_point started_at;
+  std::atomic<bool> running = false;
+  std::vector<std::thread> clients;
+  // Each client's counts, by interval: {ok, failed}. Only read once the
+  // clients have stopped.
+  std::vector<std::vector<std::pair<uint64_t, uint64_t>>> counts;
+
+  std::mutex events_mtx;
+  std::vector<std::pair<steady_clock::time_point, std::string>> events;
+
+  void run_client(size_t client);
+};
+
+#endif /* end of include guard */
@@ -0,0 +1,64 @@
+#include <future>
+
+#include "test_utils/test_utils.hpp"
+
+static constexpr std::size_t kNumThreads = 8;
+static constexpr std::size_t kNumOpsPerThread = 2'000;
+
+int main(int argc, char* argv[]) {
+  auto store = make_kvstore(argc, argv);
+  auto put_req = PutRequest{.key = "cas", .value = "0"};
+  auto put_res = PutResponse{};
+  ASSERT(store->Put(&put_req, &put_res));
+
+  // Concurrent increments are never lost, and neither are CAS updates that
+  // retry until they succeed
+  auto futures = std::vector<std::future<bool>>{};
+  for (std::size_t t = 0; t < kNumThreads; t++) {
+    futures.push_back(std::async(std::launch::async, [&, t] {
+      for (std::size_t i = 0; i < kNumOpsPerThread; i++) {
+        auto incr_req = IncrRequest{.key = "counter", .delta = t % 2 ? 2 : -1};
+        auto incr_res = IncrResponse{};
+        ASSERT(store->Incr(&incr_req, &incr_res));
+
+        auto cas_req = CasRequest{.key = "cas", .expected = "0", .value = "1"};
+        auto cas_res = CasResponse{};
+        while (true) {
+          ASSERT(store->Cas(&cas_req, &cas_res));
+          if (cas_res.swapped) break;
+          cas_req.expected = cas_res.value;
+          cas_req.value = std::to_string(std::stoll(cas_res.value) + 1);
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto& f : futures) ASSERT(f.get());
+
+  auto get_req = GetRequest{.key = "counter"};
+  auto get_res = GetResponse{};
+  ASSERT(store->Get(&get_req, &get_res));
+  // Half of the threads add 2 each time, the other half subtract 1
+  ASSERT_EQ(get_res.value, std::to_string(kNumThreads / 2 * kNumOpsPerThread));
+  get_req = GetRequest{.key = "cas"};
+  ASSERT(store->Get(&get_req, &get_res));
+  ASSERT_EQ(get_res.value, std::to_string(kNumThreads * kNumOpsPerThread));
+
+  // Exactly one of many racing PutIfAbsents wins
+  futures.clear();
+  std::atomic<std::size_t> winners = 0;
+  for (std::size_t t = 0; t < kNumThreads; t++) {
+    futures.push_back(std::async(std::launch::async, [&, t] {
+      for (std::size_t i = 0; i < kNumOpsPerThread / 10; i++) {
+        auto req = PutIfAbsentRequest{.key = "lock" + std::to_string(i),
+                                      .value = std::to_string(t)};
+        auto res = PutIfAbsentResponse{};
+        ASSERT(store->PutIfAbsent(&req, &res));
+        if (res.inserted) winners++;
+      }
+      return true;
+    }));
+  }
+  for (auto& f : futures) ASSERT(f.get());
+  ASSERT_EQ(winners.load(), kNumOpsPerThread / 10);
+}
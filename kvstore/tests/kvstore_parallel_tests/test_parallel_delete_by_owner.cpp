@@ -0,0 +1,62 @@
+#include <algorithm>
+#include <future>
+#include <set>
+
+#include "test_utils/test_utils.hpp"
+
+static constexpr std::size_t kNumOwners = 4;
+static constexpr std::size_t kNumKeysPerOwner = 5'000;
+static constexpr std::size_t kNumDeletes = 50;
+
+// For each owner, a writer keeps creating the owner's keys while a deleter
+// repeatedly deletes them. Every key must end up either deleted exactly once
+// or still in the store, never both or neither.
+void test_parallel_delete_by_owner(std::unique_ptr<KvStore> store) {
+  auto deleters = std::vector<std::future<std::vector<std::string>>>{};
+  auto writers = std::vector<std::future<bool>>{};
+  for (std::size_t t = 0; t < kNumOwners; t++) {
+    std::string owner = "user_" + std::to_string(t);
+    writers.push_back(std::async(std::launch::async, [&, t, owner] {
+      for (std::size_t i = 0; i < kNumKeysPerOwner; i++) {
+        std::string post = std::to_string(t * kNumKeysPerOwner + i);
+        auto req = PutRequest{.key = "post_" + post, .value = "v",
+                              .owner = owner};
+        auto res = PutResponse{};
+        ASSERT(store->Put(&req, &res));
+      }
+      return true;
+    }));
+    deleters.push_back(std::async(std::launch::async, [&, owner] {
+      std::vector<std::string> deleted;
+      for (std::size_t i = 0; i < kNumDeletes; i++) {
+        auto req = DeleteByOwnerRequest{owner};
+        auto res = DeleteByOwnerResponse{};
+        ASSERT(store->DeleteByOwner(&req, &res));
+        deleted.insert(deleted.end(), res.keys.begin(), res.keys.end());
+      }
+      return deleted;
+    }));
+  }
+
+  for (auto& w : writers) ASSERT(w.get());
+  std::vector<std::string> seen = store->AllKeys();
+  for (auto& d : deleters) {
+    std::vector<std::string> deleted = d.get();
+    seen.insert(seen.end(), deleted.begin(), deleted.end());
+  }
+  ASSERT_EQ(seen.size(), kNumOwners * kNumKeysPerOwner);
+  ASSERT_EQ(std::set<std::string>(seen.begin(), seen.end()).size(),
+            kNumOwners * kNumKeysPerOwner);
+}
+
+int main(int argc, char* argv[]) {
+  TEST(test_parallel_delete_by_owner, make_kvstore(argc, argv));
+
+  // Deletions must also keep ConcurrentKvStore's ordered index in step
+  auto store = make_kvstore(argc, argv);
+  if (auto* concurrent = dynamic_cast<ConcurrentKvStore*>(store.get())) {
+    concurrent->EnableOrderedIndex();
+    TEST(test_parallel_delete_by_owner, std::move(store));
+  }
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <future>
+
+#include "test_utils/test_utils.hpp"
+
+static constexpr std::size_t kNumStableKeys = 2'000;
+static constexpr std::size_t kNumWriters = 4;
+static constexpr std::size_t kNumScanners = 4;
+static constexpr std::size_t kNumOpsPerThread = 20'000;
+
+void test_parallel_scan_range(std::unique_ptr<KvStore> store) {
+  // Stable keys are never touched again, so every scan must return exactly the
+  // ones in its range, wherever the churning keys around them come and go
+  auto stable = make_rand_strs(kNumStableKeys, 8);
+  std::sort(stable.begin(), stable.end());
+  ASSERT(put_range(*store, stable, stable, 0, kNumStableKeys));
+
+  std::atomic<bool> done = false;
+  auto writers = std::vector<std::future<bool>>{};
+  for (std::size_t t = 0; t < kNumWriters; t++) {
+    writers.push_back(std::async(std::launch::async, [&, t] {
+      auto keys = make_pseudo_rand_str(kNumOpsPerThread, 7, t);
+      for (std::size_t i = 0; i < kNumOpsPerThread; i++) {
+        auto put_req = PutRequest{.key = keys[i], .value = "churn"};
+        auto put_res = PutResponse{};
+        ASSERT(store->Put(&put_req, &put_res));
+        if (i >= 10) {
+          auto del_req = DeleteRequest{.key = keys[i - 10]};
+          auto del_res = DeleteResponse{};
+          store->Delete(&del_req, &del_res);
+        }
+      }
+      return true;
+    }));
+  }
+
+  auto scanners = std::vector<std::future<bool>>{};
+  for (std::size_t t = 0; t < kNumScanners; t++) {
+    scanners.push_back(std::async(std::launch::async, [&, t] {
+      std::size_t i = t;
+      while (!done) {
+        std::size_t a = (i * 7919) % kNumStableKeys;
+        std::size_t b = std::min(kNumStableKeys - 1, a + i % 200);
+        i++;
+        auto req = ScanRangeRequest{stable[a], stable[b], 0};
+        auto res = ScanRangeResponse{};
+        ASSERT(store->ScanRange(&req, &res));
+        ASSERT(std::is_sorted(res.keys.begin(), res.keys.end()));
+        std::vector<std::string> found;
+        for (std::size_t j = 0; j < res.keys.size(); j++) {
+          ASSERT(stable[a] <= res.keys[j] && res.keys[j] < stable[b]);
+          if (res.values[j] != "churn") found.push_back(res.keys[j]);
+        }
+        auto expected = std::vector<std::string>(stable.begin() + a,
+                                                 stable.begin() + b);
+        ASSERT_EQ_VECS(found, expected);
+      }
+      return true;
+    }));
+  }
+
+  for (auto& w : writers) ASSERT(w.get());
+  done = true;
+  for (auto& s : scanners) ASSERT(s.get());
+
+  // 10 keys per writer are left over
+  auto req = ScanRangeRequest{"", "", 0};
+  auto res = ScanRangeResponse{};
+  ASSERT(store->ScanRange(&req, &res));
+  ASSERT_EQ(res.keys.size(), kNumStableKeys + 10 * kNumWriters);
+  ASSERT_EQ(res.keys.size(), store->AllKeys().size());
+}
+
+int main(int argc, char* argv[]) {
+  TEST(test_parallel_scan_range, make_kvstore(argc, argv));
+
+  // ConcurrentKvStore can also answer scans from its ordered index, whose
+  // nodes the writers unlink and free while the scanners walk them
+  auto store = make_kvstore(argc, argv);
+  if (auto* concurrent = dynamic_cast<ConcurrentKvStore*>(store.get())) {
+    concurrent->EnableOrderedIndex();
+    TEST(test_parallel_scan_range, std::move(store));
+  }
+  return 0;
+}
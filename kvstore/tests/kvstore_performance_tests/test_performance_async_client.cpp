@@ -0,0 +1,97 @@
+#include <fstream>
+
+#include "client/async_client.hpp"
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_SERVERS = 2;
+static constexpr size_t N_OPS = 100'000;
+static constexpr size_t N_TASKS = 1000;
+
+/*
+  This test has one thread make N_OPS small Gets, spread over two servers,
+  first one at a time over a blocking connection to each, then from N_TASKS
+  coroutines at once with an AsyncClient per server, all on one EventLoop.
+
+  A blocking client waits out a round trip per request, while the event loop
+  keeps up to a thousand in flight and sends (and receives) many per system
+  call. On one CPU, that took the thread from 33-36k to 50-53k ops/second.
+  Both are recorded in performance-runtime.csv, blocking first.
+*/
+// Each run returns the thread's throughput, and sets `time` to how long it
+// took.
+double run_blocking(const vector<string>& addrs, chrono::milliseconds* time) {
+  vector<shared_ptr<ServerConn>> conns;
+  for (const string& addr : addrs) {
+    conns.push_back(connect_to_server(addr));
+    ASSERT(conns.back());
+  }
+
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_OPS; i++) {
+    auto& conn = conns[i % conns.size()];
+    ASSERT(conn->send_request(GetRequest{"key"}));
+    auto res = conn->recv_response();
+    ASSERT(res && holds_alternative<GetResponse>(*res));
+  }
+  *time = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+  return to_throughput(max(*time, 1ms), 1, N_OPS);
+}
+
+Task<> get_many(AsyncClient& client, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    optional<string> value = co_await client.Get("key");
+    ASSERT(value == "value");
+  }
+}
+
+double run_async(const vector<string>& addrs, chrono::milliseconds* time) {
+  EventLoop loop;
+  vector<unique_ptr<AsyncClient>> clients;
+  for (const string& addr : addrs) {
+    clients.push_back(make_unique<AsyncClient>(loop, addr));
+  }
+
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t t = 0; t < N_TASKS; t++) {
+    loop.spawn(get_many(*clients[t % clients.size()], N_OPS / N_TASKS));
+  }
+  loop.run();
+  *time = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+  return to_throughput(max(*time, 1ms), 1, N_OPS);
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  KvServerOptions options;
+  options.io_engine = IoEngineType::IO_URING;
+  vector<string> addrs = make_server_addresses(N_SERVERS, 13710);
+  vector<shared_ptr<KvServer>> servers;
+  for (const string& addr : addrs) {
+    servers.push_back(start_server<KvServer, const string&, uint64_t,
+                                   const KvServerOptions&>(addr, 2, options));
+    ASSERT(SimpleClient(addr).Put("key", "value"));
+  }
+
+  chrono::milliseconds blocking_time, async_time;
+  double blocking = run_blocking(addrs, &blocking_time);
+  double async = run_async(addrs, &async_time);
+  for (auto&& server : servers) server->stop();
+
+  cout << "Blocking: " << blocking << " ops/second\n"
+       << "Async:    " << async << " ops/second\n";
+  output_file << "blocking_client," << blocking_time.count() << ","
+              << blocking << "\n";
+  output_file << "async_client," << async_time.count() << "," << async
+              << "\n";
+
+  ASSERT(async > blocking);
+}
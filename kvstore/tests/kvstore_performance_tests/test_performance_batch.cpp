@@ -0,0 +1,84 @@
+#include <fstream>
+
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_SINGLE_OPS = 200;
+static constexpr size_t N_BATCHED_OPS = 20'000;
+static constexpr size_t BATCH_SIZE = 100;
+
+/*
+  This test compares sending a mix of Gets, Puts, Appends and Deletes one
+  request at a time with sending them in batches of BATCH_SIZE. Each request
+  costs a connection, a message each way and a trip through a worker's queue,
+  which a batch pays once for all of its ops, so batching should be at least
+  ten times faster.
+*/
+BatchOp make_op(size_t i) {
+  string key = "key" + to_string(i / 4);
+  switch (i % 4) {
+    case 0:
+      return PutRequest{key, "value"};
+    case 1:
+      return AppendRequest{key, "+"};
+    case 2:
+      return GetRequest{key};
+    default:
+      return DeleteRequest{key};
+  }
+}
+
+bool run_op(SimpleClient& client, const BatchOp& op) {
+  if (auto* r = get_if<PutRequest>(&op)) return client.Put(r->key, r->value);
+  if (auto* r = get_if<AppendRequest>(&op)) {
+    return client.Append(r->key, r->value);
+  }
+  if (auto* r = get_if<GetRequest>(&op)) return client.Get(r->key) == "value+";
+  return client.Delete(get<DeleteRequest>(op).key) == "value+";
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  string addr = make_server_addresses(1, 12800)[0];
+  auto server = start_server<KvServer, const string&, uint64_t>(addr, 2);
+  SimpleClient client(addr);
+
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_SINGLE_OPS; i++) {
+    ASSERT(run_op(client, make_op(i)));
+  }
+  auto single = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+
+  start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_BATCHED_OPS; i += BATCH_SIZE) {
+    vector<BatchOp> ops;
+    for (size_t j = i; j < i + BATCH_SIZE; j++) ops.push_back(make_op(j));
+    auto results = client.Batch(std::move(ops));
+    ASSERT(results);
+    for (auto&& result : *results) {
+      ASSERT(!holds_alternative<ErrorResponse>(result));
+    }
+  }
+  auto batched = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+
+  double single_tput = to_throughput(max(single, 1ms), 1, N_SINGLE_OPS);
+  double batched_tput = to_throughput(max(batched, 1ms), 1, N_BATCHED_OPS);
+  cout << "one op per request: " << single_tput << " ops/second\n"
+       << "batches of " << BATCH_SIZE << ":      " << batched_tput
+       << " ops/second\n";
+  output_file << "single_op_requests," << single.count() << "," << single_tput
+              << "\n";
+  output_file << "batched_requests," << batched.count() << "," << batched_tput
+              << "\n";
+
+  ASSERT(batched_tput >= 10 * single_tput);
+  server->stop();
+}
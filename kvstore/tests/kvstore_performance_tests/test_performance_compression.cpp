@@ -0,0 +1,165 @@
+#include <fstream>
+#include <random>
+
+#include "client/simple_client.hpp"
+#include "common/lz4.hpp"
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_VALUES = 2'000;
+static constexpr size_t VALUE_SIZE = 8 * 1024;
+static constexpr size_t BATCH_SIZE = 100;
+
+/*
+  This test measures value compression on N_VALUES JSON documents of about
+  VALUE_SIZE bytes each, and reports:
+
+    - the compression ratio, and the CPU cost of compressing and
+      decompressing, in MB (of uncompressed data) per second;
+    - how much memory a store holding the documents uses with and without
+      compression;
+    - how many bytes MultiPuts and MultiGets of the documents take on the wire
+      with and without compression, and how long they take end to end.
+
+  JSON compresses well (field names repeat, values are mostly digits), so the
+  documents should shrink to less than half their size both in memory and on
+  the wire. The end-to-end times, uncompressed then compressed, are also
+  recorded in performance-runtime.csv.
+*/
+string make_json(size_t size, mt19937& rng) {
+  static const vector<string> cities = {"Providence", "Boston", "New York",
+                                        "San Francisco", "Chicago"};
+  string json = "[";
+  for (size_t i = 0; json.size() < size; i++) {
+    uint32_t id = rng() % 1'000'000;
+    json += (i ? "," : "") + string("{\"id\":") + to_string(id) +
+            ",\"username\":\"user_" + to_string(id) + "\",\"email\":\"user_" +
+            to_string(id) + "@example.com\",\"city\":\"" +
+            cities[rng() % cities.size()] +
+            "\",\"verified\":" + (rng() % 2 ? "true" : "false") +
+            ",\"followers\":" + to_string(rng() % 10'000) +
+            ",\"created_at\":\"2024-0" + to_string(1 + rng() % 9) + "-1" +
+            to_string(rng() % 10) + "\"}";
+  }
+  return json + "]";
+}
+
+double mb_per_second(size_t bytes, chrono::nanoseconds time) {
+  return double(bytes) / (1 << 20) / (max(time.count(), 1l) / 1e9);
+}
+
+// Sends the values to a fresh server on `port` in batches, reads them back, and
+// returns the bytes of the request and response bodies on the wire.
+size_t wire_bytes(const vector<string>& values, uint16_t port,
+                  WireFormat format, size_t compress_threshold,
+                  chrono::milliseconds* time) {
+  KvServerOptions options;
+  options.compress_threshold = compress_threshold;
+  string addr = make_server_addresses(1, port)[0];
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 1, options);
+
+  size_t bytes = 0;
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < values.size(); i += BATCH_SIZE) {
+    vector<string> keys;
+    for (size_t j = i; j < i + BATCH_SIZE; j++) keys.push_back(to_string(j));
+    vector<string> batch(values.begin() + i, values.begin() + i + BATCH_SIZE);
+    for (Request req : {Request{MultiPutRequest{keys, batch}},
+                        Request{MultiGetRequest{keys}}}) {
+      auto conn = connect_to_server(addr);
+      ASSERT(conn);
+      conn->wire_format = format;
+      auto msg = serialize_request(req, format);
+      ASSERT(msg);
+      bytes += msg->buf.size();
+      ASSERT(send_message(conn->fd, &*msg));
+      Message res_msg;
+      ASSERT(recv_message(conn->fd, &res_msg));
+      bytes += res_msg.buf.size();
+      auto res = deserialize_response(res_msg);
+      ASSERT(res);
+      if (auto* mget_res = get_if<MultiGetResponse>(&*res)) {
+        ASSERT_EQ_VECS(mget_res->values, batch);
+      } else {
+        ASSERT(holds_alternative<MultiPutResponse>(*res));
+      }
+    }
+  }
+  *time = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+  server->stop();
+  return bytes;
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  mt19937 rng(0);
+  vector<string> values;
+  size_t total = 0;
+  for (size_t i = 0; i < N_VALUES; i++) {
+    values.push_back(make_json(VALUE_SIZE, rng));
+    total += values.back().size();
+  }
+
+  // Raw codec speed
+  vector<string> compressed(N_VALUES);
+  size_t compressed_total = 0;
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_VALUES; i++) {
+    compressed[i] = lz4_compress(values[i]);
+    compressed_total += compressed[i].size();
+  }
+  auto compress_time = chrono::high_resolution_clock::now() - start;
+  start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_VALUES; i++) {
+    ASSERT(lz4_decompress(compressed[i])->size() == values[i].size());
+  }
+  auto decompress_time = chrono::high_resolution_clock::now() - start;
+  double ratio = double(total) / compressed_total;
+  cout << "compression ratio:  " << ratio << "\n"
+       << "compression:        " << mb_per_second(total, compress_time)
+       << " MB/s\n"
+       << "decompression:      " << mb_per_second(total, decompress_time)
+       << " MB/s\n";
+
+  // Memory
+  ConcurrentKvStore plain, packed;
+  packed.EnableCompression(1024);
+  for (size_t i = 0; i < N_VALUES; i++) {
+    auto req = PutRequest{to_string(i), values[i]};
+    auto res = PutResponse{};
+    ASSERT(plain.Put(&req, &res));
+    ASSERT(packed.Put(&req, &res));
+  }
+  size_t plain_bytes = plain.GetCacheStats().used_bytes;
+  size_t packed_bytes = packed.GetCacheStats().used_bytes;
+  cout << "store memory:       " << plain_bytes << " bytes uncompressed, "
+       << packed_bytes << " compressed\n";
+
+  // Wire
+  chrono::milliseconds plain_time, packed_time;
+  size_t plain_wire =
+      wire_bytes(values, 13000, {WireVersion::V2, false}, 0, &plain_time);
+  size_t packed_wire =
+      wire_bytes(values, 13001, {WireVersion::V2, true}, 1024, &packed_time);
+  cout << "wire bytes:         " << plain_wire << " uncompressed ("
+       << plain_time.count() << " ms), " << packed_wire << " compressed ("
+       << packed_time.count() << " ms)\n";
+  // Each value is written once and read once
+  double plain_tput = to_throughput(max(plain_time, 1ms), 1, 2 * N_VALUES);
+  double packed_tput = to_throughput(max(packed_time, 1ms), 1, 2 * N_VALUES);
+  output_file << "uncompressed_transfer," << plain_time.count() << ","
+              << plain_tput << "\n";
+  output_file << "compressed_transfer," << packed_time.count() << ","
+              << packed_tput << "\n";
+
+  ASSERT(ratio >= 2);
+  ASSERT(packed_bytes * 2 <= plain_bytes);
+  ASSERT(packed_wire * 2 <= plain_wire);
+}
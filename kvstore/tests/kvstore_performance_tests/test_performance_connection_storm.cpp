@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <fstream>
+#include <future>
+
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_THREADS = 16;
+static constexpr auto DURATION = 2s;
+static constexpr size_t N_ACCEPTORS = 4;
+
+/*
+  This test opens and closes connections to a server as fast as N_THREADS
+  clients can for DURATION, and reports the rate of connections and the tail
+  latency of connecting, for:
+
+    - a single acceptor thread with a backlog of 100 (the old defaults);
+    - a single acceptor thread with the default backlog of BACKLOG;
+    - N_ACCEPTORS acceptor threads sharing the port (SO_REUSEPORT), each with
+      its own socket and so its own backlog.
+
+  When a listener's backlog is full, the kernel drops the connection attempt
+  and the client only retries a second later, which caps the rate at a few
+  hundred connects per second and puts a second into the tail.
+
+  Each configuration's rate is recorded in performance-runtime.csv after the
+  old defaults', so that it's plotted as a speedup over them.
+*/
+struct StormResult {
+  double connects_per_second;
+  microseconds p99;
+};
+
+StormResult storm(const string& addr) {
+  vector<future<vector<microseconds>>> futures;
+  for (size_t t = 0; t < N_THREADS; t++) {
+    futures.push_back(async(launch::async, [&] {
+      vector<microseconds> latencies;
+      auto end = chrono::steady_clock::now() + DURATION;
+      while (chrono::steady_clock::now() < end) {
+        auto start = chrono::steady_clock::now();
+        int fd = connect_to_address(addr);
+        ASSERT(fd >= 0);
+        latencies.push_back(duration_cast<microseconds>(
+            chrono::steady_clock::now() - start));
+        close(fd);
+      }
+      return latencies;
+    }));
+  }
+
+  vector<microseconds> latencies;
+  for (auto&& f : futures) {
+    auto thread_latencies = f.get();
+    latencies.insert(latencies.end(), thread_latencies.begin(),
+                     thread_latencies.end());
+  }
+  sort(latencies.begin(), latencies.end());
+  return {latencies.size() / duration<double>(DURATION).count(),
+          latencies[latencies.size() * 99 / 100]};
+}
+
+StormResult run(int port, size_t n_acceptors, int backlog) {
+  KvServerOptions options;
+  options.n_acceptors = n_acceptors;
+  options.socket_options.backlog = backlog;
+  string addr = make_server_addresses(1, port)[0];
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 2, options);
+  StormResult result = storm(addr);
+  server->stop();
+  cout << n_acceptors << " acceptor(s), backlog " << backlog << ": "
+       << result.connects_per_second << " connects/second, p99 "
+       << result.p99.count() << "us\n";
+  return result;
+}
+
+// Records a configuration's result in `output_file`.
+void record(ofstream& output_file, const string& name,
+            const StormResult& result) {
+  output_file << name << ","
+              << duration_cast<milliseconds>(DURATION).count() << ","
+              << result.connects_per_second << "\n";
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  StormResult old_defaults = run(13300, 1, 100);
+  StormResult deeper = run(13301, 1, BACKLOG);
+  StormResult multi = run(13302, N_ACCEPTORS, BACKLOG);
+  record(output_file, "one_acceptor_backlog_100", old_defaults);
+  record(output_file, "one_acceptor_default_backlog", deeper);
+  record(output_file, "one_acceptor_backlog_100", old_defaults);
+  record(output_file, "reuseport_acceptors", multi);
+
+  ASSERT(multi.connects_per_second >= 5 * old_defaults.connects_per_second);
+  ASSERT(multi.p99 < old_defaults.p99);
+}
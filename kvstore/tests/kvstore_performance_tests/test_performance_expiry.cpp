@@ -0,0 +1,101 @@
+#include <algorithm>
+#include <fstream>
+
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_KEYS = 50'000;
+static constexpr size_t BATCH_SIZE = 1'000;
+static constexpr auto TTL = 10s;
+
+/*
+  This test measures whether reclaiming a large number of keys that expire at
+  the same moment disturbs foreground requests. It loads N_KEYS keys with the
+  same deadline (and as many that never expire, so that the buckets don't
+  empty out as the others are reclaimed), then times individual Puts of
+  unrelated keys while the keys expire and are reclaimed in the background,
+  and compares the latencies with a baseline taken before anything expired.
+*/
+vector<double> time_puts(ConcurrentKvStore& store, milliseconds duration) {
+  vector<double> latencies;
+  auto end = chrono::steady_clock::now() + duration;
+  for (size_t i = 0; chrono::steady_clock::now() < end; i++) {
+    auto req = PutRequest{.key = "other" + to_string(i % 1000), .value = "v"};
+    auto res = PutResponse{};
+    auto start = chrono::steady_clock::now();
+    ASSERT(store.Put(&req, &res));
+    auto time = chrono::steady_clock::now() - start;
+    latencies.push_back(chrono::duration<double, micro>(time).count());
+  }
+  sort(latencies.begin(), latencies.end());
+  return latencies;
+}
+
+double percentile(const vector<double>& sorted, double p) {
+  return sorted[min(sorted.size() - 1, size_t(p * sorted.size()))];
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  ConcurrentKvStore store;
+  for (size_t i = 0; i < N_KEYS; i += BATCH_SIZE) {
+    auto req = MultiPutRequest{.keys = {}, .values = {}};
+    for (size_t j = i; j < min(i + BATCH_SIZE, N_KEYS); j++) {
+      req.keys.push_back("user" + to_string(j));
+      req.values.push_back("data");
+    }
+    auto res = MultiPutResponse{};
+    ASSERT(store.MultiPut(&req, &res));
+  }
+
+  // Every key expires at the same moment, however long the load takes
+  auto expiry = chrono::steady_clock::now() + TTL;
+  for (size_t i = 0; i < N_KEYS; i += BATCH_SIZE) {
+    auto ttl = chrono::ceil<milliseconds>(expiry - chrono::steady_clock::now());
+    auto req = MultiPutRequest{
+        .keys = {}, .values = {}, .ttl_ms = uint64_t(max(ttl, 1ms).count())};
+    for (size_t j = i; j < min(i + BATCH_SIZE, N_KEYS); j++) {
+      req.keys.push_back("session" + to_string(j));
+      req.values.push_back("data");
+    }
+    auto res = MultiPutResponse{};
+    ASSERT(store.MultiPut(&req, &res));
+  }
+
+  // The load takes a fraction of the TTL, which leaves plenty of time for the
+  // baseline before anything expires
+  auto baseline_time = 200ms;
+  auto baseline = time_puts(store, baseline_time);
+  ASSERT(chrono::steady_clock::now() < expiry);
+  // Time Puts from when the keys expire until well after they've all been
+  // reclaimed
+  this_thread::sleep_until(expiry);
+  auto reclaiming_time = 2000ms;
+  auto reclaiming = time_puts(store, reclaiming_time);
+
+  ASSERT_EQ(store.AllKeys().size(), N_KEYS + 1000);
+
+  cout << "put latency (us)    p50      p99      max\n"
+       << "baseline:       " << percentile(baseline, 0.5) << "  "
+       << percentile(baseline, 0.99) << "  " << baseline.back() << "\n"
+       << "reclaiming:     " << percentile(reclaiming, 0.5) << "  "
+       << percentile(reclaiming, 0.99) << "  " << reclaiming.back() << "\n";
+
+  output_file << "baseline_put," << baseline_time.count() << ","
+              << to_throughput(baseline_time, 1, baseline.size()) << "\n";
+  output_file << "put_while_expiring," << reclaiming_time.count() << ","
+              << to_throughput(reclaiming_time, 1, reclaiming.size()) << "\n";
+
+  // The expirer takes each bucket's lock only to remove a single key, so
+  // Puts shouldn't generally slow down. With fewer cores than threads, some
+  // Puts do wait for the expirer to be descheduled, so the tail is allowed a
+  // few scheduler time slices on top.
+  ASSERT(percentile(reclaiming, 0.5) < 2 * percentile(baseline, 0.5));
+  ASSERT(percentile(reclaiming, 0.99) <
+         10 * percentile(baseline, 0.99) + 10'000);
+}
@@ -0,0 +1,141 @@
+#include <fstream>
+#include <numeric>
+#include <random>
+
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_USERS = 170'000;
+static constexpr size_t N_POSTS_PER_USER = 2;
+static constexpr size_t N_DELETED_USERS = 500;
+static constexpr size_t BATCH_SIZE = 6'000;
+
+/*
+  This test compares two ways of deleting all of a user's data from a server
+  holding about a million keys laid out like gdpr/database.csv: N_USERS users,
+  each with a name (user_7), a list of posts (user_7_posts), the posts
+  themselves (numbered across all users, e.g. post_15), and a list of the
+  replies to each post (post_15_replies). One all_users key lists every user;
+  it is shared, so it has no owner and neither way deletes it. Every key but
+  all_users is written with its user as the owner:
+
+    - round trips, as the client would without server support: Get the list
+      of posts, then Delete each post and its replies, the list, and the user;
+    - a single DeleteByOwner request, which the server answers from its owner
+      index.
+
+  DeleteByOwner needs one request where the round trips need 3 + twice the
+  number of posts, so it should be at least twice as fast.
+*/
+bool delete_with_round_trips(SimpleClient& client, const string& user) {
+  optional<string> posts = client.Get(user + "_posts");
+  if (!posts) return false;
+  size_t start = 0;
+  while (start <= posts->size()) {
+    size_t end = min(posts->find(',', start), posts->size());
+    string post = posts->substr(start, end - start);
+    if (!client.Delete(post) || !client.Delete(post + "_replies")) {
+      return false;
+    }
+    start = end + 1;
+  }
+  return client.Delete(user + "_posts") && client.Delete(user);
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  KvServerOptions options;
+  // About one key per bucket, as a server sized for this dataset would be
+  options.n_buckets = 1 << 20;
+  string addr = make_server_addresses(1, 12400)[0];
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 2, options);
+  SimpleClient client(addr);
+
+  vector<string> keys, values, owners;
+  string all_users;
+  for (size_t i = 1; i <= N_USERS; i++) {
+    string user = "user_" + to_string(i);
+    string posts;
+    for (size_t j = 0; j < N_POSTS_PER_USER; j++) {
+      size_t id = (i - 1) * N_POSTS_PER_USER + j + 1;
+      string post = "post_" + to_string(id);
+      keys.push_back(post);
+      values.push_back("post " + to_string(id) + " by " + user);
+      owners.push_back(user);
+      // Replies are other users' posts
+      keys.push_back(post + "_replies");
+      values.push_back("post_" + to_string(id % N_USERS + 1) + ",post_" +
+                       to_string((id + N_USERS / 2) % N_USERS + 1));
+      owners.push_back(user);
+      posts += (j ? "," : "") + post;
+    }
+    keys.push_back(user + "_posts");
+    values.push_back(posts);
+    owners.push_back(user);
+    keys.push_back(user);
+    values.push_back("name of " + user);
+    owners.push_back(user);
+    all_users += (i > 1 ? "," : "") + user;
+
+    if (keys.size() >= BATCH_SIZE || i == N_USERS) {
+      ASSERT(client.MultiPut(keys, values, 0, owners));
+      keys.clear();
+      values.clear();
+      owners.clear();
+    }
+  }
+  ASSERT(client.Put("all_users", all_users));
+
+  // Delete disjoint random samples of users each way
+  vector<size_t> users(N_USERS);
+  iota(users.begin(), users.end(), 1);
+  shuffle(users.begin(), users.end(), mt19937(0));
+
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_DELETED_USERS; i++) {
+    ASSERT(delete_with_round_trips(client, "user_" + to_string(users[i])));
+  }
+  auto round_trips = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+
+  start = chrono::high_resolution_clock::now();
+  for (size_t i = N_DELETED_USERS; i < 2 * N_DELETED_USERS; i++) {
+    auto deleted = client.DeleteByOwner("user_" + to_string(users[i]));
+    ASSERT(deleted);
+    ASSERT_EQ(deleted->size(), 2 * N_POSTS_PER_USER + 2);
+  }
+  auto by_owner = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+
+  // Both leave nothing of the deleted users behind, and only their data
+  for (size_t i = 0; i < 2 * N_DELETED_USERS; i += 97) {
+    string user = "user_" + to_string(users[i]);
+    string post = "post_" + to_string((users[i] - 1) * N_POSTS_PER_USER + 1);
+    ASSERT(!client.Get(user));
+    ASSERT(!client.Get(user + "_posts"));
+    ASSERT(!client.Get(post));
+    ASSERT(!client.Get(post + "_replies"));
+  }
+  string survivor = "user_" + to_string(users[2 * N_DELETED_USERS]);
+  ASSERT(client.Get(survivor));
+  ASSERT(client.Get(survivor + "_posts"));
+  ASSERT(client.Get("all_users") == all_users);
+
+  double round_trip_tput = to_throughput(max(round_trips, 1ms), 1,
+                                         N_DELETED_USERS);
+  double by_owner_tput = to_throughput(max(by_owner, 1ms), 1, N_DELETED_USERS);
+  output_file << "round_trip_gdpr_delete," << round_trips.count() << ","
+              << round_trip_tput << "\n";
+  output_file << "delete_by_owner," << by_owner.count() << "," << by_owner_tput
+              << "\n";
+
+  ASSERT(by_owner_tput >= 2 * round_trip_tput);
+  server->stop();
+}
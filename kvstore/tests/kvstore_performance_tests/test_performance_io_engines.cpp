@@ -0,0 +1,100 @@
+#include <fstream>
+#include <future>
+
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_CONNECTIONS = 1000;
+static constexpr size_t N_CLIENT_THREADS = 4;
+static constexpr size_t N_ROUNDS = 50;
+
+struct Result {
+  double throughput;
+  double syscalls_per_request;
+  chrono::milliseconds time;
+};
+
+/*
+  This test holds 1000 connections open to a server with two workers, and has
+  each send a Get at a time, N_ROUNDS times over. Each client thread owns a
+  quarter of the connections, and sends a request on each before it reads
+  the responses, so that the server always has plenty to do at once.
+
+  With the default THREADS engine, all but two of those connections would
+  wait for one of the first two to close, so only the event-driven engines
+  take part. On one CPU, epoll made about 2 system calls per request (a recv
+  and a send; the waits and wakeups are shared by many requests) for 44-45k
+  ops/second, and io_uring under 0.01 (one io_uring_enter for hundreds of
+  requests) for 52-58k ops/second. Both are recorded in
+  performance-runtime.csv, epoll first.
+*/
+Result run(IoEngineType type, int port) {
+  KvServerOptions options;
+  options.io_engine = type;
+  string addr = make_server_addresses(1, port)[0];
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 2, options);
+  ASSERT(server->io_engine_type() == type);
+
+  vector<int> fds;
+  for (size_t i = 0; i < N_CONNECTIONS; i++) {
+    fds.push_back(connect_to_address(addr));
+    ASSERT(fds.back() >= 0);
+  }
+  auto put = serialize_request(PutRequest{"key", "value"});
+  auto get = serialize_request(GetRequest{"key"});
+  ASSERT(put && get && send_message(fds[0], &*put));
+  Message res;
+  ASSERT(recv_message(fds[0], &res));
+
+  uint64_t syscalls_before = server->io_syscalls();
+  auto start = chrono::high_resolution_clock::now();
+  vector<future<bool>> futures;
+  for (size_t t = 0; t < N_CLIENT_THREADS; t++) {
+    futures.push_back(async(launch::async, [&, t] {
+      Message res;
+      for (size_t round = 0; round < N_ROUNDS; round++) {
+        for (size_t i = t; i < fds.size(); i += N_CLIENT_THREADS) {
+          ASSERT(send_message(fds[i], &*get));
+        }
+        for (size_t i = t; i < fds.size(); i += N_CLIENT_THREADS) {
+          ASSERT(recv_message(fds[i], &res, 2000ms));
+          ASSERT(res.type == MessageType::GET);
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto&& f : futures) ASSERT(f.get());
+  auto time = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+  uint64_t syscalls = server->io_syscalls() - syscalls_before;
+
+  for (int fd : fds) close(fd);
+  server->stop();
+  double n_requests = N_CONNECTIONS * N_ROUNDS;
+  return {to_throughput(max(time, 1ms), N_CONNECTIONS, N_ROUNDS),
+          syscalls / n_requests, time};
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  Result epoll = run(IoEngineType::EPOLL, 13600);
+  Result uring = run(IoEngineType::IO_URING, 13601);
+
+  cout << "epoll:    " << epoll.throughput << " ops/second, "
+       << epoll.syscalls_per_request << " system calls per request\n"
+       << "io_uring: " << uring.throughput << " ops/second, "
+       << uring.syscalls_per_request << " system calls per request\n";
+  output_file << "epoll_engine," << epoll.time.count() << ","
+              << epoll.throughput << "\n";
+  output_file << "io_uring_engine," << uring.time.count() << ","
+              << uring.throughput << "\n";
+
+  ASSERT(uring.syscalls_per_request < epoll.syscalls_per_request);
+}
@@ -0,0 +1,192 @@
+#include <fstream>
+#include <iomanip>
+
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_ITERATIONS = 20'000;
+static constexpr size_t N_KEYS = 100;
+static constexpr size_t N_DECODES = 200'000;
+
+/*
+  This microbenchmark serializes and deserializes one message of every type in
+  each wire format version, and prints its size and how long a round trip
+  takes. Typical keys and values are under 128 bytes, so their lengths take
+  one byte in V2 instead of four in V1, and every message with a string or
+  vector in it should shrink.
+
+  It then times decoding the read-path requests that the server decodes as
+  views (see deserialize_read_request) both ways, and records each pair in
+  performance-runtime.csv.
+*/
+string key(size_t i) {
+  return "user_" + to_string(i) + "_posts";
+}
+
+vector<string> keys(size_t n) {
+  vector<string> keys;
+  for (size_t i = 0; i < n; i++) keys.push_back(key(i));
+  return keys;
+}
+
+const string VALUE(100, 'v');
+
+vector<pair<string, Request>> sample_requests() {
+  Shard shard{"a", "m"};
+  return {
+      {"Join", JoinRequest{"127.0.0.1:1234"}},
+      {"Leave", LeaveRequest{"127.0.0.1:1234"}},
+      {"Move", MoveRequest{"127.0.0.1:1234", {shard, shard}}},
+      {"Query", QueryRequest{}},
+      {"Get", GetRequest{key(0)}},
+      {"Put", PutRequest{key(0), VALUE}},
+      {"Append", AppendRequest{key(0), VALUE}},
+      {"Delete", DeleteRequest{key(0)}},
+      {"MultiGet", MultiGetRequest{keys(N_KEYS)}},
+      {"MultiPut",
+       MultiPutRequest{keys(N_KEYS), vector<string>(N_KEYS, VALUE)}},
+      {"ScanRange", ScanRangeRequest{key(0), key(1), 10}},
+      {"Cas", CasRequest{key(0), VALUE, VALUE}},
+      {"Incr", IncrRequest{key(0), 1}},
+      {"PutIfAbsent", PutIfAbsentRequest{key(0), VALUE}},
+      {"Prepare", PrepareRequest{1, keys(10), vector<string>(10, VALUE)}},
+      {"Commit", CommitRequest{1}},
+      {"Abort", AbortRequest{1}},
+      {"DeleteByOwner", DeleteByOwnerRequest{"user_0"}},
+      {"Batch", BatchRequest{{GetRequest{key(0)}, PutRequest{key(1), VALUE},
+                              AppendRequest{key(2), VALUE},
+                              DeleteRequest{key(3)}}}},
+  };
+}
+
+vector<pair<string, Response>> sample_responses() {
+  ShardControllerConfig config;
+  config.server_to_shards["127.0.0.1:1234"] = {Shard{"a", "m"}};
+  config.server_to_shards["127.0.0.1:1235"] = {Shard{"n", "z"}};
+  return {
+      {"Join", JoinResponse{}},
+      {"Leave", LeaveResponse{}},
+      {"Move", MoveResponse{}},
+      {"Query", QueryResponse{config}},
+      {"Get", GetResponse{VALUE}},
+      {"Put", PutResponse{}},
+      {"Append", AppendResponse{}},
+      {"Delete", DeleteResponse{VALUE}},
+      {"MultiGet", MultiGetResponse{vector<string>(N_KEYS, VALUE)}},
+      {"MultiPut", MultiPutResponse{}},
+      {"ScanRange",
+       ScanRangeResponse{keys(10), vector<string>(10, VALUE)}},
+      {"Cas", CasResponse{false, VALUE}},
+      {"Incr", IncrResponse{42}},
+      {"PutIfAbsent", PutIfAbsentResponse{false, VALUE}},
+      {"Prepare", PrepareResponse{true}},
+      {"Commit", CommitResponse{}},
+      {"Abort", AbortResponse{}},
+      {"DeleteByOwner", DeleteByOwnerResponse{keys(10)}},
+      {"Batch", BatchResponse{{GetResponse{VALUE}, PutResponse{},
+                               AppendResponse{}, DeleteResponse{VALUE}}}},
+      {"Error", ErrorResponse{"key does not exist in the KVStore"}},
+  };
+}
+
+// Returns the serialized size of `msg` in `version`, and prints it along with
+// the average time to serialize and deserialize it.
+template <typename T>
+size_t bench(const T& msg, WireVersion version) {
+  // Compression is measured separately (see test_performance_compression)
+  WireFormat format{version, false};
+  auto serialize = [&] {
+    if constexpr (is_same_v<T, Request>) {
+      return serialize_request(msg, format);
+    } else {
+      return serialize_response(msg, format);
+    }
+  };
+  auto deserialize = [&](const Message& buf) {
+    if constexpr (is_same_v<T, Request>) {
+      return deserialize_request(buf);
+    } else {
+      return deserialize_response(buf);
+    }
+  };
+
+  optional<Message> serialized = serialize();
+  ASSERT(serialized);
+  auto out = deserialize(*serialized);
+  ASSERT(out);
+  ASSERT_EQ(out->index(), msg.index());
+
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_ITERATIONS; i++) {
+    serialized = serialize();
+    out = deserialize(*serialized);
+  }
+  auto time = chrono::duration_cast<chrono::nanoseconds>(
+      chrono::high_resolution_clock::now() - start);
+  cout << setw(8) << serialized->buf.size() << " B " << setw(8)
+       << time.count() / N_ITERATIONS << " ns";
+  return serialized->buf.size();
+}
+
+template <typename T>
+void bench_all(const string& kind, const vector<pair<string, T>>& samples) {
+  cout << kind << setw(30 - kind.size()) << "V1" << setw(23) << "V2\n";
+  for (auto&& [name, msg] : samples) {
+    cout << "  " << name << setw(16 - name.size()) << "";
+    size_t v1 = bench(msg, WireVersion::V1);
+    size_t v2 = bench(msg, WireVersion::V2);
+    cout << '\n';
+    ASSERT(v2 <= v1);
+  }
+}
+
+// Times decoding `req` N_DECODES times, into an owning Request and into a view,
+// and records both.
+void bench_decode(ofstream& output_file, const string& name,
+                  const Request& req) {
+  optional<Message> msg = serialize_request(req, {WireVersion::V2, false});
+  ASSERT(msg);
+  ASSERT(deserialize_read_request(*msg));
+
+  auto start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_DECODES; i++) ASSERT(deserialize_request(*msg));
+  auto owned = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+
+  start = chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < N_DECODES; i++) {
+    ASSERT(deserialize_read_request(*msg));
+  }
+  auto viewed = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+
+  double owned_tput = to_throughput(max(owned, 1ms), 1, N_DECODES);
+  double viewed_tput = to_throughput(max(viewed, 1ms), 1, N_DECODES);
+  cout << "  " << name << setw(16 - name.size()) << "" << setw(12)
+       << owned_tput << setw(12) << viewed_tput << " decodes/second\n";
+  output_file << name << "_owned_decode," << owned.count() << ","
+              << owned_tput << "\n";
+  output_file << name << "_view_decode," << viewed.count() << ","
+              << viewed_tput << "\n";
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  bench_all("Requests", sample_requests());
+  bench_all("Responses", sample_responses());
+
+  cout << "Decoding" << setw(22) << "owned" << setw(12) << "view\n";
+  bench_decode(output_file, "get", GetRequest{key(0)});
+  bench_decode(output_file, "multiget", MultiGetRequest{keys(N_KEYS)});
+
+  // Lengths are what V2 shrinks: 3 bytes saved per string and vector
+  MultiGetRequest req{keys(N_KEYS)};
+  auto v1 = serialize_request(req, {WireVersion::V1, false});
+  auto v2 = serialize_request(req, {WireVersion::V2, false});
+  ASSERT_EQ(v1->buf.size() - v2->buf.size(), 3 * (N_KEYS + 1));
+}
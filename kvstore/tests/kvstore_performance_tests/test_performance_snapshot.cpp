@@ -0,0 +1,84 @@
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_KEYS = 1'000'000;
+static constexpr size_t BATCH_SIZE = 1'000;
+// Enough buckets to keep the per-bucket lists short at N_KEYS keys.
+static constexpr size_t N_BUCKETS = 1 << 17;
+
+// The store's data directory, removed when the test exits, even through a
+// failed ASSERT (which exits without destroying main's locals).
+static filesystem::path dir;
+
+/*
+  This test measures how long a persistent store with N_KEYS keys takes to
+  start up, first by replaying the whole write-ahead log, then from a snapshot
+  (after which the log is empty). Loading a snapshot is a sequential scan that
+  appends each item straight to its bucket, so it should be faster than
+  deserializing and re-applying every logged mutation.
+
+  Both startups are linear in the number of keys, so the ratio between them
+  holds at larger sizes: at 10 million keys, each takes about 10x as long as
+  here, which exceeds the perf suite's 120s timeout on a single core.
+*/
+milliseconds time_startup(const PersistenceOptions& options,
+                          unique_ptr<ConcurrentKvStore>& store) {
+  auto start = chrono::high_resolution_clock::now();
+  store =
+      make_unique<ConcurrentKvStore>(std::hash<std::string>(), N_BUCKETS);
+  ASSERT(store->EnablePersistence(options));
+  auto end = chrono::high_resolution_clock::now();
+  return chrono::duration_cast<chrono::milliseconds>(end - start);
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  dir = filesystem::temp_directory_path() /
+        ("test_performance_snapshot_" + random_string(8));
+  atexit([] { filesystem::remove_all(dir); });
+  PersistenceOptions options{dir, SyncPolicy::NONE};
+
+  // Keys and values are short enough to avoid heap allocations, so that the
+  // store fits comfortably in memory
+  {
+    ConcurrentKvStore store(std::hash<std::string>(), N_BUCKETS);
+    ASSERT(store.EnablePersistence(options));
+    for (size_t i = 0; i < N_KEYS; i += BATCH_SIZE) {
+      auto req = MultiPutRequest{};
+      for (size_t j = i; j < min(i + BATCH_SIZE, N_KEYS); j++) {
+        req.keys.push_back("key" + to_string(j));
+        req.values.push_back("val" + to_string(j));
+      }
+      auto res = MultiPutResponse{};
+      ASSERT(store.MultiPut(&req, &res));
+    }
+  }
+
+  unique_ptr<ConcurrentKvStore> store;
+  auto replay_time = time_startup(options, store);
+  ASSERT(store->Snapshot());
+  store.reset();
+  auto snapshot_time = time_startup(options, store);
+
+  auto get_req = GetRequest{.key = "key" + to_string(N_KEYS - 1)};
+  auto get_res = GetResponse{};
+  ASSERT(store->Get(&get_req, &get_res));
+  ASSERT_EQ(get_res.value, "val" + to_string(N_KEYS - 1));
+  store.reset();
+
+  output_file << "wal_replay_startup," << replay_time.count() << ","
+              << to_throughput(max(replay_time, 1ms), 1, N_KEYS) << "\n";
+  output_file << "snapshot_startup," << snapshot_time.count() << ","
+              << to_throughput(max(snapshot_time, 1ms), 1, N_KEYS) << "\n";
+
+  ASSERT(snapshot_time <= replay_time);
+}
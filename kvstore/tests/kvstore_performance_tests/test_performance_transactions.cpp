@@ -0,0 +1,82 @@
+#include <fstream>
+#include <future>
+
+#include "client/simple_client.hpp"
+#include "client/transaction.hpp"
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_SERVERS = 4;
+static constexpr size_t N_THREADS = 4;
+static constexpr size_t N_TXNS_PER_THREAD = 50;
+static constexpr size_t N_KEYS_PER_TXN = 8;
+
+/*
+  This test measures how the throughput of atomic multi-key writes degrades
+  with the number of servers (shards) they span. N_THREADS clients commit
+  non-conflicting transactions of N_KEYS_PER_TXN keys, spread evenly over 1,
+  2 and 4 servers. A transaction on one server commits in a single round trip
+  (like a MultiPut); one that spans servers needs two, each waiting for the
+  slowest of its participants, so throughput should fall as transactions
+  span more servers.
+*/
+chrono::milliseconds run_txns(const vector<string>& servers, size_t n_shards) {
+  auto start = chrono::high_resolution_clock::now();
+  vector<future<bool>> futures;
+  for (size_t t = 0; t < N_THREADS; t++) {
+    futures.push_back(async(launch::async, [&, t] {
+      for (size_t i = 0; i < N_TXNS_PER_THREAD; i++) {
+        vector<TxnWrites> writes(n_shards);
+        for (size_t s = 0; s < n_shards; s++) writes[s].server = servers[s];
+        for (size_t k = 0; k < N_KEYS_PER_TXN; k++) {
+          TxnWrites& w = writes[k % n_shards];
+          w.keys.push_back(to_string(n_shards) + "_" + to_string(t) + "_" +
+                           to_string(i) + "_" + to_string(k));
+          w.values.push_back("value");
+        }
+        if (!two_phase_commit(writes)) return false;
+      }
+      return true;
+    }));
+  }
+  for (auto&& f : futures) ASSERT(f.get());
+  auto time = chrono::duration_cast<chrono::milliseconds>(
+      chrono::high_resolution_clock::now() - start);
+  return max(time, 1ms);
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  vector<string> servers = make_server_addresses(N_SERVERS, 12600);
+  vector<shared_ptr<KvServer>> running;
+  for (auto&& addr : servers) {
+    running.push_back(start_server<KvServer, const string&, uint64_t>(addr, 1));
+  }
+
+  map<size_t, chrono::milliseconds> times;
+  map<size_t, double> tputs;
+  for (size_t n_shards : {1, 2, 4}) {
+    times[n_shards] = run_txns(servers, n_shards);
+    tputs[n_shards] =
+        to_throughput(times[n_shards], N_THREADS, N_TXNS_PER_THREAD);
+  }
+  for (auto&& [n_shards, tput] : tputs) {
+    cout << n_shards << " shard(s): " << tput << " transactions/second\n";
+  }
+
+  // Each spanning run against the single-server baseline
+  for (size_t n_shards : {2, 4}) {
+    output_file << "txn_1_shard," << times[1].count() << "," << tputs[1]
+                << "\n";
+    output_file << "txn_" << n_shards << "_shards,"
+                << times[n_shards].count() << "," << tputs[n_shards] << "\n";
+  }
+
+  ASSERT(tputs[1] >= tputs[2] && tputs[2] >= tputs[4]);
+  for (auto&& server : running) server->stop();
+}
@@ -0,0 +1,82 @@
+#include <filesystem>
+#include <fstream>
+
+#include "test_utils/test_utils.hpp"
+
+using namespace std;
+
+static constexpr size_t N_THREADS = 8;
+static constexpr size_t N_KEYS_PER_THREAD = 5'000;
+
+/*
+  This test measures the cost of persistence: N_THREADS threads concurrently
+  Put disjoint keys into a purely in-memory store, then into stores backed by a
+  write-ahead log under each sync policy. With group commit, concurrent
+  writers share fsyncs, so the logged store should stay within 2x of the
+  in-memory store's throughput when syncing on an interval.
+*/
+chrono::milliseconds run_puts(ConcurrentKvStore& store,
+                              const vector<vector<string>>& keys_per_thread) {
+  auto start = chrono::high_resolution_clock::now();
+  {
+    vector<thread> threads;
+    for (size_t i = 0; i < N_THREADS; i++) {
+      threads.emplace_back([&, i] {
+        auto& keys = keys_per_thread[i];
+        ASSERT(put_range(store, keys, keys, 0, keys.size()));
+      });
+    }
+    for (auto& t : threads) t.join();
+  }
+  auto end = chrono::high_resolution_clock::now();
+  auto time = chrono::duration_cast<chrono::milliseconds>(end - start);
+  return max(time, 1ms);
+}
+
+chrono::milliseconds run_logged_puts(
+    SyncPolicy sync, const vector<vector<string>>& keys_per_thread) {
+  auto dir = filesystem::temp_directory_path() /
+             ("test_performance_wal_" + random_string(8));
+  chrono::milliseconds time;
+  {
+    ConcurrentKvStore store;
+    ASSERT(store.EnablePersistence(PersistenceOptions{dir, sync}));
+    time = run_puts(store, keys_per_thread);
+  }
+  filesystem::remove_all(dir);
+  return time;
+}
+
+int main() {
+  std::ofstream output_file("performance-runtime.csv", std::ios::app);
+  if (!output_file.is_open()) {
+    std::cerr << "Failed to open output file." << std::endl;
+  }
+
+  vector<vector<string>> keys_per_thread;
+  for (size_t i = 0; i < N_THREADS; i++) {
+    keys_per_thread.push_back(make_pseudo_rand_str(N_KEYS_PER_THREAD, 32, i));
+  }
+
+  chrono::milliseconds in_memory = [&] {
+    ConcurrentKvStore store;
+    return run_puts(store, keys_per_thread);
+  }();
+  chrono::milliseconds none =
+      run_logged_puts(SyncPolicy::NONE, keys_per_thread);
+  chrono::milliseconds interval =
+      run_logged_puts(SyncPolicy::INTERVAL, keys_per_thread);
+  chrono::milliseconds per_op =
+      run_logged_puts(SyncPolicy::PER_OP, keys_per_thread);
+
+  for (auto [title, time] : {pair{"in_memory_put", in_memory},
+                             pair{"wal_no_sync_put", none},
+                             pair{"wal_interval_put", interval},
+                             pair{"wal_per_op_put", per_op}}) {
+    output_file << title << "," << time.count() << ","
+                << to_throughput(time, N_THREADS, N_KEYS_PER_THREAD) << "\n";
+  }
+
+  // The logged store takes at most twice as long when syncing on an interval
+  ASSERT(interval <= in_memory * 2);
+}
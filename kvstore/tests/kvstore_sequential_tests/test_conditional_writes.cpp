@@ -0,0 +1,151 @@
+#include <filesystem>
+#include <limits>
+#include <thread>
+
+#include "test_utils/test_utils.hpp"
+
+std::optional<std::string> get(KvStore& store, const std::string& key) {
+  auto req = GetRequest{.key = key};
+  auto res = GetResponse{};
+  if (!store.Get(&req, &res)) return std::nullopt;
+  return res.value;
+}
+
+void test_cas(KvStore& store) {
+  // A missing key never matches
+  auto req = CasRequest{.key = "k", .expected = "", .value = "a"};
+  auto res = CasResponse{};
+  ASSERT(store.Cas(&req, &res));
+  ASSERT(!res.swapped);
+  ASSERT(!get(store, "k"));
+
+  auto put_req = PutRequest{.key = "k", .value = "a"};
+  auto put_res = PutResponse{};
+  ASSERT(store.Put(&put_req, &put_res));
+
+  // A stale expected value fails, and returns the current value
+  req = CasRequest{.key = "k", .expected = "x", .value = "b"};
+  res = CasResponse{};
+  ASSERT(store.Cas(&req, &res));
+  ASSERT(!res.swapped);
+  ASSERT_EQ(res.value, std::string("a"));
+  ASSERT_EQ(*get(store, "k"), std::string("a"));
+
+  req = CasRequest{.key = "k", .expected = "a", .value = "b"};
+  res = CasResponse{};
+  ASSERT(store.Cas(&req, &res));
+  ASSERT(res.swapped);
+  ASSERT_EQ(*get(store, "k"), std::string("b"));
+}
+
+void test_incr(KvStore& store) {
+  // A missing key counts as 0
+  auto req = IncrRequest{.key = "n", .delta = 5};
+  auto res = IncrResponse{};
+  ASSERT(store.Incr(&req, &res));
+  ASSERT_EQ(res.value, 5);
+  req = IncrRequest{.key = "n", .delta = -8};
+  ASSERT(store.Incr(&req, &res));
+  ASSERT_EQ(res.value, -3);
+  ASSERT_EQ(*get(store, "n"), std::string("-3"));
+
+  // Values that aren't integers, and overflows, are rejected
+  for (auto value : {"abc", "12x", "", " 1", "99999999999999999999"}) {
+    auto put_req = PutRequest{.key = "bad", .value = value};
+    auto put_res = PutResponse{};
+    ASSERT(store.Put(&put_req, &put_res));
+    req = IncrRequest{.key = "bad", .delta = 1};
+    ASSERT(!store.Incr(&req, &res));
+    ASSERT_EQ(*get(store, "bad"), std::string(value));
+  }
+  auto put_req = PutRequest{
+      .key = "max",
+      .value = std::to_string(std::numeric_limits<int64_t>::max())};
+  auto put_res = PutResponse{};
+  ASSERT(store.Put(&put_req, &put_res));
+  req = IncrRequest{.key = "max", .delta = 1};
+  ASSERT(!store.Incr(&req, &res));
+  req = IncrRequest{.key = "max", .delta = -1};
+  ASSERT(store.Incr(&req, &res));
+}
+
+void test_put_if_absent(KvStore& store) {
+  auto req = PutIfAbsentRequest{.key = "once", .value = "first"};
+  auto res = PutIfAbsentResponse{};
+  ASSERT(store.PutIfAbsent(&req, &res));
+  ASSERT(res.inserted);
+
+  req = PutIfAbsentRequest{.key = "once", .value = "second"};
+  res = PutIfAbsentResponse{};
+  ASSERT(store.PutIfAbsent(&req, &res));
+  ASSERT(!res.inserted);
+  ASSERT_EQ(res.value, std::string("first"));
+  ASSERT_EQ(*get(store, "once"), std::string("first"));
+
+  // An expired key is absent, and a TTL set here applies
+  req = PutIfAbsentRequest{.key = "lease", .value = "a", .ttl_ms = 50};
+  ASSERT(store.PutIfAbsent(&req, &res));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  req = PutIfAbsentRequest{.key = "lease", .value = "b", .ttl_ms = 50};
+  res = PutIfAbsentResponse{};
+  ASSERT(store.PutIfAbsent(&req, &res));
+  ASSERT(res.inserted);
+  ASSERT_EQ(*get(store, "lease"), std::string("b"));
+}
+
+void test_keeps_ttl(KvStore& store) {
+  // CAS and Incr change a key's value, not its lifetime
+  auto put_req = PutRequest{.key = "ttl", .value = "1", .ttl_ms = 100};
+  auto put_res = PutResponse{};
+  ASSERT(store.Put(&put_req, &put_res));
+  auto incr_req = IncrRequest{.key = "ttl", .delta = 1};
+  auto incr_res = IncrResponse{};
+  ASSERT(store.Incr(&incr_req, &incr_res));
+  auto cas_req = CasRequest{.key = "ttl", .expected = "2", .value = "3"};
+  auto cas_res = CasResponse{};
+  ASSERT(store.Cas(&cas_req, &cas_res));
+  ASSERT(cas_res.swapped);
+  std::this_thread::sleep_for(std::chrono::milliseconds(150));
+  ASSERT(!get(store, "ttl"));
+}
+
+void test_conditional_writes(std::unique_ptr<KvStore> store) {
+  test_cas(*store);
+  test_incr(*store);
+  test_put_if_absent(*store);
+  test_keeps_ttl(*store);
+}
+
+void test_recovery() {
+  auto dir = std::filesystem::temp_directory_path() /
+             ("test_conditional_writes_" + random_string(8));
+  PersistenceOptions options{dir, SyncPolicy::PER_OP};
+  {
+    ConcurrentKvStore store;
+    ASSERT(store.EnablePersistence(options));
+    for (int i = 0; i < 10; i++) {
+      auto req = IncrRequest{.key = "counter", .delta = 1};
+      auto res = IncrResponse{};
+      ASSERT(store.Incr(&req, &res));
+    }
+    auto cas_req = CasRequest{.key = "counter", .expected = "10", .value = "x"};
+    auto cas_res = CasResponse{};
+    ASSERT(store.Cas(&cas_req, &cas_res));
+    auto req = PutIfAbsentRequest{.key = "once", .value = "first"};
+    auto res = PutIfAbsentResponse{};
+    ASSERT(store.PutIfAbsent(&req, &res));
+  }
+  {
+    ConcurrentKvStore store;
+    ASSERT(store.EnablePersistence(options));
+    ASSERT_EQ(*get(store, "counter"), std::string("x"));
+    ASSERT_EQ(*get(store, "once"), std::string("first"));
+  }
+  std::filesystem::remove_all(dir);
+}
+
+int main(int argc, char* argv[]) {
+  TEST(test_conditional_writes, make_kvstore(argc, argv));
+  TEST(test_recovery);
+  return 0;
+}
@@ -0,0 +1,236 @@
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#include "test_utils/test_utils.hpp"
+
+constexpr std::size_t kNumUsers = 30;
+constexpr std::size_t kNumKVPairs = 2'000;
+
+// Maps each key to its owner ("" for none).
+using Model = std::map<std::string, std::string>;
+
+void check_delete(KvStore& store, Model& model, const std::string& owner) {
+  std::vector<std::string> owned;
+  for (auto it = model.begin(); it != model.end();) {
+    if (it->second == owner) {
+      owned.push_back(it->first);
+      it = model.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  auto req = DeleteByOwnerRequest{owner};
+  auto res = DeleteByOwnerResponse{};
+  ASSERT(store.DeleteByOwner(&req, &res));
+  std::sort(res.keys.begin(), res.keys.end());
+  ASSERT_EQ_VECS(res.keys, owned);
+
+  std::vector<std::string> remaining = store.AllKeys();
+  std::sort(remaining.begin(), remaining.end());
+  std::vector<std::string> expected;
+  for (auto&& [key, key_owner] : model) expected.push_back(key);
+  ASSERT_EQ_VECS(remaining, expected);
+}
+
+void test_delete_by_owner(std::unique_ptr<KvStore> store) {
+  // Keys whose names say nothing about their owners, some of them rewritten
+  // with another owner or none, and owners whose IDs prefix each other's
+  // (user_1, user_10, ...)
+  std::mt19937 gen(0);
+  Model model;
+  auto owner_of = [&] {
+    size_t user = gen() % (kNumUsers + 1);
+    return user == kNumUsers ? "" : "user_" + std::to_string(user);
+  };
+  for (std::size_t i = 0; i < kNumKVPairs; i++) {
+    std::string key = "key_" + std::to_string(gen() % (kNumKVPairs / 2));
+    std::string owner = owner_of();
+    if (gen() % 2) {
+      auto req = PutRequest{.key = key, .value = "v", .owner = owner};
+      auto res = PutResponse{};
+      ASSERT(store->Put(&req, &res));
+      model[key] = owner;
+    } else {
+      // A MultiPut with a different owner for each key
+      std::string other = "key_" + std::to_string(gen() % (kNumKVPairs / 2));
+      std::string other_owner = owner_of();
+      auto req = MultiPutRequest{.keys = {key, other},
+                                 .values = {"v", "v"},
+                                 .owners = {owner, other_owner}};
+      auto res = MultiPutResponse{};
+      ASSERT(store->MultiPut(&req, &res));
+      model[key] = owner;
+      model[other] = other_owner;
+    }
+  }
+
+  // Appends and Cas keep the key's owner
+  auto append_req = AppendRequest{.key = model.begin()->first, .value = "!"};
+  auto append_res = AppendResponse{};
+  ASSERT(store->Append(&append_req, &append_res));
+  auto cas_req =
+      CasRequest{.key = model.rbegin()->first, .expected = "v", .value = "w"};
+  auto cas_res = CasResponse{};
+  ASSERT(store->Cas(&cas_req, &cas_res));
+  ASSERT(cas_res.swapped);
+
+  // An expired key is removed, but isn't reported as deleted
+  auto ttl_req = PutRequest{
+      .key = "session", .value = "s", .ttl_ms = 1, .owner = "user_2"};
+  auto ttl_res = PutResponse{};
+  ASSERT(store->Put(&ttl_req, &ttl_res));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  for (std::size_t i = 0; i < kNumUsers; i++) {
+    check_delete(*store, model, "user_" + std::to_string(i));
+  }
+  // Nothing left to delete, and keys without an owner aren't the empty
+  // owner's
+  check_delete(*store, model, "user_1");
+  auto req = DeleteByOwnerRequest{""};
+  auto res = DeleteByOwnerResponse{};
+  ASSERT(store->DeleteByOwner(&req, &res));
+  ASSERT(res.keys.empty());
+  auto get_req = GetRequest{.key = "session"};
+  auto get_res = GetResponse{};
+  ASSERT(!store->Get(&get_req, &get_res));
+}
+
+// Loads gdpr/database.csv, giving each key to the user it belongs to: a
+// user's name and list of posts, their posts, and the lists of replies to
+// their posts. The list of all users belongs to nobody.
+Model load_gdpr_database(KvStore& store) {
+  auto path = std::filesystem::path(__FILE__).parent_path() / "../.." /
+              "gdpr" / "database.csv";
+  std::ifstream file(path);
+  ASSERT(file.is_open());
+
+  std::vector<std::pair<std::string, std::string>> pairs;
+  std::string line;
+  while (std::getline(file, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty()) continue;
+    size_t key_start = line.find(' ') + 1;
+    size_t key_end = line.find(' ', key_start);
+    pairs.emplace_back(line.substr(key_start, key_end - key_start),
+                       line.substr(key_end + 1));
+  }
+
+  Model owners;
+  for (auto&& [key, value] : pairs) {
+    if (!key.starts_with("user_")) continue;
+    std::string user = key.substr(0, key.find('_', 5));
+    owners[key] = user;
+    if (key.ends_with("_posts")) {
+      std::stringstream posts(value);
+      std::string post;
+      while (std::getline(posts, post, ',')) owners[post] = user;
+    }
+  }
+  for (auto&& [key, value] : pairs) {
+    if (key.ends_with("_replies")) {
+      owners[key] = owners[key.substr(0, key.size() - 8)];
+    }
+  }
+
+  Model model;
+  for (auto&& [key, value] : pairs) {
+    auto req = PutRequest{.key = key, .value = value, .owner = owners[key]};
+    auto res = PutResponse{};
+    ASSERT(store.Put(&req, &res));
+    model[key] = owners[key];
+  }
+  return model;
+}
+
+void test_gdpr_database(std::unique_ptr<KvStore> store) {
+  Model model = load_gdpr_database(*store);
+  ASSERT_EQ(model["post_20"], "user_2");
+  ASSERT_EQ(model["post_7_replies"], "user_5");
+  ASSERT_EQ(model["all_users"], "");
+
+  // user_1 wrote post_1 to post_4, and post_1 has replies
+  auto req = DeleteByOwnerRequest{"user_1"};
+  auto res = DeleteByOwnerResponse{};
+  ASSERT(store->DeleteByOwner(&req, &res));
+  std::sort(res.keys.begin(), res.keys.end());
+  ASSERT_EQ_VECS(res.keys, (std::vector<std::string>{
+                               "post_1", "post_1_replies", "post_2", "post_3",
+                               "post_4", "user_1", "user_1_posts"}));
+  model.erase("user_1");
+  model.erase("user_1_posts");
+  model.erase("post_1_replies");
+  for (int i = 1; i <= 4; i++) model.erase("post_" + std::to_string(i));
+
+  for (std::size_t i = 2; i <= 16; i++) {
+    check_delete(*store, model, "user_" + std::to_string(i));
+  }
+  ASSERT_EQ_VECS(store->AllKeys(), std::vector<std::string>{"all_users"});
+}
+
+void test_recovery() {
+  auto dir = std::filesystem::temp_directory_path() /
+             ("test_delete_by_owner_" + random_string(8));
+  PersistenceOptions options{dir, SyncPolicy::PER_OP};
+
+  std::vector<std::string> keys = {"user_1", "user_1_posts", "post_7",
+                                   "user_10", "post_8"};
+  std::vector<std::string> owners = {"user_1", "user_1", "user_1", "user_10",
+                                     "user_10"};
+  auto put_owned = [&](KvStore& store, size_t i) {
+    auto req = PutRequest{.key = keys[i], .value = "v", .owner = owners[i]};
+    auto res = PutResponse{};
+    ASSERT(store.Put(&req, &res));
+  };
+  auto delete_owner = [](KvStore& store, const std::string& owner) {
+    auto req = DeleteByOwnerRequest{owner};
+    auto res = DeleteByOwnerResponse{};
+    ASSERT(store.DeleteByOwner(&req, &res));
+    return res.keys.size();
+  };
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    for (size_t i = 0; i < keys.size(); i++) put_owned(*store, i);
+    ASSERT_EQ(delete_owner(*store, "user_1"), 3u);
+  }
+
+  // The owners and the deletion were logged, so they survive a restart
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    std::vector<std::string> remaining = store->AllKeys();
+    std::sort(remaining.begin(), remaining.end());
+    ASSERT_EQ_VECS(remaining, (std::vector<std::string>{"post_8", "user_10"}));
+
+    // ... and so do owners in a snapshot
+    for (size_t i = 0; i < 3; i++) put_owned(*store, i);
+    ASSERT(store->Snapshot());
+  }
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT_EQ(delete_owner(*store, "user_10"), 2u);
+    ASSERT_EQ(delete_owner(*store, "user_1"), 3u);
+    ASSERT(store->AllKeys().empty());
+  }
+  std::filesystem::remove_all(dir);
+}
+
+int main(int argc, char* argv[]) {
+  TEST(test_delete_by_owner, make_kvstore(argc, argv));
+  TEST(test_gdpr_database, make_kvstore(argc, argv));
+
+  // Deleting through the owner index keeps the ordered index in step
+  auto store = std::make_unique<ConcurrentKvStore>();
+  store->EnableOrderedIndex();
+  TEST(test_delete_by_owner, std::move(store));
+
+  TEST(test_recovery);
+  return 0;
+}
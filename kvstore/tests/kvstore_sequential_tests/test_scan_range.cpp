@@ -0,0 +1,97 @@
+#include <map>
+#include <random>
+#include <thread>
+
+#include "test_utils/test_utils.hpp"
+
+constexpr std::size_t kNumKVPairs = 2'000;
+constexpr std::size_t kNumScans = 500;
+
+using Model = std::map<std::string, std::string>;
+
+void check_scan(KvStore& store, const Model& model, const std::string& start,
+                const std::string& end, std::size_t limit) {
+  auto req = ScanRangeRequest{start, end, limit};
+  auto res = ScanRangeResponse{};
+  ASSERT(store.ScanRange(&req, &res));
+
+  std::vector<std::string> keys, values;
+  for (auto it = model.lower_bound(start);
+       it != model.end() && (end.empty() || it->first < end) &&
+       (!limit || keys.size() < limit);
+       it++) {
+    keys.push_back(it->first);
+    values.push_back(it->second);
+  }
+  ASSERT_EQ_VECS(res.keys, keys);
+  ASSERT_EQ_VECS(res.values, values);
+}
+
+void test_scan_range(std::unique_ptr<KvStore> store) {
+  std::mt19937 gen(0);
+  auto keys = make_rand_strs(kNumKVPairs, 6);
+  Model model;
+  for (auto&& key : keys) {
+    auto req = PutRequest{.key = key, .value = key + "!"};
+    auto res = PutResponse{};
+    ASSERT(store->Put(&req, &res));
+    model[key] = key + "!";
+  }
+  // Deleted and expired keys don't show up
+  for (std::size_t i = 0; i < kNumKVPairs; i += 3) {
+    auto req = DeleteRequest{.key = keys[i]};
+    auto res = DeleteResponse{};
+    ASSERT(store->Delete(&req, &res));
+    model.erase(keys[i]);
+  }
+  auto ttl_req = PutRequest{.key = "0expiring", .value = "v", .ttl_ms = 1};
+  auto ttl_res = PutResponse{};
+  ASSERT(store->Put(&ttl_req, &ttl_res));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+
+  // Whole store, open-ended and empty ranges
+  check_scan(*store, model, "", "", 0);
+  check_scan(*store, model, "M", "", 0);
+  check_scan(*store, model, "M", "M", 0);
+  check_scan(*store, model, "z", "A", 0);
+  check_scan(*store, model, "", "", 10);
+
+  // Prefixes
+  for (char c : std::string("0Aaz")) {
+    std::string prefix(1, c);
+    check_scan(*store, model, prefix, prefix_end(prefix), 0);
+  }
+
+  for (std::size_t i = 0; i < kNumScans; i++) {
+    std::string a = random_string(1 + gen() % 3);
+    std::string b = random_string(1 + gen() % 3);
+    if (b < a) std::swap(a, b);
+    check_scan(*store, model, a, b, gen() % 4 ? gen() % 50 : 0);
+  }
+}
+
+void test_prefix_end() {
+  ASSERT_EQ(prefix_end("user_123_"), std::string("user_123`"));
+  ASSERT_EQ(prefix_end("ab\xff"), std::string("ac"));
+  ASSERT_EQ(prefix_end("\xff\xff"), std::string(""));
+  ASSERT_EQ(prefix_end(""), std::string(""));
+}
+
+int main(int argc, char* argv[]) {
+  TEST(test_prefix_end);
+  TEST(test_scan_range, make_kvstore(argc, argv));
+
+  // With an ordered index, including keys that were there before the index
+  // was enabled
+  auto store = std::make_unique<ConcurrentKvStore>();
+  auto req = PutRequest{.key = "0before", .value = "v"};
+  auto res = PutResponse{};
+  ASSERT(store->Put(&req, &res));
+  store->EnableOrderedIndex();
+  auto del_req = DeleteRequest{.key = "0before"};
+  auto del_res = DeleteResponse{};
+  ASSERT(store->Delete(&del_req, &del_res));
+  TEST(test_scan_range, std::move(store));
+
+  return 0;
+}
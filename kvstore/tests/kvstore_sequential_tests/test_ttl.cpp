@@ -0,0 +1,104 @@
+#include <filesystem>
+#include <thread>
+
+#include "test_utils/test_utils.hpp"
+
+constexpr uint64_t kTtlMs = 100;
+
+bool get(KvStore& store, const std::string& key, std::string* value = nullptr) {
+  auto get_req = GetRequest{.key = key};
+  auto get_res = GetResponse{};
+  bool ok = store.Get(&get_req, &get_res);
+  if (ok && value) *value = get_res.value;
+  return ok;
+}
+
+void test_expiry(KvStore& store) {
+  auto put_req = PutRequest{.key = "session", .value = "a", .ttl_ms = kTtlMs};
+  auto put_res = PutResponse{};
+  ASSERT(store.Put(&put_req, &put_res));
+  auto mput_req = MultiPutRequest{
+      .keys = {"m1", "m2"}, .values = {"1", "2"}, .ttl_ms = kTtlMs};
+  auto mput_res = MultiPutResponse{};
+  ASSERT(store.MultiPut(&mput_req, &mput_res));
+
+  // Overwriting a key without a TTL makes it permanent
+  auto forever_req = PutRequest{.key = "m2", .value = "2"};
+  ASSERT(store.Put(&forever_req, &put_res));
+
+  ASSERT(get(store, "session"));
+  ASSERT(get(store, "m1"));
+  ASSERT_EQ(store.AllKeys().size(), 3u);
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(2 * kTtlMs));
+
+  // Expired keys are gone for every kind of read...
+  ASSERT(!get(store, "session"));
+  auto mget_req = MultiGetRequest{.keys = {"m1", "m2"}};
+  auto mget_res = MultiGetResponse{};
+  ASSERT(!store.MultiGet(&mget_req, &mget_res));
+  auto del_req = DeleteRequest{.key = "m1"};
+  auto del_res = DeleteResponse{};
+  ASSERT(!store.Delete(&del_req, &del_res));
+  ASSERT(get(store, "m2"));
+  ASSERT_EQ(store.AllKeys().size(), 1u);
+
+  // ... and appending to one starts over with a permanent value
+  auto append_req = AppendRequest{.key = "session", .value = "b"};
+  auto append_res = AppendResponse{};
+  ASSERT(store.Append(&append_req, &append_res));
+  std::string value;
+  ASSERT(get(store, "session", &value));
+  ASSERT_EQ(value, "b");
+}
+
+// TTLs survive a restart: deadlines are absolute, so a key that expires while
+// the store is down is gone once it comes back.
+void test_persistent_expiry() {
+  auto dir = std::filesystem::temp_directory_path() /
+             ("test_ttl_" + random_string(8));
+  PersistenceOptions options{dir, SyncPolicy::PER_OP};
+
+  {
+    ConcurrentKvStore store;
+    ASSERT(store.EnablePersistence(options));
+    auto put_req = PutRequest{.key = "short", .value = "a", .ttl_ms = kTtlMs};
+    auto put_res = PutResponse{};
+    ASSERT(store.Put(&put_req, &put_res));
+    put_req = PutRequest{.key = "long", .value = "b", .ttl_ms = 3'600'000};
+    ASSERT(store.Put(&put_req, &put_res));
+    ASSERT(store.Snapshot());
+
+    // Logged after the snapshot
+    put_req = PutRequest{.key = "short2", .value = "c", .ttl_ms = kTtlMs};
+    ASSERT(store.Put(&put_req, &put_res));
+    auto append_req = AppendRequest{.key = "long", .value = "!"};
+    auto append_res = AppendResponse{};
+    ASSERT(store.Append(&append_req, &append_res));
+  }
+  {
+    ConcurrentKvStore store;
+    ASSERT(store.EnablePersistence(options));
+    ASSERT(get(store, "short"));
+    ASSERT(get(store, "short2"));
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(2 * kTtlMs));
+  {
+    ConcurrentKvStore store;
+    ASSERT(store.EnablePersistence(options));
+    ASSERT(!get(store, "short"));
+    ASSERT(!get(store, "short2"));
+    std::string value;
+    ASSERT(get(store, "long", &value));
+    ASSERT_EQ(value, "b!");
+    ASSERT_EQ(store.AllKeys().size(), 1u);
+  }
+
+  std::filesystem::remove_all(dir);
+}
+
+int main(int argc, char* argv[]) {
+  auto store = make_kvstore(argc, argv);
+  test_expiry(*store);
+  test_persistent_expiry();
+}
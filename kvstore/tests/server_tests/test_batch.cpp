@@ -0,0 +1,112 @@
+#include <string>
+
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_serialization() {
+  BatchRequest req{{GetRequest{"a"}, PutRequest{"b", "1", 10},
+                    IncrRequest{"c", -2}}};
+  auto msg = serialize_request(req);
+  ASSERT(msg);
+  auto out = deserialize_request(*msg);
+  ASSERT(out);
+  auto* batch = get_if<BatchRequest>(&*out);
+  ASSERT(batch);
+  ASSERT_EQ(batch->ops.size(), 3ul);
+  ASSERT_EQ(get<GetRequest>(batch->ops[0]).key, string("a"));
+  ASSERT_EQ(get<PutRequest>(batch->ops[1]).ttl_ms, 10ul);
+  ASSERT_EQ(get<IncrRequest>(batch->ops[2]).delta, -2l);
+
+  BatchResponse res{{GetResponse{"v"}, ErrorResponse{"oops"}}};
+  auto res_msg = serialize_response(res);
+  ASSERT(res_msg);
+  auto res_out = deserialize_response(*res_msg);
+  ASSERT(res_out);
+  auto* batch_res = get_if<BatchResponse>(&*res_out);
+  ASSERT(batch_res);
+  ASSERT_EQ(get<GetResponse>(batch_res->results[0]).value, string("v"));
+  ASSERT_EQ(get<ErrorResponse>(batch_res->results[1]).msg, string("oops"));
+}
+
+void test_mixed_ops(const string& server) {
+  SimpleClient client(server);
+  auto results = client.Batch({
+      PutRequest{"k", "a"},
+      AppendRequest{"k", "b"},
+      GetRequest{"k"},
+      GetRequest{"missing"},
+      IncrRequest{"n", 5},
+      CasRequest{"k", "ab", "c"},
+      PutIfAbsentRequest{"k", "d"},
+      DeleteRequest{"k"},
+      GetRequest{"k"},
+  });
+  ASSERT(results);
+  ASSERT_EQ(results->size(), 9ul);
+
+  // Ops run in order, each seeing the ones before it...
+  ASSERT(holds_alternative<PutResponse>((*results)[0]));
+  ASSERT(holds_alternative<AppendResponse>((*results)[1]));
+  ASSERT_EQ(get<GetResponse>((*results)[2]).value, string("ab"));
+  // ... and one failing doesn't stop the rest
+  ASSERT(holds_alternative<ErrorResponse>((*results)[3]));
+  ASSERT_EQ(get<IncrResponse>((*results)[4]).value, 5l);
+  ASSERT(get<CasResponse>((*results)[5]).swapped);
+  ASSERT_EQ(get<PutIfAbsentResponse>((*results)[6]).value, string("c"));
+  ASSERT_EQ(get<DeleteResponse>((*results)[7]).value, string("c"));
+  ASSERT(holds_alternative<ErrorResponse>((*results)[8]));
+
+  ASSERT(!client.Get("k"));
+  ASSERT(client.Get("n") == "5");
+
+  // An empty batch is fine too
+  results = client.Batch({});
+  ASSERT(results);
+  ASSERT(results->empty());
+}
+
+void test_incr_errors(const string& server) {
+  // Each reason an Incr fails has its own error
+  SimpleClient client(server);
+  ASSERT(client.Put("word", "abc"));
+  ASSERT(client.Put("max", to_string(INT64_MAX)));
+  auto results =
+      client.Batch({IncrRequest{"word", 1}, IncrRequest{"max", 1}});
+  ASSERT(results);
+  ASSERT_EQ(get<ErrorResponse>((*results)[0]).msg,
+            string("value is not an integer"));
+  ASSERT_EQ(get<ErrorResponse>((*results)[1]).msg,
+            string("the result would overflow"));
+  ASSERT(client.Get("max") == to_string(INT64_MAX));
+}
+
+void test_locked_keys(const string& server) {
+  // Ops on keys locked by a prepared transaction fail like standalone requests
+  SimpleClient client(server);
+  ASSERT(client.Put("locked", "old"));
+  ASSERT(*client.Prepare(1, {"locked"}, {"new"}));
+  auto results =
+      client.Batch({GetRequest{"locked"}, PutRequest{"free", "v"}});
+  ASSERT(results);
+  ASSERT(holds_alternative<ErrorResponse>((*results)[0]));
+  ASSERT(holds_alternative<PutResponse>((*results)[1]));
+  ASSERT(client.Commit(1));
+  ASSERT(client.Get("locked") == "new");
+}
+
+int main() {
+  string server = make_server_addresses(1, 12700)[0];
+  auto running = start_server<KvServer, const string&, uint64_t>(server, 2);
+
+  TEST(test_serialization);
+  TEST(test_mixed_ops, server);
+  TEST(test_incr_errors, server);
+  TEST(test_locked_keys, server);
+
+  running->stop();
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_utils/cluster.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_kill_and_restart(uint64_t start_port) {
+  // Three Concurrent Stores, persisting every write before acknowledging it.
+  // (Servers here use epoll, since idle THREADS workers poll their queues,
+  // which would starve the other processes on a small machine.)
+  ClusterOptions options;
+  options.n_servers = 3;
+  options.start_port = start_port;
+  options.use_shardcontroller = false;
+  options.data_dir = "cluster-data";
+  options.server_flags = {"--io-engine=epoll", "--wal-sync=per-op",
+                          "--log-level=error"};
+  filesystem::remove_all(options.data_dir);
+  LocalCluster cluster(options);
+  ASSERT(cluster.start());
+
+  ClusterLoad load(cluster, 2, 0.5, 200ms, 200);
+  load.start();
+  this_thread::sleep_for(1s);
+  load.mark("kill server1");
+  ASSERT(cluster.kill_server(1));
+  ASSERT(!cluster.is_running(1));
+  this_thread::sleep_for(600ms);
+  load.mark("restart server1");
+  ASSERT(cluster.start_server(1));
+  this_thread::sleep_for(1s);
+  vector<ClusterLoad::Interval> timeline = load.stop();
+  ASSERT(ClusterLoad::write_csv(timeline, options.log_dir + "/timeline.csv"));
+
+  size_t killed = timeline.size(), restarted = timeline.size();
+  for (size_t i = 0; i < timeline.size(); i++) {
+    for (const string& event : timeline[i].events) {
+      if (event == "kill server1") killed = i;
+      if (event == "restart server1") restarted = i;
+    }
+  }
+  ASSERT(killed < restarted && restarted + 2 < timeline.size());
+  // Everything succeeds until the kill,
+  for (size_t i = 0; i < killed; i++) {
+    ASSERT(timeline[i].n_ok > 0);
+    ASSERT_EQ(timeline[i].n_failed, 0ul);
+  }
+  // requests to the other servers still do while server1 is down,
+  ASSERT(timeline[killed + 1].n_ok > 0);
+  ASSERT(timeline[killed + 1].n_failed > 0);
+  // and once it's back, with every key it acknowledged, they all do again
+  ASSERT(timeline.back().n_ok > 0);
+  ASSERT_EQ(timeline.back().availability(), 1.0);
+
+  cluster.stop();
+  ASSERT(!cluster.is_running(0));
+  filesystem::remove_all(options.data_dir);
+}
+
+void test_shardcontroller(uint64_t start_port) {
+  ClusterOptions options;
+  options.n_servers = 2;
+  options.start_port = start_port;
+  options.server_flags = {"--io-engine=epoll"};
+  LocalCluster cluster(options);
+  ASSERT(cluster.start());
+  ASSERT(cluster.query());
+  ASSERT(cluster.leave(1));
+  ASSERT(cluster.join(1));
+
+  // A server stops cleanly, and starts again on the same address
+  ASSERT(cluster.stop_server(0));
+  ASSERT(!cluster.is_running(0));
+  ASSERT(cluster.start_server(0));
+  ASSERT(cluster.is_running(0));
+  ASSERT(!cluster.start_server(0));
+}
+
+int main() {
+  TEST(test_kill_and_restart, 13760);
+  TEST(test_shardcontroller, 13770);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <filesystem>
+#include <random>
+
+#include "common/lz4.hpp"
+#include "test_utils/test_utils.hpp"
+
+constexpr size_t kThreshold = 1024;
+
+// A JSON document of about `size` bytes, like the values compression is for.
+std::string make_json(size_t size, std::mt19937& rng) {
+  std::string json = "[";
+  for (size_t i = 0; json.size() < size; i++) {
+    uint32_t id = rng() % 100'000;
+    json += (i ? "," : "") + std::string("{\"id\":") + std::to_string(id) +
+            ",\"name\":\"user_" + std::to_string(id) +
+            "\",\"active\":" + (rng() % 2 ? "true" : "false") +
+            ",\"score\":" + std::to_string(rng() % 1000) + "}";
+  }
+  return json + "]";
+}
+
+std::string get(KvStore& store, const std::string& key) {
+  auto req = GetRequest{.key = key};
+  auto res = GetResponse{};
+  ASSERT(store.Get(&req, &res));
+  return res.value;
+}
+
+void put(KvStore& store, const std::string& key, const std::string& value) {
+  auto req = PutRequest{.key = key, .value = value};
+  auto res = PutResponse{};
+  ASSERT(store.Put(&req, &res));
+}
+
+void test_lz4() {
+  std::mt19937 rng(0);
+  std::string noise(5000, '\0');
+  for (auto& c : noise) c = char(rng());
+  std::vector<std::string> inputs = {
+      "",
+      "a",
+      "short string",
+      std::string(100'000, 'x'),
+      "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabc",
+      noise,
+      make_json(8 * 1024, rng),
+      // Repeats further apart than a match can reach
+      noise + std::string(70'000, 'y') + noise,
+  };
+  for (auto&& input : inputs) {
+    std::string compressed = lz4_compress(input);
+    ASSERT(lz4_decompress(compressed) == input);
+  }
+  ASSERT(lz4_compress(std::string(100'000, 'x')).size() < 1000);
+
+  // Truncated or corrupted input is rejected, not overrun
+  std::string compressed = lz4_compress(make_json(8 * 1024, rng));
+  for (size_t len = 0; len < compressed.size(); len += 7) {
+    ASSERT(!lz4_decompress(compressed.substr(0, len)));
+  }
+  compressed[0] = '\xff';
+  ASSERT(!lz4_decompress(compressed));
+}
+
+void test_store(ConcurrentKvStore& store) {
+  std::mt19937 rng(1);
+  std::string json = make_json(8 * 1024, rng);
+  std::string small = "{\"id\":1}";
+
+  // Values read back as they were written, compressed or not
+  put(store, "json", json);
+  put(store, "small", small);
+  ASSERT_EQ(get(store, "json"), json);
+  ASSERT_EQ(get(store, "small"), small);
+  auto mget_req = MultiGetRequest{.keys = {"json", "small"}};
+  auto mget_res = MultiGetResponse{};
+  ASSERT(store.MultiGet(&mget_req, &mget_res));
+  ASSERT_EQ_VECS(mget_res.values, (std::vector<std::string>{json, small}));
+  auto scan_req = ScanRangeRequest{};
+  auto scan_res = ScanRangeResponse{};
+  ASSERT(store.ScanRange(&scan_req, &scan_res));
+  ASSERT_EQ_VECS(scan_res.values, (std::vector<std::string>{json, small}));
+
+  // Appends, CAS and PutIfAbsent see the plain value
+  auto append_req = AppendRequest{.key = "json", .value = "!"};
+  auto append_res = AppendResponse{};
+  ASSERT(store.Append(&append_req, &append_res));
+  ASSERT_EQ(get(store, "json"), json + "!");
+  auto cas_req =
+      CasRequest{.key = "json", .expected = json + "!", .value = "x"};
+  auto cas_res = CasResponse{};
+  ASSERT(store.Cas(&cas_req, &cas_res));
+  ASSERT(cas_res.swapped);
+  put(store, "json", json);
+  auto absent_req = PutIfAbsentRequest{.key = "json", .value = "y"};
+  auto absent_res = PutIfAbsentResponse{};
+  ASSERT(store.PutIfAbsent(&absent_req, &absent_res));
+  ASSERT_EQ(absent_res.value, json);
+  auto delete_req = DeleteRequest{.key = "json"};
+  auto delete_res = DeleteResponse{};
+  ASSERT(store.Delete(&delete_req, &delete_res));
+  ASSERT_EQ(delete_res.value, json);
+}
+
+void test_memory() {
+  // The memory accounting (and so the memory limit) counts compressed sizes
+  std::mt19937 rng(2);
+  ConcurrentKvStore plain, compressed;
+  compressed.EnableCompression(kThreshold);
+  for (int i = 0; i < 100; i++) {
+    std::string json = make_json(8 * 1024, rng);
+    put(plain, std::to_string(i), json);
+    put(compressed, std::to_string(i), json);
+  }
+  ASSERT(compressed.GetCacheStats().used_bytes * 2 <
+         plain.GetCacheStats().used_bytes);
+}
+
+void test_recovery() {
+  auto dir = std::filesystem::temp_directory_path() /
+             ("test_compression_" + random_string(8));
+  PersistenceOptions options{dir, SyncPolicy::NONE};
+  std::mt19937 rng(3);
+  std::string a = make_json(4 * 1024, rng), b = make_json(4 * 1024, rng);
+  {
+    ConcurrentKvStore store;
+    store.EnableCompression(kThreshold);
+    ASSERT(store.EnablePersistence(options));
+    put(store, "a", a);
+    ASSERT(store.Snapshot());
+    put(store, "b", b);
+    auto req = AppendRequest{.key = "a", .value = "!"};
+    auto res = AppendResponse{};
+    ASSERT(store.Append(&req, &res));
+  }
+  {
+    ConcurrentKvStore store;
+    store.EnableCompression(kThreshold);
+    ASSERT(store.EnablePersistence(options));
+    ASSERT_EQ(get(store, "a"), a + "!");
+    ASSERT_EQ(get(store, "b"), b);
+  }
+  std::filesystem::remove_all(dir);
+}
+
+int main() {
+  TEST(test_lz4);
+  ConcurrentKvStore store;
+  store.EnableCompression(kThreshold);
+  TEST(test_store, store);
+  TEST(test_memory);
+  TEST(test_recovery);
+  return 0;
+}
@@ -0,0 +1,126 @@
+#include <sched.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/simple_client.hpp"
+#include "common/cpu_affinity.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_parse_cpu_list() {
+  ASSERT(*parse_cpu_list("3") == vector<int>({3}));
+  ASSERT(*parse_cpu_list("0-3,8") == vector<int>({0, 1, 2, 3, 8}));
+  // Sorted, without duplicates
+  ASSERT(*parse_cpu_list("8,2-4,3") == vector<int>({2, 3, 4, 8}));
+  ASSERT(!parse_cpu_list(""));
+  ASSERT(!parse_cpu_list("3-1"));
+  ASSERT(!parse_cpu_list("0,,1"));
+  ASSERT(!parse_cpu_list("a-b"));
+  ASSERT(!parse_cpu_list("-1"));
+  ASSERT(!parse_cpu_list("0-100000"));
+}
+
+void test_topology() {
+  vector<int> cpus = allowed_cpus();
+  ASSERT(!cpus.empty());
+
+  // Every CPU is on exactly one node
+  NumaTopology topology = NumaTopology::detect(cpus);
+  size_t n_cpus = 0;
+  for (auto&& node_cpus : topology.node_cpus) {
+    ASSERT(!node_cpus.empty());
+    n_cpus += node_cpus.size();
+  }
+  ASSERT_EQ(n_cpus, cpus.size());
+  for (int cpu : cpus) {
+    optional<size_t> node = topology.node_of(cpu);
+    ASSERT(node);
+    auto& node_cpus = topology.node_cpus[*node];
+    ASSERT(find(node_cpus.begin(), node_cpus.end(), cpu) != node_cpus.end());
+  }
+  ASSERT(!topology.node_of(CPU_SETSIZE));
+
+  // CPUs the kernel doesn't know of still land on a node
+  NumaTopology unknown = NumaTopology::detect({CPU_SETSIZE - 1});
+  ASSERT_EQ(unknown.node_cpus.size(), 1ul);
+  ASSERT_EQ(*unknown.node_of(CPU_SETSIZE - 1), 0ul);
+}
+
+void test_pin_thread() {
+  int cpu = allowed_cpus().back();
+  thread pinned([cpu] {
+    ASSERT(pin_thread({cpu}));
+    ASSERT(allowed_cpus() == vector<int>({cpu}));
+    ASSERT_EQ(sched_getcpu(), cpu);
+  });
+  pinned.join();
+  ASSERT(!pin_thread({}));
+}
+
+void test_pinned_server(const string& addr, WorkerPinning pinning,
+                        IoEngineType io_engine) {
+  KvServerOptions options;
+  options.pin_workers = pinning;
+  options.steer_connections = true;
+  options.io_engine = io_engine;
+  vector<int> cpus = allowed_cpus();
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 3, options);
+
+  // Each worker is pinned to some of the server's CPUs
+  vector<vector<int>> worker_cpus = server->worker_cpus();
+  ASSERT_EQ(worker_cpus.size(), 3ul);
+  for (auto&& pinned : worker_cpus) {
+    ASSERT(!pinned.empty());
+    if (pinning == WorkerPinning::CORES) ASSERT_EQ(pinned.size(), 1ul);
+    for (int cpu : pinned) {
+      ASSERT(find(cpus.begin(), cpus.end(), cpu) != cpus.end());
+    }
+  }
+
+  // and connections, steered or not, are served
+  vector<SimpleClient> clients;
+  for (int i = 0; i < 4; i++) clients.emplace_back(addr);
+  for (int i = 0; i < 4; i++) {
+    ASSERT(clients[i].Put("key" + to_string(i), "value" + to_string(i)));
+  }
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(*clients[(i + 1) % 4].Get("key" + to_string(i)),
+              "value" + to_string(i));
+  }
+  server->stop();
+}
+
+void test_unpinnable_cpus(const string& addr) {
+  // A CPU that doesn't exist: workers run unpinned instead
+  KvServerOptions options;
+  options.pin_workers = WorkerPinning::CORES;
+  options.worker_cpus = {CPU_SETSIZE - 1};
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 2, options);
+  for (auto&& pinned : server->worker_cpus()) ASSERT(pinned.empty());
+  SimpleClient client(addr);
+  ASSERT(client.Put("key", "value"));
+  ASSERT_EQ(*client.Get("key"), "value");
+  server->stop();
+}
+
+int main() {
+  TEST(test_parse_cpu_list);
+  TEST(test_topology);
+  TEST(test_pin_thread);
+  TEST(test_pinned_server, make_server_addresses(1, 13790)[0],
+       WorkerPinning::CORES, IoEngineType::THREADS);
+  TEST(test_pinned_server, make_server_addresses(1, 13791)[0],
+       WorkerPinning::NODES, IoEngineType::THREADS);
+  TEST(test_pinned_server, make_server_addresses(1, 13792)[0],
+       WorkerPinning::CORES, IoEngineType::EPOLL);
+  TEST(test_unpinnable_cpus, make_server_addresses(1, 13793)[0]);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,79 @@
+#include "test_utils/test_utils.hpp"
+
+constexpr std::size_t kMaxBytes = 256 * 1024;
+constexpr std::size_t kNumKVPairs = 20'000;
+constexpr std::size_t kNumHotKeys = 100;
+constexpr std::size_t kValueLength = 64;
+
+int main() {
+  ConcurrentKvStore store;
+  store.SetMemoryLimit(kMaxBytes);
+
+  auto keys = make_rand_strs(kNumKVPairs, 16);
+  std::string value(kValueLength, 'v');
+
+  // Write far more than fits, reading a small hot set in between; the hot
+  // keys keep getting their reference bits set, so CLOCK should keep them
+  for (std::size_t i = 0; i < kNumHotKeys; i++) {
+    auto put_req = PutRequest{.key = keys[i], .value = value};
+    auto put_res = PutResponse{};
+    ASSERT(store.Put(&put_req, &put_res));
+  }
+  for (std::size_t i = kNumHotKeys; i < kNumKVPairs; i++) {
+    auto put_req = PutRequest{.key = keys[i], .value = value};
+    auto put_res = PutResponse{};
+    ASSERT(store.Put(&put_req, &put_res));
+
+    auto get_req = GetRequest{.key = keys[i % kNumHotKeys]};
+    auto get_res = GetResponse{};
+    store.Get(&get_req, &get_res);
+  }
+
+  CacheStats stats = store.GetCacheStats();
+  ASSERT(stats.used_bytes <= stats.max_bytes);
+  ASSERT(stats.max_bytes <= kMaxBytes);
+  ASSERT(stats.evictions > 0);
+  ASSERT_EQ(store.AllKeys().size(), kNumKVPairs - stats.evictions);
+
+  std::size_t hot_hits = 0;
+  for (std::size_t i = 0; i < kNumHotKeys; i++) {
+    auto get_req = GetRequest{.key = keys[i]};
+    auto get_res = GetResponse{};
+    hot_hits += store.Get(&get_req, &get_res);
+  }
+  // Only a fraction of all keys fit, but nearly all of the hot ones should
+  ASSERT(store.AllKeys().size() < kNumKVPairs / 2);
+  ASSERT(hot_hits >= kNumHotKeys * 9 / 10);
+
+  // Every Get is counted as exactly one hit or miss (there was one per Put of
+  // a cold key, plus one per hot key above)
+  CacheStats after = store.GetCacheStats();
+  ASSERT_EQ(after.hits + after.misses, kNumKVPairs);
+  ASSERT_EQ(after.hits - stats.hits, hot_hits);
+
+  // Making room for a MultiPut evicts older keys, never the batch's own, even
+  // when they all share one bucket and the first ones written are unreferenced
+  ConcurrentKvStore one_bucket([](const std::string&) { return 0; }, 1);
+  one_bucket.SetMemoryLimit(16 * kValueLength);
+  ASSERT(put_range(one_bucket, keys, std::vector<std::string>(8, value), 0, 8));
+  auto multiput_req = MultiPutRequest{};
+  for (std::size_t i = 8; i < 16; i++) {
+    multiput_req.keys.push_back(keys[i]);
+    multiput_req.values.push_back(value);
+  }
+  auto multiput_res = MultiPutResponse{};
+  ASSERT(one_bucket.MultiPut(&multiput_req, &multiput_res));
+  auto multiget_req = MultiGetRequest{.keys = multiput_req.keys};
+  auto multiget_res = MultiGetResponse{};
+  ASSERT(one_bucket.MultiGet(&multiget_req, &multiget_res));
+  ASSERT(multiget_res.values == multiput_req.values);
+  ASSERT(one_bucket.GetCacheStats().evictions > 0);
+
+  // An unbounded store never evicts
+  ConcurrentKvStore unbounded;
+  ASSERT(put_range(unbounded, keys, keys, 0, kNumKVPairs));
+  stats = unbounded.GetCacheStats();
+  ASSERT_EQ(stats.evictions, 0u);
+  ASSERT_EQ(stats.max_bytes, 0u);
+  ASSERT_EQ(unbounded.AllKeys().size(), kNumKVPairs);
+}
@@ -0,0 +1,132 @@
+#include <atomic>
+#include <string>
+
+#include "client/simple_client.hpp"
+#include "server/hot_key_cache.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+constexpr size_t kNumReads = 20;
+constexpr size_t kNumThreads = 8;
+
+CachedResponse make_response(const string& value, uint64_t version,
+                             uint64_t expires_at = 0) {
+  auto msg = serialize_response(GetResponse{value});
+  ASSERT(msg);
+  return {make_shared<const Message>(std::move(*msg)), true, version,
+          expires_at};
+}
+
+void test_admission() {
+  // A single slot, so that every key competes for it
+  HotKeyCache cache(1);
+
+  // Keys only get cached once they're hot
+  for (uint32_t i = 1; i < HotKeyCache::HOT_THRESHOLD; i++) {
+    ASSERT(!cache.get("hot", 1));
+  }
+  cache.put("hot", make_response("v", 1));
+  ASSERT(!cache.get("hot", 1));
+  ASSERT(cache.is_hot("hot"));
+  cache.put("hot", make_response("v", 1));
+  ASSERT(cache.get("hot", 1));
+
+  // A write to the key's bucket invalidates the response
+  ASSERT(!cache.get("hot", 2));
+  cache.put("hot", make_response("v2", 2));
+  ASSERT(cache.get("hot", 2));
+
+  // So does the key expiring
+  cache.put("hot", make_response("v3", 3, now_ms() - 1));
+  ASSERT(!cache.get("hot", 3));
+
+  // Misses aren't cached
+  cache.put("hot", CachedResponse{nullptr, false, 4, 0});
+  ASSERT(!cache.get("hot", 4));
+
+  // A few one-off reads of other keys don't displace a hot key...
+  cache.put("hot", make_response("v", 5));
+  for (uint32_t i = 0; i < HotKeyCache::HOT_THRESHOLD; i++) {
+    ASSERT(!cache.get("cold" + to_string(i), 1));
+  }
+  ASSERT(cache.get("hot", 5));
+
+  // ... but a key that's no longer read eventually does
+  for (uint32_t i = 0; i <= HotKeyCache::MAX_HEAT; i++) {
+    cache.get("other", 1);
+  }
+  ASSERT(!cache.is_hot("hot"));
+  ASSERT(!cache.get("hot", 5));
+}
+
+void test_coalescing() {
+  GetCoalescer coalescer;
+  atomic<size_t> fetches = 0;
+  auto fetch = [&] {
+    fetches++;
+    this_thread::sleep_for(200ms);
+    return make_response("v", 1);
+  };
+
+  // Identical Gets that overlap are answered by a single lookup
+  vector<thread> threads;
+  for (size_t i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&] {
+      CachedResponse res = coalescer.get("key", 1, fetch);
+      ASSERT(res.found && res.msg);
+    });
+  }
+  for (auto&& t : threads) t.join();
+  ASSERT_EQ(fetches.load(), 1u);
+
+  // A Get that started after a write doesn't reuse an earlier one's result
+  fetches = 0;
+  thread first([&] { coalescer.get("key", 1, fetch); });
+  this_thread::sleep_for(50ms);
+  coalescer.get("key", 2, fetch);
+  first.join();
+  ASSERT_EQ(fetches.load(), 2u);
+}
+
+void test_server() {
+  string addr = make_server_addresses(1, 12300)[0];
+  auto server = start_server<KvServer, const string&, uint64_t>(addr, 2);
+  SimpleClient client(addr);
+
+  // Reads of a hot key see every write to it
+  ASSERT(client.Put("celebrity", "a"));
+  for (size_t i = 0; i < kNumReads; i++) ASSERT(client.Get("celebrity") == "a");
+  ASSERT(client.Put("celebrity", "b"));
+  ASSERT(client.Get("celebrity") == "b");
+  ASSERT(client.Append("celebrity", "c"));
+  for (size_t i = 0; i < kNumReads; i++) {
+    ASSERT(client.Get("celebrity") == "bc");
+  }
+  ASSERT(client.Delete("celebrity") == "bc");
+  ASSERT(!client.Get("celebrity"));
+
+  // Writes to other keys in the same bucket don't change what's read
+  ASSERT(client.Put("celebrity", "d"));
+  for (size_t i = 0; i < kNumReads; i++) {
+    ASSERT(client.Put("other" + to_string(i), "x"));
+    ASSERT(client.Get("celebrity") == "d");
+  }
+
+  // A cached key still expires
+  ASSERT(client.Put("session", "s", 300));
+  for (size_t i = 0; i < kNumReads; i++) ASSERT(client.Get("session") == "s");
+  this_thread::sleep_for(400ms);
+  ASSERT(!client.Get("session"));
+
+  server->stop();
+}
+
+int main() {
+  TEST(test_admission);
+  TEST(test_coalescing);
+  TEST(test_server);
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,125 @@
+#include <endian.h>
+
+#include <string>
+#include <vector>
+
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_simple_client(const string& server) {
+  SimpleClient client(server);
+  ASSERT(client.Put("a", "1"));
+  ASSERT(client.Append("a", "2"));
+  ASSERT(client.Get("a") == "12");
+  ASSERT(!client.Get("missing"));
+
+  // Large values span many receive buffers, and don't fit in the socket in
+  // one send
+  string large(3 << 20, 'x');
+  for (size_t i = 0; i < large.size(); i += 4096) large[i] = char('a' + i % 26);
+  ASSERT(client.Put("large", large));
+  ASSERT(client.Get("large") == large);
+}
+
+void test_pipelining(const string& server) {
+  // Requests sent back to back on one connection are answered in order
+  int fd = connect_to_address(server);
+  ASSERT(fd >= 0);
+  for (int i = 0; i < 50; i++) {
+    auto msg = serialize_request(AppendRequest{"pipelined", to_string(i)});
+    ASSERT(msg && send_message(fd, &*msg));
+  }
+  auto msg = serialize_request(GetRequest{"pipelined"});
+  ASSERT(msg && send_message(fd, &*msg));
+
+  for (int i = 0; i < 50; i++) {
+    Message res_msg;
+    ASSERT(recv_message(fd, &res_msg));
+    auto res = deserialize_response(res_msg);
+    ASSERT(res && holds_alternative<AppendResponse>(*res));
+  }
+  Message res_msg;
+  ASSERT(recv_message(fd, &res_msg));
+  auto res = deserialize_response(res_msg);
+  ASSERT(res);
+  string expected;
+  for (int i = 0; i < 50; i++) expected += to_string(i);
+  ASSERT_EQ(get<GetResponse>(*res).value, expected);
+  close(fd);
+}
+
+void test_idle_connections(const string& server) {
+  // Open connections don't tie up the (two) workers
+  vector<shared_ptr<ServerConn>> conns;
+  for (int i = 0; i < 200; i++) {
+    conns.push_back(connect_to_server(server));
+    ASSERT(conns.back());
+  }
+  for (size_t i = 0; i < conns.size(); i++) {
+    ASSERT(conns[i]->send_request(PutRequest{"k" + to_string(i), "v"}));
+  }
+  for (auto&& conn : conns) {
+    auto res = conn->recv_response();
+    ASSERT(res && holds_alternative<PutResponse>(*res));
+  }
+  for (auto&& conn : conns) conn->close();
+  ASSERT(SimpleClient(server).Get("k199") == "v");
+}
+
+void test_bad_clients(const string& server) {
+  // A client whose header claims more than the maximum is disconnected...
+  int fd = connect_to_address(server);
+  ASSERT(fd >= 0);
+  uint64_t header =
+      htobe64(uint64_t(MessageType::PUT) << MESSAGE_SIZE_BITS | (64 << 20));
+  ASSERT_EQ(sendall(fd, &header, sizeof(header), MSG_NOSIGNAL),
+            ssize_t(sizeof(header)));
+  Message msg;
+  ASSERT(!recv_message(fd, &msg));
+  close(fd);
+
+  // ... as is one that sends garbage
+  fd = connect_to_address(server);
+  ASSERT(fd >= 0);
+  Message garbage{MessageType::PUT, 16, vector<byte>(16, byte(0xff))};
+  ASSERT(send_message(fd, &garbage));
+  ASSERT(!recv_message(fd, &msg));
+  close(fd);
+
+  // One that goes away halfway through a message is forgotten
+  fd = connect_to_address(server);
+  ASSERT(fd >= 0);
+  header = htobe64(uint64_t(MessageType::PUT) << MESSAGE_SIZE_BITS | 1000);
+  ASSERT_EQ(sendall(fd, &header, sizeof(header), MSG_NOSIGNAL),
+            ssize_t(sizeof(header)));
+  close(fd);
+
+  // while everyone else carries on
+  ASSERT(SimpleClient(server).Get("a") == "12");
+}
+
+int main() {
+  int port = 13500;
+  for (IoEngineType type : {IoEngineType::EPOLL, IoEngineType::IO_URING}) {
+    KvServerOptions options;
+    options.io_engine = type;
+    options.max_message_size = 8 << 20;
+    string addr = make_server_addresses(1, port++)[0];
+    auto server = start_server<KvServer, const string&, uint64_t,
+                               const KvServerOptions&>(addr, 2, options);
+    // io_uring may fall back to epoll on older kernels
+    ASSERT(server->io_engine_type() != IoEngineType::THREADS);
+
+    TEST(test_simple_client, addr);
+    TEST(test_pipelining, addr);
+    TEST(test_idle_connections, addr);
+    TEST(test_bad_clients, addr);
+    server->stop();
+  }
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include <string>
+#include <vector>
+
+#include "client/simple_client.hpp"
+#include "server/codel.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_codel() {
+  CoDel codel(5ms, 100ms);
+  auto start = CoDel::Clock::now();
+
+  // A burst that drains is let through, unless it waits a whole interval
+  ASSERT(!codel.shed(start, start + 50ms, 10));
+  ASSERT(!codel.shed(start, start + 90ms, 0));
+  ASSERT(codel.shed(start, start + 101ms, 5));
+
+  // Once the queue hasn't emptied for an interval, anything that's waited
+  // more than the target is shed...
+  auto t = start + 200ms;
+  ASSERT(!codel.shed(t, t, 0));
+  ASSERT(!codel.shed(t + 60ms, t + 62ms, 10));
+  ASSERT(!codel.shed(t + 108ms, t + 110ms, 10));
+  ASSERT(codel.shed(t + 140ms, t + 150ms, 10));
+  ASSERT(!codel.shed(t + 148ms, t + 151ms, 10));
+
+  // ... until it empties again
+  ASSERT(!codel.shed(t + 160ms, t + 170ms, 0));
+  ASSERT(!codel.shed(t + 170ms, t + 180ms, 3));
+}
+
+void test_error_codes() {
+  auto msg = serialize_response(
+      ErrorResponse{"server overloaded", ErrorCode::OVERLOADED});
+  ASSERT(msg);
+  auto res = deserialize_response(*msg);
+  ASSERT(res);
+  ASSERT(get<ErrorResponse>(*res).code == ErrorCode::OVERLOADED);
+
+  // Errors from peers that predate codes (the same, without the code at the
+  // end) are generic
+  msg->buf.pop_back();
+  msg->sz--;
+  res = deserialize_response(*msg);
+  ASSERT(res);
+  ASSERT_EQ(get<ErrorResponse>(*res).msg, string("server overloaded"));
+  ASSERT(get<ErrorResponse>(*res).code == ErrorCode::GENERIC);
+}
+
+void test_engine_queue_depth(const string& addr) {
+  // One worker, and 200 clients sending at once: those that find too many
+  // waiting behind them are turned away, and everyone gets an answer
+  KvServerOptions options;
+  options.io_engine = IoEngineType::EPOLL;
+  options.max_queue_depth = 10;
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 1, options);
+  ASSERT(SimpleClient(addr).Put("key", "value"));
+
+  vector<shared_ptr<ServerConn>> conns;
+  for (int i = 0; i < 200; i++) {
+    conns.push_back(connect_to_server(addr));
+    ASSERT(conns.back());
+  }
+  // Keep the worker busy while the Gets arrive
+  auto slow = connect_to_server(addr);
+  vector<string> keys = make_rand_strs(100'000, 10);
+  ASSERT(slow && slow->send_request(MultiPutRequest{keys, keys}));
+  for (auto&& conn : conns) ASSERT(conn->send_request(GetRequest{"key"}));
+  auto slow_res = slow->recv_response();
+  ASSERT(slow_res && holds_alternative<MultiPutResponse>(*slow_res));
+
+  size_t n_shed = 0;
+  for (auto&& conn : conns) {
+    auto res = conn->recv_response();
+    ASSERT(res);
+    if (auto* error_res = get_if<ErrorResponse>(&*res)) {
+      ASSERT(error_res->code == ErrorCode::OVERLOADED);
+      n_shed++;
+    } else {
+      ASSERT_EQ(get<GetResponse>(*res).value, string("value"));
+    }
+  }
+  ASSERT(n_shed > 0);
+  ASSERT_EQ(server->worker_loads()[0].n_shed, n_shed);
+
+  // The queue drained, so later requests go through
+  ASSERT(SimpleClient(addr).Get("key") == "value");
+  for (auto&& conn : conns) conn->close();
+  slow->close();
+  server->stop();
+}
+
+void test_threads_queue_depth(const string& addr) {
+  // With THREADS, it's connections that queue: while the only worker serves
+  // one, the first of the next two finds the other behind it, and is shed
+  KvServerOptions options;
+  options.max_queue_depth = 1;
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 1, options);
+
+  auto busy = connect_to_server(addr);
+  ASSERT(busy && busy->send_request(PutRequest{"key", "value"}));
+  ASSERT(busy->recv_response());
+
+  auto first = connect_to_server(addr);
+  auto second = connect_to_server(addr);
+  ASSERT(first && first->send_request(GetRequest{"key"}));
+  ASSERT(second && second->send_request(GetRequest{"key"}));
+  this_thread::sleep_for(100ms);
+  ASSERT_EQ(server->worker_loads()[0].queue_depth, 2ul);
+  busy->close();
+
+  auto res = first->recv_response();
+  ASSERT(res && get<ErrorResponse>(*res).code == ErrorCode::OVERLOADED);
+  res = second->recv_response();
+  ASSERT(res && get<GetResponse>(*res).value == "value");
+  ASSERT_EQ(server->worker_loads()[0].n_shed, 1ul);
+  first->close();
+  second->close();
+  server->stop();
+}
+
+void test_threads_shed_silent_client(const string& addr) {
+  // A shed connection is answered before it sends anything, so one that never
+  // does can't hold up the worker
+  KvServerOptions options;
+  options.max_queue_depth = 1;
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 1, options);
+
+  auto busy = connect_to_server(addr);
+  ASSERT(busy && busy->send_request(PutRequest{"key", "value"}));
+  ASSERT(busy->recv_response());
+
+  auto silent = connect_to_server(addr);
+  ASSERT(silent);
+  this_thread::sleep_for(50ms);
+  auto second = connect_to_server(addr);
+  ASSERT(second && second->send_request(GetRequest{"key"}));
+  this_thread::sleep_for(100ms);
+  ASSERT_EQ(server->worker_loads()[0].queue_depth, 2ul);
+  auto start = chrono::steady_clock::now();
+  busy->close();
+
+  auto res = silent->recv_response();
+  ASSERT(res && get<ErrorResponse>(*res).code == ErrorCode::OVERLOADED);
+  res = second->recv_response();
+  ASSERT(res && get<GetResponse>(*res).value == "value");
+  ASSERT(chrono::steady_clock::now() - start < 200ms);
+  ASSERT_EQ(server->worker_loads()[0].n_shed, 1ul);
+  silent->close();
+  second->close();
+  server->stop();
+}
+
+int main() {
+  TEST(test_codel);
+  TEST(test_error_codes);
+  TEST(test_engine_queue_depth, make_server_addresses(1, 13720)[0]);
+  TEST(test_threads_queue_depth, make_server_addresses(1, 13721)[0]);
+  TEST(test_threads_shed_silent_client, make_server_addresses(1, 13797)[0]);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,82 @@
+#include <filesystem>
+#include <string>
+
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_simple_client(const string& path) {
+  // Both local transports reach the same server
+  SimpleClient unix_client(UNIX_SCHEME + path);
+  SimpleClient shm_client(SHM_SCHEME + path);
+  ASSERT(unix_client.Put("a", "1"));
+  ASSERT(shm_client.Get("a") == "1");
+  ASSERT(shm_client.Put("b", "2"));
+  ASSERT(unix_client.Get("b") == "2");
+
+  // Values larger than a ring stream through it
+  string large(3 * ShmChannel::RING_SIZE + 7, 'x');
+  for (size_t i = 0; i < large.size(); i += 4096) large[i] = char('a' + i % 26);
+  ASSERT(shm_client.Put("large", large));
+  ASSERT(shm_client.Get("large") == large);
+  ASSERT(unix_client.Get("large") == large);
+}
+
+void test_persistent_connection(const string& path) {
+  // Many requests go back and forth over one channel
+  auto conn = connect_to_server(SHM_SCHEME + path);
+  ASSERT(conn);
+  for (int i = 0; i < 1000; i++) {
+    string key = "k" + to_string(i % 10);
+    ASSERT(conn->send_request(AppendRequest{key, to_string(i)}));
+    auto res = conn->recv_response();
+    ASSERT(res && holds_alternative<AppendResponse>(*res));
+  }
+  ASSERT(conn->send_request(GetRequest{"k3"}));
+  auto res = conn->recv_response();
+  ASSERT(res);
+  string expected;
+  for (int i = 3; i < 1000; i += 10) expected += to_string(i);
+  ASSERT_EQ(get<GetResponse>(*res).value, expected);
+}
+
+void test_client_disappears(const string& path) {
+  // A client that goes away without closing its channel (as if its process
+  // died) doesn't hold on to the server's only worker
+  auto* leaked =
+      new shared_ptr<ServerConn>(connect_to_server(SHM_SCHEME + path));
+  ASSERT(*leaked);
+  ASSERT((*leaked)->send_request(GetRequest{"a"}));
+  ASSERT((*leaked)->recv_response());
+  ::close((*leaked)->fd);
+  ASSERT(SimpleClient(UNIX_SCHEME + path).Get("a") == "1");
+
+  // Neither does one that doesn't say which transport it uses
+  int fd = connect_to_address(UNIX_SCHEME + path);
+  ASSERT(fd >= 0);
+  auto msg = serialize_request(GetRequest{"a"});
+  ASSERT(msg && send_message(fd, &*msg));
+  Message res;
+  ASSERT(!recv_message(fd, &res));
+  close(fd);
+  ASSERT(SimpleClient(SHM_SCHEME + path).Get("a") == "1");
+}
+
+int main() {
+  string path = (filesystem::temp_directory_path() /
+                 ("test_local_transports_" + random_string(8) + ".sock"))
+                    .string();
+  auto server =
+      start_server<KvServer, const string&, uint64_t>(UNIX_SCHEME + path, 1);
+
+  TEST(test_simple_client, path);
+  TEST(test_persistent_connection, path);
+  TEST(test_client_disappears, path);
+
+  server->stop();
+  ASSERT(!filesystem::exists(path));
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
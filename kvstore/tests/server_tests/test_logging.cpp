@@ -0,0 +1,135 @@
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common/log.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+// Captures what the logger writes to `stream` while it's alive.
+class Capture {
+ public:
+  explicit Capture(ostream& stream) : stream(stream) {
+    flush_logs();
+    this->old = stream.rdbuf(this->captured.rdbuf());
+  }
+  ~Capture() {
+    this->stream.rdbuf(this->old);
+  }
+
+  vector<string> lines() {
+    flush_logs();
+    vector<string> lines;
+    istringstream in(this->captured.str());
+    for (string line; getline(in, line);) lines.push_back(line);
+    return lines;
+  }
+
+ private:
+  ostream& stream;
+  ostringstream captured;
+  streambuf* old;
+};
+
+static int n_evaluated = 0;
+static string evaluated() {
+  n_evaluated++;
+  return "evaluated";
+}
+
+void test_levels() {
+  Capture out(cout);
+  Capture err(cerr);
+  log_level = LogLevel::WARN;
+  log_debug("debug ", evaluated());
+  log_info("info ", evaluated());
+  log_warn("warn ", evaluated());
+  log_error("error ", evaluated());
+  log_level = LogLevel::INFO;
+
+  // Disabled lines don't even evaluate their arguments
+  ASSERT_EQ(n_evaluated, 2);
+  ASSERT(out.lines().empty());
+  vector<string> lines = err.lines();
+  ASSERT_EQ(lines.size(), 2ul);
+  ASSERT(lines[0].find("warn evaluated") != string::npos);
+  ASSERT(lines[0].find("test_logging.cpp") != string::npos);
+  ASSERT(lines[1].find("error evaluated") != string::npos);
+}
+
+void test_threads() {
+  // Each thread's lines come out whole, and in the order it logged them
+  Capture out(cout);
+  vector<thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < 500; i++) log_info(t, ' ', i);
+    });
+  }
+  for (auto&& thread : threads) thread.join();
+
+  vector<string> lines = out.lines();
+  ASSERT_EQ(lines.size(), 2000ul);
+  vector<int> next(4, 0);
+  for (const string& line : lines) {
+    istringstream in(line.substr(BLUE.size()));
+    int t, i;
+    ASSERT(in >> t >> i);
+    ASSERT_EQ(i, next[t]);
+    next[t]++;
+  }
+}
+
+void test_dropped() {
+  // A thread that logs faster than the flusher keeps up drops lines rather
+  // than wait, and the flusher says how many
+  Capture out(cout);
+  Capture err(cerr);
+  thread([] {
+    for (int i = 0; i < 20000; i++) log_info("line ", i);
+  }).join();
+
+  size_t n_written = out.lines().size();
+  size_t n_dropped = 0;
+  for (const string& line : err.lines()) {
+    istringstream in(line.substr(YELLOW.size()));
+    string dropped;
+    size_t n;
+    ASSERT(in >> dropped >> n && dropped == "Dropped");
+    n_dropped += n;
+  }
+  ASSERT_EQ(n_written + n_dropped, 20000ul);
+}
+
+void test_sampling() {
+  LogSampler sampler(100ms);
+  uint64_t suppressed;
+  ASSERT(sampler.sample(&suppressed));
+  ASSERT_EQ(suppressed, 0ul);
+  for (int i = 0; i < 9; i++) ASSERT(!sampler.sample(&suppressed));
+  this_thread::sleep_for(110ms);
+  ASSERT(sampler.sample(&suppressed));
+  ASSERT_EQ(suppressed, 9ul);
+
+  // A repeated error is logged once a second
+  Capture err(cerr);
+  for (int i = 0; i < 1000; i++) {
+    log_sampled(LogLevel::WARN, "request ", i, " failed");
+  }
+  vector<string> lines = err.lines();
+  ASSERT_EQ(lines.size(), 1ul);
+  ASSERT(lines[0].find("request 0 failed") != string::npos);
+}
+
+int main() {
+  TEST(test_levels);
+  TEST(test_threads);
+  TEST(test_dropped);
+  TEST(test_sampling);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
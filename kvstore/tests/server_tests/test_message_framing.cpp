@@ -0,0 +1,127 @@
+#include <endian.h>
+#include <sys/socket.h>
+
+#include <future>
+#include <string>
+
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+// Writes a raw message header announcing a body of `size` bytes.
+void send_header(int fd, MessageType type, uint64_t size) {
+  uint64_t header = htobe64(uint64_t(type) << MESSAGE_SIZE_BITS | size);
+  ASSERT_EQ(sendall(fd, &header, sizeof(header), MSG_NOSIGNAL),
+            ssize_t(sizeof(header)));
+}
+
+void test_chunked_round_trip() {
+  // A body spanning several chunks arrives intact, over a socket whose buffer
+  // is far smaller than it
+  int fds[2];
+  ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  Message msg{MessageType::PUT, 0, {}};
+  msg.buf.resize(5 * MESSAGE_CHUNK_SIZE + 123);
+  for (size_t i = 0; i < msg.buf.size(); i++) msg.buf[i] = byte(i * 7);
+  msg.sz = msg.buf.size();
+  auto sent = async(launch::async, [&] { return send_message(fds[0], &msg); });
+
+  // The receive buffer holds a previous, larger message
+  Message out;
+  out.buf.resize(10 * MESSAGE_CHUNK_SIZE);
+  ASSERT(recv_message(fds[1], &out, 2000ms));
+  ASSERT(sent.get());
+  ASSERT(out.type == MessageType::PUT);
+  ASSERT_EQ(out.sz, msg.sz);
+  ASSERT(out.buf == msg.buf);
+
+  // So does an empty one
+  Message empty{MessageType::QUERY, 0, {}};
+  ASSERT(send_message(fds[0], &empty));
+  ASSERT(recv_message(fds[1], &out));
+  ASSERT(out.type == MessageType::QUERY);
+  ASSERT_EQ(out.sz, size_t(0));
+  ASSERT(out.buf.empty());
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_large_header() {
+  // Sizes past 32 bits survive the header, and the buffer only grows as the
+  // body actually arrives
+  int fds[2];
+  ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  send_header(fds[0], MessageType::MULTI_PUT, uint64_t(1) << 33);
+  string partial(1000, 'x');
+  ASSERT(sendall(fds[0], partial.data(), partial.size(), 0) > 0);
+  close(fds[0]);
+
+  Message msg;
+  ASSERT(!recv_message(fds[1], &msg, 400ms, SIZE_MAX));
+  ASSERT(msg.type == MessageType::MULTI_PUT);
+  ASSERT_EQ(msg.sz, size_t(1) << 33);
+  ASSERT(msg.buf.capacity() <= MESSAGE_CHUNK_SIZE);
+  close(fds[1]);
+}
+
+void test_max_size() {
+  // Bodies over the maximum are refused before anything is read or allocated
+  int fds[2];
+  ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  send_header(fds[0], MessageType::PUT, DEFAULT_MAX_MESSAGE_SIZE + 1);
+  Message msg;
+  ASSERT(!recv_message(fds[1], &msg));
+  ASSERT_EQ(msg.buf.capacity(), size_t(0));
+
+  Message small{MessageType::PUT, 100, vector<byte>(100)};
+  ASSERT(send_message(fds[0], &small));
+  ASSERT(!recv_message(fds[1], &msg, 400ms, 99));
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void test_server(const string& server) {
+  SimpleClient client(server);
+  string value(3 << 20, 'v');
+  ASSERT(client.Put("small", "v"));
+
+  // A client that sends a request over the server's limit is disconnected...
+  auto conn = connect_to_server(server);
+  ASSERT(conn);
+  conn->wire_format.compression = false;
+  conn->send_request(PutRequest{"big", value});
+  ASSERT(!conn->recv_response());
+
+  // ... as is one whose header claims an absurd size
+  conn = connect_to_server(server);
+  ASSERT(conn);
+  send_header(conn->fd, MessageType::PUT,
+              (uint64_t(1) << MESSAGE_SIZE_BITS) - 1);
+  ASSERT(!conn->recv_response());
+
+  // while everyone else carries on
+  ASSERT(!client.Get("big"));
+  ASSERT(client.Get("small") == "v");
+  value.resize(1 << 20);
+  ASSERT(client.Put("big", value));
+  ASSERT(client.Get("big") == value);
+}
+
+int main() {
+  KvServerOptions options;
+  options.max_message_size = 2 << 20;
+  string addr = make_server_addresses(1, 13100)[0];
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 2, options);
+
+  TEST(test_chunked_round_trip);
+  TEST(test_large_header);
+  TEST(test_max_size);
+  TEST(test_server, addr);
+
+  server->stop();
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,50 @@
+#include <future>
+
+#include "test_utils/test_utils.hpp"
+
+static constexpr std::size_t kMaxBytes = 1 << 20;
+static constexpr std::size_t kNumThreads = 8;
+static constexpr std::size_t kNumKeysPerThread = 20'000;
+
+int main() {
+  ConcurrentKvStore store;
+  store.SetMemoryLimit(kMaxBytes);
+
+  // Threads write, append to and read their own keys while evicting each
+  // other's. Every successful read must see a value some thread wrote.
+  auto threads = std::vector<std::future<bool>>{};
+  for (std::size_t t = 0; t < kNumThreads; t++) {
+    threads.push_back(std::async(std::launch::async, [&, t] {
+      auto keys = make_pseudo_rand_str(kNumKeysPerThread, 16, t);
+      for (std::size_t i = 0; i < kNumKeysPerThread; i++) {
+        if (i % 10 == 9) {
+          auto mput_req = MultiPutRequest{
+              .keys = {keys[i - 1], keys[i]}, .values = {"m", "m"}};
+          auto mput_res = MultiPutResponse{};
+          ASSERT(store.MultiPut(&mput_req, &mput_res));
+        } else {
+          auto put_req = PutRequest{.key = keys[i], .value = keys[i]};
+          auto put_res = PutResponse{};
+          ASSERT(store.Put(&put_req, &put_res));
+          auto append_req = AppendRequest{.key = keys[i], .value = "!"};
+          auto append_res = AppendResponse{};
+          ASSERT(store.Append(&append_req, &append_res));
+        }
+
+        auto get_req = GetRequest{.key = keys[i / 2]};
+        auto get_res = GetResponse{};
+        if (store.Get(&get_req, &get_res)) {
+          ASSERT(get_res.value == "m" || get_res.value == "!" ||
+                 get_res.value.starts_with(keys[i / 2]));
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto& t : threads) ASSERT(t.get());
+
+  CacheStats stats = store.GetCacheStats();
+  ASSERT(stats.used_bytes <= stats.max_bytes);
+  ASSERT(stats.evictions > 0);
+  ASSERT_EQ(stats.hits + stats.misses, kNumThreads * kNumKeysPerThread);
+}
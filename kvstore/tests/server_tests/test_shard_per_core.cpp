@@ -0,0 +1,218 @@
+#include <future>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client/simple_client.hpp"
+#include "common/spsc_queue.hpp"
+#include "server/core_shards.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_spsc_queue() {
+  // Across several blocks, and with the consumer racing the producer
+  SpscQueue<string, 4> queue;
+  ASSERT(!queue.pop());
+  const int n = 10000;
+  thread producer([&] {
+    for (int i = 0; i < n; i++) queue.push(to_string(i));
+  });
+  for (int i = 0; i < n;) {
+    if (optional<string> item = queue.pop()) {
+      ASSERT_EQ(*item, to_string(i));
+      i++;
+    }
+  }
+  producer.join();
+  ASSERT(!queue.pop());
+  ASSERT_EQ(queue.size(), 0ul);
+
+  // Leftover items are freed with the queue
+  for (int i = 0; i < 10; i++) queue.push("left over");
+  ASSERT_EQ(queue.size(), 10ul);
+}
+
+void test_core_of() {
+  // Keys are split over the cores by range
+  CoreShards shards(4);
+  ASSERT_EQ(shards.n_cores(), 4ul);
+  ASSERT_EQ(shards.core_of("0abc"), 0ul);
+  ASSERT_EQ(shards.core_of("zebra"), 3ul);
+  ASSERT_EQ(shards.core_of("Zebra"), 3ul);
+  for (string key : {"0", "9", "A", "k", "M", "n", "Y", "z"}) {
+    size_t core = shards.core_of(key);
+    for (string next : {"0", "9", "A", "k", "M", "n", "Y", "z"}) {
+      if (toupper(next[0]) > toupper(key[0])) {
+        ASSERT(shards.core_of(next) >= core);
+      }
+    }
+  }
+  // and keys outside every range land on a core too
+  for (string key : {"", "_", "-x", "\xff"}) ASSERT(shards.core_of(key) < 4);
+  ASSERT_EQ(CoreShards(1).core_of("anything"), 0ul);
+}
+
+void test_split_and_merge() {
+  CoreShards shards(2);
+  size_t a = shards.core_of("apple"), z = shards.core_of("zoo");
+  ASSERT(a != z);
+
+  // Single-key requests go to their key's core, and keyless ones stay home
+  vector<CoreShards::Part> parts = shards.split(GetRequest{"zoo"}, a);
+  ASSERT_EQ(parts.size(), 1ul);
+  ASSERT_EQ(parts[0].core, z);
+  parts = shards.split(StatsRequest{}, z);
+  ASSERT_EQ(parts.size(), 1ul);
+  ASSERT_EQ(parts[0].core, z);
+
+  // Multi-key requests are split, and their responses put back in order
+  parts = shards.split(MultiGetRequest{{"zoo", "apple", "zebra"}}, a);
+  ASSERT_EQ(parts.size(), 2ul);
+  for (auto&& part : parts) {
+    auto& keys = get<MultiGetRequest>(part.req).keys;
+    MultiGetResponse res;
+    for (auto&& key : keys) res.values.push_back(key + "!");
+    part.res = res;
+  }
+  Response res = CoreShards::merge(parts);
+  ASSERT(get<MultiGetResponse>(res).values ==
+         vector<string>({"zoo!", "apple!", "zebra!"}));
+
+  // A part's error is the whole request's
+  parts = shards.split(MultiPutRequest{{"apple", "zoo"}, {"1", "2"}, 0}, a);
+  ASSERT_EQ(parts.size(), 2ul);
+  parts[0].res = MultiPutResponse{};
+  parts[1].res = ErrorResponse{"nope"};
+  ASSERT_EQ(get<ErrorResponse>(CoreShards::merge(parts)).msg, "nope");
+
+  // Scans go to every core, and are merged in key order, up to their limit
+  parts = shards.split(ScanRangeRequest{"", "", 3}, a);
+  ASSERT_EQ(parts.size(), 2ul);
+  parts[0].res = ScanRangeResponse{{"apple", "bee"}, {"1", "2"}};
+  parts[1].res = ScanRangeResponse{{"ant", "zoo"}, {"3", "4"}};
+  res = CoreShards::merge(parts, 3);
+  ASSERT(get<ScanRangeResponse>(res).keys ==
+         vector<string>({"ant", "apple", "bee"}));
+}
+
+void test_server(const string& addr, uint64_t n_cores) {
+  KvServerOptions options;
+  options.io_engine = IoEngineType::EPOLL;
+  options.shard_per_core = true;
+  options.ordered_index = true;
+  auto server =
+      start_server<KvServer, const string&, uint64_t, const KvServerOptions&>(
+          addr, uint64_t(n_cores), options);
+  ASSERT(server->shard_per_core());
+
+  // Keys spread over every core, from connections homed on every core
+  vector<string> keys;
+  for (char c : string("0123456789abcdefghijklmnopqrstuvwxyz")) {
+    keys.push_back(string(1, c) + "key");
+  }
+  vector<SimpleClient> clients;
+  for (size_t i = 0; i < 3; i++) clients.emplace_back(addr);
+  for (size_t i = 0; i < keys.size(); i++) {
+    SimpleClient& client = clients[i % clients.size()];
+    ASSERT(client.Put(keys[i], "v" + keys[i]));
+  }
+  for (size_t i = 0; i < keys.size(); i++) {
+    SimpleClient& client = clients[(i + 1) % clients.size()];
+    ASSERT_EQ(*client.Get(keys[i]), "v" + keys[i]);
+  }
+  ASSERT(clients[0].Append("zkey", "!"));
+  ASSERT_EQ(*clients[1].Delete("zkey"), "vzkey!");
+  ASSERT(!clients[0].Get("zkey"));
+
+  // Multi-key requests across cores
+  ASSERT(clients[0].MultiPut({"akey", "mkey", "ykey"}, {"1", "2", "3"}));
+  optional<vector<string>> values =
+      clients[1].MultiGet({"ykey", "akey", "mkey"});
+  ASSERT(values);
+  ASSERT(*values == vector<string>({"3", "1", "2"}));
+  ASSERT(!clients[1].MultiGet({"akey", "zkey"}));
+
+  // A scan sees every core's keys, in order
+  optional<map<string, string>> scan = clients[0].ScanRange("", "", 5);
+  ASSERT(scan);
+  ASSERT_EQ(scan->size(), 5ul);
+  ASSERT_EQ(scan->begin()->first, "0key");
+  ASSERT_EQ(scan->rbegin()->first, "4key");
+
+  // as does a batch, with its results in order
+  optional<vector<BatchResult>> results = clients[2].Batch(
+      {GetRequest{"ykey"}, IncrRequest{"counter", 5}, GetRequest{"0key"}});
+  ASSERT(results);
+  ASSERT_EQ(results->size(), 3ul);
+  ASSERT_EQ(get<GetResponse>((*results)[0]).value, "3");
+  ASSERT_EQ(get<IncrResponse>((*results)[1]).value, 5);
+  ASSERT_EQ(get<GetResponse>((*results)[2]).value, "v0key");
+  map<string, string> all = server->all_kvpairs();
+  ASSERT_EQ(all.size(), keys.size());
+  ASSERT_EQ(all["akey"], "1");
+  server->stop();
+}
+
+void test_atomic_multiput_multiget(const string& addr) {
+  // Like test_atomic_multiput_multiget, but with the keys spread over cores:
+  // a MultiGet sees all of a MultiPut's values, or none of them
+  KvServerOptions options;
+  options.io_engine = IoEngineType::EPOLL;
+  options.shard_per_core = true;
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 3, options);
+  vector<string> keys;
+  for (char c : string("0123456789abcdefghijklmnopqrstuvwxyz")) {
+    keys.push_back(string(1, c) + "key");
+  }
+  ASSERT(SimpleClient(addr).MultiPut(keys, vector<string>(keys.size(), "A")));
+
+  const size_t n_threads = 6, n_ops = 300;
+  vector<future<bool>> threads;
+  for (size_t t = 0; t < n_threads; t++) {
+    threads.push_back(async(launch::async, [&, t] {
+      SimpleClient client(addr);
+      vector<string> values(keys.size(), string(1, 'A' + t));
+      for (size_t i = 0; i < n_ops; i++) {
+        if (t % 2) {
+          ASSERT(client.MultiPut(keys, values));
+          continue;
+        }
+        optional<vector<string>> got = client.MultiGet(keys);
+        ASSERT(got && got->size() == keys.size());
+        for (auto&& value : *got) ASSERT_EQ(value, got->front());
+      }
+      return true;
+    }));
+  }
+  for (auto&& thread : threads) ASSERT(thread.get());
+  server->stop();
+}
+
+void test_needs_io_engine(const string& addr) {
+  KvServerOptions options;
+  options.shard_per_core = true;
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 2, options);
+  ASSERT(!server->shard_per_core());
+  SimpleClient client(addr);
+  ASSERT(client.Put("key", "value"));
+  ASSERT_EQ(*client.Get("key"), "value");
+  server->stop();
+}
+
+int main() {
+  TEST(test_spsc_queue);
+  TEST(test_core_of);
+  TEST(test_split_and_merge);
+  TEST(test_server, make_server_addresses(1, 13794)[0], 1);
+  TEST(test_server, make_server_addresses(1, 13795)[0], 3);
+  TEST(test_atomic_multiput_multiget, make_server_addresses(1, 13798)[0]);
+  TEST(test_needs_io_engine, make_server_addresses(1, 13796)[0]);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
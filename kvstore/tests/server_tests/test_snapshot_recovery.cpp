@@ -0,0 +1,79 @@
+#include <filesystem>
+
+#include "test_utils/test_utils.hpp"
+
+constexpr std::size_t kRandStringLength = 12;
+constexpr std::size_t kNumKVPairs = 1'000;
+
+// Counts the write-ahead log segments in `dir`.
+std::size_t count_segments(const std::filesystem::path& dir) {
+  std::size_t n = 0;
+  for (auto&& entry : std::filesystem::directory_iterator(dir)) {
+    n += entry.path().filename().string().starts_with("wal-");
+  }
+  return n;
+}
+
+int main() {
+  auto dir = std::filesystem::temp_directory_path() /
+             ("test_snapshot_recovery_" + random_string(8));
+  PersistenceOptions options{dir, SyncPolicy::PER_OP};
+
+  auto keys = make_rand_strs(kNumKVPairs, kRandStringLength);
+  auto vals = make_rand_strs(kNumKVPairs, kRandStringLength);
+
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT(put_range(*store, keys, vals, 0, kNumKVPairs / 2));
+    auto append_req = AppendRequest{.key = keys[0], .value = "!"};
+    auto append_res = AppendResponse{};
+    ASSERT(store->Append(&append_req, &append_res));
+
+    // The snapshot covers everything so far, so the log it replaces is deleted
+    ASSERT(store->Snapshot());
+    ASSERT_EQ(count_segments(dir), 1u);
+
+    // Keep writing after the snapshot; these must come from the log
+    ASSERT(multiput_range(*store, keys, vals, kNumKVPairs / 2, kNumKVPairs,
+                          10));
+    ASSERT(store->Append(&append_req, &append_res));
+    auto del_req = DeleteRequest{.key = keys[1]};
+    auto del_res = DeleteResponse{};
+    ASSERT(store->Delete(&del_req, &del_res));
+  }
+
+  // "Restart" the store: the snapshot and the log after it should combine to
+  // the same contents, with the appends applied exactly once
+  vals[0] += "!!";
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT(get_range(*store, keys, vals, 2, kNumKVPairs));
+    ASSERT(get_range(*store, keys, vals, 0, 1));
+
+    auto get_req = GetRequest{.key = keys[1]};
+    auto get_res = GetResponse{};
+    ASSERT(!store->Get(&get_req, &get_res));
+    ASSERT_EQ(store->AllKeys().size(), kNumKVPairs - 1);
+
+    // Snapshotting again should leave only the (empty) current segment
+    ASSERT(store->Snapshot());
+    ASSERT_EQ(count_segments(dir), 1u);
+  }
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT(get_range(*store, keys, vals, 0, 1));
+    ASSERT_EQ(store->AllKeys().size(), kNumKVPairs - 1);
+  }
+
+  // A store with a different number of buckets can't use the snapshot
+  {
+    auto store = std::make_unique<ConcurrentKvStore>(std::hash<std::string>(),
+                                                     DbMap::BUCKET_COUNT + 1);
+    ASSERT(!store->EnablePersistence(options));
+  }
+
+  std::filesystem::remove_all(dir);
+}
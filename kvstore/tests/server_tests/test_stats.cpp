@@ -0,0 +1,103 @@
+#include <string>
+#include <vector>
+
+#include "client/simple_client.hpp"
+#include "common/latency_histogram.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+void test_buckets() {
+  // Every latency lands in a bucket that ends at most 1/32 above it
+  for (uint64_t ns = 0; ns < (uint64_t(1) << 39); ns = ns * 5 / 4 + 1) {
+    size_t i = LatencyHistogram::bucket(ns);
+    ASSERT(i < LatencyHistogram::N_BUCKETS);
+    uint64_t top = LatencyHistogram::bucket_max(i);
+    ASSERT(top >= ns);
+    ASSERT(top - ns <= ns / 32);
+    ASSERT(i == 0 || LatencyHistogram::bucket_max(i - 1) < ns);
+  }
+  ASSERT_EQ(LatencyHistogram::bucket(~uint64_t(0)),
+            LatencyHistogram::N_BUCKETS - 1);
+}
+
+void test_percentiles() {
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 10000; i++) histogram.record(microseconds(i));
+
+  LatencyHistogram::Counts counts;
+  histogram.add_to(&counts);
+  ASSERT_EQ(counts.total, 10000ul);
+  ASSERT_EQ(counts.max, nanoseconds(10ms));
+  auto near = [](nanoseconds actual, nanoseconds expected) {
+    return actual >= expected && actual <= expected + expected / 32;
+  };
+  ASSERT(near(counts.percentile(0.5), 5000us));
+  ASSERT(near(counts.percentile(0.99), 9900us));
+  ASSERT(near(counts.percentile(0.999), 9990us));
+  ASSERT_EQ(counts.percentile(1), nanoseconds(10ms));
+
+  // Histograms add up
+  histogram.add_to(&counts);
+  ASSERT_EQ(counts.total, 20000ul);
+  ASSERT(near(counts.percentile(0.5), 5000us));
+}
+
+void test_server_stats(const string& addr, IoEngineType io_engine) {
+  KvServerOptions options;
+  options.io_engine = io_engine;
+  auto server = start_server<KvServer, const string&, uint64_t,
+                             const KvServerOptions&>(addr, 1, options);
+  SimpleClient client(addr);
+  for (int i = 0; i < 50; i++) {
+    ASSERT(client.Put("key" + to_string(i), "value"));
+  }
+  for (int i = 0; i < 20; i++) ASSERT(client.Get("key" + to_string(i)));
+  ASSERT(client.Append("key0", "!"));
+  ASSERT(client.Delete("key1"));
+  ASSERT(client.MultiGet({"key2", "key3"}));
+
+  optional<StatsResponse> stats = client.Stats();
+  ASSERT(stats);
+  map<string, LatencyStats> by_name;
+  for (auto&& latency : stats->latencies) by_name[latency.name] = latency;
+  ASSERT_EQ(by_name["put"].count, 50ul);
+  ASSERT_EQ(by_name["get"].count, 20ul);
+  ASSERT_EQ(by_name["append"].count, 1ul);
+  ASSERT_EQ(by_name["delete"].count, 1ul);
+  ASSERT_EQ(by_name["multiget"].count, 1ul);
+  ASSERT_EQ(by_name["multiput"].count, 0ul);
+  // Each SimpleClient call, including this one, waited in the queue once
+  ASSERT_EQ(by_name["queue"].count, 74ul);
+  for (auto&& [name, latency] : by_name) {
+    ASSERT(latency.p50_us <= latency.p99_us);
+    ASSERT(latency.p99_us <= latency.p999_us);
+    ASSERT(latency.p999_us <= latency.max_us);
+  }
+  ASSERT(stats->bytes_in > 0 && stats->bytes_out > 0);
+  // Every key read was there, and the store is unbounded
+  ASSERT_EQ(stats->cache_hits, 22ul);
+  ASSERT_EQ(stats->cache_misses, 0ul);
+  ASSERT_EQ(stats->cache_evictions, 0ul);
+
+  // Counters only go up, the last request included
+  optional<StatsResponse> later = client.Stats();
+  ASSERT(later);
+  ASSERT_EQ(later->latencies[0].count, 20ul);
+  ASSERT(later->bytes_out > stats->bytes_out);
+  ASSERT(later->uptime_ms >= stats->uptime_ms);
+  server->stop();
+}
+
+int main() {
+  TEST(test_buckets);
+  TEST(test_percentiles);
+  TEST(test_server_stats, make_server_addresses(1, 13730)[0],
+       IoEngineType::THREADS);
+  TEST(test_server_stats, make_server_addresses(1, 13731)[0],
+       IoEngineType::EPOLL);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
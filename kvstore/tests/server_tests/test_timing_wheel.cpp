@@ -0,0 +1,65 @@
+#include <deque>
+#include <map>
+#include <random>
+#include <set>
+
+#include "kvstore/timing_wheel.hpp"
+#include "test_utils/test_utils.hpp"
+
+constexpr uint64_t kResolutionMs = 10;
+constexpr size_t kNumTimers = 20'000;
+
+int main() {
+  // Deadlines spread over every level of the wheel, plus some beyond its
+  // range (which is ~46 hours at this resolution) and some in the past
+  std::mt19937_64 gen(0);
+  std::vector<uint64_t> spans = {0,         1'000,          60'000,
+                                 3'600'000, 2 * 86'400'000, 5 * 86'400'000};
+  uint64_t start = 1'000'000'000;
+  TimingWheel wheel(std::chrono::milliseconds(kResolutionMs), start);
+
+  std::map<std::string, uint64_t> deadlines;
+  std::set<std::pair<uint64_t, std::string>> pending;
+  for (size_t i = 0; i < kNumTimers; i++) {
+    uint64_t span = spans[i % spans.size()];
+    uint64_t deadline = start - 5 + (span ? gen() % span : 0);
+    auto key = std::to_string(i);
+    deadlines[key] = deadline;
+    pending.emplace(deadline, key);
+    wheel.schedule({key, deadline});
+  }
+  ASSERT_EQ(wheel.size(), kNumTimers);
+
+  // Advance in uneven steps; every timer must fire at the first step that
+  // reaches its deadline (rounded up to a tick), and never before it. Timers
+  // that were already due when scheduled fire on the first tick.
+  std::deque<TimingWheel::Timer> due;
+  uint64_t now = start;
+  uint64_t prev = start;
+  uint64_t end = start + 6 * 86'400'000ull;
+  while (now < end) {
+    now += 1 + gen() % (now - start < 120'000 ? 50 : 3'600'000);
+    wheel.advance(now, due);
+    for (auto&& timer : due) {
+      ASSERT_EQ(timer.deadline, deadlines[timer.key]);
+      ASSERT(timer.deadline <= now);
+      uint64_t tick = (timer.deadline + kResolutionMs - 1) / kResolutionMs;
+      ASSERT(tick * kResolutionMs > prev - prev % kResolutionMs ||
+             timer.deadline <= start);
+      pending.erase({timer.deadline, timer.key});
+      deadlines.erase(timer.key);
+    }
+    due.clear();
+    if (!pending.empty()) {
+      uint64_t next_tick =
+          (pending.begin()->first + kResolutionMs - 1) / kResolutionMs;
+      ASSERT(next_tick > now / kResolutionMs ||
+             (pending.begin()->first <= start &&
+              now / kResolutionMs == start / kResolutionMs));
+    }
+    prev = now;
+  }
+
+  ASSERT(deadlines.empty());
+  ASSERT_EQ(wheel.size(), 0u);
+}
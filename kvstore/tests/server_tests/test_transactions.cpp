@@ -0,0 +1,226 @@
+#include <filesystem>
+#include <future>
+#include <string>
+
+#include "client/simple_client.hpp"
+#include "client/transaction.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+constexpr size_t N_SERVERS = 3;
+constexpr size_t kNumThreads = 4;
+constexpr size_t kNumTxnsPerThread = 20;
+// For the servers that settle stalled transactions
+constexpr milliseconds kTxnTimeout = 200ms;
+
+vector<TxnWrites> make_txn(const vector<string>& servers, const string& prefix,
+                           const string& value) {
+  vector<TxnWrites> writes;
+  for (size_t i = 0; i < servers.size(); i++) {
+    string n = to_string(i);
+    writes.push_back(
+        {servers[i], {prefix + "a" + n, prefix + "b" + n}, {value, value}});
+  }
+  return writes;
+}
+
+void test_commit(const vector<string>& servers) {
+  ASSERT(two_phase_commit(make_txn(servers, "commit", "v")));
+  for (size_t i = 0; i < servers.size(); i++) {
+    SimpleClient client(servers[i]);
+    auto values = client.MultiGet(
+        {"commita" + to_string(i), "commitb" + to_string(i)});
+    ASSERT(values);
+    ASSERT_EQ_VECS(*values, (vector<string>{"v", "v"}));
+  }
+}
+
+void test_conflict(const vector<string>& servers) {
+  // A prepared transaction's keys can't be read or written...
+  SimpleClient first(servers[0]);
+  ASSERT(first.Put("conflicta0", "old"));
+  ASSERT(*first.Prepare(1, {"conflicta0"}, {"new"}));
+  ASSERT(!first.Get("conflicta0"));
+  ASSERT(!first.Put("conflicta0", "x"));
+
+  // ... nor prepared by another transaction, which then gives up without
+  // leaving anything behind on the other servers
+  ASSERT(!two_phase_commit(make_txn(servers, "conflict", "v"), 1));
+  SimpleClient second(servers[1]);
+  ASSERT(!second.Get("conflicta1"));
+  ASSERT(second.Put("conflicta1", "free"));
+
+  // Committing applies the writes and unlocks the keys
+  ASSERT(first.Commit(1));
+  ASSERT(first.Get("conflicta0") == "new");
+  // (and committing again is harmless, in case the coordinator retries)
+  ASSERT(first.Commit(1));
+
+  // Aborting drops them
+  ASSERT(*first.Prepare(2, {"conflicta0"}, {"newer"}));
+  ASSERT(first.Abort(2));
+  ASSERT(first.Get("conflicta0") == "new");
+}
+
+// Polls until `done()` holds, for up to a few timeouts.
+template <typename Done>
+bool eventually(Done done) {
+  for (auto deadline = steady_clock::now() + 10 * kTxnTimeout;
+       steady_clock::now() < deadline; this_thread::sleep_for(10ms)) {
+    if (done()) return true;
+  }
+  return done();
+}
+
+void test_stalled_coordinator(const vector<string>& servers) {
+  // A coordinator that stalls after both servers voted yes, for much longer
+  // than the timeout: neither server can tell how the transaction ended, so
+  // they both keep its keys locked, rather than giving up on it
+  SimpleClient a(servers[0]), b(servers[1]);
+  ASSERT(*a.Prepare(10, {"stalla"}, {"v"}, false, servers));
+  ASSERT(*b.Prepare(10, {"stallb"}, {"v"}, false, servers));
+  this_thread::sleep_for(5 * kTxnTimeout);
+  ASSERT(!a.Put("stalla", "x"));
+  ASSERT(!b.Put("stallb", "x"));
+
+  // and it can still commit once the coordinator is back
+  ASSERT(a.Commit(10));
+  ASSERT(b.Commit(10));
+  ASSERT(a.Get("stalla") == "v");
+  ASSERT(b.Get("stallb") == "v");
+}
+
+void test_learn_outcome(const vector<string>& servers) {
+  // A coordinator that dies after telling only one server to commit: the
+  // other learns the outcome from it
+  SimpleClient a(servers[0]), b(servers[1]);
+  ASSERT(*a.Prepare(11, {"learna"}, {"v"}, false, servers));
+  ASSERT(*b.Prepare(11, {"learnb"}, {"v"}, false, servers));
+  ASSERT(a.Commit(11));
+  ASSERT(eventually([&] { return b.Get("learnb") == "v"; }));
+
+  // and likewise for an abort
+  ASSERT(*a.Prepare(12, {"learna"}, {"w"}, false, servers));
+  ASSERT(*b.Prepare(12, {"learnb"}, {"w"}, false, servers));
+  ASSERT(b.Abort(12));
+  ASSERT(eventually([&] { return a.Put("learna", "x"); }));
+  ASSERT(a.Get("learna") == "x");
+}
+
+void test_refuse_unprepared(const vector<string>& servers) {
+  // A coordinator that dies before asking every server to prepare: one that
+  // was never asked refuses the transaction, so the other can abort it
+  SimpleClient a(servers[0]), b(servers[1]);
+  ASSERT(*a.Prepare(13, {"refusea"}, {"v"}, false, servers));
+  ASSERT(eventually([&] { return a.Put("refusea", "x"); }));
+  ASSERT(!a.Commit(13));
+
+  // and votes no if the Prepare turns up after all
+  ASSERT(!*b.Prepare(13, {"refuseb"}, {"v"}, false, servers));
+  ASSERT(b.Put("refuseb", "x"));
+}
+
+void test_restart(const string& addr) {
+  // A vote survives a restart (and the snapshots before it), so the server
+  // still holds the transaction's keys, and can commit it
+  KvServerOptions options;
+  options.io_engine = IoEngineType::EPOLL;
+  options.data_dir = (filesystem::temp_directory_path() /
+                      ("test_transactions_" + random_string(8)))
+                         .string();
+  options.snapshot_interval = 50ms;
+  options.txn_timeout = kTxnTimeout;
+  auto start = [&] {
+    return start_server<KvServer, const string&, uint64_t,
+                        const KvServerOptions&>(addr, 1, options);
+  };
+
+  auto server = start();
+  SimpleClient client(addr);
+  ASSERT(client.Put("durable", "old"));
+  ASSERT(*client.Prepare(14, {"durable"}, {"new"}, false, {addr}));
+  this_thread::sleep_for(200ms);
+  server->stop();
+  server.reset();
+
+  server = start();
+  ASSERT(!client.Get("durable"));
+  ASSERT(client.Commit(14));
+  ASSERT(client.Get("durable") == "new");
+  this_thread::sleep_for(200ms);
+  server->stop();
+  server.reset();
+
+  // and so does the outcome
+  server = start();
+  ASSERT(client.Get("durable") == "new");
+  ASSERT(client.Commit(14));
+  ASSERT(!*client.Prepare(14, {"durable"}, {"newer"}));
+  server->stop();
+  server.reset();
+  filesystem::remove_all(options.data_dir);
+}
+
+void test_concurrent(const vector<string>& servers) {
+  // Transactions that overlap on every key eventually all commit (retrying
+  // on conflicts), and each one's writes land together: all keys end up with
+  // the value of whichever committed last
+  vector<future<bool>> futures;
+  for (size_t t = 0; t < kNumThreads; t++) {
+    futures.push_back(async(launch::async, [&, t] {
+      for (size_t i = 0; i < kNumTxnsPerThread; i++) {
+        string value = to_string(t) + "/" + to_string(i);
+        if (!two_phase_commit(make_txn(servers, "shared", value), 100)) {
+          return false;
+        }
+      }
+      return true;
+    }));
+  }
+  for (auto&& f : futures) ASSERT(f.get());
+
+  optional<string> value = SimpleClient(servers[0]).Get("shareda0");
+  ASSERT(value);
+  for (size_t i = 0; i < servers.size(); i++) {
+    auto values = SimpleClient(servers[i]).MultiGet(
+        {"shareda" + to_string(i), "sharedb" + to_string(i)});
+    ASSERT(values);
+    ASSERT_EQ_VECS(*values, (vector<string>{*value, *value}));
+  }
+}
+
+int main() {
+  vector<string> servers = make_server_addresses(N_SERVERS, 12500);
+  vector<shared_ptr<KvServer>> running;
+  for (auto&& addr : servers) {
+    running.push_back(start_server<KvServer, const string&, uint64_t>(addr, 2));
+  }
+
+  TEST(test_commit, servers);
+  TEST(test_conflict, servers);
+  TEST(test_concurrent, servers);
+  for (auto&& server : running) server->stop();
+
+  // Servers that give up waiting for the coordinator sooner
+  KvServerOptions options;
+  options.io_engine = IoEngineType::EPOLL;
+  options.txn_timeout = kTxnTimeout;
+  vector<string> pair = make_server_addresses(2, 12510);
+  running.clear();
+  for (auto&& addr : pair) {
+    running.push_back(
+        start_server<KvServer, const string&, uint64_t,
+                     const KvServerOptions&>(addr, 1, options));
+  }
+  TEST(test_stalled_coordinator, pair);
+  TEST(test_learn_outcome, pair);
+  TEST(test_refuse_unprepared, pair);
+  for (auto&& server : running) server->stop();
+
+  TEST(test_restart, make_server_addresses(1, 12512)[0]);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
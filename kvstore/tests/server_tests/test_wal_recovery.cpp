@@ -0,0 +1,88 @@
+#include <filesystem>
+#include <fstream>
+
+#include "test_utils/test_utils.hpp"
+
+constexpr std::size_t kRandStringLength = 12;
+constexpr std::size_t kNumKVPairs = 1'000;
+
+int main() {
+  auto dir = std::filesystem::temp_directory_path() /
+             ("test_wal_recovery_" + random_string(8));
+  PersistenceOptions options{dir, SyncPolicy::PER_OP};
+
+  auto keys = make_rand_strs(kNumKVPairs, kRandStringLength);
+  auto vals = make_rand_strs(kNumKVPairs, kRandStringLength);
+
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+
+    // Put the first half, MultiPut the second half
+    ASSERT(put_range(*store, keys, vals, 0, kNumKVPairs / 2));
+    ASSERT(multiput_range(*store, keys, vals, kNumKVPairs / 2, kNumKVPairs,
+                          10));
+
+    // Append to the first key, and delete the second
+    auto append_req = AppendRequest{.key = keys[0], .value = "!"};
+    auto append_res = AppendResponse{};
+    ASSERT(store->Append(&append_req, &append_res));
+    auto del_req = DeleteRequest{.key = keys[1]};
+    auto del_res = DeleteResponse{};
+    ASSERT(store->Delete(&del_req, &del_res));
+  }
+
+  // "Restart" the store; its contents should be recovered from the log
+  vals[0] += "!";
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT(get_range(*store, keys, vals, 2, kNumKVPairs));
+    ASSERT(get_range(*store, keys, vals, 0, 1));
+
+    auto get_req = GetRequest{.key = keys[1]};
+    auto get_res = GetResponse{};
+    ASSERT(!store->Get(&get_req, &get_res));
+    ASSERT_EQ(store->AllKeys().size(), kNumKVPairs - 1);
+  }
+
+  // Simulate a crash in the middle of writing a record: the torn record should
+  // be discarded, and everything before it recovered
+  // No snapshot has been taken, so the whole log is in one segment
+  {
+    auto segment = std::filesystem::directory_iterator(dir)->path();
+    std::ofstream log(segment, std::ios::app | std::ios::binary);
+    log.write("\x20\x00\x00\x00torn", 8);
+  }
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT_EQ(store->AllKeys().size(), kNumKVPairs - 1);
+
+    // ... and the log should still be writable afterwards
+    auto put_req = PutRequest{.key = "hello", .value = "world"};
+    auto put_res = PutResponse{};
+    ASSERT(store->Put(&put_req, &put_res));
+  }
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    auto get_req = GetRequest{.key = "hello"};
+    auto get_res = GetResponse{};
+    ASSERT(store->Get(&get_req, &get_res));
+    ASSERT_EQ(get_res.value, "world");
+  }
+
+  // Stray files that look like segments should be ignored rather than parsed
+  for (auto name : {"wal-backup.log", "wal-.log", "wal-1.log",
+                    "wal-99999999999999999999999.log"}) {
+    std::ofstream(dir / name) << "junk";
+  }
+  {
+    auto store = std::make_unique<ConcurrentKvStore>();
+    ASSERT(store->EnablePersistence(options));
+    ASSERT_EQ(store->AllKeys().size(), kNumKVPairs);
+  }
+
+  std::filesystem::remove_all(dir);
+}
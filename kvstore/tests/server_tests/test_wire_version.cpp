@@ -0,0 +1,181 @@
+#include <random>
+#include <string>
+
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+// Whether a message's body was sent compressed (see the format byte layout in
+// network_messages.cpp).
+bool compressed(const Message& msg) {
+  return uint8_t(msg.buf[0]) & 0x80;
+}
+
+// Sends `req` in `format`, and returns the response along with the raw message
+// and the format it came back in.
+tuple<Response, Message, WireFormat> send(const string& server,
+                                          const Request& req,
+                                          WireFormat format) {
+  auto conn = connect_to_server(server);
+  ASSERT(conn);
+  conn->wire_format = format;
+  ASSERT(conn->send_request(req));
+  Message msg;
+  ASSERT(recv_message(conn->fd, &msg));
+  WireFormat res_format;
+  auto res = deserialize_response(msg, &res_format);
+  ASSERT(res);
+  return {*res, msg, res_format};
+}
+
+void test_formats_round_trip() {
+  // A large, compressible body, and a small one
+  MultiPutRequest large{{"a", string(200, 'k')}, {"", string(3000, 'v')}, 5};
+  MultiPutRequest small{{"a"}, {"b"}};
+  for (auto version : {WireVersion::V1, WireVersion::V2}) {
+    for (bool compression : {false, true}) {
+      WireFormat format{version, compression};
+      for (auto* req : {&large, &small}) {
+        auto msg = serialize_request(*req, format);
+        ASSERT(msg);
+        ASSERT(compressed(*msg) == (compression && req == &large));
+        WireFormat out_format;
+        auto out = deserialize_request(*msg, &out_format);
+        ASSERT(out);
+        ASSERT(out_format == format);
+        auto& out_req = get<MultiPutRequest>(*out);
+        ASSERT_EQ_VECS(out_req.keys, req->keys);
+        ASSERT_EQ_VECS(out_req.values, req->values);
+        ASSERT_EQ(out_req.ttl_ms, req->ttl_ms);
+      }
+    }
+  }
+
+  // Incompressible bodies are sent as they are
+  mt19937 rng(0);
+  string noise(4000, '\0');
+  for (auto& c : noise) c = char(rng());
+  auto msg = serialize_request(PutRequest{"k", noise});
+  ASSERT(!compressed(*msg));
+
+  // Unknown versions and corrupt compressed bodies are rejected
+  msg = serialize_request(GetRequest{"a"});
+  msg->buf[0] = std::byte(0x3f);
+  ASSERT(!deserialize_request(*msg));
+  msg = serialize_request(large);
+  msg->buf.resize(msg->buf.size() / 2);
+  ASSERT(!deserialize_request(*msg));
+}
+
+// Whether `view` points into `msg`'s body.
+bool points_into(string_view view, const Message& msg) {
+  auto* begin = reinterpret_cast<const char*>(msg.buf.data());
+  auto* end = begin + msg.buf.size();
+  return view.data() >= begin && view.data() + view.size() <= end;
+}
+
+void test_read_request_views() {
+  for (auto version : {WireVersion::V1, WireVersion::V2}) {
+    WireFormat format{version, true};
+    auto msg = serialize_request(GetRequest{"key"}, format);
+    WireFormat out_format;
+    auto view = deserialize_read_request(*msg, &out_format);
+    ASSERT(view);
+    ASSERT(out_format == format);
+    auto& get_view = get<GetRequestView>(*view);
+    ASSERT_EQ(get_view.key, "key");
+    ASSERT(points_into(get_view.key, *msg));
+
+    msg = serialize_request(DeleteRequest{"gone"}, format);
+    view = deserialize_read_request(*msg);
+    ASSERT(view);
+    ASSERT_EQ(get<DeleteRequestView>(*view).key, "gone");
+
+    msg = serialize_request(MultiGetRequest{{"a", "", "ccc"}}, format);
+    view = deserialize_read_request(*msg);
+    ASSERT(view);
+    auto& keys = get<MultiGetRequestView>(*view).keys;
+    ASSERT(keys == vector<string_view>({"a", "", "ccc"}));
+    for (auto key : keys) ASSERT(points_into(key, *msg));
+
+    msg = serialize_request(ScanRangeRequest{"from", "to", 7}, format);
+    view = deserialize_read_request(*msg);
+    ASSERT(view);
+    auto& scan_view = get<ScanRangeRequestView>(*view);
+    ASSERT_EQ(scan_view.start, "from");
+    ASSERT_EQ(scan_view.end, "to");
+    ASSERT_EQ(scan_view.limit, 7ul);
+
+    // Other requests, and compressed bodies, need deserialize_request
+    msg = serialize_request(PutRequest{"key", "value"}, format);
+    ASSERT(!deserialize_read_request(*msg));
+    msg = serialize_request(MultiGetRequest{{string(3000, 'k')}}, format);
+    ASSERT(compressed(*msg));
+    ASSERT(!deserialize_read_request(*msg));
+    ASSERT(deserialize_request(*msg));
+  }
+
+  // and so do truncated ones
+  auto msg = serialize_request(GetRequest{"key"});
+  msg->buf.resize(msg->buf.size() - 1);
+  ASSERT(!deserialize_read_request(*msg));
+}
+
+void test_server_answers_in_kind(const string& server) {
+  // The server answers each request in its format, including Gets of hot
+  // keys, whose responses it caches pre-serialized
+  string value(5000, 'v');
+  ASSERT(holds_alternative<PutResponse>(
+      get<0>(send(server, PutRequest{"hot", value}, WIRE_FORMAT))));
+  for (size_t i = 0; i < 20; i++) {
+    for (auto version : {WireVersion::V1, WireVersion::V2}) {
+      for (bool compression : {false, true}) {
+        WireFormat format{version, compression};
+        auto [res, msg, res_format] = send(server, GetRequest{"hot"}, format);
+        ASSERT(res_format == format);
+        ASSERT(compressed(msg) == compression);
+        ASSERT_EQ(get<GetResponse>(res).value, value);
+      }
+    }
+  }
+}
+
+void test_server_reads_views(const string& server) {
+  // Reads the server decodes as views, in every format, and a compressed
+  // MultiGet that it can't
+  string long_key(3000, 'k');
+  ASSERT(holds_alternative<MultiPutResponse>(get<0>(send(
+      server, MultiPutRequest{{"x", "y", long_key}, {"1", "2", "3"}},
+      WIRE_FORMAT))));
+  for (auto version : {WireVersion::V1, WireVersion::V2}) {
+    for (bool compression : {false, true}) {
+      WireFormat format{version, compression};
+      auto res = get<0>(send(server, MultiGetRequest{{"y", "x"}}, format));
+      ASSERT(get<MultiGetResponse>(res).values ==
+             vector<string>({"2", "1"}));
+      res = get<0>(send(server, MultiGetRequest{{long_key}}, format));
+      ASSERT(get<MultiGetResponse>(res).values == vector<string>({"3"}));
+      res = get<0>(send(server, ScanRangeRequest{"x", "z", 0}, format));
+      ASSERT(get<ScanRangeResponse>(res).keys == vector<string>({"x", "y"}));
+    }
+  }
+  auto res = get<0>(send(server, DeleteRequest{"x"}, WIRE_FORMAT));
+  ASSERT_EQ(get<DeleteResponse>(res).value, "1");
+  res = get<0>(send(server, GetRequest{"x"}, WIRE_FORMAT));
+  ASSERT(holds_alternative<ErrorResponse>(res));
+}
+
+int main() {
+  string server = make_server_addresses(1, 12900)[0];
+  auto running = start_server<KvServer, const string&, uint64_t>(server, 1);
+
+  TEST(test_formats_round_trip);
+  TEST(test_read_request_views);
+  TEST(test_server_answers_in_kind, server);
+  TEST(test_server_reads_views, server);
+
+  running->stop();
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,171 @@
+#include <string>
+#include <vector>
+
+#include "client/async_client.hpp"
+#include "client/simple_client.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+constexpr size_t N_KEYS = 2000;
+
+shared_ptr<KvServer> start_async_server(const string& addr) {
+  KvServerOptions options;
+  options.io_engine = IoEngineType::IO_URING;
+  return start_server<KvServer, const string&, uint64_t,
+                      const KvServerOptions&>(addr, 2, options);
+}
+
+// (Results are stored before they're checked, since ASSERT would put the
+// co_await in a condition; see Task.)
+Task<> basic_ops(AsyncClient& client, bool& done) {
+  bool ok = co_await client.Put("a", "1");
+  ASSERT(ok);
+  ok = co_await client.Append("a", "2");
+  ASSERT(ok);
+  optional<string> value = co_await client.Get("a");
+  ASSERT(value == "12");
+  value = co_await client.Get("missing");
+  ASSERT(!value);
+  value = co_await client.Delete("a");
+  ASSERT(value == "12");
+  value = co_await client.Get("a");
+  ASSERT(!value);
+
+  vector<string> keys{"x", "y"};
+  vector<string> expected{"1", "2"};
+  ok = co_await client.MultiPut(keys, expected);
+  ASSERT(ok);
+  optional<vector<string>> values = co_await client.MultiGet(keys);
+  ASSERT(values == expected);
+
+  Request req = GetRequest{"x"};
+  optional<Response> res = co_await client.Send(req);
+  ASSERT(res && get<GetResponse>(*res).value == "1");
+  done = true;
+}
+
+void test_basic_ops(const string& server) {
+  EventLoop loop;
+  AsyncClient client(loop, server);
+  bool done = false;
+  loop.spawn(basic_ops(client, done));
+  loop.run();
+  ASSERT(done);
+  ASSERT(SimpleClient(server).Get("y") == "2");
+}
+
+Task<> update_key(AsyncClient& client, size_t i, size_t& n_done) {
+  string key = "key" + to_string(i);
+  bool ok = co_await client.Put(key, to_string(i));
+  ASSERT(ok);
+  ok = co_await client.Append(key, "!");
+  ASSERT(ok);
+  optional<string> value = co_await client.Get(key);
+  ASSERT(value == to_string(i) + "!");
+  n_done++;
+}
+
+void test_many_in_flight(const vector<string>& servers) {
+  // One thread keeps thousands of requests in flight across both servers
+  EventLoop loop;
+  vector<unique_ptr<AsyncClient>> clients;
+  for (const string& server : servers) {
+    clients.push_back(make_unique<AsyncClient>(loop, server, 2));
+  }
+
+  size_t n_done = 0;
+  for (size_t i = 0; i < N_KEYS; i++) {
+    loop.spawn(update_key(*clients[i % clients.size()], i, n_done));
+  }
+  loop.run();
+  ASSERT_EQ(n_done, N_KEYS);
+
+  for (size_t i = 0; i < N_KEYS; i += 97) {
+    ASSERT(SimpleClient(servers[i % servers.size()])
+               .Get("key" + to_string(i)) == to_string(i) + "!");
+  }
+}
+
+Task<> put(AsyncClient& client) {
+  bool ok = co_await client.Put("a", "1");
+  ASSERT(ok);
+}
+
+Task<> get_or_fail(AsyncClient& client, size_t& n_failed) {
+  optional<string> value = co_await client.Get("a");
+  if (!value) n_failed++;
+}
+
+void test_server_down(const string& addr) {
+  // Nothing listens on `addr`
+  EventLoop loop;
+  AsyncClient client(loop, addr);
+  size_t n_failed = 0;
+  loop.spawn(get_or_fail(client, n_failed));
+  loop.spawn(get_or_fail(client, n_failed));
+  loop.run();
+  ASSERT_EQ(n_failed, size_t(2));
+}
+
+void test_server_stops(const string& addr) {
+  // Requests in flight when the server goes away fail rather than hang
+  auto server = start_async_server(addr);
+  EventLoop loop;
+  AsyncClient client(loop, addr);
+  loop.spawn(put(client));
+  loop.run();
+
+  size_t n_failed = 0;
+  for (int i = 0; i < 10; i++) loop.spawn(get_or_fail(client, n_failed));
+  server->stop();
+  loop.run();
+  ASSERT_EQ(n_failed, size_t(10));
+
+  // and so do later ones
+  loop.spawn(get_or_fail(client, n_failed));
+  loop.run();
+  ASSERT_EQ(n_failed, size_t(11));
+}
+
+Task<> sleep_then_log(EventLoop& loop, EventLoop::Clock::time_point when,
+                      int id, vector<int>& woken) {
+  EventLoop::SleepAwaiter sleep = loop.sleep_until(when);
+  co_await sleep;
+  ASSERT(EventLoop::Clock::now() >= when);
+  woken.push_back(id);
+}
+
+void test_sleep() {
+  // Sleepers wake in deadline order, whatever order they slept in, and one
+  // whose deadline has passed doesn't sleep at all
+  EventLoop loop;
+  auto start = EventLoop::Clock::now();
+  vector<int> woken;
+  loop.spawn(sleep_then_log(loop, start + 30ms, 3, woken));
+  loop.spawn(sleep_then_log(loop, start + 10ms, 1, woken));
+  loop.spawn(sleep_then_log(loop, start - 10ms, 0, woken));
+  loop.spawn(sleep_then_log(loop, start + 20ms, 2, woken));
+  ASSERT_EQ_VECS(woken, vector<int>{0});
+  loop.run();
+  ASSERT_EQ_VECS(woken, (vector<int>{0, 1, 2, 3}));
+  ASSERT(EventLoop::Clock::now() - start < 1s);
+}
+
+int main() {
+  vector<string> addrs = make_server_addresses(2, 13700);
+  vector<shared_ptr<KvServer>> servers;
+  for (const string& addr : addrs) servers.push_back(start_async_server(addr));
+
+  TEST(test_basic_ops, addrs[0]);
+  TEST(test_many_in_flight, addrs);
+  for (auto&& server : servers) server->stop();
+
+  TEST(test_server_down, make_server_addresses(1, 13702)[0]);
+  TEST(test_server_stops, make_server_addresses(1, 13703)[0]);
+  TEST(test_sleep);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
@@ -0,0 +1,64 @@
+#include <random>
+#include <string>
+
+#include "common/shard.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+constexpr size_t N_SHARDS = 7;
+constexpr size_t kNumRanges = 2'000;
+constexpr size_t kNumKeysPerRange = 200;
+
+const string kKeyChars =
+    "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+string random_key(mt19937& gen) {
+  string key;
+  for (size_t i = 0, n = 1 + gen() % 4; i < n; i++) {
+    key += kKeyChars[gen() % kKeyChars.size()];
+  }
+  return key;
+}
+
+int main() {
+  // ShardKvClient::ScanRange skips the servers whose shards don't overlap the
+  // range, so a shard holding a key in the range must never be skipped
+  mt19937 gen(0);
+  vector<Shard> shards = split_into(N_SHARDS);
+  size_t skipped = 0;
+  for (size_t i = 0; i < kNumRanges; i++) {
+    string start = random_key(gen), end = i % 10 ? random_key(gen) : "";
+    if (!end.empty() && end < start) swap(start, end);
+
+    for (auto&& shard : shards) {
+      if (may_overlap(shard, start, end)) continue;
+      skipped++;
+      for (size_t j = 0; j < kNumKeysPerRange; j++) {
+        string key = start + random_key(gen);
+        if (j % 2) key = random_key(gen);
+        if (key < start || (!end.empty() && key >= end)) continue;
+        ASSERT(!shard.contains(to_upper(key)));
+      }
+    }
+  }
+  // ... while still skipping most of them for narrow ranges
+  ASSERT(skipped > kNumRanges);
+
+  // A range within one shard overlaps it, and at most its neighbours (the
+  // bounds only constrain a key's characters up to where they differ)
+  string lower = shards[3].lower, upper = shards[3].upper;
+  for (size_t i = 0; i < N_SHARDS; i++) {
+    bool overlaps = may_overlap(shards[i], lower, upper);
+    if (i == 3) ASSERT(overlaps);
+    if (i < 2 || i > 4) ASSERT(!overlaps);
+  }
+  // Empty ranges overlap nothing
+  for (auto&& shard : shards) {
+    ASSERT(!may_overlap(shard, "B1", "B"));
+  }
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}
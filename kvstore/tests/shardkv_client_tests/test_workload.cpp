@@ -0,0 +1,108 @@
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "client/workload.hpp"
+#include "test_utils/test_utils.hpp"
+
+// for simplicity
+using namespace std;
+
+constexpr int N_SAMPLES = 200000;
+
+void test_zipfian() {
+  // P(rank r) is (1 / (r + 1)^theta) / zeta(n, theta)
+  ZipfianGenerator zipfian(1000, 0.99);
+  mt19937_64 rng(1);
+  vector<int> counts(1000, 0);
+  for (int i = 0; i < N_SAMPLES; i++) {
+    uint64_t rank = zipfian.next(rng);
+    ASSERT(rank < 1000);
+    counts[rank]++;
+  }
+
+  double zeta = 0;
+  for (int r = 1; r <= 1000; r++) zeta += 1 / pow(r, 0.99);
+  for (int r : {0, 1, 9}) {
+    double expected = N_SAMPLES / pow(r + 1, 0.99) / zeta;
+    ASSERT(abs(counts[r] - expected) < expected * 0.05);
+  }
+  // The top 1% of keys get a large share of requests, the bottom half little
+  int top = 0, bottom = 0;
+  for (int r = 0; r < 10; r++) top += counts[r];
+  for (int r = 500; r < 1000; r++) bottom += counts[r];
+  ASSERT(top > N_SAMPLES * 0.35);
+  ASSERT(bottom < N_SAMPLES * 0.15);
+}
+
+void test_mix() {
+  // Each workload's operations come in its proportions
+  map<char, map<OpKind, double>> expected{
+      {'a', {{OpKind::READ, 0.5}, {OpKind::UPDATE, 0.5}}},
+      {'b', {{OpKind::READ, 0.95}, {OpKind::UPDATE, 0.05}}},
+      {'c', {{OpKind::READ, 1}}},
+      {'d', {{OpKind::READ, 0.95}, {OpKind::INSERT, 0.05}}},
+      {'e', {{OpKind::SCAN, 0.95}, {OpKind::INSERT, 0.05}}},
+      {'f', {{OpKind::READ, 0.5}, {OpKind::READ_MODIFY_WRITE, 0.5}}},
+  };
+  mt19937_64 rng(2);
+  for (auto&& [name, fractions] : expected) {
+    optional<WorkloadSpec> spec = ycsb_workload(name);
+    ASSERT(spec);
+    Workload workload(*spec, 1000);
+    map<OpKind, int> counts;
+    for (int i = 0; i < N_SAMPLES / 10; i++) {
+      Workload::Op op = workload.next(rng);
+      counts[op.kind]++;
+      if (op.kind == OpKind::SCAN) {
+        ASSERT(op.scan_length >= 1);
+        ASSERT(op.scan_length <= Workload::MAX_SCAN_LENGTH);
+      }
+    }
+    for (auto&& [kind, n] : counts) {
+      ASSERT(fractions.count(kind));
+      ASSERT(abs(n - fractions[kind] * N_SAMPLES / 10) < N_SAMPLES / 100);
+    }
+  }
+  ASSERT(!ycsb_workload('g'));
+}
+
+void test_keys() {
+  // Inserts add new keys, which reads then pick from, the latest most often
+  WorkloadSpec spec = *ycsb_workload('d');
+  Workload workload(spec, 100);
+  mt19937_64 rng(3);
+  set<string> loaded;
+  for (uint64_t i = 0; i < 100; i++) loaded.insert(Workload::key(i));
+  ASSERT_EQ(loaded.size(), 100ul);
+
+  set<string> inserted;
+  map<string, int> reads;
+  for (int i = 0; i < N_SAMPLES / 10; i++) {
+    Workload::Op op = workload.next(rng);
+    if (op.kind == OpKind::INSERT) {
+      ASSERT(!loaded.count(op.key));
+      ASSERT(inserted.insert(op.key).second);
+    } else {
+      ASSERT(loaded.count(op.key) || inserted.count(op.key));
+      reads[op.key]++;
+    }
+  }
+  ASSERT(!inserted.empty());
+  // The most read key is one of the inserted ones
+  auto most_read = max_element(
+      reads.begin(), reads.end(),
+      [](auto& a, auto& b) { return a.second < b.second; });
+  ASSERT(inserted.count(most_read->first));
+}
+
+int main() {
+  TEST(test_zipfian);
+  TEST(test_mix);
+  TEST(test_keys);
+
+  cout_color(GREEN, "Test passed!");
+  return 0;
+}